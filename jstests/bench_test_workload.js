@@ -0,0 +1,69 @@
+// benchRun workloads and transaction ops
+
+t = db.bench_test_workload
+t.drop();
+
+function withAuth( benchArgs ) {
+    if (jsTest.options().auth) {
+        benchArgs['db'] = 'admin';
+        benchArgs['username'] = jsTest.options().adminUser;
+        benchArgs['password'] = jsTest.options().adminPassword;
+    }
+    return benchArgs;
+}
+
+// workload a, loaded by benchRun with the bulk loader, in transactions of 5 ops
+res = benchRun( withAuth( { workload : { type : "a" ,
+                                         ns : t.getFullName() ,
+                                         recordCount : 500 ,
+                                         load : true ,
+                                         bulkLoad : true ,
+                                         fieldCount : 4 ,
+                                         fieldLength : 10 ,
+                                         transactionSize : 5 } ,
+                            parallel : 2 ,
+                            seconds : 2 ,
+                            host : db.getMongo().host } ) );
+printjson( res );
+
+assert.eq( 500 , t.count() );
+assert.eq( 5 , Object.keySet( t.findOne() ).length );
+assert.lt( 0 , res.loadSeconds );
+assert.lt( 0 , res.latencies.findOne.count );
+assert.lt( 0 , res.latencies.update.count );
+assert.lte( res.latencies.update.p50 , res.latencies.update.max );
+assert.lt( 0 , res.latencies.commitTransaction.count );
+assert.lte( 2 , res.opsPerSecond.length );
+
+// workload e, on the records already there
+res = benchRun( withAuth( { workload : { type : "e" ,
+                                         ns : t.getFullName() ,
+                                         recordCount : 500 ,
+                                         fieldCount : 4 ,
+                                         fieldLength : 10 ,
+                                         maxScanLength : 10 } ,
+                            parallel : 2 ,
+                            seconds : 1 ,
+                            host : db.getMongo().host } ) );
+printjson( res );
+
+assert.lt( 0 , res.latencies.query.count );
+assert.lt( 500 , t.count() );
+assert.eq( t.count() - 500 , res.latencies.insert.count );
+
+// transaction ops in an op list: the rolled back inserts never show up
+t.drop();
+res = benchRun( withAuth( { ops : [ { ns : t.getFullName() , op : "beginTransaction" } ,
+                                    { ns : t.getFullName() , op : "insert" , doc : { x : 1 } } ,
+                                    { ns : t.getFullName() , op : "commitTransaction" } ,
+                                    { ns : t.getFullName() , op : "beginTransaction" } ,
+                                    { ns : t.getFullName() , op : "insert" , doc : { x : 2 } } ,
+                                    { ns : t.getFullName() , op : "rollbackTransaction" } ] ,
+                            parallel : 1 ,
+                            seconds : 1 ,
+                            host : db.getMongo().host } ) );
+printjson( res );
+
+assert.lt( 0 , res.latencies.commitTransaction.count );
+assert.lt( 0 , t.count( { x : 1 } ) );
+assert.eq( 0 , t.count( { x : 2 } ) );
@@ -0,0 +1,52 @@
+// test changing the compression, pageSize and readPageSize of existing indexes
+
+t = db.change_index_attributes;
+t.drop();
+
+t.insert({_id: 1, a: 1});
+t.ensureIndex({a: 1}, {compression: "zlib"});
+
+function indexStats(name) {
+    var stats = t.stats();
+    for (var i = 0; i < stats.indexDetails.length; i++) {
+        if (stats.indexDetails[i].name == name) {
+            return stats.indexDetails[i];
+        }
+    }
+    assert(false, "no stats for index " + name);
+}
+
+assert.commandWorked(t.changeIndexAttributes("a_1", {compression: "lzma", pageSize: 1000000}));
+assert.eq("lzma", indexStats("a_1").compression);
+assert.eq(1000000, indexStats("a_1").pageSize);
+assert.eq(65536, indexStats("a_1").readPageSize);
+assert.eq("zlib", indexStats("_id_").compression);
+assert.eq(1, indexStats("a_1").count);
+assert(indexStats("a_1").compressionRatio >= 0);
+
+// the new attributes are persisted in the index info
+idx = db.system.indexes.findOne({ns: t.getFullName(), name: "a_1"});
+assert.eq("lzma", idx.compression);
+assert.eq(1000000, idx.pageSize);
+
+// indexes may also be named by key pattern, or all at once with "*"
+assert.commandWorked(t.changeIndexAttributes({a: 1}, {readPageSize: 32768}));
+assert.eq(32768, indexStats("a_1").readPageSize);
+assert.commandWorked(t.changeIndexAttributes("*", {compression: "quicklz"}));
+assert.eq("quicklz", indexStats("_id_").compression);
+assert.eq("quicklz", indexStats("a_1").compression);
+assert.eq(2, db.system.indexes.find({ns: t.getFullName(), compression: "quicklz"}).itcount());
+
+// bad requests change nothing
+assert.commandFailed(t.changeIndexAttributes("nosuchindex", {compression: "lzma"}));
+assert.commandFailed(t.changeIndexAttributes("a_1", {compression: "bogus"}));
+assert.commandFailed(t.changeIndexAttributes("a_1", {pageSize: -1}));
+assert.commandFailed(t.changeIndexAttributes("a_1", {}));
+assert.eq("quicklz", indexStats("a_1").compression);
+assert.eq(1000000, indexStats("a_1").pageSize);
+
+// data written before and after the change is all still there
+t.insert({_id: 2, a: 2});
+assert.eq(2, t.find().hint({a: 1}).itcount());
+
+t.drop();
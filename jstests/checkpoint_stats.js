@@ -0,0 +1,42 @@
+// serverStatus reports what each recent checkpoint cost, newest first
+
+var t = db.jstests_checkpoint_stats;
+t.drop();
+
+var a = db.getSisterDB( "admin" );
+
+var before = db.serverStatus().checkpoints;
+assert( before , "no checkpoints section in serverStatus" );
+assert.eq( 0 , before.targetBandwidth );
+
+for ( var i = 0; i < 1000; i++ ) {
+    t.insert( { _id : i , s : "dirty some nodes" } );
+}
+assert.eq( null , db.getLastError() );
+assert.commandWorked( a.runCommand( { checkpoint : 1 } ) );
+
+var after = db.serverStatus().checkpoints;
+assert.lt( before.count , after.count , tojson( after ) );
+assert.lte( before.totalMillis , after.totalMillis );
+assert.lt( 0 , after.history.length );
+assert.lte( after.history.length , 20 );
+
+var cp = after.history[ 0 ];
+assert( cp.requested , tojson( cp ) );
+assert( cp.start instanceof Date , tojson( cp ) );
+assert.lte( 0 , cp.millis , tojson( cp ) );
+[ "beginMicros" , "bytesWritten" , "uncompressedBytesWritten" , "nodesWritten" ].forEach( function( f ) {
+    assert( typeof( cp[ f ] ) == "number" , f + ": " + tojson( cp ) );
+} );
+for ( var j = 1; j < after.history.length; j++ ) {
+    assert.lte( after.history[ j ].start , after.history[ j - 1 ].start , tojson( after.history ) );
+}
+
+// pacing to a target bandwidth can be turned on and off while running
+assert.commandFailed( a.runCommand( { setParameter : 1 , checkpointTargetBandwidth : -1 } ) );
+assert.commandWorked( a.runCommand( { setParameter : 1 , checkpointTargetBandwidth : 16 * 1024 * 1024 } ) );
+assert.eq( 16 * 1024 * 1024 , db.serverStatus().checkpoints.targetBandwidth );
+assert.commandWorked( a.runCommand( { setParameter : 1 , checkpointTargetBandwidth : 0 } ) );
+assert.eq( 0 , db.serverStatus().checkpoints.targetBandwidth );
+
+t.drop();
@@ -0,0 +1,55 @@
+// DDL (drop, ensureIndex, dropIndexes, renameCollection) locks just the
+// collections it changes, and serverStatus reports each collection's lock.
+
+var dbname = "jstests_collection_locks";
+var d = db.getSiblingDB( dbname );
+var admin = db.getSiblingDB( "admin" );
+d.dropDatabase();
+
+d.a.insert( { x: 1, y: 1 } );
+d.b.insert( { x: 1 } );
+assert.eq( 1, d.a.count() );
+assert.eq( 1, d.b.count() );
+
+// foreground and background index builds
+d.a.ensureIndex( { x: 1 } );
+assert.isnull( d.getLastError() );
+d.a.ensureIndex( { y: 1 }, { background: true } );
+assert.isnull( d.getLastError() );
+assert.eq( 3, d.a.getIndexes().length );
+
+// an index on a collection that doesn't exist yet creates it
+d.c.ensureIndex( { x: 1 } );
+assert.isnull( d.getLastError() );
+assert.eq( 2, d.c.getIndexes().length );
+
+assert.commandWorked( d.a.dropIndex( { x: 1 } ) );
+assert.eq( 2, d.a.getIndexes().length );
+
+// rename within a database, onto an existing collection, and across databases
+assert.commandWorked( admin.runCommand( { renameCollection: dbname + ".b", to: dbname + ".d" } ) );
+assert.eq( 0, d.b.count() );
+assert.eq( 1, d.d.count() );
+assert.commandFailed( admin.runCommand( { renameCollection: dbname + ".d", to: dbname + ".c" } ) );
+assert.commandWorked( admin.runCommand( { renameCollection: dbname + ".d", to: dbname + ".c", dropTarget: true } ) );
+assert.eq( 1, d.c.count() );
+assert.eq( 1, d.c.getIndexes().length );
+var other = db.getSiblingDB( dbname + "_other" );
+other.dropDatabase();
+assert.commandWorked( admin.runCommand( { renameCollection: dbname + ".c", to: other.getName() + ".c" } ) );
+assert.eq( 1, other.c.count() );
+other.dropDatabase();
+
+assert( d.a.drop() );
+assert( !d.a.drop() );
+assert.eq( 0, d.a.count() );
+
+var locks = db.serverStatus().locks[dbname];
+assert( locks.collections, tojson( locks ) );
+var a = locks.collections[dbname + ".a"];
+assert( a, tojson( locks.collections ) );
+assert( "w" in a.timeLockedMicros, tojson( a ) );
+assert( "r" in a.timeLockedMicros, tojson( a ) );
+assert( "w" in a.timeAcquiringMicros, tojson( a ) );
+
+d.dropDatabase();
@@ -0,0 +1,43 @@
+// Secondary index keys embed the primary key, so queries and projections on
+// the index fields plus the primary key are answered without reading documents.
+
+t = db["jstests_coveredIndex6"];
+t.drop();
+
+for (i = 0; i < 20; i++) {
+    t.save({_id: i, a: i % 5, b: i});
+}
+t.ensureIndex({a: 1});
+
+// matching on _id as well as the key doesn't need the document
+explain = t.find({a: 2, _id: {$gte: 10}}, {a: 1}).hint({a: 1}).explain();
+assert.eq(true, explain.indexOnly, "Find is not using covered index");
+assert.eq(2, explain.n);
+assert.eq(0, explain.nscannedObjects, "Matching on _id loaded documents");
+arr = t.find({a: 2, _id: {$gte: 10}}, {a: 1}).hint({a: 1}).toArray();
+assert.eq(2, arr.length);
+for (i = 0; i < arr.length; i++) {
+    assert.eq(2, arr[i].a);
+    assert.eq(undefined, arr[i].b);
+    assert.gte(arr[i]._id, 10);
+}
+
+// a query on the key alone still matches off the key
+explain = t.find({a: {$in: [1, 2]}}, {a: 1}).hint({a: 1}).explain();
+assert.eq(8, explain.n);
+assert.eq(0, explain.nscannedObjects, "Matching on the key loaded documents");
+
+// projecting only the _id comes from the pk too
+arr = t.find({a: 3}, {_id: 1}).hint({a: 1}).toArray();
+assert.eq(4, arr.length);
+for (i = 0; i < arr.length; i++) {
+    assert.eq(3, arr[i]._id % 5);
+    assert.eq(undefined, arr[i].a);
+}
+
+// a field that is in neither the key nor the pk still loads documents
+explain = t.find({a: 2, b: {$gte: 10}}, {a: 1}).hint({a: 1}).explain();
+assert.eq(2, explain.n);
+assert.lt(0, explain.nscannedObjects);
+
+t.drop();
@@ -0,0 +1,38 @@
+// hashed indexes with hashVersion 1 hash their keys with MurmurHash3
+
+var t = db.hashindex_murmur;
+t.drop();
+
+// an unknown version is refused
+t.ensureIndex({a: "hashed"}, {hashVersion: 7});
+assert(db.getLastError(), "unknown hashVersion accepted");
+assert.eq(0, t.getIndexes().length, "no index should be created");
+
+t.ensureIndex({a: "hashed"}, {hashVersion: 1});
+assert(!db.getLastError());
+assert.eq(2, t.getIndexes().length, "hashed index didn't get created");
+
+for (i = 0; i < 100; i++) {
+    t.insert({a: i});
+}
+t.insert({a: 3.1});
+t.insert({a: "3"});
+assert.eq(102, t.find().hint({a: "hashed"}).itcount());
+assert.eq(1, t.find({a: 3}).hint({a: "hashed"}).itcount());
+assert.eq(3.1, t.find({a: 3.1}).hint({a: "hashed"}).next().a);
+assert.eq("3", t.find({a: "3"}).hint({a: "hashed"}).next().a);
+assert.eq("IndexCursor a_hashed", t.find({a: 5}).explain().cursor);
+
+// the index holds the version 1 hashes
+var h0 = db.runCommand({_hashBSONElement: 5, seed: 0});
+var h1 = db.runCommand({_hashBSONElement: 5, seed: 0, hashVersion: 1});
+assert.commandWorked(h1);
+assert.eq(1, h1.hashVersion);
+assert.neq(h0.out, h1.out);
+assert.eq(1, t.find({a: 5}).hint({a: "hashed"}).itcount());
+assert(!db.runCommand({_hashBSONElement: 5, hashVersion: 7}).ok);
+
+// numbers still squash, so 5 and 5.0 share a key
+assert.eq(h1.out, db.runCommand({_hashBSONElement: 5.0, hashVersion: 1}).out);
+
+t.drop();
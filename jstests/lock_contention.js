@@ -0,0 +1,80 @@
+// the lockContention profiler records row lock waits by namespace, index and query pattern
+
+var t = db.jstests_lock_contention;
+t.drop();
+t.insert( { _id : 0 } );  // prevent mvcc dictionary too new
+assert.eq( null , db.getLastError() );
+
+var a = db.getSisterDB( "admin" );
+
+assert.commandFailed( a.runCommand( { lockContention : 1 , sampleMillis : 0 } ) );
+assert.commandFailed( a.runCommand( { lockContention : 1 , thresholdMillis : -1 } ) );
+
+var r = a.runCommand( { lockContention : 1 , enable : true , reset : true ,
+                        thresholdMillis : 0 , sampleMillis : 5 } );
+assert.commandWorked( r );
+assert( r.enabled , "profiler didn't turn on" );
+assert.eq( 0 , r.contention.length );
+
+// hold the lock on _id 1 while another connection waits for it until lockTimeout
+assert.commandWorked( db.beginTransaction() );
+t.insert( { _id : 1 } );
+assert.eq( null , db.getLastError() );
+
+var waiter = startParallelShell( 'db.jstests_lock_contention.insert( { _id : 1 } );' +
+                                 'assert.neq( null , db.getLastError() );' );
+waiter();
+db.rollbackTransaction();
+sleep( 100 );  // let the sampler see the wait is over
+
+r = a.runCommand( { lockContention : 1 , enable : false } );
+assert.commandWorked( r );
+assert( ! r.enabled , "profiler didn't turn off" );
+
+var found = null;
+r.contention.forEach( function( e ) {
+    if ( e.ns == t.getFullName() && e.index == "_id_" ) {
+        found = e;
+    }
+} );
+assert( found , tojson( r ) );
+// a timeout is only counted as a timeout, not also as a wait
+assert.eq( 1 , found.timeouts , tojson( found ) );
+assert.eq( 0 , found.waits.count , tojson( found ) );
+assert.neq( 0 , found.last.blockingTxnid , tojson( found ) );
+assert.neq( found.last.blockedTxnid , found.last.blockingTxnid , tojson( found ) );
+assert.eq( 2 , found.last.bounds.length , tojson( found ) );
+assert.eq( 1 , r.recent.filter( function( w ) { return w.blockedTxnid == found.last.blockedTxnid; } ).length ,
+           tojson( r.recent ) );
+
+// a wait that ends in the lock being granted is counted as a wait
+assert.commandWorked( a.runCommand( { lockContention : 1 , enable : true , reset : true ,
+                                      thresholdMillis : 0 , sampleMillis : 5 } ) );
+assert.commandWorked( db.beginTransaction() );
+t.insert( { _id : 2 } );
+assert.eq( null , db.getLastError() );
+waiter = startParallelShell( 'db.jstests_lock_contention.insert( { _id : 2 } );' +
+                             'assert.eq( null , db.getLastError() );' );
+sleep( 500 );
+db.rollbackTransaction();
+waiter();
+sleep( 100 );
+
+r = a.runCommand( { lockContention : 1 , enable : false } );
+assert.commandWorked( r );
+found = null;
+r.contention.forEach( function( e ) {
+    if ( e.ns == t.getFullName() && e.index == "_id_" ) {
+        found = e;
+    }
+} );
+assert( found , tojson( r ) );
+assert.eq( 0 , found.timeouts , tojson( found ) );
+assert.eq( 1 , found.waits.count , tojson( found ) );
+
+// reset forgets everything
+r = a.runCommand( { lockContention : 1 , reset : true , limit : 0 } );
+assert.eq( 0 , r.contention.length );
+assert.eq( 0 , r.recent.length );
+
+t.drop();
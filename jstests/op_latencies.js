@@ -0,0 +1,39 @@
+// latency histograms in serverStatus and top
+
+t = db.jstests_op_latencies;
+t.drop();
+
+for ( i = 0; i < 100; i++ ) {
+    t.insert( { _id : i } );
+}
+db.getLastError();
+for ( i = 0; i < 50; i++ ) {
+    t.findOne( { _id : i } );
+}
+
+s = db.serverStatus().opLatencies;
+assert( s , "no opLatencies in serverStatus" );
+assert.lte( 100 , s.insert.count , "insert count" );
+assert.lte( 50 , s.queries.count , "query count" );
+assert.lte( s.queries.p50 , s.queries.p99 , "percentiles out of order" );
+assert.lte( s.queries.p99 , s.queries.max , "p99 above max" );
+assert.isnull( s.queries.buckets , "serverStatus shouldn't have buckets" );
+
+l = db.adminCommand( { top : 1 , latencies : true } );
+assert.commandWorked( l );
+c = l.latencies.namespaces[ t.getFullName() ];
+assert( c , "no latencies for " + t.getFullName() );
+assert.eq( 100 , c.insert.count , "collection insert count" );
+assert.eq( 50 , c.queries.count , "collection query count" );
+
+total = 0;
+c.queries.buckets.forEach( function( b ) { total += b[1]; } );
+assert.eq( c.queries.count , total , "buckets don't add up" );
+
+assert( ! db.adminCommand( { top : 1 } ).latencies , "latencies without asking" );
+
+// a dropped collection starts over
+t.drop();
+l = db.adminCommand( { top : 1 , latencies : true } );
+assert( ! l.latencies.namespaces[ t.getFullName() ] || ! l.latencies.namespaces[ t.getFullName() ].insert ,
+        "latencies survived drop" );
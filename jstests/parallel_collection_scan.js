@@ -0,0 +1,105 @@
+// parallelCollectionScan hands out cursors over disjoint ranges of the primary key, all
+// reading one snapshot
+
+var t = db.jstests_parallel_collection_scan;
+t.drop();
+
+var s = "x";
+while ( s.length < 1000 ) {
+    s += s;
+}
+var N = 10000;
+for ( var i = 0; i < N; i++ ) {
+    t.insert( { _id : i , s : s } );
+}
+assert.eq( null , db.getLastError() );
+
+assert.commandFailed( db.runCommand( { parallelCollectionScan : t.getName() } ) );
+assert.commandFailed( db.runCommand( { parallelCollectionScan : t.getName() , numCursors : 0 } ) );
+assert.commandFailed( db.runCommand( { parallelCollectionScan : "jstests_parallel_collection_scan_none" ,
+                                       numCursors : 4 } ) );
+
+function readAll( cursors ) {
+    var seen = {};
+    var n = 0;
+    cursors.forEach( function( c ) {
+        var last = null;
+        while ( c.hasNext() ) {
+            var id = c.next()._id;
+            assert( ! seen[ id ] , "saw " + id + " twice" );
+            if ( last != null ) {
+                assert.lt( last , id , "out of order" );
+            }
+            seen[ id ] = true;
+            last = id;
+            n++;
+        }
+    } );
+    return n;
+}
+
+var res = db.runCommand( { parallelCollectionScan : t.getName() , numCursors : 4 } );
+assert.commandWorked( res );
+assert.gte( 4 , res.cursors.length );
+assert.lte( 1 , res.cursors.length );
+res.cursors.forEach( function( c , i ) {
+    assert.eq( i > 0 , "min" in c.range , tojson( c ) );
+    assert.eq( i < res.cursors.length - 1 , "max" in c.range , tojson( c ) );
+    if ( i > 0 ) {
+        assert.eq( res.cursors[ i - 1 ].range.max._id , c.range.min._id );
+    }
+} );
+
+// everything is read once, as of the command, whatever happens after it
+var cursors = res.cursors.map( function( c ) { return new DBCommandCursor( db.getMongo() , c ); } );
+t.insert( { _id : N , s : s } );
+t.remove( { _id : 0 } );
+assert.eq( null , db.getLastError() );
+assert.eq( N , readAll( cursors ) );
+
+assert.eq( N , readAll( t.parallelCollectionScan( 1 ) ) );
+assert.eq( N , readAll( t.parallelCollectionScan( 16 ) ) );
+
+// abandoned cursors don't keep the others from finishing
+cursors = t.parallelCollectionScan( 4 );
+assert.eq( N , readAll( cursors ) );
+cursors = t.parallelCollectionScan( 4 );
+cursors[ 0 ].next();
+assert.eq( N , t.count() );
+
+// in a multi-statement transaction, other connections read the cursors in its snapshot
+var other = new Mongo( db.getMongo().host ).getDB( db.getName() );
+assert.commandWorked( db.beginTransaction() );
+res = db.runCommand( { parallelCollectionScan : t.getName() , numCursors : 4 } );
+assert.commandWorked( res );
+other.jstests_parallel_collection_scan.insert( { _id : N + 1 , s : s } );
+assert.eq( null , other.getLastError() );
+assert.eq( N , readAll( res.cursors.map( function( c ) { return new DBCommandCursor( other.getMongo() , c ); } ) ) );
+assert.commandWorked( db.commitTransaction() );
+assert.eq( N + 1 , t.count() );
+
+// the cursors go with the transaction, even if another connection is reading them
+assert.commandWorked( db.runCommand( { beginTransaction : 1 , readOnly : true } ) );
+res = db.runCommand( { parallelCollectionScan : t.getName() , numCursors : 4 } );
+assert.commandWorked( res );
+assert.commandWorked( db.rollbackTransaction() );
+res.cursors.forEach( function( c ) {
+    var cursor = new DBCommandCursor( other.getMongo() , c );
+    assert.throws( function() { cursor.hasNext(); } , [] , tojson( c ) );
+} );
+
+// partitioned collections split across their partitions
+var p = db.jstests_parallel_collection_scan_partitioned;
+p.drop();
+assert.commandWorked( db.runCommand( { create : p.getName() , partitioned : true } ) );
+for ( var i = 0; i < 1000; i++ ) {
+    p.insert( { _id : i , s : s } );
+    if ( i % 250 == 249 ) {
+        assert.commandWorked( p.addPartition() );
+    }
+}
+assert.eq( null , db.getLastError() );
+assert.eq( 1000 , readAll( p.parallelCollectionScan( 3 ) ) );
+
+p.drop();
+t.drop();
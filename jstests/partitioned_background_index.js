@@ -0,0 +1,63 @@
+// background index builds on partitioned collections index every partition side by side,
+// while writes go on
+
+var t = db.jstests_partitioned_background_index;
+t.drop();
+assert.commandWorked( db.runCommand( { create : t.getName() , partitioned : true } ) );
+
+var N = 40000;
+for ( var i = 0; i < N; i++ ) {
+    t.insert( { _id : i , a : i % 100 , b : [ i , -i ] } );
+    if ( i % 10000 == 9999 ) {
+        assert.commandWorked( t.addPartition() );
+    }
+}
+assert.eq( null , db.getLastError() );
+var numPartitions = t.getPartitionInfo().numPartitions;
+assert.lt( 1 , numPartitions );
+
+// unique and special indexes are refused in the background too
+t.ensureIndex( { a : 1 } , { unique : true , background : true } );
+assert.neq( null , db.getLastError() );
+t.ensureIndex( { a : "hashed" } , { background : true } );
+assert.neq( null , db.getLastError() );
+
+var builder = startParallelShell( 'db.jstests_partitioned_background_index.ensureIndex( { a : 1 } , { background : true } );' +
+                                  'assert.eq( null , db.getLastError() );' +
+                                  'db.jstests_partitioned_background_index.ensureIndex( { b : 1 } , { background : true } );' +
+                                  'assert.eq( null , db.getLastError() );' );
+
+// writes land in every partition while the build goes on
+var sawProgress = false;
+for ( var i = N; i < N + 2000; i++ ) {
+    t.insert( { _id : i , a : i % 100 , b : [ i , -i ] } );
+    t.update( { _id : i - N } , { $set : { a : 1000 } } );
+    if ( i % 100 == 0 ) {
+        db.currentOp().inprog.forEach( function( op ) {
+            if ( op.msg && op.msg.indexOf( "hot build" ) >= 0 ) {
+                assert.eq( numPartitions * 1000 , op.progress.total , tojson( op ) );
+                sawProgress = true;
+            }
+        } );
+    }
+}
+assert.eq( null , db.getLastError() );
+builder();
+print( "saw hot index build progress in currentOp: " + sawProgress );
+
+assert.eq( 3 , t.getIndexes().length );
+assert.eq( 11 , t.find( { b : { $gte : -10 , $lte : 10 } } ).hint( { b : 1 } ).itcount() );
+assert.eq( 2000 , t.find( { a : 1000 } ).hint( { a : 1 } ).itcount() );
+for ( var a = 0; a < 100; a += 7 ) {
+    assert.eq( t.find( { a : a } ).hint( { _id : 1 } ).itcount() ,
+               t.find( { a : a } ).hint( { a : 1 } ).itcount() , "a: " + a );
+}
+assert.eq( 1 , t.find( { b : -( N + 1 ) } ).hint( { b : 1 } ).itcount() );
+
+// partitions added after the build have the index too
+assert.commandWorked( t.addPartition() );
+t.insert( { _id : N * 2 , a : 5000 } );
+assert.eq( null , db.getLastError() );
+assert.eq( 1 , t.find( { a : 5000 } ).hint( { a : 1 } ).itcount() );
+
+t.drop();
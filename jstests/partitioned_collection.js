@@ -0,0 +1,109 @@
+// test partitioned collections: routing by _id, queries across partitions,
+// secondary indexes, and dropping the oldest partition
+
+t = db.partitioned_collection;
+t.drop();
+
+assert.commandWorked(db.runCommand({create: t.getName(), partitioned: true}));
+info = t.getPartitionInfo();
+assert.eq(1, info.numPartitions);
+assert.eq(MaxKey, info.partitions[0].max._id);
+
+// an empty last partition can only be closed with an explicit max
+assert.commandFailed(t.addPartition());
+
+for (i = 0; i < 10; i++) {
+    t.insert({_id: i, a: 10 - i});
+}
+assert.eq(9, t.addPartition().max._id);
+for (i = 10; i < 20; i++) {
+    t.insert({_id: i, a: 20 - i});
+}
+assert.eq(25, t.addPartition({_id: 25}).max._id);
+// new max must not be less than the previous one
+assert.commandFailed(t.addPartition({_id: 5}));
+for (i = 20; i < 30; i++) {
+    t.insert({_id: i, a: 30 - i});
+}
+info = t.getPartitionInfo();
+assert.eq(3, info.numPartitions);
+assert.eq(9, info.partitions[0].max._id);
+assert.eq(25, info.partitions[1].max._id);
+
+stats = t.stats();
+assert.eq(30, stats.count);
+assert.eq(3, stats.numPartitions);
+assert.eq(10, stats.partitions[0].count);
+assert.eq(16, stats.partitions[1].count);
+assert.eq(4, stats.partitions[2].count);
+
+// queries see every partition, in _id order both ways
+assert.eq(30, t.count());
+assert.eq(30, t.find().itcount());
+assert.eq(0, t.find().sort({_id: 1}).next()._id);
+assert.eq(29, t.find().sort({_id: -1}).next()._id);
+assert.eq(15, t.findOne({_id: 15})._id);
+assert.eq(11, t.find({_id: {$gte: 7, $lt: 18}}).itcount());
+arr = t.find({_id: {$gt: 5, $lte: 27}}).sort({_id: -1}).toArray();
+assert.eq(22, arr.length);
+for (i = 0; i < arr.length; i++) {
+    assert.eq(27 - i, arr[i]._id);
+}
+
+// secondary indexes are built in every partition and merged by key
+t.ensureIndex({a: 1});
+assert.eq(2, t.getIndexes().length);
+arr = t.find({a: {$gte: 3, $lte: 8}}).sort({a: 1}).hint({a: 1}).toArray();
+assert.eq(18, arr.length);
+for (i = 1; i < arr.length; i++) {
+    assert.lte(arr[i - 1].a, arr[i].a);
+}
+assert.eq(3, t.find({a: 5}).hint({a: 1}).itcount());
+// unique secondary indexes cannot be enforced across partitions
+t.ensureIndex({b: 1}, {unique: true});
+assert(db.getLastError());
+
+// updates and deletes go to the partition that owns the _id
+t.update({_id: 3}, {$set: {a: 100}});
+assert.eq(100, t.findOne({_id: 3}).a);
+assert.eq(1, t.find({a: 100}).hint({a: 1}).itcount());
+t.remove({_id: 22});
+assert.eq(29, t.count());
+
+// dropping the oldest partition drops its documents, nothing else
+res = t.dropPartition();
+assert.commandWorked(res);
+assert.eq(0, res.dropped);
+assert.eq(19, t.count());
+assert.eq(null, t.findOne({_id: 3}));
+assert.eq(0, t.find({a: 100}).hint({a: 1}).itcount());
+assert.eq(10, t.find().sort({_id: 1}).next()._id);
+assert.eq(2, t.getPartitionInfo().numPartitions);
+
+// nor changed in a multi-statement transaction
+assert.commandWorked(db.beginTransaction());
+assert.commandFailed(t.addPartition());
+assert.commandFailed(t.dropPartition());
+assert.commandWorked(db.rollbackTransaction());
+assert.eq(2, t.getPartitionInfo().numPartitions);
+
+// the last partition cannot be dropped
+t.dropPartition();
+assert.commandFailed(t.dropPartition());
+assert.eq(1, t.getPartitionInfo().numPartitions);
+assert.eq(4, t.count());
+
+// partitioned collections cannot be renamed, and plain ones have no partitions
+assert.commandFailed(t.renameCollection("partitioned_collection_renamed"));
+db.partitioned_collection_plain.drop();
+db.partitioned_collection_plain.insert({_id: 1});
+assert.commandFailed(db.partitioned_collection_plain.getPartitionInfo());
+db.partitioned_collection_plain.drop();
+
+// nor sharded: the shard key commands refuse them
+assert.commandFailed(db.runCommand({checkShardingIndex: t.getFullName(), keyPattern: {_id: 1}}));
+assert.commandFailed(db.runCommand({splitVector: t.getFullName(), keyPattern: {_id: 1}, maxChunkSize: 1}));
+
+assert(t.drop());
+assert.eq(0, db.system.namespaces.find({name: /partitioned_collection\$\$p/}).itcount());
+assert.eq(0, db.system.indexes.find({ns: /partitioned_collection/}).itcount());
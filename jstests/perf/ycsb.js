@@ -0,0 +1,51 @@
+/**
+ *  YCSB core workloads a through f, through benchRun.
+ *
+ *  Loads the records once with the bulk loader, then runs each workload
+ *  against them and prints one JSON document with each workload's
+ *  throughput, per-second timeline and per-op latency percentiles, for
+ *  comparing builds.  Set ycsbConfig before loading this file to change
+ *  the defaults, e.g. { recordCount : 1000000, seconds : 300, parallel : 32 }.
+ */
+
+var config = Object.extend( { recordCount : 100000 ,
+                              seconds : 30 ,
+                              parallel : 8 ,
+                              distribution : null ,
+                              transactionSize : 0 } ,
+                            typeof( ycsbConfig ) == "undefined" ? {} : ycsbConfig );
+
+var t = db.ycsb_usertable;
+t.drop();
+
+function run( type , load ) {
+    var workload = { type : type ,
+                     ns : t.getFullName() ,
+                     // d and e add to what's there
+                     recordCount : load ? config.recordCount : t.count() ,
+                     load : load ,
+                     bulkLoad : load ,
+                     transactionSize : config.transactionSize };
+    if ( config.distribution ) {
+        workload.distribution = config.distribution;
+    }
+    var res = benchRun( { workload : workload ,
+                          parallel : config.parallel ,
+                          seconds : config.seconds ,
+                          host : db.getMongo().host } );
+    var ops = 0;
+    res.opsPerSecond.forEach( function( n ) { ops += n; } );
+    return { opsPerSecond : ops / config.seconds ,
+             timeline : res.opsPerSecond ,
+             latencies : res.latencies ,
+             errCount : res.errCount ,
+             loadSeconds : res.loadSeconds };
+}
+
+// d and e insert, so they go last
+var results = { config : config , workloads : {} };
+[ "a" , "b" , "c" , "f" , "d" , "e" ].forEach( function( type , i ) {
+    results.workloads[ type ] = run( type , i == 0 );
+} );
+
+print( tojson( results , "" , true ) );
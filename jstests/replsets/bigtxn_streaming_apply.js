@@ -0,0 +1,44 @@
+// Secondaries apply a spilled transaction's oplog.refs a batch at a time, in order, and
+// show how far along they are in currentOp.
+
+var name = "bigtxn_streaming_apply";
+var replTest = new ReplSetTest( { name : name , nodes : 2 , txnMemLimit : 1000 } );
+var nodes = replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster().getDB( name );
+var slaveConn = replTest.liveNodes.slaves[ 0 ];
+slaveConn.setSlaveOk();
+var slave = slaveConn.getDB( name );
+master.x.insert( { _id : 0 , n : 0 } );
+replTest.awaitReplication();
+
+// every update depends on the one before, so applying them out of order shows
+var n = 20000;
+assert.commandWorked( master.beginTransaction() );
+for ( var i = 1; i <= n; i++ ) {
+    master.x.update( { _id : 0 } , { $inc : { n : 1 } , $set : { last : i } } );
+    master.y.insert( { _id : i , s : "spill me" } );
+}
+assert.eq( null , master.getLastError() );
+assert.commandWorked( master.commitTransaction() );
+assert( master.getSiblingDB( "local" ).oplog.refs.count() > 1 );
+
+var sawProgress = false;
+assert.soon( function() {
+    slaveConn.getDB( "admin" ).currentOp().inprog.forEach( function( op ) {
+        if ( op.msg && op.msg.indexOf( "spilled transaction" ) >= 0 ) {
+            sawProgress = true;
+        }
+    } );
+    return slave.y.count() == n;
+} );
+print( "saw spilled transaction progress in currentOp: " + sawProgress );
+
+replTest.awaitReplication();
+var doc = slave.x.findOne();
+assert.eq( n , doc.n , tojson( doc ) );
+assert.eq( n , doc.last , tojson( doc ) );
+assert.eq( n , slave.y.count() );
+
+replTest.stopSet();
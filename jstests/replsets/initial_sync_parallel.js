@@ -0,0 +1,67 @@
+// Initial sync copies collections over several connections at once, bulk loading those it can,
+// and ends up with the same data and indexes as the source.
+
+load("jstests/replsets/rslib.js");
+
+var replTest = new ReplSetTest( { name : "initial_sync_parallel" , nodes : 1 } );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var md = master.getDB( "para" );
+
+print( "1. Insert some data" );
+var s = "x";
+while ( s.length < 500 ) {
+    s += s;
+}
+for ( var i = 0; i < 20000; i++ ) {
+    md.big.insert( { _id : i , x : i % 100 , a : [ i , i + 1 ] , s : s } );
+}
+md.big.ensureIndex( { x : 1 } );
+md.big.ensureIndex( { a : 1 } );
+for ( var i = 0; i < 1000; i++ ) {
+    md.small.insert( { _id : "k" + i , y : i } );
+}
+md.small.ensureIndex( { y : -1 } );
+md.createCollection( "empty" );
+md.empty.ensureIndex( { z : 1 } );
+md.createCollection( "capped" , { capped : true , size : 100000 } );
+for ( var i = 0; i < 100; i++ ) {
+    md.capped.insert( { i : i } );
+}
+assert.eq( null , md.getLastError() );
+
+print( "2. Bring up a new node that clones over 3 connections" );
+replTest.nodeOptions.n1 = { initialSyncStreams : 3 };
+var slave = replTest.add();
+replTest.reInitiate();
+
+print( "3. Write while it syncs" );
+for ( var i = 20000; i < 21000; i++ ) {
+    md.big.insert( { _id : i , x : i % 100 , a : [ i ] , s : s } );
+}
+md.big.remove( { _id : { $lt : 100 } } );
+assert.eq( null , md.getLastError() );
+
+print( "4. Wait for it to become secondary and catch up" );
+assert.soon( function() {
+    var res = slave.getDB( "admin" ).runCommand( { isMaster : 1 } );
+    return res.secondary;
+} , "new node never became secondary" , 300000 );
+replTest.awaitReplication();
+
+print( "5. Compare" );
+slave.setSlaveOk();
+var sd = slave.getDB( "para" );
+[ "big" , "small" , "empty" , "capped" ].forEach( function( c ) {
+    assert.eq( md[ c ].count() , sd[ c ].count() , c );
+    assert.eq( md[ c ].getIndexes().length , sd[ c ].getIndexes().length , c );
+} );
+assert.eq( 20900 , sd.big.count() );
+assert.eq( md.big.find( { x : 7 } ).itcount() , sd.big.find( { x : 7 } ).hint( { x : 1 } ).itcount() );
+assert.eq( 2 , sd.big.find( { a : 1000 } ).hint( { a : 1 } ).itcount() );
+assert.eq( 0 , sd.big.find( { _id : { $lt : 100 } } ).itcount() );
+assert.eq( 1 , sd.small.find( { y : 500 } ).hint( { y : -1 } ).itcount() );
+
+replTest.stopSet();
@@ -0,0 +1,62 @@
+// Members started with --networkCompressor compress the oplog they ship each other, and
+// leave members without it alone.
+
+var replTest = new ReplSetTest( { name : "network_compression" ,
+                                  nodes : [ { networkCompressor : "zlib" } ,
+                                            { networkCompressor : "zlib" } ,
+                                            {} ] } );
+var nodes = replTest.startSet();
+var config = replTest.getReplSetConfig();
+config.members[2].priority = 0;
+replTest.initiate( config );
+
+var master = replTest.getMaster();
+var md = master.getDB( "comp" );
+
+function zlibStats( conn ) {
+    return conn.getDB( "admin" ).serverStatus().network.compression.zlib;
+}
+
+print( "1. Negotiate from the shell" );
+var res = master.getDB( "admin" ).runCommand( { isMaster : 1 , compression : [ "lz4" , "zlib" ] } );
+assert.commandWorked( res );
+assert.eq( [ "zlib" ] , res.compression , tojson( res ) );
+res = nodes[2].getDB( "admin" ).runCommand( { isMaster : 1 , compression : [ "zlib" ] } );
+assert.commandWorked( res );
+assert( ! ( "compression" in res ) , tojson( res ) );
+
+print( "2. Replicate something worth compressing" );
+var s = "";
+while ( s.length < 4000 ) {
+    s += "the quick brown fox jumps over the lazy dog ";
+}
+for ( var i = 0; i < 2000; i++ ) {
+    md.foo.insert( { _id : i , s : s } );
+}
+assert.eq( null , md.getLastError() );
+replTest.awaitReplication();
+
+// this shell's replies from the master have been compressed since step 1
+assert.eq( 2000 , md.foo.find().itcount() );
+
+print( "3. Check the counters" );
+var stats = zlibStats( master );
+printjson( stats );
+assert.lt( 0 , stats.compressor.messages , tojson( stats ) );
+assert.lt( 2 , stats.compressor.ratio , tojson( stats ) );
+
+var compressing = nodes[0] == master ? nodes[1] : nodes[0];
+stats = zlibStats( compressing );
+printjson( stats );
+assert.lt( 0 , stats.decompressor.messages , tojson( stats ) );
+
+stats = zlibStats( nodes[2] );
+assert.eq( 0 , stats.compressor.messages , tojson( stats ) );
+assert.eq( 0 , stats.decompressor.messages , tojson( stats ) );
+
+[ compressing , nodes[2] ].forEach( function( n ) {
+    n.setSlaveOk();
+    assert.eq( 2000 , n.getDB( "comp" ).foo.count() );
+} );
+
+replTest.stopSet();
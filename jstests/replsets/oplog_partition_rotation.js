@@ -0,0 +1,90 @@
+// New oplog partitions begin past every entry already written, even ones whose transactions
+// haven't committed yet, so rotating under load loses nothing on either member.
+
+var opts = { expireOplogHours : 1000 , oplogPartitionPeriodMillis : 1000 };
+var replTest = new ReplSetTest( { name : "oplog_partition_rotation" , nodes : [ opts , opts ] } );
+var nodes = replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var md = master.getDB( "test" );
+md.foo.insert( { _id : -1 } );
+assert.eq( null , md.getLastError() );
+replTest.awaitReplication();
+
+// Many small writers, and multi-statement transactions big enough that their oplog
+// entries take a while to commit, all while partitions are added every second.
+var writers = [];
+for ( var w = 0; w < 4; w++ ) {
+    writers.push( startParallelShell(
+        "var t = db.getSisterDB( 'test' ).foo;" +
+        "var s = new Array( 1000 ).join( 'x' );" +
+        "for ( var i = 0; i < 200; i++ ) {" +
+        "    if ( i % 20 == 0 ) {" +
+        "        db.beginTransaction();" +
+        "        for ( var j = 0; j < 500; j++ ) {" +
+        "            t.insert( { w : " + w + " , i : i , j : j , s : s } );" +
+        "        }" +
+        "        db.commitTransaction();" +
+        "    } else {" +
+        "        t.insert( { w : " + w + " , i : i } );" +
+        "    }" +
+        "}" +
+        "assert.eq( null , db.getLastError() );" ,
+        master.port ) );
+}
+
+// a tailing cursor started now must see every entry from here on, in order
+var oplog = master.getDB( "local" ).oplog.rs;
+var last = oplog.find().sort( { $natural : -1 } ).limit( 1 ).next();
+var tail = oplog.find( { _id : { $gte : last._id } } ).addOption( DBQuery.Option.tailable )
+                                                     .addOption( DBQuery.Option.awaitData );
+var tailed = [];
+function drain() {
+    while ( tail.hasNext() ) {
+        tailed.push( tail.next()._id );
+    }
+}
+
+// read along as the writers go, so the cursor crosses partitions as they're added
+var expected = 4 * ( 190 + 10 * 500 ) + 1;
+assert.soon( function() { drain(); return md.foo.count() == expected; } ,
+             "writers didn't finish" , 10 * 60 * 1000 , 100 );
+writers.forEach( function( join ) { join(); } );
+assert.soon( function() {
+    drain();
+    return oplog.find( { _id : { $gte : last._id } } ).itcount() == tailed.length;
+} , "tailing cursor missed oplog entries" );
+
+assert.eq( expected , md.foo.count() );
+replTest.awaitReplication();
+
+replTest.nodes.forEach( function( n ) {
+    n.setSlaveOk();
+    var local = n.getDB( "local" );
+    var info = local.oplog.rs.getPartitionInfo();
+    assert.lt( 1 , info.numPartitions , tojson( info ) );
+
+    // every entry is in the partition its _id routes to
+    var c = local.oplog.rs.find();
+    var prev = null;
+    while ( c.hasNext() ) {
+        var e = c.next();
+        if ( prev != null ) {
+            assert.lt( 0 , bsonWoCompare( { x : e._id } , { x : prev } ) , "out of order" );
+        }
+        assert.neq( null , local.oplog.rs.findOne( { _id : e._id } ) , tojson( e._id ) );
+        prev = e._id;
+    }
+
+    assert.eq( expected , n.getDB( "test" ).foo.count() );
+} );
+
+// and the tailing cursor saw them all, in the oplog's order
+var all = oplog.find( { _id : { $gte : last._id } } ).toArray();
+assert.eq( all.length , tailed.length );
+for ( var i = 0; i < all.length; i++ ) {
+    assert.eq( 0 , bsonWoCompare( { x : all[ i ]._id } , { x : tailed[ i ] } ) , i );
+}
+
+replTest.stopSet();
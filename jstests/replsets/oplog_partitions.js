@@ -0,0 +1,42 @@
+// The oplog is a partitioned collection whose partitions the purge thread adds and drops
+// as history expires, and which tailing cursors read as one.
+
+var replTest = new ReplSetTest( { name : "oplog_partitions" , nodes : 2 } );
+var nodes = replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var md = master.getDB( "test" );
+
+replTest.nodes.forEach( function( n ) {
+    var local = n.getDB( "local" );
+    var info = local.oplog.rs.getPartitionInfo();
+    assert.eq( 1 , info.numPartitions , tojson( info ) );
+    assert( local.oplog.rs.stats().partitioned );
+    // only the server moves the oplog's partitions around
+    assert.commandFailed( local.oplog.rs.addPartition() );
+    assert.commandFailed( local.runCommand( { dropPartition : "oplog.rs" , id : 0 } ) );
+} );
+
+for ( var i = 0; i < 100; i++ ) {
+    md.foo.insert( { _id : i } );
+}
+assert.eq( null , md.getLastError() );
+replTest.awaitReplication();
+
+// a tailable cursor reads the oplog to its end and picks up what comes after
+var oplog = master.getDB( "local" ).oplog.rs;
+var n = oplog.count();
+var c = oplog.find().addOption( DBQuery.Option.tailable );
+assert.eq( n , c.itcount() );
+md.foo.insert( { _id : 100 } );
+assert.eq( null , md.getLastError() );
+assert.soon( function() { return c.hasNext(); } );
+assert.eq( 100 , c.next().ops[ 0 ].o._id );
+
+replTest.awaitReplication();
+var slave = replTest.liveNodes.slaves[ 0 ];
+slave.setSlaveOk();
+assert.eq( 101 , slave.getDB( "test" ).foo.count() );
+
+replTest.stopSet();
@@ -0,0 +1,31 @@
+// dumprestore_parallel.js
+// dump and restore several collections concurrently
+
+t = new ToolTest( "dumprestore_parallel" );
+
+db = t.startDB( "foo" ).getDB();
+var colls = [ "a" , "b" , "c" , "d" , "e" ];
+for ( var i = 0; i < colls.length; i++ ) {
+    var c = db[ colls[ i ] ];
+    for ( var j = 0; j < 1000 * ( i + 1 ); j++ ) {
+        c.insert( { _id : j , x : j % 7 , s : "str" + j } );
+    }
+    c.ensureIndex( { x : 1 } );
+}
+
+t.runTool( "dump" , "--out" , t.ext , "--numThreads" , "3" );
+db.dropDatabase();
+assert.eq( 0 , db.a.count() , "after drop" );
+
+t.runTool( "restore" , "--dir" , t.ext , "--numThreads" , "3" );
+for ( var i = 0; i < colls.length; i++ ) {
+    var c = db[ colls[ i ] ];
+    var n = 1000 * ( i + 1 );
+    assert.eq( n , c.count() , colls[ i ] + " count" );
+    assert.eq( "str" + ( n - 1 ) , c.findOne( { _id : n - 1 } ).s , colls[ i ] + " doc" );
+    // the dumped index was built by the bulk load
+    assert.eq( 2 , db.system.indexes.count( { ns : c.getFullName() } ) , colls[ i ] + " indexes" );
+    assert.eq( Math.ceil( ( n - 3 ) / 7 ) , c.find( { x : 3 } ).hint( { x : 1 } ).itcount() , colls[ i ] + " index" );
+}
+
+t.stop();
@@ -0,0 +1,59 @@
+// importparallel1.js
+// import with several parser threads and insertion workers
+
+t = new ToolTest( "importparallel1" );
+
+c = t.startDB( "foo" );
+
+// enough data for several chunks, with long strings so records straddle chunk boundaries
+var pad = new Array( 4000 ).join( "x" );
+var n = 5000;
+for ( var i = 0; i < n; i++ ) {
+    c.insert( { _id : i , a : i % 10 , s : pad + i } );
+}
+assert.eq( n , c.count() , "setup" );
+
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+
+function check( msg ) {
+    assert.eq( n , c.count() , msg );
+    assert.eq( n / 10 , c.count( { a : 3 } ) , msg );
+    var doc = c.findOne( { _id : 1234 } );
+    assert.eq( pad + 1234 , doc.s , msg );
+}
+
+// ordered, with parsers running ahead of the single writer
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParseThreads" , "4" );
+check( "ordered" );
+var last = -1;
+c.find().forEach( function( doc ) {
+    assert.lt( last , doc._id , "ordered import out of order" );
+    last = doc._id;
+} );
+
+// unordered, with several connections inserting into an existing collection
+c.drop();
+c.ensureIndex( { a : 1 } );
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" ,
+           "--numParseThreads" , "3" , "--numInsertionWorkers" , "3" , "--unordered" );
+check( "unordered" );
+
+// several workers must be asked for unordered
+c.drop();
+assert.neq( 0 , t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" ,
+                           "--numInsertionWorkers" , "2" ) , "ordered with workers" );
+assert.eq( 0 , c.count() , "ordered with workers" );
+
+// one record bigger than the chunks the parsers are sized for
+c.drop();
+var big = new Array( 9 * 1024 * 1024 ).join( "y" );
+c.insert( { _id : 0 , s : big } );
+assert.eq( null , c.getDB().getLastError() , "big setup" );
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+assert.eq( 1 , c.count() , "big record" );
+assert.eq( big.length , c.findOne().s.length , "big record" );
+
+t.stop();
@@ -0,0 +1,47 @@
+// tracepoints and sampleStacks
+
+t = db.jstests_tracepoints;
+t.drop();
+
+a = db.getSisterDB( "admin" );
+
+r = a.runCommand( { tracepoints : 1 , enable : true , reset : true } );
+assert.commandWorked( r );
+assert( r.enabled , "tracing didn't turn on" );
+[ "lockDBWrite" , "ydbPut" , "ydbCommit" , "ydbCursorGet" , "messageSend" , "queryPlan" ].forEach( function( name ) {
+    assert( r.tracepoints[ name ] , "no tracepoint " + name );
+} );
+
+for ( i = 0; i < 100; i++ ) {
+    t.insert( { _id : i } );
+}
+db.getLastError();
+t.find().itcount();
+
+r = a.runCommand( { tracepoints : 1 , enable : false } );
+assert( ! r.enabled , "tracing didn't turn off" );
+assert.lte( 100 , r.tracepoints.ydbPut.count , "inserts not traced" );
+assert.lte( 1 , r.tracepoints.queryPlan.count , "query not traced" );
+assert.lte( r.tracepoints.ydbPut.p50 , r.tracepoints.ydbPut.max );
+
+// nothing is recorded while tracing is off
+before = r.tracepoints.ydbPut.count;
+t.insert( { _id : 100 } );
+db.getLastError();
+assert.eq( before , a.runCommand( { tracepoints : 1 } ).tracepoints.ydbPut.count );
+
+assert.commandFailed( a.runCommand( { sampleStacks : 0 } ) );
+assert.commandFailed( a.runCommand( { sampleStacks : 1 , hz : 0 } ) );
+
+r = a.runCommand( { sampleStacks : 1 , hz : 199 , limit : 10 } );
+if ( r.ok ) {
+    assert.lte( 0 , r.samples );
+    assert.gte( 10 , r.stacks.length );
+    r.stacks.forEach( function( s ) {
+        assert.eq( "string" , typeof( s.stack ) );
+        assert.lt( 0 , s.count );
+    } );
+}
+else {
+    assert( /not supported/.test( r.errmsg ) , tojson( r ) );
+}
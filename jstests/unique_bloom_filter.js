@@ -0,0 +1,95 @@
+// test unique indexes with a bloom filter in front of their uniqueness checks
+
+t = db.unique_bloom_filter;
+t.drop();
+
+function filterStats() {
+    var stats = t.stats();
+    for (var i = 0; i < stats.indexDetails.length; i++) {
+        if (stats.indexDetails[i].name == "a_1") {
+            return stats.indexDetails[i].bloomFilter;
+        }
+    }
+    assert(false, "no stats for index a_1");
+}
+
+// the filter is populated while building the index over existing data
+for (i = 0; i < 100; i++) {
+    t.insert({_id: i, a: i});
+}
+t.ensureIndex({a: 1}, {unique: true, bloomFilter: true});
+assert(!db.getLastError());
+assert(filterStats().ready);
+assert.eq(100, filterStats().keys);
+
+// new keys skip the probe, duplicates are still caught
+for (i = 100; i < 200; i++) {
+    t.insert({_id: i, a: i});
+}
+assert(!db.getLastError());
+assert.eq(100, filterStats().checks);
+assert.lte(90, filterStats().skipped);
+
+t.insert({_id: 500, a: 5});
+assert(db.getLastError());
+t.insert({_id: 501, a: 150.0});
+assert(db.getLastError());
+t.update({_id: 10}, {$set: {a: 20}});
+assert(db.getLastError());
+assert.eq(200, t.count());
+
+// deleted keys stay in the filter, and cost a probe that finds nothing
+t.remove({a: 7});
+t.insert({_id: 502, a: 7});
+assert(!db.getLastError());
+assert.lte(1, filterStats().falsePositives);
+assert.eq(201, t.count());
+
+// an index without the option has no filter
+t.ensureIndex({b: 1}, {unique: true, sparse: true});
+stats = t.stats();
+for (i = 0; i < stats.indexDetails.length; i++) {
+    if (stats.indexDetails[i].name == "b_1") {
+        assert.eq(undefined, stats.indexDetails[i].bloomFilter);
+    }
+}
+
+// a new collection's filter is ready from the start
+t.drop();
+t.ensureIndex({a: 1}, {unique: true, bloomFilter: true});
+t.insert({a: 1});
+t.insert({a: 1});
+assert(db.getLastError());
+assert(filterStats().ready);
+assert.eq(1, t.count());
+
+// a crowded filter is replaced by a bigger one in the background
+assert.eq(0, filterStats().rebuilds);
+var capacity = filterStats().capacity;
+for (i = 2; i <= capacity + 5000; i++) {
+    t.insert({a: i});
+}
+assert(!db.getLastError());
+assert.soon(function() { return filterStats().rebuilds == 1 && !filterStats().rebuilding; });
+assert.lt(capacity, filterStats().capacity);
+assert(filterStats().ready);
+t.insert({a: capacity});
+assert(db.getLastError());
+
+// but never past bloomFilterMaxMemory
+t.drop();
+var was = db.adminCommand({setParameter: 1, bloomFilterMaxMemory: 1024}).was;
+assert(was);
+t.ensureIndex({a: 1}, {unique: true, bloomFilter: true});
+assert.gte(1024 * 8, filterStats().bits);
+for (i = 0; i < 2000; i++) {
+    t.insert({a: i});
+}
+assert(!db.getLastError());
+assert.eq(0, filterStats().rebuilds);
+assert(!filterStats().rebuilding);
+t.insert({a: 1999});
+assert(db.getLastError());
+assert.commandWorked(db.adminCommand({setParameter: 1, bloomFilterMaxMemory: was}));
+
+t.drop();
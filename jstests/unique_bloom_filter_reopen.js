@@ -0,0 +1,53 @@
+// a unique index's bloom filter is filled in the background when the index is opened,
+// and keys are probed until it is ready
+
+var testName = 'unique_bloom_filter_reopen';
+
+var path = MongoRunner.toRealDir(testName);
+var port = allocatePorts(1, parseInt(myPort(), 10) + 1)[0];
+var mongod = startMongod('--port', port,
+                         '--dbpath', path,
+                         '--nohttpinterface',
+                         '--bind_ip', '127.0.0.1');
+
+var db = mongod.getDB(testName);
+db.foo.ensureIndex({a: 1}, {unique: true, bloomFilter: true});
+for (var i = 0; i < 50000; i++) {
+    db.foo.insert({_id: i, a: i});
+}
+assert(!db.getLastError());
+
+stopMongod(port);
+
+mongod = startMongodNoReset('--port', port,
+                            '--dbpath', path,
+                            '--nohttpinterface',
+                            '--bind_ip', '127.0.0.1');
+
+db = mongod.getDB(testName);
+function filterStats() {
+    var stats = db.foo.stats();
+    for (var i = 0; i < stats.indexDetails.length; i++) {
+        if (stats.indexDetails[i].name == "a_1") {
+            return stats.indexDetails[i].bloomFilter;
+        }
+    }
+    assert(false, "no stats for index a_1");
+}
+
+// duplicates are caught whether or not the filter is ready yet
+db.foo.insert({_id: 50000, a: 49999});
+assert(db.getLastError());
+db.foo.insert({_id: 50001, a: 50001});
+assert(!db.getLastError());
+
+assert.soon(function() { return filterStats().ready; });
+assert.lte(45000, filterStats().keys);  // a few collide
+db.foo.insert({_id: 50002, a: 0});
+assert(db.getLastError());
+db.foo.insert({_id: 50003, a: 50003});
+assert(!db.getLastError());
+assert.lte(1, filterStats().skipped);
+assert.eq(50002, db.foo.count());
+
+stopMongod(port);
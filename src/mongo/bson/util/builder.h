@@ -70,32 +70,37 @@ namespace mongo {
         void Free(void *p) { free(p); }
     };
 
-    class StackAllocator {
+    /** Hands out its own buffer for up to SZ bytes, and goes to Overflow past that. */
+    template <class Overflow>
+    class _StackAllocator {
     public:
         enum { SZ = 512 };
         void* Malloc(size_t sz) {
             if( sz <= SZ ) return buf;
-            return malloc(sz); 
+            return overflow.Malloc(sz); 
         }
         void* Realloc(void *p, size_t sz) { 
             if( p == buf ) {
                 if( sz <= SZ ) return buf;
-                void *d = malloc(sz);
+                void *d = overflow.Malloc(sz);
                 if ( d == 0 )
                     msgasserted( 15912 , "out of memory StackAllocator::Realloc" );
                 memcpy(d, p, SZ);
                 return d;
             }
-            return realloc(p, sz); 
+            return overflow.Realloc(p, sz); 
         }
         void Free(void *p) { 
             if( p != buf )
-                free(p); 
+                overflow.Free(p); 
         }
     private:
         char buf[SZ];
+        Overflow overflow;
     };
 
+    typedef _StackAllocator<TrivialAllocator> StackAllocator;
+
     template< class Allocator >
     class _BufBuilder {
         // non-copyable, non-assignable
@@ -403,13 +403,19 @@ namespace mongo {
         return isOk(info);
     }
 
-    bool DBClientWithCommands::beginTransaction(const string &isolation, BSONObj *res) {
+    bool DBClientWithCommands::beginTransaction(const string &isolation, BSONObj *res, bool readOnly) {
         BSONObj o;
         if (res == NULL) {
             res = &o;
         }
+        BSONObjBuilder b;
+        b.append("beginTransaction", "");
+        b.append("isolation", isolation);
+        if (readOnly) {
+            b.append("readOnly", true);
+        }
         // The dbname needs to be something but it doesn't need to be anything in particular.
-        return runCommand("x", BSON("beginTransaction" << "" << "isolation" << isolation), *res);
+        return runCommand("x", b.done(), *res);
     }
 
     bool DBClientWithCommands::commitTransaction(BSONObj *res) {
@@ -822,6 +828,41 @@ namespace mongo {
         }
 #endif
 
+        if ( _compressor != MessageCompressor::NONE ) {
+            return _negotiateCompression( errmsg );
+        }
+        return true;
+    }
+
+    bool DBClientConnection::_negotiateCompression( string& errmsg ) {
+        BSONObj info;
+        try {
+            runCommand( "admin" ,
+                        BSON( "isMaster" << 1 <<
+                              "compression" << BSON_ARRAY( MessageCompressor::name( _compressor ) ) ) ,
+                        info );
+        }
+        catch ( DBException& e ) {
+            errmsg = str::stream() << "couldn't negotiate compression with " << _serverString
+                                   << causedBy( e );
+            _failed = true;
+            return false;
+        }
+
+        // The server answers with the one compressor it picked from ours, or
+        // not at all.
+        BSONElement e = info["compression"];
+        if ( e.type() == Array ) {
+            BSONForEach( c , e.Obj() ) {
+                MessageCompressor::Id id;
+                if ( c.type() == String && MessageCompressor::forName( c.valuestr() , &id ) &&
+                     id == _compressor ) {
+                    p->setCompressor( id );
+                    LOG(1) << "compressing messages to and from " << _serverString
+                           << " with " << MessageCompressor::name( id ) << endl;
+                }
+            }
+        }
         return true;
     }
 
@@ -1330,6 +1371,7 @@ namespace mongo {
 
     AtomicUInt DBClientConnection::_numConnections;
     bool DBClientConnection::_lazyKillCursor = true;
+    MessageCompressor::Id DBClientConnection::_compressor = MessageCompressor::NONE;
 
 
     bool serverAlive( const string &uri ) {
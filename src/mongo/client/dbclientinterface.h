@@ -603,9 +603,10 @@ namespace mongo {
 
             @param isolation isolation level.  Options are "mvcc" (default), "serializable", and "readUncommitted".
             @param res pointer to object to return the result of the begin.
+            @param readOnly if true, the server refuses writes in the transaction.
             @return true iff the begin was successful.
          */
-        virtual bool beginTransaction(const string &isolation = "mvcc", BSONObj *res = NULL);
+        virtual bool beginTransaction(const string &isolation = "mvcc", BSONObj *res = NULL, bool readOnly = false);
 
         /** Commit a multi-statement transaction.
             If you are using a SyncClusterConnection, you must use these wrappers (or a RemoteTransaction), not bare runCommand() calls.
@@ -1204,6 +1205,15 @@ namespace mongo {
         static void setLazyKillCursor( bool lazy ) { _lazyKillCursor = lazy; }
         static bool getLazyKillCursor() { return _lazyKillCursor; }
 
+        /**
+         * Has every connection made from now on ask its server, with an extra
+         * isMaster, to compress messages both ways with compressor.  Servers
+         * that don't use the same one, or don't know of compression, say no,
+         * and the connection goes on uncompressed.
+         */
+        static void setCompressor( MessageCompressor::Id compressor ) { _compressor = compressor; }
+        static MessageCompressor::Id getCompressor() { return _compressor; }
+
     protected:
         friend class SyncClusterConnection;
         virtual void sayPiggyBack( Message &toSend );
@@ -1224,9 +1234,11 @@ namespace mongo {
         map< string, pair<string,string> > authCache;
         double _so_timeout;
         bool _connect( string& errmsg );
+        bool _negotiateCompression( string& errmsg );
 
         static AtomicUInt _numConnections;
         static bool _lazyKillCursor; // lazy means we piggy back kill cursors on next op
+        static MessageCompressor::Id _compressor;
 
 #ifdef MONGO_SSL
         static SSLManager* sslManager();
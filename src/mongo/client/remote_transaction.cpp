@@ -27,9 +27,9 @@
 
 namespace mongo {
 
-    RemoteTransaction::RemoteTransaction(DBClientWithCommands &conn, const string &isolation) : _conn(NULL) {
+    RemoteTransaction::RemoteTransaction(DBClientWithCommands &conn, const string &isolation, bool readOnly) : _conn(NULL) {
         BSONObj res;
-        bool ok = conn.beginTransaction(isolation, &res);
+        bool ok = conn.beginTransaction(isolation, &res, readOnly);
         if (ok) {
             _conn = &conn;
         } else {
@@ -51,8 +51,9 @@ namespace mongo {
         /** Creates a remote transaction using a connection.
             @param conn -- The connection to use for this transaction.
             @param isolation -- What isolation level to use.  Possible values are serializable, mvcc (default), and readUncommitted.
+            @param readOnly -- If true, the server refuses writes in the transaction.
         */
-        RemoteTransaction(DBClientWithCommands &conn, const string &isolation = "mvcc");
+        RemoteTransaction(DBClientWithCommands &conn, const string &isolation = "mvcc", bool readOnly = false);
         /** Rolls back the transaction if necessary. */
         ~RemoteTransaction();
         /** Commits the transaction.
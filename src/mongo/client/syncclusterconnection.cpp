@@ -503,10 +503,10 @@ namespace mongo {
         return requiresSync;
     }
 
-    bool SyncClusterConnection::beginTransaction(const string &isolation, BSONObj *res) {
+    bool SyncClusterConnection::beginTransaction(const string &isolation, BSONObj *res, bool readOnly) {
         _txnNestLevel++;
         try {
-            return DBClientWithCommands::beginTransaction(isolation, res);
+            return DBClientWithCommands::beginTransaction(isolation, res, readOnly);
         }
         catch (DBException &e) {
             _txnNestLevel--;
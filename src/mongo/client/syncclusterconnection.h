@@ -75,9 +75,10 @@ namespace mongo {
 
             @param isolation isolation level.  Options are "mvcc" (default), "serializable", and "readUncommitted".
             @param res pointer to object to return the result of the begin.
+            @param readOnly if true, the server refuses writes in the transaction.
             @return true iff the begin was successful.
          */
-        virtual bool beginTransaction(const string &isolation = "mvcc", BSONObj *res = NULL);
+        virtual bool beginTransaction(const string &isolation = "mvcc", BSONObj *res = NULL, bool readOnly = false);
 
         /** Commit a multi-statement transaction.  See DBClientWithCommands::commitTransaction().
             This resolves the SyncClusterConnection's synchronous mode if successful.
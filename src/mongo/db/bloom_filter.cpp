@@ -0,0 +1,121 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include <cmath>
+
+#include "mongo/db/bloom_filter.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    // 10 bits per key and 7 probes gives a false positive rate just under 1%.
+    static const uint64_t bitsPerKey = 10;
+    static const int numProbes = 7;
+
+    BloomFilter::BloomFilter(const uint64_t expectedKeys, const uint64_t maxBytes) :
+        _mutex("bloomFilter"),
+        _bits(std::max(std::min((std::max(expectedKeys, (uint64_t) 1) * bitsPerKey + 63) / 64,
+                                maxBytes / sizeof(uint64_t)),
+                       (uint64_t) 1), 0),
+        _nbits(_bits.size() * 64),
+        _nkeys(0) {
+    }
+
+    uint64_t BloomFilter::capacity() const {
+        return _nbits / bitsPerKey;
+    }
+
+    uint64_t BloomFilter::keys() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _nkeys;
+    }
+
+    // Keys that compare equal in the index must hash equal here, or the filter
+    // would let a duplicate through. BSONElementHasher hashes the canonical type
+    // and squashes numbers to 64-bit ints, so { : 1 } and { : 1.0 } agree.
+    uint64_t BloomFilter::hash(const BSONObj &key) {
+        uint64_t h = 0;
+        for (BSONObjIterator it(key); it.more(); ) {
+            h = h * 31 + (uint64_t) BSONElementHasher::hash64(it.next(), BSONElementHasher::DEFAULT_HASH_SEED);
+        }
+        return h;
+    }
+
+    bool BloomFilter::testAndAdd(const BSONObj &key) {
+        // Double hashing: probe i looks at bit h1 + i * h2.
+        const uint64_t h = hash(key);
+        const uint64_t h1 = h & 0xffffffff;
+        const uint64_t h2 = (h >> 32) | 1;
+
+        bool present = true;
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            for (int i = 0; i < numProbes; i++) {
+                const uint64_t bit = (h1 + i * h2) % _nbits;
+                uint64_t &word = _bits[bit / 64];
+                const uint64_t mask = 1ULL << (bit % 64);
+                if (!(word & mask)) {
+                    present = false;
+                    word |= mask;
+                }
+            }
+            if (!present) {
+                _nkeys++;
+            }
+        }
+
+        if (!ready()) {
+            return true;
+        }
+        _checks.fetchAndAdd(1);
+        if (!present) {
+            _skipped.fetchAndAdd(1);
+        }
+        return present;
+    }
+
+    void BloomFilter::setReady() {
+        _ready.store(1);
+    }
+
+    void BloomFilter::appendStats(BSONObjBuilder &b) const {
+        uint64_t nkeys;
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            nkeys = _nkeys;
+        }
+        const uint64_t checks = _checks.load();
+        const uint64_t skipped = _skipped.load();
+        const uint64_t falsePositives = _falsePositives.load();
+        b.appendBool("ready", ready());
+        b.appendNumber("bits", (long long) _nbits);
+        b.appendNumber("capacity", (long long) capacity());
+        b.appendNumber("keys", (long long) nkeys);
+        b.appendNumber("checks", (long long) checks);
+        b.appendNumber("skipped", (long long) skipped);
+        b.appendNumber("falsePositives", (long long) falsePositives);
+        // Observed over the probes that found no duplicate, and expected
+        // from how full the filter is. Both climb as the index outgrows it.
+        const uint64_t negatives = skipped + falsePositives;
+        b.appendNumber("falsePositiveRate", negatives == 0 ? 0.0 : (double) falsePositives / negatives);
+        b.appendNumber("expectedFalsePositiveRate",
+                       std::pow(1.0 - std::exp(-(double) numProbes * nkeys / _nbits), numProbes));
+    }
+
+} // namespace mongo
@@ -0,0 +1,107 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    // In-memory bloom filter over the keys of a unique index, used to skip
+    // the uniqueness probe (a point query, often a disk read) for keys that
+    // are definitely not in the index.
+    //
+    // Keys are never removed: a delete may still abort, and clearing bits
+    // that other keys share would make the filter lie. Deleted keys only cost
+    // false positives, which the filter counts so they can be watched.
+    //
+    // Until setReady() is called, the filter may be missing keys that are in
+    // the index, so it answers "maybe present" for everything.
+    //
+    // A filter never grows. Once it holds more keys than it was sized for, it
+    // is crowded, and the index replaces it with a bigger one (see
+    // IndexDetails::requestBloomFilterRebuild()).
+    class BloomFilter : boost::noncopyable {
+    public:
+        // Sized for expectedKeys keys at roughly a 1% false positive rate, but
+        // never bigger than maxBytes.
+        BloomFilter(const uint64_t expectedKeys, const uint64_t maxBytes);
+
+        // Add the key to the filter.
+        // @return true if it may already have been present, in which case
+        //         the caller must probe the index to find out.
+        //
+        // Testing and adding is atomic, so of two concurrent inserts of the
+        // same key at least one is told to probe, and the index's row locks
+        // settle which of them wins.
+        bool testAndAdd(const BSONObj &key);
+
+        void add(const BSONObj &key) {
+            testAndAdd(key);
+        }
+
+        // The filter holds every key in the index, and may be trusted.
+        void setReady();
+
+        uint64_t bytes() const {
+            return _bits.size() * sizeof(uint64_t);
+        }
+
+        // The number of keys the filter holds at a 1% false positive rate.
+        uint64_t capacity() const;
+
+        uint64_t keys() const;
+
+        bool crowded() const {
+            return keys() > capacity();
+        }
+
+        // @return true for the first caller only, who should see that the
+        //         filter gets replaced.
+        bool claimRebuild() {
+            return _rebuildClaimed.compareAndSwap(0, 1) == 0;
+        }
+
+        bool ready() const {
+            return _ready.load() != 0;
+        }
+
+        // A "maybe present" answer turned out to be wrong.
+        void noteFalsePositive() {
+            _falsePositives.fetchAndAdd(1);
+        }
+
+        void appendStats(BSONObjBuilder &b) const;
+
+    private:
+        static uint64_t hash(const BSONObj &key);
+
+        mutable SimpleMutex _mutex;
+        vector<uint64_t> _bits;
+        const uint64_t _nbits;
+        uint64_t _nkeys;
+
+        AtomicWord<unsigned> _ready;
+        AtomicWord<unsigned> _rebuildClaimed;
+        AtomicWord<uint64_t> _checks;
+        AtomicWord<uint64_t> _skipped;
+        AtomicWord<uint64_t> _falsePositives;
+    };
+
+} // namespace mongo
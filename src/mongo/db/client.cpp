@@ -229,7 +229,8 @@ namespace mongo {
 
     void Client::Context::_finishInit( bool doauth ) {
         dassert( Lock::isLocked() );
-        int writeLocked = Lock::somethingWriteLocked();
+        // DDL under a Lock::CollectionWrite needs write access too, wherever its context is
+        int writeLocked = Lock::somethingWriteLocked() || Lock::hasCollectionWriteLock();
 
         _db = dbHolderUnchecked().getOrCreate( _ns , _path );
         verify(_db);
@@ -519,6 +520,8 @@ namespace mongo {
         fastmodinsert = false;
         upsert = false;
         keyUpdates = 0;  // unsigned, so -1 not possible
+        arenaAllocs = -1;
+        arenaMallocs = -1;
         
         exceptionInfo.reset();
         lockNotGrantedInfo = BSONObj();
@@ -579,6 +582,8 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP_BOOL( fastmodinsert );
         OPDEBUG_TOSTRING_HELP_BOOL( upsert );
         OPDEBUG_TOSTRING_HELP( keyUpdates );
+        OPDEBUG_TOSTRING_HELP( arenaAllocs );
+        OPDEBUG_TOSTRING_HELP( arenaMallocs );
         
         if ( extra.len() )
             s << " " << extra.str();
@@ -635,6 +640,8 @@ namespace mongo {
         OPDEBUG_APPEND_BOOL( fastmodinsert );
         OPDEBUG_APPEND_BOOL( upsert );
         OPDEBUG_APPEND_NUMBER( keyUpdates );
+        OPDEBUG_APPEND_NUMBER( arenaAllocs );
+        OPDEBUG_APPEND_NUMBER( arenaMallocs );
 
         b.append( "lockStats" , curop.lockStat().report() );
         
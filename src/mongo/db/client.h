@@ -38,6 +38,7 @@
 #include "mongo/db/gtid.h"
 #include "mongo/db/txn_context.h"
 #include "mongo/db/opsettings.h"
+#include "mongo/util/buf_arena.h"
 #include "mongo/util/paths.h"
 #include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/net/message_port.h"
@@ -95,6 +96,8 @@ namespace mongo {
         AuthenticationInfo * getAuthenticationInfo() { return &_ai; }
         bool isAdmin() { return _ai.isAuthorized( "admin" ); }
         CurOp* curop() const { return _curOp; }
+        /** transient buffers for the operation in progress, see assembleResponse */
+        BufArena& bufArena() { return _bufArena; }
         Context* getContext() const { return _context; }
         Database* database() const {  return _context ? _context->db() : 0; }
         const char *ns() const { return _context->ns(); }
@@ -323,6 +326,7 @@ namespace mongo {
         BSONObj _remoteId;
         AbstractMessagingPort * const _mp;
         OpSettings _opSettings;
+        BufArena _bufArena;
 
         // for CmdCopyDb and CmdCopyDbGetNonce
         shared_ptr< DBClientConnection > _authConn;
@@ -32,6 +32,7 @@
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/introspect.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/nonce.h"
 #include "mongo/db/repl_block.h"
 #include "mongo/db/scanandorder.h"
 #include "mongo/db/repl/rs.h"
@@ -51,30 +52,88 @@ namespace mongo {
         return false;
     }
 
-    CCById ClientCursor::clientCursorsById;
-    boost::recursive_mutex& ClientCursor::ccmutex( *(new boost::recursive_mutex()) );
-    long long ClientCursor::numberTimedOut = 0;
+    ClientCursor::Partition* const ClientCursor::partitions = new ClientCursor::Partition[NumPartitions];
+    AtomicUInt64 ClientCursor::idleClock;
+    AtomicUInt64 ClientCursor::numberTimedOut;
+
+    namespace {
+        // new cursors are spread over the partitions round robin
+        AtomicUInt32 nextPartition;
+    }
 
     /*static*/ void ClientCursor::assertNoCursors() {
-        recursive_scoped_lock lock(ccmutex);
-        if( clientCursorsById.size() ) {
-            log() << "ERROR clientcursors exist but should not at this point" << endl;
-            ClientCursor *cc = clientCursorsById.begin()->second;
-            log() << "first one: " << cc->_cursorid << ' ' << cc->_ns << endl;
-            clientCursorsById.clear();
-            verify(false);
+        for ( int i = 0; i < NumPartitions; i++ ) {
+            Partition& p = partitions[i];
+            SimpleMutex::scoped_lock lock(p.mutex);
+            if( p.cursors.size() ) {
+                log() << "ERROR clientcursors exist but should not at this point" << endl;
+                ClientCursor *cc = p.cursors.begin()->second;
+                log() << "first one: " << cc->_cursorid << ' ' << cc->_ns << endl;
+                p.cursors.clear();
+                verify(false);
+            }
         }
     }
 
+    template <typename Predicate>
+    void ClientCursor::eraseIf( Predicate& shouldErase ) {
+        for ( int i = 0; i < NumPartitions; i++ ) {
+            Partition& p = partitions[i];
+            vector<ClientCursor*> doomed;
+            {
+                SimpleMutex::scoped_lock lock(p.mutex);
+                for ( CCById::iterator it = p.cursors.begin(); it != p.cursors.end(); ) {
+                    if ( shouldErase( it->second ) ) {
+                        doomed.push_back( it->second );
+                        p.cursors.erase( it++ );
+                    }
+                    else {
+                        ++it;
+                    }
+                }
+            }
+            // Out of the registry, so no one else can find them, and deleting them can
+            // erase other cursors without deadlocking on this partition.
+            for ( vector<ClientCursor*>::iterator it = doomed.begin(); it != doomed.end(); ++it ) {
+                delete *it;
+            }
+        }
+    }
+
+    namespace {
+        struct EraseAll {
+            bool operator()( ClientCursor *cc ) const { return true; }
+        };
+    }
+
     void ClientCursor::invalidateAllCursors() {
         verify(Lock::isW());
-        for( LockedIterator i; i.ok(); ) {
-            i.deleteAndAdvance();
-        }
+        EraseAll all;
+        eraseIf( all );
     }
 
     /* ------------------------------------------- */
 
+    namespace {
+        struct EraseForNs {
+            EraseForNs( Database *db, const StringData &ns, bool isDB ) : db( db ), ns( ns ), isDB( isDB ) {}
+            bool operator()( ClientCursor *cc ) const {
+                if (cc->c()->shouldDestroyOnNSDeletion() && cc->db() == db) {
+                    if (isDB) {
+                        // already checked that db matched above
+                        dassert( StringData(cc->ns()).startsWith(ns) );
+                        return true;
+                    }
+                    return ns == cc->ns();
+                }
+                return false;
+            }
+            Database *db;
+            const StringData &ns;
+            bool isDB;
+        };
+    }
+
     // ns is either a full namespace or "dbname." when invalidating for a whole db
     void ClientCursor::invalidate(const StringData &ns) {
         Lock::assertWriteLocked(ns);
@@ -82,93 +141,110 @@ namespace mongo {
         verify(dotpos != string::npos);
         bool isDB = (dotpos + 1) == ns.size(); // first (and only) dot is the last char
 
-        {
-            //cout << "\nTEMP invalidate " << ns << endl;
-            Database *db = cc().database();
-            verify(db);
-            verify( ns.startsWith(db->name()) );
-
-            for( LockedIterator i; i.ok(); ) {
-                ClientCursor *cc = i.current();
+        Database *db = cc().database();
+        verify(db);
+        verify( ns.startsWith(db->name()) );
 
-                bool shouldDelete = false;
-                if (cc->c()->shouldDestroyOnNSDeletion() && cc->_db == db) {
-                    if (isDB) {
-                        // already checked that db matched above
-                        dassert( StringData(cc->_ns).startsWith(ns) );
-                        shouldDelete = true;
-                    }
-                    else {
-                        if ( ns == cc->_ns )
-                            shouldDelete = true;
-                    }
-                }
+        EraseForNs forNs( db, ns, isDB );
+        eraseIf( forNs );
+    }
 
-                if ( shouldDelete ) {
-                    i.deleteAndAdvance();
-                }
-                else {
-                    i.advance();
-                }
-            }
-        }
+    unsigned ClientCursor::idleTime() const {
+        return (unsigned) ( idleClock.load() - _lastUsed );
     }
 
-    /* note called outside of locks (other than ccmutex) so care must be exercised */
+    /* note called outside of locks (other than a partition's) so care must be exercised */
     bool ClientCursor::shouldTimeout( unsigned millis ) {
-        _idleAgeMillis += millis;
-        return _idleAgeMillis > 600000 && _pinValue == 0;
+        return idleClock.load() - _lastUsed + millis > 600000 && _pinValue == 0;
+    }
+
+    namespace {
+        struct EraseTimedOut {
+            EraseTimedOut() : n( 0 ) {}
+            bool operator()( ClientCursor *cc ) {
+                if ( ! cc->shouldTimeout( 0 ) ) {
+                    return false;
+                }
+                LOG(1) << "killing old cursor " << cc->cursorid() << ' ' << cc->ns()
+                       << " idle:" << cc->idleTime() << "ms\n";
+                n++;
+                return true;
+            }
+            long long n;
+        };
+
+        // erases nothing, just looks
+        struct CountTimedOut {
+            CountTimedOut() : n( 0 ) {}
+            bool operator()( ClientCursor *cc ) {
+                n += cc->shouldTimeout( 0 );
+                return false;
+            }
+            long long n;
+        };
     }
 
     /* called every 4 seconds.  millis is amount of idle time passed since the last call -- could be zero */
     void ClientCursor::idleTimeReport(unsigned millis) {
-        bool foundSomeToTimeout = false;
+        // Rather than age every cursor, move the clock they measure their idle time
+        // against.  Cursors only need looking at to find the ones to time out.
+        idleClock.fetchAndAdd( millis );
 
-        // two passes so that we don't need to readlock unless we really do some timeouts
-        // we assume here that incrementing _idleAgeMillis outside readlock is ok.
         {
-            recursive_scoped_lock lock(ccmutex);
-            {
-                unsigned sz = clientCursorsById.size();
-                static time_t last;
-                if( sz >= 100000 ) { 
-                    if( time(0) - last > 300 ) {
-                        last = time(0);
-                        log() << "warning number of open cursors is very large: " << sz << endl;
-                    }
-                }
-            }
-            for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end();  ) {
-                CCById::iterator j = i;
-                i++;
-                if( j->second->shouldTimeout( millis ) ) {
-                    foundSomeToTimeout = true;
+            unsigned sz = numCursors();
+            static time_t last;
+            if( sz >= 100000 ) { 
+                if( time(0) - last > 300 ) {
+                    last = time(0);
+                    log() << "warning number of open cursors is very large: " << sz << endl;
                 }
             }
         }
 
-        if( foundSomeToTimeout ) {
+        // two passes so that we don't need to readlock unless we really do some timeouts
+        CountTimedOut found;
+        eraseIf( found );
+
+        if( found.n > 0 ) {
             Lock::GlobalRead lk;
-            for( LockedIterator i; i.ok(); ) {
-                ClientCursor *cc = i.current();
-                if( cc->shouldTimeout(0) ) {
-                    numberTimedOut++;
-                    LOG(1) << "killing old cursor " << cc->_cursorid << ' ' << cc->_ns
-                           << " idle:" << cc->idleTime() << "ms\n";
-                    i.deleteAndAdvance();
-                }
-                else {
-                    i.advance();
-                }
-            }
+            EraseTimedOut timedOut;
+            eraseIf( timedOut );
+            numberTimedOut.fetchAndAdd( timedOut.n );
         }
     }
 
-    void ClientCursor::LockedIterator::deleteAndAdvance() {
-        ClientCursor *cc = current();
-        CursorId id = cc->cursorid();
-        delete cc;
-        _i = clientCursorsById.upper_bound( id );
+    bool ClientCursor::pin( CursorId id ) {
+        Partition& p = partitionFor(id);
+        SimpleMutex::scoped_lock lock(p.mutex);
+        ClientCursor *cursor = find_inlock( p, id, true );
+        if ( ! cursor ) {
+            return false;
+        }
+        uassert( 12051, "clientcursor already in use? driver problem?",
+                 cursor->_pinValue < 100 );
+        cursor->_pinValue += 100;
+        return true;
+    }
+
+    void ClientCursor::unpin( CursorId id ) {
+        Partition& p = partitionFor(id);
+        SimpleMutex::scoped_lock lock(p.mutex);
+        ClientCursor *cursor = find_inlock( p, id, false );
+        if ( cursor ) {
+            verify( cursor->_pinValue >= 100 );
+            cursor->_pinValue -= 100;
+            cursor->_lastUsed = idleClock.load();
+        }
+    }
+
+    unsigned ClientCursor::numCursors() {
+        size_t n = 0;
+        for ( int i = 0; i < NumPartitions; i++ ) {
+            Partition& p = partitions[i];
+            SimpleMutex::scoped_lock lock(p.mutex);
+            n += p.cursors.size();
+        }
+        return n;
     }
     
     ClientCursor::ClientCursor(int queryOptions, const shared_ptr<Cursor>& c, const string& ns,
@@ -177,7 +253,7 @@ namespace mongo {
         _c(c), _pos(0),
         _query(query),  _queryOptions(queryOptions),
         _slaveReadTillTS(0),
-        _idleAgeMillis(0), _pinValue(0),
+        _lastUsed(idleClock.load()), _pinValue(0),
         _partOfMultiStatementTxn(inMultiStatementTxn) {
 
         Lock::assertAtLeastReadLocked(ns);
@@ -186,9 +262,13 @@ namespace mongo {
         verify( str::startsWith(_ns, _db->name()) );
         if( queryOptions & QueryOption_NoCursorTimeout )
             noTimeout();
-        recursive_scoped_lock lock(ccmutex);
-        _cursorid = allocCursorId_inlock();
-        clientCursorsById.insert( make_pair(_cursorid, this) );
+        {
+            const int partition = nextPartition.fetchAndAdd(1) % NumPartitions;
+            Partition& p = partitions[partition];
+            SimpleMutex::scoped_lock lock(p.mutex);
+            _cursorid = allocCursorId_inlock(p, partition);
+            p.cursors.insert( make_pair(_cursorid, this) );
+        }
 
         if (_partOfMultiStatementTxn) {
             transactions = cc().txnStack();
@@ -224,9 +304,13 @@ namespace mongo {
         }
 
         {
-            recursive_scoped_lock lock(ccmutex);
+            // may have been taken out of the registry already, by erase() or eraseIf()
+            Partition& p = partitionFor(_cursorid);
+            SimpleMutex::scoped_lock lock(p.mutex);
 
-            clientCursorsById.erase(_cursorid);
+            CCById::iterator it = p.cursors.find(_cursorid);
+            if ( it != p.cursors.end() && it->second == this )
+                p.cursors.erase(it);
 
             // defensive:
             _cursorid = INVALID_CURSOR_ID;
@@ -324,20 +408,30 @@ namespace mongo {
         }
     }
 
-    // See SERVER-5726.
-    long long ctmLast = 0; // so we don't have to do find() which is a little slow very often.
-    long long ClientCursor::allocCursorId_inlock() {
-        long long ctm = curTimeMillis64();
-        dassert( ctm );
-        long long x;
+    // See SERVER-5726.  Ids are random, so they can't be guessed, except for the low bits,
+    // which say which partition the cursor is on.
+    CursorId ClientCursor::allocCursorId_inlock( Partition& p, int partition ) {
         while ( 1 ) {
-            x = (((long long)rand()) << 32);
-            x = x ^ ctm;
-            if ( ctm != ctmLast || ClientCursor::find_inlock(x, false) == 0 )
-                break;
+            if ( p.idsUntilReseed == 0 ) {
+                p.state0 = Security::getNonce();
+                p.state1 = Security::getNonce() | 1;
+                p.idsUntilReseed = 1024;
+            }
+            p.idsUntilReseed--;
+
+            // xorshift128+
+            unsigned long long s1 = p.state0;
+            const unsigned long long s0 = p.state1;
+            p.state0 = s0;
+            s1 ^= s1 << 23;
+            p.state1 = s1 ^ s0 ^ ( s1 >> 17 ) ^ ( s0 >> 26 );
+            const unsigned long long r = p.state1 + s0;
+
+            // positive, and never 0, which means no cursor
+            CursorId x = (CursorId) ( ( ( r << PartitionBits ) | partition ) & 0x7fffffffffffffffULL );
+            if ( x != 0 && find_inlock(p, x, false) == 0 )
+                return x;
         }
-        ctmLast = ctm;
-        return x;
     }
 
     void ClientCursor::storeOpForSlave( BSONObj curr ) {
@@ -362,19 +456,24 @@ namespace mongo {
     }
 
     void ClientCursor::appendStats( BSONObjBuilder& result ) {
-        recursive_scoped_lock lock(ccmutex);
-        result.appendNumber("totalOpen", clientCursorsById.size() );
-        result.appendNumber("clientCursors_size", (int) numCursors());
-        result.appendNumber("timedOut" , numberTimedOut);
+        unsigned total = 0;
         unsigned pinned = 0;
         unsigned notimeout = 0;
-        for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end(); i++ ) {
-            unsigned p = i->second->_pinValue;
-            if( p >= 100 )
-                pinned++;
-            else if( p > 0 )
-                notimeout++;
+        for ( int i = 0; i < NumPartitions; i++ ) {
+            Partition& p = partitions[i];
+            SimpleMutex::scoped_lock lock(p.mutex);
+            total += p.cursors.size();
+            for ( CCById::iterator it = p.cursors.begin(); it != p.cursors.end(); it++ ) {
+                unsigned pin = it->second->_pinValue;
+                if( pin >= 100 )
+                    pinned++;
+                else if( pin > 0 )
+                    notimeout++;
+            }
         }
+        result.appendNumber("totalOpen", (int) total );
+        result.appendNumber("clientCursors_size", (int) total);
+        result.appendNumber("timedOut" , (long long) numberTimedOut.load());
         if( pinned ) 
             result.append("pinned", pinned);
         if( notimeout )
@@ -409,28 +508,37 @@ namespace mongo {
     }
 
     void ClientCursor::find( const string& ns , set<CursorId>& all ) {
-        recursive_scoped_lock lock(ccmutex);
-
-        for ( CCById::iterator i=clientCursorsById.begin(); i!=clientCursorsById.end(); ++i ) {
-            if ( i->second->_ns == ns )
-                all.insert( i->first );
+        for ( int p = 0; p < NumPartitions; p++ ) {
+            SimpleMutex::scoped_lock lock(partitions[p].mutex);
+            const CCById& cursors = partitions[p].cursors;
+            for ( CCById::const_iterator i=cursors.begin(); i!=cursors.end(); ++i ) {
+                if ( i->second->_ns == ns )
+                    all.insert( i->first );
+            }
         }
     }
 
     bool ClientCursor::erase( CursorId id ) {
-        recursive_scoped_lock lock( ccmutex );
-        ClientCursor *cursor = find_inlock( id );
-        if ( ! cursor )
-            return false;
+        ClientCursor *cursor;
+        {
+            Partition& p = partitionFor( id );
+            SimpleMutex::scoped_lock lock( p.mutex );
+            cursor = find_inlock( p, id );
+            if ( ! cursor )
+                return false;
 
-        if ( ! cc().getAuthenticationInfo()->isAuthorizedReads( nsToDatabase( cursor->ns() ) ) )
-            return false;
+            if ( ! cc().getAuthenticationInfo()->isAuthorizedReads( nsToDatabase( cursor->ns() ) ) )
+                return false;
 
-        // Must not have an active ClientCursor::Pin.
-        massert( 16089,
-                str::stream() << "Cannot kill active cursor " << id,
-                cursor->_pinValue < 100 );
-        
+            // Must not have an active ClientCursor::Pin.
+            massert( 16089,
+                    str::stream() << "Cannot kill active cursor " << id,
+                    cursor->_pinValue < 100 );
+
+            p.cursors.erase( id );
+        }
+
+        // not under the partition's lock, deleting a cursor can erase others
         delete cursor;
         return true;
     }
@@ -27,21 +27,20 @@
 
 #include "mongo/pch.h"
 
-#include <boost/thread/recursive_mutex.hpp>
-
 #include "mongo/db/cursor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher.h"
 #include "mongo/db/projection.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/d_chunk_manager.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/background.h"
 
 namespace mongo {
 
-    typedef boost::recursive_mutex::scoped_lock recursive_scoped_lock;
     typedef long long CursorId; /* passed to the client so it can send back on getMore */
     static const CursorId INVALID_CURSOR_ID = -1; // But see SERVER-5726.
     class Cursor; /* internal server cursor base class */
@@ -72,12 +71,7 @@ namespace mongo {
         public:
             Pin( long long cursorid ) :
                 _cursorid( INVALID_CURSOR_ID ) {
-                recursive_scoped_lock lock( ccmutex );
-                ClientCursor *cursor = ClientCursor::find_inlock( cursorid, true );
-                if ( cursor ) {
-                    uassert( 12051, "clientcursor already in use? driver problem?",
-                            cursor->_pinValue < 100 );
-                    cursor->_pinValue += 100;
+                if ( ClientCursor::pin( cursorid ) ) {
                     _cursorid = cursorid;
                 }
             }
@@ -85,12 +79,9 @@ namespace mongo {
                 if ( _cursorid == INVALID_CURSOR_ID ) {
                     return;
                 }
-                ClientCursor *cursor = c();
+                CursorId cursorid = _cursorid;
                 _cursorid = INVALID_CURSOR_ID;
-                if ( cursor ) {
-                    verify( cursor->_pinValue >= 100 );
-                    cursor->_pinValue -= 100;
-                }
+                ClientCursor::unpin( cursorid );
             }
             ~Pin() { DESTRUCTOR_GUARD( release(); ) }
             ClientCursor *c() const { return ClientCursor::find( _cursorid ); }
@@ -139,26 +130,6 @@ namespace mongo {
             CursorId _id;
         };
 
-        /**
-         * Iterates through all ClientCursors, under its own ccmutex lock.
-         * Also supports deletion on the fly.
-         */
-        class LockedIterator : boost::noncopyable {
-        public:
-            LockedIterator() : _lock( ccmutex ), _i( clientCursorsById.begin() ) {}
-            bool ok() const { return _i != clientCursorsById.end(); }
-            ClientCursor *current() const { return _i->second; }
-            void advance() { ++_i; }
-            /**
-             * Delete 'current' and advance. Properly handles cascading deletions that may occur
-             * when one ClientCursor is directly deleted.
-             */
-            void deleteAndAdvance();
-        private:
-            recursive_scoped_lock _lock;
-            CCById::const_iterator _i;
-        };
-        
         ClientCursor(int queryOptions, const shared_ptr<Cursor>& c, const string& ns,
                      BSONObj query = BSONObj(), const bool inMultiStatementTxn = false );
 
@@ -243,9 +214,36 @@ namespace mongo {
         ShardChunkManagerPtr getChunkManager(){ return _chunkManager; }
 
     private:
-        static ClientCursor* find_inlock(CursorId id, bool warn = true) {
-            CCById::iterator it = clientCursorsById.find(id);
-            if ( it == clientCursorsById.end() ) {
+        /**
+         * The registry of ClientCursors is split into partitions, each with its own
+         * lock, so that cursors on different partitions can be registered, found,
+         * pinned and erased without waiting for each other.  A cursor's id says which
+         * partition it's on.
+         *
+         * A partition's lock is never held while a cursor is deleted, as deleting one
+         * can end a transaction and erase others, anywhere in the registry.
+         */
+        struct Partition {
+            Partition() : mutex( "ClientCursor::Partition" ), state0( 0 ), state1( 0 ),
+                          idsUntilReseed( 0 ) {}
+            SimpleMutex mutex;
+            CCById cursors;
+            // id generator, reseeded from Security::getNonce() now and then
+            unsigned long long state0;
+            unsigned long long state1;
+            unsigned idsUntilReseed;
+        };
+
+        static const int PartitionBits = 6;
+        static const int NumPartitions = 1 << PartitionBits;
+
+        static Partition& partitionFor( CursorId id ) {
+            return partitions[ id & ( NumPartitions - 1 ) ];
+        }
+
+        static ClientCursor* find_inlock(Partition& p, CursorId id, bool warn = true) {
+            CCById::iterator it = p.cursors.find(id);
+            if ( it == p.cursors.end() ) {
                 if ( warn )
                     OCCASIONALLY out() << "ClientCursor::find(): cursor not found in map " << id << " (ok after a drop)\n";
                 return 0;
@@ -253,10 +251,22 @@ namespace mongo {
             return it->second;
         }
 
+        /** @return false if there's no such cursor, uassert if it's already pinned */
+        static bool pin( CursorId id );
+        static void unpin( CursorId id );
+
+        /**
+         * Delete every cursor for which shouldErase( cursor ) is true.  Locks one
+         * partition at a time to pick them, and none while deleting them.
+         */
+        template <typename Predicate>
+        static void eraseIf( Predicate& shouldErase );
+
     public:
         static ClientCursor* find(CursorId id, bool warn = true) {
-            recursive_scoped_lock lock(ccmutex);
-            ClientCursor *c = find_inlock(id, warn);
+            Partition& p = partitionFor(id);
+            SimpleMutex::scoped_lock lock(p.mutex);
+            ClientCursor *c = find_inlock(p, id, warn);
             // if this asserts, your code was not thread safe - you either need to set no timeout
             // for the cursor or keep a ClientCursor::Pointer in scope for it.
             massert( 12521, "internal error: use of an unlocked ClientCursor", c == 0 || c->_pinValue );
@@ -275,7 +285,7 @@ namespace mongo {
         static int erase( int n , long long * ids );
 
         /**
-         * @param millis amount of idle passed time since last call
+         * @param millis more idle time to count, on top of what has passed
          */
         bool shouldTimeout( unsigned millis );
 
@@ -283,14 +293,19 @@ namespace mongo {
         void updateSlaveLocation( CurOp& curop );
         bool lastOpForSlaveTooOld();
 
-        unsigned idleTime() const { return _idleAgeMillis; }
+        /** milliseconds of server idle time since the cursor was last unpinned */
+        unsigned idleTime() const;
         
     public: // static methods
 
+        /**
+         * Advance the idle clock by millis and time out the cursors that have been
+         * idle too long.
+         */
         static void idleTimeReport(unsigned millis);
 
         static void appendStats( BSONObjBuilder& result );
-        static unsigned numCursors() { return clientCursorsById.size(); }
+        static unsigned numCursors();
         static void find( const string& ns , set<CursorId>& all );
 
     public:
@@ -335,7 +350,7 @@ namespace mongo {
         GTID _slaveReadTill;
         uint64_t _slaveReadTillTS;
 
-        unsigned _idleAgeMillis;                 // how long has the cursor been around, relative to server idle time
+        unsigned long long _lastUsed;           // idle clock reading when last unpinned, see idleTimeReport()
 
         /* 0 = normal
            1 = no timeout allowed
@@ -352,10 +367,10 @@ namespace mongo {
 
     private: // static members
 
-        static CCById clientCursorsById;
-        static long long numberTimedOut;
-        static boost::recursive_mutex& ccmutex;   // must use this for all statics above!
-        static CursorId allocCursorId_inlock();
+        static Partition* const partitions;
+        static AtomicUInt64 idleClock;           // server idle time, in millis, see idleTimeReport()
+        static AtomicUInt64 numberTimedOut;
+        static CursorId allocCursorId_inlock( Partition& p, int partition );
 
     };
 
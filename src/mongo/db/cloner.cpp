@@ -18,6 +18,9 @@
 */
 
 #include "mongo/pch.h"
+
+#include <boost/thread/thread.hpp>
+
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/client/dbclientinterface.h"
@@ -33,6 +36,8 @@
 #include "mongo/db/database.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/storage/exception.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/queue.h"
 
 namespace mongo {
 
@@ -364,6 +369,313 @@ namespace mongo {
         return true;
     }
 
+    namespace {
+
+        // One range of a collection, read over one connection.
+        struct CloneStream {
+            size_t coll;
+            string ns;
+            long long cursorId;
+        };
+
+        struct CloneBatch {
+            CloneBatch() : coll(0), bytes(0), last(false) { }
+            size_t coll;
+            vector<BSONObj> docs;
+            size_t bytes;
+            // The stream is done, or failed with errmsg.
+            bool last;
+            string errmsg;
+        };
+
+        size_t cloneBatchSize(const CloneBatch &batch) {
+            return batch.bytes;
+        }
+
+    } // namespace
+
+    /**
+     * Copies collections over several connections at once, for initial sync.
+     *
+     * Each collection is split by parallelCollectionScan, whose cursors read
+     * the snapshot of the multi-statement transaction conn is in, so every
+     * range of every collection is read as of the same point in time.  That
+     * transaction should be read only, since its cursors are read over
+     * several connections at once.  The fetchers only see what's in the
+     * CloneStreams they're handed, never _colls, which go() may change.  A
+     * thread per extra connection reads ranges and queues their batches, and
+     * the calling thread, which holds the global write lock and the local
+     * transaction, inserts them.  Collections that can be bulk loaded are, so
+     * their indexes are built in the same pass as the data.
+     *
+     * At most parallelStreams collections are loaded at once, to bound the
+     * loaders' memory.  go() takes the collections it copied out of the list,
+     * and leaves the rest (capped, natural order, partitioned and system
+     * collections, or all of them if the source is too old to split them)
+     * for the caller to copy one at a time.
+     */
+    class ParallelCopy : boost::noncopyable {
+    public:
+        static const size_t MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+        ParallelCopy(const char *masterHost, const shared_ptr<DBClientBase> &conn,
+                     const CloneOptions &opts, const string &todb) :
+            _masterHost(masterHost), _conn(conn), _opts(opts), _todb(todb), _unsupported(false),
+            _batches(MAX_QUEUED_BYTES, cloneBatchSize) {
+        }
+
+        ~ParallelCopy() {
+            try {
+                stop();
+            } catch (const DBException &e) {
+                LOG(0) << "error stopping parallel clone of " << _opts.fromDB << ": " << e.what() << endl;
+            }
+        }
+
+        bool go(list<BSONObj> &toClone, set<string> &bulkLoaded, string &errmsg) {
+            verify(Lock::isW());
+            for (list<BSONObj>::iterator i = toClone.begin(); i != toClone.end(); ) {
+                if (loadable(*i)) {
+                    _colls.push_back(Collection(*i, _todb));
+                    i = toClone.erase(i);
+                } else {
+                    i++;
+                }
+            }
+            if (_colls.empty()) {
+                return true;
+            }
+
+            for (int i = 0; i < _opts.parallelStreams; i++) {
+                shared_ptr<DBClientConnection> c = makeConnection(_masterHost.c_str(), errmsg);
+                if (!c) {
+                    return false;
+                }
+                _conns.push_back(c);
+            }
+            for (size_t i = 0; i < _conns.size(); i++) {
+                _threads.create_thread(boost::bind(&ParallelCopy::fetch, this, _conns[i].get()));
+            }
+
+            size_t next = 0;
+            int active = 0;
+            while (next < _colls.size() || active > 0) {
+                while (next < _colls.size() && active < _opts.parallelStreams) {
+                    if (!start(next, errmsg)) {
+                        if (!_unsupported) {
+                            return false;
+                        }
+                        // Copy everything not started yet the old way.
+                        for (size_t i = next; i < _colls.size(); i++) {
+                            toClone.push_back(_colls[i].info);
+                        }
+                        _colls.erase(_colls.begin() + next, _colls.end());
+                        break;
+                    }
+                    active++;
+                    if (_colls[next++].openStreams == 0) {
+                        finish(next - 1);
+                        active--;
+                    }
+                }
+                if (active == 0) {
+                    continue;
+                }
+
+                CloneBatch batch;
+                if (!_batches.blockingPop(batch, 1)) {
+                    mayInterrupt(_opts.mayBeInterrupted);
+                    continue;
+                }
+                Collection &coll = _colls[batch.coll];
+                if (!batch.errmsg.empty()) {
+                    errmsg = str::stream() << "clone of " << coll.from << " failed: " << batch.errmsg;
+                    return false;
+                }
+                insert(coll, batch.docs);
+                if (batch.last && --coll.openStreams == 0) {
+                    finish(batch.coll);
+                    active--;
+                }
+            }
+
+            // Every cursor was read to the end.
+            _cursorIds.clear();
+            stop();
+            for (size_t i = 0; i < _colls.size(); i++) {
+                bulkLoaded.insert(_colls[i].from);
+            }
+            return true;
+        }
+
+    private:
+        struct Collection {
+            Collection(const BSONObj &collection, const string &todb) :
+                info(collection), from(collection["name"].String()),
+                to(todb + strchr(from.c_str(), '.')), openStreams(0), n(0) {
+            }
+            BSONObj info;
+            string from;
+            string to;
+            int openStreams;
+            long long n;
+        };
+
+        static bool loadable(const BSONObj &collection) {
+            const char *name = collection["name"].valuestr();
+            const BSONObj options = collection.getObjectField("options");
+            return !strstr(name, ".system.") &&
+                   !options["capped"].trueValue() &&
+                   !options["natural"].trueValue() &&
+                   !options["partitioned"].trueValue();
+        }
+
+        // Split the collection into ranges for the fetchers, and begin loading it.
+        bool start(const size_t i, string &errmsg) {
+            Collection &coll = _colls[i];
+            const char *collName = strchr(coll.from.c_str(), '.') + 1;
+            BSONObj res;
+            if (!_conn->runCommand(_opts.fromDB,
+                                   BSON("parallelCollectionScan" << collName <<
+                                        "numCursors" << _opts.parallelStreams),
+                                   res, _opts.slaveOk ? QueryOption_SlaveOk : 0)) {
+                _unsupported = str::startsWith(res["errmsg"].str(), "no such cmd");
+                errmsg = str::stream() << "could not split " << coll.from << " for cloning: " << res;
+                return false;
+            }
+
+            vector<BSONObj> indexes;
+            if (_opts.syncIndexes) {
+                auto_ptr<DBClientCursor> c = _conn->query(_opts.fromDB + ".system.indexes",
+                                                          BSON("ns" << coll.from << "name" << NE << "_id_"),
+                                                          0, 0, 0, _opts.slaveOk ? QueryOption_SlaveOk : 0);
+                while (c->more()) {
+                    indexes.push_back(fixindex(c->nextSafe(), _todb).getOwned());
+                }
+            }
+            {
+                Client::Context ctx(coll.to);
+                beginBulkLoad(coll.to, indexes, coll.info.getObjectField("options"));
+            }
+            LOG(1) << "\t\t cloning " << coll.from << " -> " << coll.to << " in parallel" << endl;
+
+            vector<BSONElement> cursors = res["cursors"].Array();
+            for (vector<BSONElement>::const_iterator it = cursors.begin(); it != cursors.end(); it++) {
+                const BSONObj cursor = it->Obj()["cursor"].Obj();
+                const BSONElement firstBatch = cursor["firstBatch"];
+                if (firstBatch.isABSONObj() && !firstBatch.Obj().isEmpty()) {
+                    vector<BSONObj> docs;
+                    for (BSONObjIterator d(firstBatch.Obj()); d.more(); ) {
+                        docs.push_back(d.next().Obj());
+                    }
+                    insert(coll, docs);
+                }
+                const long long id = cursor["id"].numberLong();
+                if (id != 0) {
+                    _cursorIds.push_back(id);
+                    CloneStream stream;
+                    stream.coll = i;
+                    stream.ns = coll.from;
+                    stream.cursorId = id;
+                    coll.openStreams++;
+                    _streams.push(stream);
+                }
+            }
+            return true;
+        }
+
+        void insert(Collection &coll, const vector<BSONObj> &docs) {
+            Client::ReadContext ctx(coll.to);
+            for (vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); it++) {
+                BSONObj js = *it;
+                try {
+                    insertObject(coll.to.c_str(), js, 0, _opts.logForRepl);
+                }
+                catch (UserException& e) {
+                    error() << "error: exception cloning object in " << coll.from << ' ' << e.what() << " obj:" << js.toString() << '\n';
+                    throw;
+                }
+            }
+            coll.n += docs.size();
+        }
+
+        void finish(const size_t i) {
+            Collection &coll = _colls[i];
+            {
+                Client::Context ctx(coll.to);
+                commitBulkLoad(coll.to);
+            }
+            log() << "clone " << coll.to << ' ' << coll.n << " objects, bulk loaded" << endl;
+        }
+
+        // Runs on each extra connection, reading one range at a time until stopped.
+        void fetch(DBClientConnection *c) {
+            while (!_stopping.load()) {
+                CloneStream stream;
+                if (!_streams.blockingPop(stream, 1)) {
+                    continue;
+                }
+                CloneBatch batch;
+                batch.coll = stream.coll;
+                try {
+                    DBClientCursor cursor(c, stream.ns, stream.cursorId, 0,
+                                          _opts.slaveOk ? QueryOption_SlaveOk : 0);
+                    while (!_stopping.load() && cursor.more()) {
+                        while (cursor.moreInCurrentBatch()) {
+                            BSONObj o = cursor.nextSafe().getOwned();
+                            batch.bytes += o.objsize();
+                            batch.docs.push_back(o);
+                        }
+                        _batches.push(batch);
+                        batch.docs.clear();
+                        batch.bytes = 0;
+                    }
+                } catch (const DBException &e) {
+                    batch.errmsg = e.toString();
+                } catch (const std::exception &e) {
+                    batch.errmsg = e.what();
+                }
+                batch.last = true;
+                _batches.push(batch);
+            }
+            _exited.fetchAndAdd(1);
+        }
+
+        // Stop the fetchers, unblocking any waiting for room in the queue, and
+        // kill the cursors they didn't finish.
+        void stop() {
+            if (_stopping.swap(1) != 0) {
+                return;
+            }
+            while (_exited.load() < _threads.size()) {
+                CloneBatch batch;
+                if (!_batches.tryPop(batch)) {
+                    sleepmillis(10);
+                }
+            }
+            _threads.join_all();
+            for (vector<long long>::const_iterator it = _cursorIds.begin(); it != _cursorIds.end(); it++) {
+                _conn->killCursor(*it);
+            }
+            _cursorIds.clear();
+        }
+
+        const string _masterHost;
+        shared_ptr<DBClientBase> _conn;
+        const CloneOptions &_opts;
+        const string _todb;
+        bool _unsupported;
+
+        deque<Collection> _colls;
+        vector<shared_ptr<DBClientConnection> > _conns;
+        vector<long long> _cursorIds;
+        boost::thread_group _threads;
+        BlockingQueue<CloneStream> _streams;
+        BlockingQueue<CloneBatch> _batches;
+        AtomicUInt32 _stopping;
+        AtomicUInt32 _exited;
+    };
+
     bool Cloner::go(
         const char *masterHost, 
         string& errmsg, 
@@ -485,6 +797,18 @@ namespace mongo {
             }
         }
 
+        // Collections whose indexes were built as they were loaded.
+        set<string> bulkLoaded;
+        if ( opts.parallelStreams > 1 && !toClone.empty() ) {
+            if (!checkCollectionsExist(*conn, opts.fromDB, toCloneNames, errmsg)) {
+                return false;
+            }
+            ParallelCopy parallelCopy(masterHost, conn, opts, todb);
+            if (!parallelCopy.go(toClone, bulkLoaded, errmsg)) {
+                return false;
+            }
+        }
+
         for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
             mayInterrupt( opts.mayBeInterrupted );
             if (!checkCollectionsExist(*conn, opts.fromDB, toCloneNames, errmsg)) {
@@ -540,6 +864,7 @@ namespace mongo {
             // build a $nin query filter for the collections we *don't* want
             BSONArrayBuilder barr;
             barr.append( opts.collsToIgnore );
+            barr.append( bulkLoaded );
             BSONArray arr = barr.arr();
             
             // Also don't copy the _id_ index
@@ -33,6 +33,8 @@ namespace mongo {
 
             syncData = true;
             syncIndexes = true;
+
+            parallelStreams = 1;
         }
             
         string fromDB;
@@ -45,6 +47,12 @@ namespace mongo {
 
         bool syncData;
         bool syncIndexes;
+
+        // If more than one, copy that many collections, or ranges of a collection, at once,
+        // each over its own connection, and bulk load the collections that can be. The
+        // connection given to cloneFrom must be in a multi-statement transaction, so that
+        // every connection reads its snapshot, and the caller must hold the global write lock.
+        int parallelStreams;
     };
 
     class DBClientBase;
@@ -123,8 +123,12 @@ namespace mongo {
         ("objcheck", "inspect client data for validity on receipt")
         ("logpath", po::value<string>() , "log file to send write to instead of stdout - has to be a file, not directory" )
         ("logappend" , "append to logpath instead of over-writing" )
+        ("logAsync" , "write the log from a background thread instead of the threads that log" )
+        ("logAsyncDrop" , "with --logAsync, drop log lines rather than wait when the log buffer is full" )
         ("pidfilepath", po::value<string>(), "full path to pidfile (if not set, no pidfile is created)")
         ("keyFile", po::value<string>(), "private key for cluster authentication")
+        ("networkCompressor", po::value<string>(),
+         "compress traffic with other servers that use the same compressor: zlib or none (default)")
         ("enableFaultInjection", "enable the fault injection framework, for debugging."
                 " DO NOT USE IN PRODUCTION")
 #ifndef _WIN32
@@ -463,6 +467,14 @@ namespace mongo {
             initLogging( logpath , params.count( "logappend" ) );
         }
 
+        if ( params.count( "logAsync" ) ) {
+            Logstream::startAsync( params.count( "logAsyncDrop" ) , 16 * 1024 );
+        }
+        else if ( params.count( "logAsyncDrop" ) ) {
+            cout << "--logAsyncDrop requires --logAsync" << endl;
+            ::_exit(EXIT_BADOPTIONS);
+        }
+
         if ( params.count("pidfilepath")) {
             writePidFile( params["pidfilepath"].as<string>() );
         }
@@ -482,6 +494,14 @@ namespace mongo {
             cmdLine.keyFile = false;
         }
 
+        if (params.count("networkCompressor")) {
+            const string compressor = params["networkCompressor"].as<string>();
+            if ( ! MessageCompressor::forName( compressor, &cmdLine.networkCompressor ) ) {
+                cout << "unknown networkCompressor " << compressor << endl;
+                ::_exit(EXIT_BADOPTIONS);
+            }
+        }
+
         if (params.count("pluginsDir")) {
             cmdLine.pluginsDir = params["pluginsDir"].as<string>();
         }
@@ -21,6 +21,7 @@
 #include "jsobj.h"
 
 #include "mongo/base/units.h"
+#include "mongo/util/net/message_compressor.h"
 
 namespace boost {
     namespace program_options {
@@ -87,6 +88,7 @@ namespace mongo {
         uint32_t logFlushPeriod; // group/batch commit interval ms
         uint32_t expireOplogDays;  // number of days before an oplog entry is eligible for removal
         uint32_t expireOplogHours; // number of hours, in addition to days above.
+        uint64_t oplogPartitionPeriodMillis; // for testing: how often to start an oplog partition, 0 for the default
 
 
         bool objcheck;         // --objcheck
@@ -103,6 +105,8 @@ namespace mongo {
 
         bool keyFile;
 
+        MessageCompressor::Id networkCompressor; // --networkCompressor
+
 #ifndef _WIN32
         pid_t parentProc;      // --fork pid of initial process
         pid_t leaderProc;      // --fork pid of leader process
@@ -121,7 +125,9 @@ namespace mongo {
         bool gdb;
         BytesQuantity<uint64_t> cacheSize;
         BytesQuantity<uint64_t> locktreeMaxMemory;
+        BytesQuantity<uint64_t> bloomFilterMaxMemory; // per unique index with { bloomFilter: true }
         uint32_t checkpointPeriod;
+        BytesQuantity<uint64_t> checkpointTargetBandwidth; // bytes/sec, 0 means checkpoint every checkpointPeriod
         uint32_t cleanerPeriod;
         uint32_t cleanerIterations;
         uint64_t lockTimeout;
@@ -164,10 +170,11 @@ namespace mongo {
         configsvr(false), quota(false), quotaFiles(8), cpu(false),
         logFlushPeriod(100), // 0 means fsync every transaction, 100 means fsync log once every 100 ms
         expireOplogDays(0), expireOplogHours(0), // default of 0 means never purge entries from oplog
+        oplogPartitionPeriodMillis(0),
         objcheck(false), defaultProfile(0),
         slowMS(100), defaultLocalThresholdMillis(15), moveParanoia( true ),
         syncdelay(60), noUnixSocket(false), doFork(0), socket("/tmp"),
-        directio(false), cacheSize(0), locktreeMaxMemory(0), checkpointPeriod(60), cleanerPeriod(2),
+        networkCompressor(MessageCompressor::NONE), directio(false), cacheSize(0), locktreeMaxMemory(0), bloomFilterMaxMemory(64ULL<<20), checkpointPeriod(60), checkpointTargetBandwidth(0), cleanerPeriod(2),
         cleanerIterations(5), lockTimeout(4000), fsRedzone(5), logDir(""), tmpDir(""), gdbPath(""),
         txnMemLimit(1ULL<<20), pluginsDir(), plugins()
     {
@@ -80,6 +80,14 @@ namespace mongo {
         */
         virtual bool lockGlobally() const { return false; }
 
+        /** DDL that changes only one or two collections can lock just those, exclusively,
+            instead of the whole database (or everything, if lockGlobally()).  To do that,
+            fill in their namespaces, all in one database; leave it empty to lock as usual.
+            See Lock::CollectionWrite.
+        */
+        virtual void lockedCollections(const string& dbname, const BSONObj& cmdObj,
+                                       vector<string>& namespaces) const { }
+
         /** @return true iff this command wants a transaction */
         virtual bool needsTxn() const = 0;
 
@@ -35,6 +35,7 @@ namespace mongo {
 
         /* CmdObj has the form {"hash" : <thingToHash>}
          * or {"hash" : <thingToHash>, "seed" : <number> }
+         * or {"hash" : <thingToHash>, "seed" : <number>, "hashVersion" : <number> }
          * Result has the form
          * {"key" : <thingTohash>, "seed" : <int>, "out": NumberLong(<hash>)}
          *
@@ -62,7 +63,17 @@ namespace mongo {
             }
             result.append( "seed" , seed );
 
-            result.append( "out" , BSONElementHasher::hash64( cmdObj.firstElement() , seed ) );
+            HashVersion hashVersion = HASH_VERSION_MD5;
+            if (cmdObj.hasField("hashVersion")){
+                hashVersion = cmdObj["hashVersion"].numberInt();
+                if (! cmdObj["hashVersion"].isNumber() || ! isValidHashVersion(hashVersion)) {
+                    errmsg += "hashVersion must be a known hash version";
+                    return false;
+                }
+                result.append( "hashVersion" , hashVersion );
+            }
+
+            result.append( "out" , BSONElementHasher::hash64( cmdObj.firstElement() , seed , hashVersion ) );
             return true;
         }
     } cmdHashElt;
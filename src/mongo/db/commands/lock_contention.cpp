@@ -0,0 +1,90 @@
+// lock_contention.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/commands.h"
+#include "mongo/db/stats/lock_contention.h"
+#include "mongo/db/storage/env.h"
+
+namespace mongo {
+
+    /* { lockContention : 1 } reports row lock waits by (ns, index, query pattern)
+     * { lockContention : 1, enable : <bool> } turns the profiler on or off
+     * { lockContention : 1, thresholdMillis : <n>, sampleMillis : <n> } changes what it records
+     * { lockContention : 1, reset : true } forgets what it has recorded
+     * { lockContention : 1, limit : <n> } reports only the n patterns that waited longest
+     */
+    class CmdLockContention : public InformationCommand {
+    public:
+        CmdLockContention() : InformationCommand("lockContention") {}
+        virtual bool adminOnly() const { return true; }
+        virtual void help( stringstream& help ) const {
+            help << "row lock waits longer than thresholdMillis, by namespace, index and query pattern\n"
+                 << "{ lockContention : 1, enable : true|false, thresholdMillis : <default 100>, "
+                 << "sampleMillis : <default 20>, reset : true, limit : <default 100> }";
+        }
+
+        bool run( const string& db, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool fromRepl ) {
+            LockContentionProfile& profile = LockContentionProfile::global;
+
+            BSONElement enable = cmdObj["enable"];
+            if ( ! enable.eoo() && ! enable.isBoolean() && ! enable.isNumber() ) {
+                errmsg = "enable must be a boolean";
+                return false;
+            }
+            BSONElement threshold = cmdObj["thresholdMillis"];
+            if ( ! threshold.eoo() && ( ! threshold.isNumber() || threshold.numberLong() < 0 ) ) {
+                errmsg = "thresholdMillis must be a number, at least 0";
+                return false;
+            }
+            BSONElement sample = cmdObj["sampleMillis"];
+            if ( ! sample.eoo() && ( ! sample.isNumber() ||
+                                     sample.numberLong() < 1 || sample.numberLong() > 60000 ) ) {
+                errmsg = "sampleMillis must be between 1 and 60000";
+                return false;
+            }
+            const int limit = cmdObj["limit"].isNumber() ? cmdObj["limit"].numberInt() : 100;
+            if ( limit < 0 ) {
+                errmsg = "limit must not be negative";
+                return false;
+            }
+
+            if ( ! threshold.eoo() ) {
+                profile.setThresholdMillis( (unsigned) std::min( threshold.numberLong(), 0xffffffffLL ) );
+            }
+            if ( ! sample.eoo() ) {
+                profile.setSampleMillis( (unsigned) sample.numberLong() );
+            }
+            if ( ! enable.eoo() ) {
+                if ( enable.trueValue() ) {
+                    storage::start_lock_contention_sampler();
+                }
+                profile.setEnabled( enable.trueValue() );
+            }
+            if ( cmdObj["reset"].trueValue() ) {
+                profile.reset();
+            }
+
+            profile.append( result , limit );
+            return true;
+        }
+    } cmdLockContention;
+
+} // namespace mongo
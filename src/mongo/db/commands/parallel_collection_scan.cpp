@@ -0,0 +1,153 @@
+// parallel_collection_scan.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/clientcursor.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/namespacestring.h"
+
+namespace mongo {
+
+    /* { parallelCollectionScan : <collection>, numCursors : <n> }
+     *
+     * Splits the collection's primary key into at most n ranges of about the
+     * same size, by the ydb's estimates, and returns a cursor over each, for
+     * getMore from as many connections.  The cursors share one read-only
+     * snapshot transaction, so together they see the collection as of the
+     * command; the last cursor to finish or be killed ends it.
+     *
+     * In a multi-statement transaction, the cursors read its snapshot
+     * instead, so that a client can scan several collections in parallel as
+     * of one point in time (see initial sync).  They are read from other
+     * connections, since this one is in the transaction, and must be
+     * exhausted or killed before the transaction is committed.
+     */
+    class CmdParallelCollectionScan : public QueryCommand {
+    public:
+        static const int MAX_CURSORS = 10000;
+
+        CmdParallelCollectionScan() : QueryCommand("parallelCollectionScan") {}
+        // The cursors keep the transaction, so run() begins it itself rather
+        // than having one committed when it returns.
+        virtual bool needsTxn() const { return false; }
+        virtual int txnFlags() const { return noTxnFlags(); }
+        virtual bool canRunInMultiStmtTxn() const { return true; }
+        virtual bool requiresAuth() { return true; }
+        virtual void help( stringstream& help ) const {
+            help << "returns cursors over disjoint ranges of a collection, in one snapshot\n"
+                 << "{ parallelCollectionScan : <collection>, numCursors : <n> }";
+        }
+
+        bool run( const string& dbname, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool fromRepl ) {
+            const string coll = cmdObj.firstElement().valuestrsafe();
+            if ( coll.empty() ) {
+                errmsg = "no collection name specified";
+                return false;
+            }
+            const string ns = dbname + "." + coll;
+            if ( ! NamespaceString::normal( ns.c_str() ) ) {
+                errmsg = "bad namespace name";
+                return false;
+            }
+            BSONElement numCursors = cmdObj["numCursors"];
+            if ( ! numCursors.isNumber() ||
+                 numCursors.numberLong() < 1 || numCursors.numberLong() > MAX_CURSORS ) {
+                errmsg = str::stream() << "numCursors must be between 1 and " << MAX_CURSORS;
+                return false;
+            }
+
+            NamespaceDetails *d = nsdetails( ns );
+            if ( d == NULL ) {
+                errmsg = "ns does not exist";
+                return false;
+            }
+
+            // The cursors must go before the transaction they were opened in,
+            // if something goes wrong before they're handed off.
+            const bool inMultiStatementTxn = cc().hasTxn();
+            scoped_ptr<Client::Transaction> transaction( inMultiStatementTxn ? NULL :
+                    new Client::Transaction( DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY ) );
+            vector<BSONObj> splitPoints;
+            Helpers::pkSplitPoints( d , numCursors.numberInt() , splitPoints );
+
+            OwnedPointerVector<ClientCursor::Holder> cursors;
+            for ( size_t i = 0; i <= splitPoints.size(); i++ ) {
+                const BSONObj min = i == 0 ? BSONObj() : splitPoints[i - 1];
+                const BSONObj max = i == splitPoints.size() ? BSONObj() : splitPoints[i];
+                shared_ptr<Cursor> c = Helpers::pkRangeCursor( d , min , max );
+                cursors.vector().push_back( new ClientCursor::Holder( new ClientCursor( 0 , c , ns ) ) );
+            }
+
+            // Hand the transaction to the cursors, or share the client's.
+            {
+                shared_ptr<Client::TransactionStack> stack = cc().txnStack();
+                if ( ! inMultiStatementTxn ) {
+                    stack.reset();
+                    cc().swapTransactionStack( stack );
+                }
+                for ( size_t i = 0; i < cursors.vector().size(); i++ ) {
+                    ClientCursor::Holder &holder = *cursors.vector()[i];
+                    holder->transactions = stack;
+                    // They may be read on other connections, but they still
+                    // go if the transaction rolls back.
+                    if ( inMultiStatementTxn ) {
+                        cc().txn().clientCursorRollback().noteClientCursor( holder->cursorid() );
+                    }
+                }
+            }
+
+            BSONArrayBuilder arr( result.subarrayStart( "cursors" ) );
+            for ( size_t i = 0; i < cursors.vector().size(); i++ ) {
+                ClientCursor::Holder &holder = *cursors.vector()[i];
+                BSONObjBuilder b( arr.subobjStart() );
+                {
+                    BSONObjBuilder cursor( b.subobjStart( "cursor" ) );
+                    cursor.append( "id" , holder->cursorid() );
+                    cursor.append( "ns" , ns );
+                    cursor.append( "firstBatch" , BSONArray() );
+                    cursor.done();
+                }
+                {
+                    BSONObjBuilder range( b.subobjStart( "range" ) );
+                    if ( i > 0 ) {
+                        range.append( "min" , splitPoints[i - 1] );
+                    }
+                    if ( i < splitPoints.size() ) {
+                        range.append( "max" , splitPoints[i] );
+                    }
+                    range.done();
+                }
+                b.appendBool( "ok" , true );
+                b.done();
+            }
+            arr.done();
+
+            for ( size_t i = 0; i < cursors.vector().size(); i++ ) {
+                cursors.vector()[i]->release();
+            }
+            return true;
+        }
+    } cmdParallelCollectionScan;
+
+} // namespace mongo
@@ -0,0 +1,160 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/client.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/oplog_helpers.h"
+#include "mongo/db/repl/rs_optime.h"
+
+namespace mongo {
+
+    // Partitioned collections are created with { create: <coll>, partitioned: true }.
+    // These commands manage the partitions of such a collection. The ones that change
+    // the partitioning log themselves, with any defaults resolved, so that secondaries
+    // end up with exactly the same partitions as the primary.
+
+    static NamespaceDetails *partitionedDetails(const string &ns) {
+        NamespaceDetails *d = nsdetails(ns);
+        uassert( 17026, str::stream() << "ns not found: " << ns, d != NULL );
+        uassert( 17027, str::stream() << ns << " is not a partitioned collection", d->isPartitioned() );
+        return d;
+    }
+
+    // The purge thread adds and drops the oplog's partitions as its history expires, and
+    // keeps the oplog open across them, so nobody else may.
+    static NamespaceDetails *repartitionableDetails(const string &ns) {
+        uassert( 17061, "The oplog's partitions are managed by the server.", ns != rsoplog );
+        return partitionedDetails(ns);
+    }
+
+    class AddPartitionCmd : public FileopsCommand {
+    public:
+        AddPartitionCmd() : FileopsCommand("addPartition") {}
+        // Creates a dictionary, which a multi-statement transaction shouldn't hold open.
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual bool logTheOp() { return false; } // logged in run() with the resolved max
+        virtual bool slaveOk() const { return false; }
+        virtual bool adminOnly() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "add partition" << endl <<
+                "Closes the last partition of a partitioned collection and starts a new one." << endl <<
+                "The closed partition keeps every _id up to newMax, or up to its greatest _id." << endl <<
+                "{ addPartition: <collName>[, newMax: { _id: <value> }] }" << endl;
+        }
+
+        virtual bool run(const string& db,
+                         BSONObj& cmdObj,
+                         int options,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl)
+        {
+            const string coll = cmdObj.firstElement().valuestrsafe();
+            uassert( 17028, "must pass name of collection to addPartition", !coll.empty() );
+            const string ns = db + "." + coll;
+            NamespaceDetails *d = repartitionableDetails(ns);
+
+            BSONObj newMaxPK;
+            const BSONElement e = cmdObj["newMax"];
+            if (e.ok()) {
+                uassert( 17029, "newMax must be an object of the form { _id: <value> }",
+                                e.type() == mongo::Object && e.Obj().nFields() == 1 && e.Obj()["_id"].ok() );
+                newMaxPK = e.Obj()["_id"].wrap("");
+            }
+
+            const BSONObj maxPK = d->addPartition(newMaxPK).replaceFieldNames(d->pkPattern());
+            if (!fromRepl) {
+                OpLogHelpers::logCommand((db + ".$cmd").c_str(),
+                                         BSON("addPartition" << coll << "newMax" << maxPK),
+                                         &cc().txn());
+            }
+            result.append("max", maxPK);
+            return true;
+        }
+    } addPartitionCmd;
+
+    class DropPartitionCmd : public FileopsCommand {
+    public:
+        DropPartitionCmd() : FileopsCommand("dropPartition") {}
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual bool logTheOp() { return false; } // logged in run() with the resolved id
+        virtual bool slaveOk() const { return false; }
+        virtual bool adminOnly() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "drop partition" << endl <<
+                "Drops a partition of a partitioned collection, and every document in it." << endl <<
+                "Drops the oldest partition unless a partition id is given." << endl <<
+                "{ dropPartition: <collName>[, id: <partition id>] }" << endl;
+        }
+
+        virtual bool run(const string& db,
+                         BSONObj& cmdObj,
+                         int options,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl)
+        {
+            const string coll = cmdObj.firstElement().valuestrsafe();
+            uassert( 17030, "must pass name of collection to dropPartition", !coll.empty() );
+            const string ns = db + "." + coll;
+            NamespaceDetails *d = repartitionableDetails(ns);
+
+            long long id = -1;
+            const BSONElement e = cmdObj["id"];
+            if (e.ok()) {
+                uassert( 17031, "id must be a non-negative number", e.isNumber() && e.numberLong() >= 0 );
+                id = e.numberLong();
+            }
+
+            const long long droppedId = d->dropPartition(id);
+            if (!fromRepl) {
+                OpLogHelpers::logCommand((db + ".$cmd").c_str(),
+                                         BSON("dropPartition" << coll << "id" << droppedId),
+                                         &cc().txn());
+            }
+            result.append("dropped", droppedId);
+            return true;
+        }
+    } dropPartitionCmd;
+
+    class GetPartitionInfoCmd : public QueryCommand {
+    public:
+        GetPartitionInfoCmd() : QueryCommand("getPartitionInfo") {}
+        virtual bool adminOnly() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "get partition info" << endl <<
+                "Lists the partitions of a partitioned collection and the greatest _id each may hold." << endl <<
+                "{ getPartitionInfo: <collName> }" << endl;
+        }
+
+        virtual bool run(const string& db,
+                         BSONObj& cmdObj,
+                         int options,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl)
+        {
+            const string coll = cmdObj.firstElement().valuestrsafe();
+            uassert( 17032, "must pass name of collection to getPartitionInfo", !coll.empty() );
+            NamespaceDetails *d = partitionedDetails(db + "." + coll);
+            d->getPartitionInfo(result);
+            return true;
+        }
+    } getPartitionInfoCmd;
+
+} // namespace mongo
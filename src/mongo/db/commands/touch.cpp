@@ -83,6 +83,19 @@ namespace mongo {
                 return false;
             }
 
+            if (nsd->isPartitioned()) {
+                // The partitions are where the data and index entries actually live.
+                for (int i = 0; i < nsd->numPartitions(); i++) {
+                    touch(nsd->getPartition(i), touch_data, touch_indexes);
+                }
+            } else {
+                touch(nsd, touch_data, touch_indexes);
+            }
+
+            return true;
+        }
+
+        void touch( NamespaceDetails *nsd, bool touch_data, bool touch_indexes ) {
             for (int i = 0; i < nsd->nIndexes(); i++) {
                 IndexDetails &idx = nsd->idx(i);
                 if ((nsd->isPKIndex(idx) && touch_data) || (!nsd->isPKIndex(idx) && touch_indexes)) {
@@ -91,8 +104,6 @@ namespace mongo {
                     }
                 }
             }
-
-            return true;
         }
     } touchCmd;
 
@@ -0,0 +1,133 @@
+// tracepoints.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/commands.h"
+#include "mongo/util/stack_sampler.h"
+#include "mongo/util/tracepoint.h"
+
+namespace mongo {
+
+    /* { tracepoints : 1 } reports the time spent at each tracepoint
+     * { tracepoints : 1, enable : <bool> } turns tracing on or off
+     * { tracepoints : 1, reset : true } zeroes every tracepoint
+     */
+    class CmdTracepoints : public InformationCommand {
+    public:
+        CmdTracepoints() : InformationCommand("tracepoints") {}
+        virtual bool adminOnly() const { return true; }
+        virtual void help( stringstream& help ) const {
+            help << "time spent in locks, ydb calls, network i/o and query plans, in micros\n"
+                 << "{ tracepoints : 1, enable : true|false, reset : true }";
+        }
+
+        bool run( const string& db, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool fromRepl ) {
+            BSONElement enable = cmdObj["enable"];
+            if ( ! enable.eoo() ) {
+                if ( ! enable.isBoolean() && ! enable.isNumber() ) {
+                    errmsg = "enable must be a boolean";
+                    return false;
+                }
+                Tracepoint::setEnabled( enable.trueValue() );
+            }
+
+            const TracepointMap& tracepoints = getTracepoints();
+            if ( cmdObj["reset"].trueValue() ) {
+                for ( TracepointMap::const_iterator i = tracepoints.begin(); i != tracepoints.end(); ++i ) {
+                    i->second->reset();
+                }
+            }
+
+            result.appendBool( "enabled" , Tracepoint::enabled() );
+            BSONObjBuilder b( result.subobjStart( "tracepoints" ) );
+            for ( TracepointMap::const_iterator i = tracepoints.begin(); i != tracepoints.end(); ++i ) {
+                BSONObjBuilder bb( b.subobjStart( i->first ) );
+                i->second->append( bb );
+                bb.done();
+            }
+            b.done();
+            return true;
+        }
+    } cmdTracepoints;
+
+    /* { sampleStacks : <seconds>, hz : <samples per CPU-second>, limit : <stacks> }
+     *
+     * Samples the stacks of running threads for a while and returns them
+     * folded, busiest first.  For a flame graph, print each as
+     * stack + " " + count and feed the lines to flamegraph.pl.
+     */
+    class CmdSampleStacks : public InformationCommand {
+    public:
+        CmdSampleStacks() : InformationCommand("sampleStacks") {}
+        virtual bool adminOnly() const { return true; }
+        virtual void help( stringstream& help ) const {
+            help << "sample the stacks of running threads and return them folded, for flame graphs\n"
+                 << "{ sampleStacks : <seconds, default 5>, hz : <default 99>, limit : <default 1000> }";
+        }
+
+        bool run( const string& db, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool fromRepl ) {
+            double seconds = 5;
+            if ( cmdObj.firstElement().isNumber() ) {
+                seconds = cmdObj.firstElement().numberDouble();
+            }
+            const int hz = cmdObj["hz"].isNumber() ? cmdObj["hz"].numberInt() : 99;
+            const int limit = cmdObj["limit"].isNumber() ? cmdObj["limit"].numberInt() : 1000;
+            if ( seconds <= 0 || seconds > 60 ) {
+                errmsg = "seconds must be more than 0 and at most 60";
+                return false;
+            }
+            if ( hz < 1 || hz > 1000 ) {
+                errmsg = "hz must be between 1 and 1000";
+                return false;
+            }
+            if ( limit < 1 ) {
+                errmsg = "limit must be positive";
+                return false;
+            }
+
+            StackSampler::Profile profile;
+            if ( ! StackSampler::run( (int) ( seconds * 1000 ) , hz , profile , errmsg ) ) {
+                return false;
+            }
+
+            // busiest first
+            vector<pair<long long, const string*> > stacks;
+            for ( map<string, long long>::const_iterator i = profile.stacks.begin(); i != profile.stacks.end(); ++i ) {
+                stacks.push_back( make_pair( -i->second , &i->first ) );
+            }
+            sort( stacks.begin() , stacks.end() );
+
+            result.append( "seconds" , seconds );
+            result.append( "hz" , hz );
+            result.appendNumber( "samples" , profile.samples );
+            result.appendNumber( "lost" , profile.lost );
+            BSONArrayBuilder arr( result.subarrayStart( "stacks" ) );
+            const size_t shown = std::min( stacks.size() , (size_t) limit );
+            for ( size_t i = 0; i < shown; i++ ) {
+                arr.append( BSON( "stack" << *stacks[i].second << "count" << -stacks[i].first ) );
+            }
+            arr.done();
+            result.appendBool( "truncated" , shown < stacks.size() );
+            return true;
+        }
+    } cmdSampleStacks;
+
+} // namespace mongo
@@ -30,8 +30,9 @@ namespace mongo {
         virtual void help( stringstream& help ) const {
             help << "begin transaction\n"
                 "Create a transaction for multiple statements.\n"
-                "{ beginTransaction, [isolation : ]  }\n"
-                " Possible values for isolation: serializable, mvcc (default), readUncommitted \n";
+                "{ beginTransaction, [isolation : ], [readOnly : true]  }\n"
+                " Possible values for isolation: serializable, mvcc (default), readUncommitted \n"
+                " A readOnly transaction refuses writes, so its cursors may be read concurrently.\n";
         }
         BeginTransactionCmd() : InformationCommand("beginTransaction") {}
 
@@ -66,6 +67,9 @@ namespace mongo {
                     uasserted(16739, "invalid isolation passed in");
                 }
             }
+            if (cmdObj["readOnly"].trueValue()) {
+                iso_flags |= DB_TXN_READ_ONLY;
+            }
 
             // We disallow clients from _explicitly_ creating child transactions.
             // If we ever change this, we'll have to make sure that the child
@@ -70,6 +70,8 @@ namespace mongo {
         bool fastmodinsert;  // upsert of an $operation. builds a default object
         bool upsert;         // true if the update actually did an insert
         int keyUpdates;
+        long long arenaAllocs;  // buffers served by the client's BufArena
+        long long arenaMallocs; // and the mallocs it needed for them
 
         // error handling
         ExceptionInfo exceptionInfo;
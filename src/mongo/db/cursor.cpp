@@ -20,6 +20,7 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/queryutil.h"
 
 namespace mongo {
 
@@ -42,7 +43,9 @@ namespace mongo {
     }
 
     shared_ptr<Cursor> BasicCursor::make( NamespaceDetails *d, int direction ) {
-        if ( d != NULL ) {
+        if ( d != NULL && d->isPartitioned() ) {
+            return PartitionedCursor::make(d, direction);
+        } else if ( d != NULL ) {
             return shared_ptr<Cursor>(new BasicCursor(d, direction));
         } else {
             return shared_ptr<Cursor>(new DummyCursor(direction));
@@ -53,4 +56,228 @@ namespace mongo {
         IndexScanCursor( d, d->getPKIndex(), direction ) {
     }
 
+    shared_ptr<Cursor> PartitionedCursor::make( NamespaceDetails *d, int direction ) {
+        return shared_ptr<Cursor>( new PartitionedCursor( d, NULL, BSONObj(), BSONObj(), true,
+                                                          shared_ptr<FieldRangeVector>(), 0,
+                                                          direction, 0 ) );
+    }
+
+    shared_ptr<Cursor> PartitionedCursor::make( NamespaceDetails *d, const IndexDetails &idx,
+                                                const BSONObj &startKey, const BSONObj &endKey,
+                                                bool endKeyInclusive, int direction,
+                                                int numWanted ) {
+        return shared_ptr<Cursor>( new PartitionedCursor( d, &idx, startKey, endKey, endKeyInclusive,
+                                                          shared_ptr<FieldRangeVector>(), 0,
+                                                          direction, numWanted ) );
+    }
+
+    shared_ptr<Cursor> PartitionedCursor::make( NamespaceDetails *d, const IndexDetails &idx,
+                                                const shared_ptr< FieldRangeVector > &bounds,
+                                                int singleIntervalLimit, int direction,
+                                                int numWanted ) {
+        return shared_ptr<Cursor>( new PartitionedCursor( d, &idx, BSONObj(), BSONObj(), true,
+                                                          bounds, singleIntervalLimit,
+                                                          direction, numWanted ) );
+    }
+
+    PartitionedCursor::PartitionedCursor( NamespaceDetails *d, const IndexDetails *idx,
+                                          const BSONObj &startKey, const BSONObj &endKey,
+                                          bool endKeyInclusive, const shared_ptr< FieldRangeVector > &bounds,
+                                          int singleIntervalLimit, int direction, int numWanted ) :
+        _d(d),
+        _indexName(idx != NULL ? idx->indexName() : ""),
+        _keyPattern(idx != NULL ? idx->keyPattern() : BSONObj()),
+        _ordering(Ordering::make(idx != NULL ? idx->keyPattern() : d->pkPattern())),
+        _merge(idx != NULL && !d->isPKIndex(*idx)),
+        _multiKey(idx != NULL && d->isMultikey(d->idxNo(*idx))),
+        _direction(direction),
+        _numWanted(numWanted),
+        _startKey(startKey),
+        _endKey(endKey),
+        _endKeyInclusive(endKeyInclusive),
+        _bounds(bounds),
+        _singleIntervalLimit(singleIntervalLimit),
+        _nextPartition(0),
+        _current(NULL),
+        _nscannedExhausted(0),
+        _tailable(false),
+        _tailPartition(0) {
+        verify( _d != NULL && _d->isPartitioned() );
+        if ( _bounds ) {
+            _startKey = _bounds->startKey();
+            _endKey = _bounds->endKey();
+        }
+
+        // Only primary key scans can skip partitions, since the partitions are
+        // laid out by primary key.
+        const bool prune = idx != NULL && !_merge;
+        const int n = _d->numPartitions();
+        for ( int i = 0; i < n; i++ ) {
+            const int p = _direction > 0 ? i : n - 1 - i;
+            if ( !prune || partitionIntersectsBounds( p > 0 ? _d->partitionMaxPK(p - 1) : BSONObj(),
+                                                      _d->partitionMaxPK(p) ) ) {
+                _partitions.push_back( _d->getPartition(p) );
+            }
+        }
+
+        if ( _merge ) {
+            for ( ; _nextPartition < _partitions.size(); _nextPartition++ ) {
+                _cursors.push_back( makeSubCursor( _partitions[_nextPartition] ) );
+            }
+        }
+        if ( _cursors.empty() ) {
+            _cursors.push_back( shared_ptr<Cursor>( new DummyCursor( _direction ) ) );
+        }
+        _current = _cursors[0].get();
+        if ( _merge ) {
+            pickMergeCursor();
+        } else {
+            skipExhaustedPartitions();
+        }
+    }
+
+    bool PartitionedCursor::partitionIntersectsBounds(const BSONObj &prevMaxPK, const BSONObj &maxPK) const {
+        const bool forward = _startKey.woCompare( _endKey, BSONObj(), false ) <= 0;
+        const BSONObj &low = forward ? _startKey : _endKey;
+        const BSONObj &high = forward ? _endKey : _startKey;
+        return maxPK.woCompare( low, BSONObj(), false ) >= 0 &&
+               ( prevMaxPK.isEmpty() || prevMaxPK.woCompare( high, BSONObj(), false ) < 0 );
+    }
+
+    shared_ptr<Cursor> PartitionedCursor::makeSubCursor(NamespaceDetails *partition) const {
+        shared_ptr<Cursor> c;
+        if ( _indexName.empty() ) {
+            c = BasicCursor::make( partition, _direction );
+        } else {
+            const int idxNo = partition->findIndexByName( _indexName );
+            massert( 17023, str::stream() << "bug: index " << _indexName <<
+                            " is missing from a partition", idxNo >= 0 );
+            const IndexDetails &idx = partition->idx( idxNo );
+            if ( _bounds ) {
+                c = IndexCursor::make( partition, idx, _bounds, _singleIntervalLimit,
+                                       _direction, _numWanted );
+            } else {
+                c = IndexCursor::make( partition, idx, _startKey, _endKey, _endKeyInclusive,
+                                       _direction, _numWanted );
+            }
+        }
+        if ( _tailable ) {
+            c->setTailable();
+        }
+        if ( _matcher ) {
+            c->setMatcher( _matcher );
+        }
+        if ( _keyFieldsOnly ) {
+            c->setKeyFieldsOnly( _keyFieldsOnly );
+        }
+        return c;
+    }
+
+    void PartitionedCursor::skipExhaustedPartitions() {
+        while ( !_current->ok() && _nextPartition < _partitions.size() ) {
+            // Close the finished partition's cursor before opening the next one.
+            _nscannedExhausted += _current->nscanned();
+            _cursors[0] = makeSubCursor( _partitions[_nextPartition++] );
+            _current = _cursors[0].get();
+        }
+    }
+
+    void PartitionedCursor::skipSettledPartitions() {
+        while ( !_current->ok() && _tailPartition < _d->numPartitions() - 1 &&
+                _d->minUnsafeKey().woCompare( _d->partitionMaxPK( _tailPartition ), BSONObj(), false ) > 0 ) {
+            _nscannedExhausted += _current->nscanned();
+            _cursors[0] = makeSubCursor( _d->getPartition( ++_tailPartition ) );
+            _current = _cursors[0].get();
+        }
+    }
+
+    void PartitionedCursor::setTailable() {
+        verify( !_merge && _direction > 0 );
+        _tailable = true;
+        // The constructor skipped partitions that are empty for now, but a late
+        // transaction may still write to them. Start over from the partition that
+        // owns the start key, this time with tailable cursors.
+        const int n = _d->numPartitions();
+        for ( _tailPartition = 0; _tailPartition < n - 1; _tailPartition++ ) {
+            if ( _startKey.isEmpty() ||
+                 _d->partitionMaxPK( _tailPartition ).woCompare( _startKey, BSONObj(), false ) >= 0 ) {
+                break;
+            }
+        }
+        _nscannedExhausted += _current->nscanned();
+        _cursors[0] = makeSubCursor( _d->getPartition( _tailPartition ) );
+        _current = _cursors[0].get();
+        skipSettledPartitions();
+    }
+
+    void PartitionedCursor::pickMergeCursor() {
+        Cursor *best = NULL;
+        for ( vector< shared_ptr<Cursor> >::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it ) {
+            Cursor *c = it->get();
+            if ( !c->ok() ) {
+                continue;
+            }
+            if ( best == NULL ) {
+                best = c;
+                continue;
+            }
+            int cmp = c->currKey().woCompare( best->currKey(), _ordering );
+            if ( cmp == 0 ) {
+                cmp = c->currPK().woCompare( best->currPK() );
+            }
+            if ( cmp * _direction < 0 ) {
+                best = c;
+            }
+        }
+        if ( best != NULL ) {
+            _current = best;
+        }
+    }
+
+    bool PartitionedCursor::ok() {
+        return _current->ok();
+    }
+
+    bool PartitionedCursor::advance() {
+        _current->advance();
+        if ( _merge ) {
+            pickMergeCursor();
+        } else if ( _tailable ) {
+            skipSettledPartitions();
+        } else {
+            skipExhaustedPartitions();
+        }
+        return ok();
+    }
+
+    string PartitionedCursor::toString() const {
+        return _current->toString();
+    }
+
+    BSONObj PartitionedCursor::prettyIndexBounds() const {
+        return _current->prettyIndexBounds();
+    }
+
+    void PartitionedCursor::setMatcher( shared_ptr< CoveredIndexMatcher > matcher ) {
+        _matcher = matcher;
+        for ( vector< shared_ptr<Cursor> >::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it ) {
+            (*it)->setMatcher( matcher );
+        }
+    }
+
+    void PartitionedCursor::setKeyFieldsOnly( const shared_ptr<Projection::KeyOnly> &keyFieldsOnly ) {
+        _keyFieldsOnly = keyFieldsOnly;
+        for ( vector< shared_ptr<Cursor> >::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it ) {
+            (*it)->setKeyFieldsOnly( keyFieldsOnly );
+        }
+    }
+
+    long long PartitionedCursor::nscanned() const {
+        long long n = _nscannedExhausted;
+        for ( vector< shared_ptr<Cursor> >::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it ) {
+            n += (*it)->nscanned();
+        }
+        return n;
+    }
+
 } // namespace mongo
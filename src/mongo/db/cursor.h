@@ -36,7 +36,7 @@ namespace mongo {
      * concept and is for the user's cursor.
      *
      * WARNING concurrency: the vfunctions below are called back from within a
-     * ClientCursor::ccmutex.  Don't cause a deadlock, you've been warned.
+     * ClientCursor registry partition's lock.  Don't cause a deadlock, you've been warned.
      */
     class Cursor : boost::noncopyable {
     public:
@@ -414,6 +414,121 @@ namespace mongo {
         BasicCursor( NamespaceDetails *d, int direction );
     };
 
+    /**
+     * Cursor over a partitioned collection, built from ordinary cursors over its partitions.
+     *
+     * Partitions own disjoint, increasing ranges of the primary key, so scans over the
+     * primary key visit the partitions one after another (skipping those whose range
+     * cannot intersect the bounds) and only open a partition's cursor when they get to
+     * it. Scans over a secondary index merge the partitions' cursors by key and then pk.
+     *
+     * A tailable scan (only the partitioned oplog allows one) stays in a partition until
+     * nothing more can appear in it, and finds partitions added after it started.
+     */
+    class PartitionedCursor : public Cursor {
+    public:
+        // Create a table scan cursor, like BasicCursor::make().
+        static shared_ptr<Cursor> make( NamespaceDetails *d, int direction = 1 );
+
+        // Create a cursor over a specific start, end key range, like IndexCursor::make().
+        static shared_ptr<Cursor> make( NamespaceDetails *d, const IndexDetails &idx,
+                                        const BSONObj &startKey, const BSONObj &endKey,
+                                        bool endKeyInclusive, int direction,
+                                        int numWanted = 0 );
+
+        // Create a cursor over a set of one or more field ranges, like IndexCursor::make().
+        static shared_ptr<Cursor> make( NamespaceDetails *d, const IndexDetails &idx,
+                                        const shared_ptr< FieldRangeVector > &bounds,
+                                        int singleIntervalLimit, int direction,
+                                        int numWanted = 0 );
+
+        bool ok();
+        bool advance();
+        bool supportGetMore() { return true; }
+
+        void setTailable();
+        bool tailable() const { return _tailable; }
+
+        bool getsetdup(const BSONObj &pk) {
+            if ( _multiKey ) {
+                pair<set<BSONObj>::iterator, bool> p = _dups.insert(pk.copy());
+                return !p.second;
+            }
+            return false;
+        }
+
+        bool modifiedKeys() const { return _multiKey; }
+        bool isMultiKey() const { return _multiKey; }
+
+        BSONObj currPK() const { return _current->currPK(); }
+        BSONObj currKey() const { return _current->currKey(); }
+        BSONObj current() { return _current->current(); }
+        BSONObj indexKeyPattern() const { return _keyPattern; }
+
+        string toString() const;
+        BSONObj prettyIndexBounds() const;
+
+        CoveredIndexMatcher *matcher() const { return _matcher.get(); }
+        void setMatcher( shared_ptr< CoveredIndexMatcher > matcher );
+        bool currentMatches( MatchDetails *details = NULL ) {
+            return _current->currentMatches( details );
+        }
+        const Projection::KeyOnly *keyFieldsOnly() const { return _keyFieldsOnly.get(); }
+        void setKeyFieldsOnly( const shared_ptr<Projection::KeyOnly> &keyFieldsOnly );
+
+        long long nscanned() const;
+
+    private:
+        PartitionedCursor( NamespaceDetails *d, const IndexDetails *idx,
+                           const BSONObj &startKey, const BSONObj &endKey,
+                           bool endKeyInclusive, const shared_ptr< FieldRangeVector > &bounds,
+                           int singleIntervalLimit, int direction, int numWanted );
+
+        // True if the partition with the given primary key range, (prevMaxPK, maxPK],
+        // may hold keys between _startKey and _endKey.
+        bool partitionIntersectsBounds(const BSONObj &prevMaxPK, const BSONObj &maxPK) const;
+        shared_ptr<Cursor> makeSubCursor(NamespaceDetails *partition) const;
+        // Concatenation: move on to the next partition until its cursor is ok.
+        void skipExhaustedPartitions();
+        // Merge: point _current at the cursor with the smallest key/pk in scan order.
+        void pickMergeCursor();
+        // Tailing: move on to the next partition once everything up to the current
+        // partition's max is committed or aborted, as long as there is a next one.
+        void skipSettledPartitions();
+
+        NamespaceDetails *const _d;
+        const string _indexName; // empty for a table scan
+        const BSONObj _keyPattern;
+        const Ordering _ordering;
+        const bool _merge;
+        const bool _multiKey;
+        const int _direction;
+        const int _numWanted;
+        BSONObj _startKey;
+        BSONObj _endKey;
+        const bool _endKeyInclusive;
+        shared_ptr< FieldRangeVector > _bounds;
+        const int _singleIntervalLimit;
+
+        set<BSONObj> _dups;
+        shared_ptr< CoveredIndexMatcher > _matcher;
+        shared_ptr<Projection::KeyOnly> _keyFieldsOnly;
+
+        // Partitions to scan, in scan order. A merge keeps a cursor open on each of
+        // them, a concatenation only on the partition it is currently scanning.
+        vector<NamespaceDetails *> _partitions;
+        size_t _nextPartition;
+        vector< shared_ptr<Cursor> > _cursors;
+        Cursor *_current;
+        long long _nscannedExhausted;
+
+        // A tailable cursor outlives the partition list it was created with, so it
+        // follows _d's partitions by offset instead of _partitions. Dropping a
+        // partition kills the namespace's cursors, so offsets don't shift under it.
+        bool _tailable;
+        int _tailPartition;
+    };
+
     /**
      * Dummy cursor returning no results.
      * Can be used to represent a cursor over a non-existent collection.
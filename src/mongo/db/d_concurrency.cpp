@@ -31,6 +31,7 @@
 #include "d_globals.h"
 #include "server.h"
 #include "lockstat.h"
+#include "../util/tracepoint.h"
 
 // oplog locking
 // no top level read locks
@@ -86,6 +87,23 @@ namespace mongo {
         new WrapperForRWLock("admin")
     };
 
+    /* The collection ns belongs to, whose lock it takes: indexes (db.coll.$name) and
+       partitions (db.coll$$pN) go with their collection.  Empty for a database, or db.$cmd.
+    */
+    static string collectionOf(const StringData& ns) {
+        const size_t dot = ns.find('.');
+        if( dot == string::npos )
+            return "";
+        size_t end = ns.find('$');
+        if( end == string::npos )
+            end = ns.size();
+        else if( ns[end-1] == '.' )
+            end--;
+        if( end <= dot + 1 )
+            return "";
+        return ns.substr(0, end).toString();
+    }
+
     LockStat* Lock::nestableLockStat( Nestable db ) {
         return &nestableLocks[db]->stats;
     }
@@ -191,7 +209,12 @@ namespace mongo {
         {
             mapsf<string,WrapperForRWLock*>::ref r(dblocks);
             for( map<string,WrapperForRWLock*>::const_iterator i = r.r.begin(); i != r.r.end(); i++ ) {
-                b.append(i->first, i->second->stats.report());
+                BSONObjBuilder db(b.subobjStart(i->first));
+                db.appendElements(i->second->stats.report());
+                BSONObjBuilder collections(db.subobjStart("collections"));
+                i->second->collections.report(collections);
+                collections.done();
+                db.done();
             }
         }
         result.append("locks", b.obj());
@@ -226,10 +249,18 @@ namespace mongo {
         LockState &ls = lockState();
         if( ls.threadState() == 'W' ) 
             return true;
+        if( ls.hasCollectionWriteLock() && ls.isCollectionWriteLocked( ns ) )
+            return true;
         if( ls.threadState() != 'w' ) 
             return false;
         return ls.isLocked( ns );
     }
+    bool Lock::isCollectionWriteLocked(const StringData& ns) {
+        return lockState().isCollectionWriteLocked( ns );
+    }
+    bool Lock::hasCollectionWriteLock() {
+        return lockState().hasCollectionWriteLock();
+    }
     bool Lock::atLeastReadLocked(const StringData& ns)
     { 
         LockState &ls = lockState();
@@ -291,6 +322,10 @@ namespace mongo {
         _timer.reset();
     }
     
+    MONGO_TRACEPOINT_DECLARE(lockGlobalWrite);
+    MONGO_TRACEPOINT_DECLARE(lockDBWrite);
+    MONGO_TRACEPOINT_DECLARE(lockCollectionWrite);
+
     Lock::GlobalWrite::GlobalWrite(bool sg, int timeoutms)
         : ScopedLock('W') {
         char ts = threadState();
@@ -301,6 +336,7 @@ namespace mongo {
         }
         dassert( ts == 0 );
 
+        MONGO_TRACE(lockGlobalWrite);
         Acquiring a(this,lockState());
         
         if ( timeoutms != -1 ) {
@@ -438,6 +474,7 @@ namespace mongo {
 
     void Lock::DBWrite::lockDB(const string& ns) {
         fassert( 16253, !ns.empty() );
+        MONGO_TRACE(lockDBWrite);
         LockState& ls = lockState();
         
         Acquiring a(this,ls);
@@ -479,6 +516,8 @@ namespace mongo {
         Acquiring a(this,ls);
         _locked_r=false; 
         _weLocked=0; 
+        _databaseShared=false;
+        _collection=0;
 
         if ( ls.isRW() )
             return;
@@ -549,6 +588,7 @@ namespace mongo {
             else
                 lockState().unlockedOther();
 
+            unlockCollection();
             _weLocked->unlock_shared();
         }
 
@@ -616,6 +656,130 @@ namespace mongo {
         fassert(16135,_weLocked==0);
         ls.otherLock()->lock_shared();
         _weLocked = ls.otherLock();
+        lockCollection(_weLocked);
+    }
+
+    void Lock::DBRead::lockCollection(WrapperForRWLock *db) {
+        const string collection = collectionOf(_what);
+        if( collection.empty() ) {
+            // we may look at any collection, keep out DDL on all of them
+            db->collections.lockShared();
+            _databaseShared = true;
+            return;
+        }
+        _collection = db->collections.get(collection);
+        const long long start = curTimeMicros64();
+        _collection->lock_shared();
+        _collectionLockedAt = curTimeMicros64();
+        _collection->stats.recordAcquireTimeMicros('r', _collectionLockedAt - start);
+    }
+
+    void Lock::DBRead::unlockCollection() {
+        if( _collection ) {
+            _collection->stats.recordLockTimeMicros('r', curTimeMicros64() - _collectionLockedAt);
+            _collection->unlock_shared();
+            _collection = 0;
+        }
+        if( _databaseShared ) {
+            _weLocked->collections.unlockShared();
+            _databaseShared = false;
+        }
+    }
+
+    Lock::CollectionWrite::CollectionWrite( const StringData& ns )
+        : ScopedLock( 'r' ), _locked_r(false), _weLocked(0), _collectionsLockedAt(0) {
+        lockCollections( vector<string>(1, ns.toString()) );
+    }
+
+    Lock::CollectionWrite::CollectionWrite( const vector<string>& namespaces )
+        : ScopedLock( 'r' ), _locked_r(false), _weLocked(0), _collectionsLockedAt(0) {
+        lockCollections( namespaces );
+    }
+
+    Lock::CollectionWrite::~CollectionWrite() {
+        unlockCollections();
+    }
+
+    void Lock::CollectionWrite::lockCollections(const vector<string>& namespaces) {
+        fassert( 17056, !namespaces.empty() );
+        const string db = nsToDatabase(namespaces[0]);
+        set<string> collections; // in order, so two renames can't deadlock
+        for( vector<string>::const_iterator i = namespaces.begin(); i != namespaces.end(); ++i ) {
+            const string collection = collectionOf(*i);
+            massert(17052, str::stream() << "can't lock " << *i << " as a collection", !collection.empty());
+            massert(17053, str::stream() << "can't lock collections in two databases: " << namespaces[0] << ' ' << *i,
+                    nsToDatabase(*i) == db);
+            collections.insert(collection);
+        }
+
+        LockState& ls = lockState();
+        if( ls.threadState() ) {
+            // nested, which is fine if we already have these (or their database) write locked
+            for( set<string>::const_iterator i = collections.begin(); i != collections.end(); ++i ) {
+                massert(17054, str::stream() << "can't lock " << *i << " exclusively, threadState=" << (int) ls.threadState(),
+                        isWriteLocked(*i));
+            }
+            return;
+        }
+
+        if( !DB_LEVEL_LOCKING_ENABLED || n(db.c_str()) != notnestable ) {
+            _dbWrite.reset(new DBWrite(db));
+            return;
+        }
+
+        MONGO_TRACE(lockCollectionWrite);
+        Acquiring a(this,ls);
+
+        // same order as DBRead: the database, then what's under it, then the global intent lock
+        {
+            mapsf<string,WrapperForRWLock*>::ref r(dblocks);
+            WrapperForRWLock*& lock = r[db];
+            if( lock == 0 )
+                lock = new WrapperForRWLock(db.c_str());
+            ls.lockedOther( db , -1 , lock );
+        }
+        _weLocked = ls.otherLock();
+        _weLocked->lock_shared();
+        _weLocked->collections.lockIntentExclusive();
+        for( set<string>::const_iterator i = collections.begin(); i != collections.end(); ++i ) {
+            CollectionLock *lock = _weLocked->collections.get(*i);
+            const long long start = curTimeMicros64();
+            lock->lock();
+            lock->stats.recordAcquireTimeMicros('w', curTimeMicros64() - start);
+            _collections.push_back(lock);
+        }
+        _collectionsLockedAt = curTimeMicros64();
+        ls.lockedCollections( vector<string>(collections.begin(), collections.end()) );
+
+        qlk.lock_r();
+        _locked_r = true;
+    }
+
+    void Lock::CollectionWrite::unlockCollections() {
+        if( _dbWrite ) {
+            _dbWrite.reset();
+            return;
+        }
+        if( _weLocked ) {
+            recordTime();  // for lock stats
+
+            const long long held = curTimeMicros64() - _collectionsLockedAt;
+            lockState().unlockedCollections();
+            for( vector<CollectionLock*>::reverse_iterator i = _collections.rbegin(); i != _collections.rend(); ++i ) {
+                (*i)->stats.recordLockTimeMicros('w', held);
+                (*i)->unlock();
+            }
+            _collections.clear();
+            _weLocked->collections.unlockIntentExclusive();
+
+            lockState().unlockedOther();
+            _weLocked->unlock_shared();
+            _weLocked = 0;
+        }
+        if( _locked_r ) {
+            qlk.unlock_r();
+            _locked_r = false;
+        }
     }
 
     Lock::DBWrite::UpgradeToExclusive::UpgradeToExclusive() {
@@ -32,6 +32,7 @@
 namespace mongo {
 
     class WrapperForRWLock;
+    class CollectionLock;
     class LockState;
 
     class Lock : boost::noncopyable { 
@@ -44,7 +45,9 @@ namespace mongo {
         static bool isR();          
         static bool isRW();         // R or W. i.e., we are write-exclusive          
         static bool nested();
-        static bool isWriteLocked(const StringData& ns);
+        static bool isWriteLocked(const StringData& ns); // the database, or just ns's collection
+        static bool isCollectionWriteLocked(const StringData& ns);
+        static bool hasCollectionWriteLock();
         static bool atLeastReadLocked(const StringData& ns); // true if this db is locked
         static void assertAtLeastReadLocked(const StringData& ns);
         static void assertWriteLocked(const StringData& ns);
@@ -152,11 +155,49 @@ namespace mongo {
             virtual ~DBRead();
 
         private:
+            void lockCollection(WrapperForRWLock *db);
+            void unlockCollection();
+
             bool _locked_r;
             WrapperForRWLock *_weLocked;
             string _what;
             bool _nested;
-            
+            // what we hold below the database: its collection locks shared (a database ns),
+            // or our collection shared (a collection ns)
+            bool _databaseShared;
+            CollectionLock *_collection;
+            long long _collectionLockedAt;
+        };
+
+        /**
+         * Lock collections exclusively, for DDL on them (drop, index builds,
+         * rename), while ops on the database's other collections go on.  The
+         * database is held intent exclusive, which conflicts only with DBWrite
+         * and with a DBRead of the whole database; see CollectionLocks in
+         * lockstate.h.  local and admin have no collection locks, so there this
+         * is a DBWrite.
+         *
+         * Code under it is write locked for the collections, their indexes and
+         * partitions, but only read locked for the rest of the database.  What
+         * needs more (creating a database or a system collection) throws
+         * RetryWithWriteLock as it does in a DBRead.
+         */
+        class CollectionWrite : public ScopedLock {
+        public:
+            explicit CollectionWrite(const StringData& ns);
+            /** all in one database; renames lock both collections */
+            explicit CollectionWrite(const vector<string>& namespaces);
+            virtual ~CollectionWrite();
+
+        private:
+            void lockCollections(const vector<string>& namespaces);
+            void unlockCollections();
+
+            scoped_ptr<DBWrite> _dbWrite;
+            bool _locked_r;
+            WrapperForRWLock *_weLocked;
+            vector<CollectionLock*> _collections;
+            long long _collectionsLockedAt;
         };
 
     };
@@ -487,8 +487,10 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
 
     general_options.add_options()
     ("auth", "run with security")
+    ("bloomFilterMaxMemory", po::value(&cmdLine.bloomFilterMaxMemory), "tokumx memory limit (in bytes) for each unique index's bloom filter")
     ("cacheSize", po::value(&cmdLine.cacheSize), "tokumx cache size (in bytes) for data and indexes")
     ("checkpointPeriod", po::value<uint32_t>(), "tokumx time between checkpoints, 0 means never checkpoint")
+    ("checkpointTargetBandwidth", po::value(&cmdLine.checkpointTargetBandwidth), "tokumx checkpoint write rate (in bytes/sec) to pace checkpoints to, checkpointPeriod apart at most; 0 means every checkpointPeriod")
     ("cleanerIterations", po::value<uint32_t>(), "tokumx number of iterations per cleaner thread operation, 0 means never run")
     ("cleanerPeriod", po::value<uint32_t>(), "tokumx time between cleaner thread operations, 0 means never run")
     ("cpu", "periodically show cpu and iowait utilization")
@@ -553,6 +555,7 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
     rs_options.add_options()
     ("replSet", po::value<string>(), "arg is <setname>[/<optionalseedhostlist>]")
     ("replIndexPrefetch", po::value<string>(), "specify index prefetching behavior (if secondary) [none|_id_only|all]")
+    ("initialSyncStreams", po::value<int>(), "number of connections initial sync copies collections over at once (default 4)")
     ;
 
     sharding_options.add_options()
@@ -575,6 +578,8 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
     ("pairwith", "DEPRECATED")
     ("arbiter", "DEPRECATED")
     ("opIdMem", "DEPRECATED")
+    // for testing
+    ("oplogPartitionPeriodMillis", po::value<uint64_t>(), "how often to start a new oplog partition, instead of a 24th of the expiry period")
     ;
 
     positional_options.add("command", 3);
@@ -707,6 +712,9 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
         if( params.count("expireOplogHours") ) {
             cmdLine.expireOplogHours = params["expireOplogHours"].as<uint32_t>();
         }
+        if( params.count("oplogPartitionPeriodMillis") ) {
+            cmdLine.oplogPartitionPeriodMillis = params["oplogPartitionPeriodMillis"].as<uint64_t>();
+        }
         if (params.count("journalOptions")) {
             out() << "journalOptions deprecated" <<endl;
         }
@@ -816,6 +824,13 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
         if (params.count("fastsync")) {
             replSettings.fastsync = true;
         }
+        if (params.count("initialSyncStreams")) {
+            replSettings.initialSyncStreams = params["initialSyncStreams"].as<int>();
+            if (replSettings.initialSyncStreams < 1 || replSettings.initialSyncStreams > 64) {
+                out() << "--initialSyncStreams must be between 1 and 64" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+        }
         if (params.count("autoresync")) {
             replSettings.autoresync = true;
             if( params.count("replSet") ) {
@@ -992,6 +1007,9 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
         if (params.count("enableFaultInjection")) {
             enableFailPointCmd();
         }
+
+        // replication and migration connect to other members as clients
+        DBClientConnection::setCompressor( cmdLine.networkCompressor );
     }
 
     setupSignals( false );
@@ -1077,6 +1095,7 @@ namespace mongo {
     // this will be called in certain c++ error cases, for example if there are two active
     // exceptions
     void myterminate() {
+        Logstream::stopAsync();
         rawOut( "terminate() called, printing stack (if implemented for platform):" );
         printStackTrace();
         ::abort();
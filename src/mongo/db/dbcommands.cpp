@@ -43,11 +43,14 @@
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/stats/checkpoint_stats.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/op_latencies.h"
 #include "mongo/db/storage/env.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
+#include "mongo/util/async_log.h"
 #include "mongo/util/version.h"
 #include "mongo/util/lruishmap.h"
 #include "mongo/util/md5.hpp"
@@ -538,6 +541,48 @@ namespace mongo {
             {
                 BSONObjBuilder bb( result.subobjStart( "network" ) );
                 networkCounter.append( bb );
+                {
+                    BSONObjBuilder cb( bb.subobjStart( "compression" ) );
+                    MessageCompressor::appendStats( cb );
+                    cb.done();
+                }
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "bufArena" ) );
+                bufArenaCounters.append( bb );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "opLatencies" ) );
+                bb.append( "note" , "all times in microseconds" );
+                OpLatencies::global.appendGlobal( bb , true );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "checkpoints" ) );
+                bb.appendNumber( "periodSeconds" , (long long) cmdLine.checkpointPeriod );
+                bb.appendNumber( "targetBandwidth" , (long long) (uint64_t) cmdLine.checkpointTargetBandwidth );
+                CheckpointStats::global.append( bb );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "log" ) );
+                AsyncLogWriter* writer = Logstream::getAsyncWriter();
+                bb.appendBool( "async" , writer != NULL );
+                if ( writer != NULL ) {
+                    AsyncLogWriter::Stats stats = writer->stats();
+                    bb.append( "overflow" , writer->overflow() == AsyncLogWriter::DROP ? "drop" : "block" );
+                    bb.appendNumber( "capacity" , (long long) writer->capacity() );
+                    bb.appendNumber( "written" , stats.written );
+                    bb.appendNumber( "dropped" , stats.dropped );
+                    bb.appendNumber( "blocked" , stats.blocked );
+                    bb.appendNumber( "batches" , stats.batches );
+                }
                 bb.done();
             }
 
@@ -696,6 +741,12 @@ namespace mongo {
         virtual bool slaveOk() const { return false; }
         virtual bool adminOnly() const { return false; }
         virtual void help( stringstream& help ) const { help << "drop a collection\n{drop : <collectionName>}"; }
+        virtual void lockedCollections(const string& dbname, const BSONObj& cmdObj, vector<string>& namespaces) const {
+            const string ns = dbname + '.' + cmdObj.firstElement().valuestrsafe();
+            if ( NamespaceString::validCollectionName( ns.c_str() ) ) {
+                namespaces.push_back( ns );
+            }
+        }
         virtual bool run(const string& dbname , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
             string nsToDrop = dbname + '.' + cmdObj.firstElement().valuestr();
             if ( !cmdLine.quiet )
@@ -777,6 +828,12 @@ namespace mongo {
         virtual void help( stringstream& help ) const {
             help << "drop indexes for a collection";
         }
+        virtual void lockedCollections(const string& dbname, const BSONObj& cmdObj, vector<string>& namespaces) const {
+            const string ns = dbname + '.' + cmdObj.firstElement().valuestrsafe();
+            if ( NamespaceString::validCollectionName( ns.c_str() ) ) {
+                namespaces.push_back( ns );
+            }
+        }
         bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& anObjBuilder, bool /*fromRepl*/) {
             BSONElement e = jsobj.firstElement();
             string toDeleteNs = dbname + '.' + e.valuestr();
@@ -856,6 +913,72 @@ namespace mongo {
         }
     } cmdReIndex;
 
+    class CmdChangeIndexAttributes : public FileopsCommand {
+    public:
+        CmdChangeIndexAttributes() : FileopsCommand("changeIndexAttributes") { }
+        virtual bool logTheOp() { return true; }
+        virtual bool slaveOk() const { return false; }
+        // The ydb layer does not roll back attribute changes.
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "change the compression, pageSize and/or readPageSize of an index, without a rebuild" << endl <<
+                "Only data written from now on uses the new attributes, run reIndex to rewrite the rest." << endl <<
+                "{ changeIndexAttributes: <collName>, index: <name|keyPattern|'*'>" <<
+                "[, compression: <lzma|quicklz|zlib|none>, pageSize: <bytes>, readPageSize: <bytes>] }";
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
+            BSONElement e = jsobj.firstElement();
+            string ns = dbname + '.' + e.valuestr();
+            NamespaceDetails *d = nsdetails(ns.c_str());
+            if ( !cmdLine.quiet )
+                tlog() << "CMD: changeIndexAttributes " << ns << endl;
+            if ( ! d ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            BSONObjBuilder b;
+            for (BSONObjIterator it(jsobj); it.more(); ) {
+                BSONElement f = it.next();
+                if (str::equals(f.fieldName(), "compression") ||
+                    str::equals(f.fieldName(), "pageSize") ||
+                    str::equals(f.fieldName(), "readPageSize")) {
+                    b.append(f);
+                }
+            }
+            const BSONObj attrs = b.obj();
+            if ( attrs.isEmpty() ) {
+                errmsg = "must specify at least one of compression, pageSize, readPageSize";
+                return false;
+            }
+
+            string name;
+            BSONElement f = jsobj.getField("index");
+            if ( f.type() == String ) {
+                name = f.valuestr();
+            }
+            else if ( f.type() == Object ) {
+                int idxId = d->findIndexByKeyPattern( f.embeddedObject() );
+                if ( idxId < 0 ) {
+                    errmsg = "can't find index with key:";
+                    errmsg += f.embeddedObject().toString();
+                    return false;
+                }
+                name = d->idx( idxId ).indexName();
+            }
+            else {
+                errmsg = "invalid index name spec";
+                return false;
+            }
+
+            if ( ! d->changeIndexAttributes( name, attrs ) ) {
+                errmsg = "index not found";
+                return false;
+            }
+            return true;
+        }
+    } cmdChangeIndexAttributes;
+
     class CmdRenameCollection : public FileopsCommand {
     public:
         CmdRenameCollection() : FileopsCommand( "renameCollection" ) {}
@@ -869,6 +992,17 @@ namespace mongo {
         virtual void help( stringstream &help ) const {
             help << " example: { renameCollection: foo.a, to: bar.b }";
         }
+        // within a database, a rename only needs both collections locked
+        virtual void lockedCollections(const string& dbname, const BSONObj& cmdObj, vector<string>& namespaces) const {
+            const string source = cmdObj.getStringField( name.c_str() );
+            const string target = cmdObj.getStringField( "to" );
+            if ( NamespaceString::validCollectionName( source.c_str() ) &&
+                 NamespaceString::validCollectionName( target.c_str() ) &&
+                 nsToDatabaseSubstring( source ) == nsToDatabaseSubstring( target ) ) {
+                namespaces.push_back( source );
+                namespaces.push_back( target );
+            }
+        }
         virtual bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
             string source = cmdObj.getStringField( name.c_str() );
             string target = cmdObj.getStringField( "to" );
@@ -909,6 +1043,7 @@ namespace mongo {
                     renameNamespace( source, target, cmdObj["stayTemp"].trueValue() );
                     // make sure we drop counters etc
                     Top::global.collectionDropped( source );
+                    OpLatencies::global.collectionDropped( source );
                     return true;
                 }
             }
@@ -1220,7 +1355,12 @@ namespace mongo {
                 min = Helpers::modifiedRangeBound( min , idx->keyPattern() , -1 );
                 max = Helpers::modifiedRangeBound( max , idx->keyPattern() , -1 );
 
-                c = IndexCursor::make( d, *idx, min, max, false, 1 );
+                if ( d->isPartitioned() ) {
+                    c = PartitionedCursor::make( d, *idx, min, max, false, 1 );
+                }
+                else {
+                    c = IndexCursor::make( d, *idx, min, max, false, 1 );
+                }
             }
 
             //long long avgObjSize = d->stats.datasize / d->stats.nrecords;
@@ -1508,6 +1648,10 @@ namespace mongo {
             throw;
         }
         catch (RetryWithWriteLock &e) {
+            if (Lock::hasCollectionWriteLock()) {
+                // execCommand retries with the whole database locked
+                throw;
+            }
             uasserted(16796, str::stream() << 
                              "bug: Unhandled RetryWithWriteLock exception thrown during cmd: " << causedBy(e)
                              << ". Either a necessary collection was dropped manually, or you hit a bug. ");
@@ -1593,6 +1737,31 @@ namespace mongo {
         return retval;
     }
 
+    // The rest of a WRITE command, once it's locked.  contextNs is dbname, or the first
+    // collection the command locked if it locked just its collections.
+    static bool runWriteCommand(Command* c, Client& client, int queryOptions,
+                                const char *cmdns, BSONObj& cmdObj, BSONObjBuilder& result,
+                                bool fromRepl, string& dbname, const string& contextNs) {
+        if (!canRunCommand(c, dbname, queryOptions, fromRepl, result)) {
+            return false;
+        }
+
+        Client::Context ctx(contextNs, dbpath, c->requiresAuth());
+        scoped_ptr<Client::Transaction> transaction((!fromRepl && c->needsTxn())
+                                                    ? new Client::Transaction(c->txnFlags())
+                                                    : NULL);
+        client.curop()->ensureStarted();
+        bool retval = _execCommand(c, dbname , cmdObj , queryOptions, result , fromRepl );
+        if ( retval && c->logTheOp() && ! fromRepl ) {
+            OpLogHelpers::logCommand(cmdns, cmdObj, &cc().txn());
+        }
+
+        if (retval && transaction) {
+            transaction->commit();
+        }
+        return retval;
+    }
+
     /**
      * this handles
      - auth
@@ -1713,6 +1882,23 @@ namespace mongo {
         }
         else {
             dassert( c->locktype() == Command::WRITE );
+            vector<string> collections;
+            c->lockedCollections(dbname, cmdObj, collections);
+            if (!collections.empty()) {
+                try {
+                    Lock::CollectionWrite lk(collections);
+                    return runWriteCommand(c, client, queryOptions, cmdns, cmdObj, result, fromRepl,
+                                           dbname, collections[0]);
+                }
+                catch (RetryWithWriteLock &e) {
+                    LOG(1) << "command " << c->name << " needs more than its collections locked, "
+                           << "retrying with the database locked" << causedBy(e) << endl;
+                }
+                Lock::DBWrite lk(nsToDatabaseSubstring(collections[0]));
+                return runWriteCommand(c, client, queryOptions, cmdns, cmdObj, result, fromRepl,
+                                       dbname, collections[0]);
+            }
+
             bool global = c->lockGlobally();
             DEV {
                 if( !global && Lock::isW() ) { 
@@ -1726,23 +1912,8 @@ namespace mongo {
             scoped_ptr<Lock::ScopedLock> lk(global
                                             ? static_cast<Lock::ScopedLock*>(new Lock::GlobalWrite())
                                             : static_cast<Lock::ScopedLock*>(new Lock::DBWrite(dbname)));
-            if (!canRunCommand(c, dbname, queryOptions, fromRepl, result)) {
-                return false;
-            }
-
-            Client::Context ctx(dbname, dbpath, c->requiresAuth());
-            scoped_ptr<Client::Transaction> transaction((!fromRepl && c->needsTxn())
-                                                        ? new Client::Transaction(c->txnFlags())
-                                                        : NULL);
-            client.curop()->ensureStarted();
-            retval = _execCommand(c, dbname , cmdObj , queryOptions, result , fromRepl );
-            if ( retval && c->logTheOp() && ! fromRepl ) {
-                OpLogHelpers::logCommand(cmdns, cmdObj, &cc().txn());
-            }
-
-            if (retval && transaction) {
-                transaction->commit();
-            }
+            retval = runWriteCommand(c, client, queryOptions, cmdns, cmdObj, result, fromRepl,
+                                     dbname, dbname);
         }
 
         return retval;
@@ -169,6 +169,22 @@ namespace mongo {
                 log() << "setParameter checkpointPeriod=" << x << endl;
                 s++;
             }
+            if( cmdObj.hasElement("bloomFilterMaxMemory") ) { 
+                long long x = cmdObj["bloomFilterMaxMemory"].numberLong();
+                uassert(17067, "bloomFilterMaxMemory must be positive", x > 0);
+                if( s == 0 )
+                    result.appendNumber("was", (long long) (uint64_t) cmdLine.bloomFilterMaxMemory);
+                cmdLine.bloomFilterMaxMemory = x;
+                log() << "setParameter bloomFilterMaxMemory=" << x << endl;
+                s++;
+            }
+            if( cmdObj.hasElement("checkpointTargetBandwidth") ) { 
+                long long x = cmdObj["checkpointTargetBandwidth"].numberLong();
+                uassert(17062, "checkpointTargetBandwidth must not be negative", x >= 0);
+                storage::set_checkpoint_target_bandwidth(x);
+                log() << "setParameter checkpointTargetBandwidth=" << x << endl;
+                s++;
+            }
             if( cmdObj.hasElement("cleanerPeriod") ) { 
                 int x = (int) cmdObj["cleanerPeriod"].Number();
                 storage::set_cleaner_period(x);
@@ -28,6 +28,7 @@
 #include "mongo/db/queryoptimizercursor.h"
 #include "mongo/db/repl_block.h"
 #include "mongo/db/database.h"
+#include "mongo/db/keypattern.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/update.h"
@@ -116,7 +117,13 @@ namespace mongo {
         int minOrMax = maxInclusive ? 1 : -1;
         BSONObj newMax = Helpers::modifiedRangeBound( max , keyPattern , minOrMax );
 
-        for (shared_ptr<Cursor> c(IndexCursor::make(d, i, newMin, newMax, maxInclusive, 1)); c->ok(); c->advance()) {
+        shared_ptr<Cursor> c;
+        if (d->isPartitioned()) {
+            c = PartitionedCursor::make(d, i, newMin, newMax, maxInclusive, 1);
+        } else {
+            c = IndexCursor::make(d, i, newMin, newMax, maxInclusive, 1);
+        }
+        for ( ; c->ok(); c->advance()) {
             BSONObj pk = c->currPK();
             BSONObj obj = c->current();
             OpLogHelpers::logDelete(ns.c_str(), obj, fromMigrate, &cc().txn());
@@ -128,4 +135,104 @@ namespace mongo {
         return numDeleted;
     }
 
+    namespace {
+
+        // Walks one or more PK dictionaries in key order, putting a split
+        // point every step bytes.
+        class PKSplitter {
+            const KeyPattern _pattern;
+            const Ordering _ordering;
+            const uint64_t _step;
+            const int _max;
+            vector<BSONObj> &_points;
+            // bytes since the last split point, carried from one dictionary to the next
+            uint64_t _carried;
+            // what the last getKeyAfterBytes() found
+            BSONObj _found;
+            uint64_t _skipped;
+            bool _end;
+
+          public:
+            PKSplitter(const BSONObj &pkPattern, uint64_t step, int maxPoints, vector<BSONObj> &points) :
+                _pattern(pkPattern), _ordering(Ordering::make(pkPattern)), _step(step),
+                _max(maxPoints), _points(points), _carried(0), _skipped(0), _end(false) {
+            }
+
+            void operator()(const storage::KeyV1 *endKey, const BSONObj *endPK, uint64_t skipped) {
+                _skipped = skipped;
+                _end = endKey == NULL;
+                if (!_end) {
+                    _found = endKey->toBson();
+                }
+            }
+
+            bool full() const {
+                return (int) _points.size() >= _max;
+            }
+
+            void split(const IndexDetails &pk, uint64_t dataSize) {
+                storage::Key start(Helpers::modifiedRangeBound(BSONObj(), _pattern.toBSON(), -1), NULL);
+                uint64_t left = dataSize;
+                while (!full() && _carried + left >= _step) {
+                    const uint64_t want = _step - _carried;
+                    pk.getKeyAfterBytes(start, want, *this);
+                    if (_end || _skipped == 0) {
+                        // the estimates were off, or one document is bigger than a range
+                        break;
+                    }
+                    if (_points.empty() ||
+                        _found.woCompare(Helpers::modifiedRangeBound(_points.back(), _pattern.toBSON(), -1),
+                                         _ordering) > 0) {
+                        _points.push_back(_pattern.prettyKey(_found).getOwned());
+                    }
+                    start.reset(_found, NULL);
+                    left -= std::min(left, _skipped);
+                    _carried = 0;
+                }
+                _carried += left;
+            }
+        };
+
+    } // namespace
+
+    void Helpers::pkSplitPoints( NamespaceDetails *d, int n, vector<BSONObj> &splitPoints ) {
+        splitPoints.clear();
+        if (n <= 1) {
+            return;
+        }
+
+        vector<pair<const IndexDetails *, uint64_t> > dictionaries;
+        uint64_t total = 0;
+        const int parts = d->isPartitioned() ? d->numPartitions() : 1;
+        for (int i = 0; i < parts; i++) {
+            const IndexDetails &pk = d->isPartitioned()
+                                     ? d->getPartition(i)->getPKIndex()
+                                     : d->getPKIndex();
+            DB_BTREE_STAT64 stats;
+            pk.getStat64(&stats);
+            dictionaries.push_back(make_pair(&pk, stats.bt_dsize));
+            total += stats.bt_dsize;
+        }
+        if (total == 0) {
+            return;
+        }
+
+        PKSplitter splitter(d->pkPattern(), std::max<uint64_t>(total / n, 1), n - 1, splitPoints);
+        for (size_t i = 0; i < dictionaries.size() && !splitter.full(); i++) {
+            splitter.split(*dictionaries[i].first, dictionaries[i].second);
+        }
+    }
+
+    shared_ptr<Cursor> Helpers::pkRangeCursor( NamespaceDetails *d, const BSONObj &min, const BSONObj &max ) {
+        const IndexDetails &pk = d->getPKIndex();
+        const BSONObj startKey = modifiedRangeBound( min , pk.keyPattern() , -1 );
+        // past the last range, include everything up to MaxKey
+        const BSONObj endKey = modifiedRangeBound( max , pk.keyPattern() , max.isEmpty() ? 1 : -1 );
+        if (d->isPartitioned()) {
+            return PartitionedCursor::make( d , pk , startKey , endKey , max.isEmpty() , 1 );
+        } else {
+            return IndexCursor::make( d , pk , startKey , endKey , max.isEmpty() , 1 );
+        }
+    }
+
 } // namespace mongo
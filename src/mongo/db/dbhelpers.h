@@ -28,6 +28,9 @@
 
 namespace mongo {
 
+    class Cursor;
+    class NamespaceDetails;
+
     /**
        all helpers assume locking is handled above them
      */
@@ -93,6 +96,26 @@ namespace mongo {
                                       /* RemoveCallback * callback = 0, */
                                       bool fromMigrate = false );
 
+        /**
+         * Splits the primary key space of d into at most n ranges holding
+         * about the same number of bytes, by the ydb's estimates, without
+         * reading any documents.  Fills splitPoints with the boundaries
+         * between them, in increasing order, as primary keys with field
+         * names.  Range i is [ splitPoints[i-1], splitPoints[i] ), with the
+         * first and last ranges unbounded below and above.
+         *
+         * A partitioned collection is split across its partitions, each
+         * split by its own estimates.  Must be in a transaction.
+         */
+        void pkSplitPoints( NamespaceDetails *d, int n, vector<BSONObj> &splitPoints );
+
+        /**
+         * A forward cursor over the documents of d with primary keys in
+         * [ min, max ), as given by pkSplitPoints().  An empty min or max
+         * leaves that end unbounded.
+         */
+        shared_ptr<Cursor> pkRangeCursor( NamespaceDetails *d, const BSONObj &min, const BSONObj &max );
+
     };
 
 } // namespace mongo
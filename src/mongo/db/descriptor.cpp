@@ -26,13 +26,14 @@ namespace mongo {
                            const bool hashed,
                            const int hashSeed,
                            const bool sparse,
-                           const bool clustering) :
+                           const bool clustering,
+                           const int hashVersion) :
         _data(NULL), _size(serializedSize(keyPattern)), _dataOwned(new char[_size]) {
         _data = _dataOwned.get();
 
         // Create a header and write it first.
         Header h(Ordering::make(keyPattern),
-                 hashed, sparse, clustering, hashSeed, keyPattern.nFields());
+                 hashed, sparse, clustering, hashSeed, keyPattern.nFields(), hashVersion);
         memcpy(_dataOwned.get(), &h, sizeof(Header));
 
         // The offsets array is based after the header. It is an array of
@@ -108,13 +109,16 @@ namespace mongo {
     }
 
     void Descriptor::generateKeys(const BSONObj &obj, BSONObjSet &keys) const {
+        BSONObjSetKeySink sink(keys);
+        generateKeys(obj, sink);
+    }
+
+    void Descriptor::generateKeys(const BSONObj &obj, KeySink &keys) const {
         const Header &h(*reinterpret_cast<const Header *>(_data));
         vector<const char *> fields;
         fieldNames(fields);
         if (h.hashed) {
-            // If we ever add new hash versions in the future, we'll need to add
-            // a hashVersion field to the descriptor and up the descriptor version.
-            const HashVersion hashVersion = 0;
+            const HashVersion hashVersion = h.hashVersion();
             HashKeyGenerator generator(fields[0], h.hashSeed, hashVersion, h.sparse);
             generator.getKeys(obj, keys);
         } else {
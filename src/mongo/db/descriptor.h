@@ -24,6 +24,8 @@
 
 namespace mongo {
 
+    class KeySink;
+
     // A Descriptor contains the necessary information for comparing
     // and generating index keys and values.
     //
@@ -39,7 +41,8 @@ namespace mongo {
                    const bool hashed = false,
                    const int hashSeed = 0,
                    const bool sparse = false,
-                   const bool clustering = false);
+                   const bool clustering = false,
+                   const int hashVersion = 0);
         // For interpretting a memory buffer as a descriptor.
         Descriptor(const char *data, const size_t size);
 
@@ -56,6 +59,7 @@ namespace mongo {
         int compareKeys(const storage::Key &key1, const storage::Key &key2) const;
 
         void generateKeys(const BSONObj &obj, BSONObjSet &keys) const;
+        void generateKeys(const BSONObj &obj, KeySink &keys) const;
 
         bool clustering() const {
             const Header &h(*reinterpret_cast<const Header *>(_data));
@@ -70,7 +74,7 @@ namespace mongo {
         //   [
         //     4 bytes: ordering,
         //     1 byte: version,
-        //     1 byte: hashed boolean,
+        //     1 byte: hashed, 0 if not, else 1 + the hash version (version 2 and up),
         //     1 byte: sparse boolean,
         //     1 byte: clustering boolean,
         //     4 bytes: hash seed integer,
@@ -84,16 +88,25 @@ namespace mongo {
                 // Version 0 is kind of a fake version.
                 VERSION_0 = 0,
                 VERSION_1 = 1,
-                NEXT_VERSION = 2
+                // Hashed indexes may use a hash version other than 0.
+                VERSION_2 = 2,
+                NEXT_VERSION = 3
             };
             static const int CURRENT_VERSION = (int) NEXT_VERSION - 1;
 
         public:
-            Header(const Ordering &o, char h, char s, char c, int hs, uint32_t n)
-                : ordering(o), version((char) CURRENT_VERSION), hashed(h), sparse(s), clustering(c),
+            // Indexes that don't need version 2 keep writing version 1, so
+            // that older servers can still open them.
+            Header(const Ordering &o, char h, char s, char c, int hs, uint32_t n, int hv)
+                : ordering(o), version((char) (h && hv != 0 ? CURRENT_VERSION : VERSION_1)),
+                  hashed(h ? 1 + hv : 0), sparse(s), clustering(c),
                   hashSeed(hs), numFields(n) {
             }
 
+            int hashVersion() const {
+                return hashed ? hashed - 1 : 0;
+            }
+
             Ordering ordering;
             char version;
             char hashed;
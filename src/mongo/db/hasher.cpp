@@ -22,32 +22,64 @@
 */
 
 #include "mongo/db/hasher.h"
+
+#include "third_party/murmurhash3/MurmurHash3.h"
+
 #include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
 #include "mongo/util/startup_test.h"
 
 namespace mongo {
 
-    Hasher::Hasher( HashSeed seed ) : _seed( seed ) {
+    MD5Hasher::MD5Hasher( HashSeed seed ) : _seed( seed ) {
         md5_init( &_md5State );
         md5_append( &_md5State , reinterpret_cast< const md5_byte_t * >( & _seed ) , sizeof( _seed ) );
     }
 
-    void Hasher::addData( const void * keyData , size_t numBytes ) {
+    void MD5Hasher::addData( const void * keyData , size_t numBytes ) {
         md5_append( &_md5State , static_cast< const md5_byte_t * >( keyData ), numBytes );
     }
 
-    void Hasher::finish( HashDigest out ) {
+    void MD5Hasher::finish( HashDigest out ) {
         md5_finish( &_md5State , out );
     }
 
-    long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ){
-        scoped_ptr<Hasher> h( HasherFactory::createHasher( seed ) );
-        recursiveHash( h.get() , e , false );
+    void Murmur3Hasher::finish( HashDigest out ) {
+        BOOST_STATIC_ASSERT( sizeof( HashDigest ) == 16 );
+        MurmurHash3_x64_128( _buf.buf() , _buf.len() , static_cast< uint32_t >( _seed ) , out );
+    }
+
+    Hasher* HasherFactory::createHasher( HashSeed seed , HashVersion version ) {
+        massert( 17038 , mongoutils::str::stream() << "unknown hashVersion " << version ,
+                 isValidHashVersion( version ) );
+        if ( version == HASH_VERSION_MURMUR3 ) {
+            return new Murmur3Hasher( seed );
+        }
+        return new MD5Hasher( seed );
+    }
+
+    long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ,
+                                             HashVersion version ){
+        // Called for every key of a hashed index or shard key, so the
+        // hashers live on the stack rather than coming from the factory.
         HashDigest d;
-        h->finish(d);
+        if ( version == HASH_VERSION_MURMUR3 ) {
+            Murmur3Hasher h( seed );
+            recursiveHash( &h , e , false );
+            h.finish( d );
+        }
+        else {
+            massert( 17039 , mongoutils::str::stream() << "unknown hashVersion " << version ,
+                     version == HASH_VERSION_MD5 );
+            MD5Hasher h( seed );
+            recursiveHash( &h , e , false );
+            h.finish( d );
+        }
         //HashDigest is actually 16 bytes, but we just get 8 via truncation
         // NOTE: assumes little-endian
-        return *reinterpret_cast< long long int * >( d );
+        long long int out;
+        memcpy( &out , d , sizeof( out ) );
+        return out;
     }
 
     void BSONElementHasher::recursiveHash( Hasher* h ,
@@ -98,6 +130,7 @@ namespace mongo {
             // Hard-coded check to ensure the hash function is consistent across platforms
             BSONObj o = BSON( "check" << 42 );
             verify( BSONElementHasher::hash64( o.firstElement(), 0 ) == -944302157085130861LL );
+            verify( BSONElementHasher::hash64( o.firstElement(), 0, HASH_VERSION_MURMUR3 ) == 8715208212397937794LL );
         }
     } hasherUnitTest;
 }
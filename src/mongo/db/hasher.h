@@ -25,6 +25,7 @@
 
 #include "mongo/pch.h"
 #include "mongo/bson/bsonelement.h"
+#include "mongo/bson/util/builder.h"
 #include "mongo/util/md5.hpp"
 
 namespace mongo {
@@ -33,17 +34,40 @@ namespace mongo {
     typedef int HashVersion;
     typedef unsigned char HashDigest[16];
 
+    /* The hash functions a HashVersion may name.  Hashed indexes and hashed
+     * shard keys record the version they were created with, so the keys
+     * already stored never change meaning.
+     */
+    enum HashVersions {
+        // MD5 of the seed followed by the data
+        HASH_VERSION_MD5 = 0,
+        // MurmurHash3_x64_128 of the data, seeded with the seed.  Several
+        // times cheaper than MD5 and just as well distributed for our keys.
+        HASH_VERSION_MURMUR3 = 1,
+        NEXT_HASH_VERSION = 2
+    };
+
+    inline bool isValidHashVersion( HashVersion v ) {
+        return v >= 0 && v < NEXT_HASH_VERSION;
+    }
+
     class Hasher : private boost::noncopyable {
     public:
-
-        explicit Hasher( HashSeed seed );
-        ~Hasher() { };
+        virtual ~Hasher() { };
 
         //pointer to next part of input key, length in bytes to read
-        void addData( const void * keyData , size_t numBytes );
+        virtual void addData( const void * keyData , size_t numBytes ) = 0;
 
         //finish computing the hash, put the result in the digest
         //only call this once per Hasher
+        virtual void finish( HashDigest out ) = 0;
+    };
+
+    class MD5Hasher : public Hasher {
+    public:
+        explicit MD5Hasher( HashSeed seed );
+
+        void addData( const void * keyData , size_t numBytes );
         void finish( HashDigest out );
 
     private:
@@ -51,14 +75,26 @@ namespace mongo {
         HashSeed _seed;
     };
 
-    class HasherFactory : private boost::noncopyable  {
+    /* MurmurHash3 has no incremental interface, so the data is gathered
+     * up and hashed all at once in finish().
+     */
+    class Murmur3Hasher : public Hasher {
     public:
-        /* Eventually this may be a more sophisticated factory
-         * for creating other hashers, but for now use MD5.
-         */
-        static Hasher* createHasher( HashSeed seed ) {
-            return new Hasher( seed );
+        explicit Murmur3Hasher( HashSeed seed ) : _seed( seed ) { }
+
+        void addData( const void * keyData , size_t numBytes ) {
+            _buf.appendBuf( keyData , numBytes );
         }
+        void finish( HashDigest out );
+
+    private:
+        StackBufBuilder _buf;
+        HashSeed _seed;
+    };
+
+    class HasherFactory : private boost::noncopyable  {
+    public:
+        static Hasher* createHasher( HashSeed seed , HashVersion version = HASH_VERSION_MD5 );
 
     private:
         HasherFactory();
@@ -83,9 +119,11 @@ namespace mongo {
          * This function is used in the computation of hashed indexes
          * and hashed shard keys, and thus should not be changed unless
          * the associated "getKeys" and "makeSingleKey" method in the
-         * hashindex type is changed accordingly.
+         * hashindex type is changed accordingly.  New hash functions get
+         * a new HashVersion instead.
          */
-        static long long int hash64( const BSONElement& e , HashSeed seed );
+        static long long int hash64( const BSONElement& e , HashSeed seed ,
+                                     HashVersion version = HASH_VERSION_MD5 );
 
     private:
         BSONElementHasher();
@@ -23,6 +23,7 @@
 
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/index.h"
+#include "mongo/db/bloom_filter.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/keygenerator.h"
@@ -31,6 +32,7 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/storage/key.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/util/background.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/stringutils.h"
 
@@ -40,10 +42,11 @@ namespace mongo {
      *
      * Optional arguments:
      *  "seed" : int (default = 0, a seed for the hash function)
-     *  "hashVersion : int (default = 0, determines which hash function to use)
+     *  "hashVersion : int (default = 0, determines which hash function to use:
+     *                    0 for MD5, 1 for MurmurHash3, see hasher.h)
      *
      * Example use in the mongo shell:
-     * > db.foo.ensureIndex({a : "hashed"}, {seed : 3, hashVersion : 0})
+     * > db.foo.ensureIndex({a : "hashed"}, {seed : 3, hashVersion : 1})
      *
      * LIMITATION: Only works with a single field. The HashedIndex
      * constructor uses uassert to ensure that the spec has the form
@@ -73,9 +76,11 @@ namespace mongo {
                             _keyPattern.nFields() == 1 );
             uassert( 16242, "Currently hashed indexes cannot guarantee uniqueness. Use a regular index.",
                             !unique() );
+            uassert( 17040, str::stream() << "unknown hashVersion " << _hashVersion,
+                            isValidHashVersion( _hashVersion ) );
 
-            // Create a descriptor with hashed = true and the appropriate hash seed.
-            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _sparse, _clustering));
+            // Create a descriptor with hashed = true and the appropriate hash seed and version.
+            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _sparse, _clustering, _hashVersion));
         }
 
         // @return the "special" name for this index.
@@ -181,6 +186,11 @@ namespace mongo {
             idx.reset(new IndexDetails(info));
         }
         idx->open(may_create);
+        if (!may_create && idx->_bloomFilter) {
+            // Opening an existing index, so its keys are already in it. A new
+            // index's builder notes the keys it writes instead.
+            populateBloomFilterInBackground(idx->parentNS(), idx->indexName(), false);
+        }
         return idx;
     }
 
@@ -190,7 +200,8 @@ namespace mongo {
         _unique(info["unique"].trueValue()),
         _sparse(info["sparse"].trueValue()),
         _clustering(info["clustering"].trueValue()),
-        _descriptor(new Descriptor(_keyPattern, false, 0, _sparse, _clustering)) {
+        _descriptor(new Descriptor(_keyPattern, false, 0, _sparse, _clustering)),
+        _bloomFilterRebuilds(0) {
         verify(!_info.isEmpty());
         verify(!_keyPattern.isEmpty());
     }
@@ -214,6 +225,14 @@ namespace mongo {
             msgasserted(16988, mongoutils::str::stream() << "dictionary " << dname
                                << " should exist, but we got ENOENT");
         }
+
+        if (_unique && _info["bloomFilter"].trueValue()) {
+            // Leave room for the index to double before the filter gets crowded.
+            DB_BTREE_STAT64 stats;
+            getStat64(&stats);
+            _bloomFilter.reset(new BloomFilter(std::max(2 * stats.bt_nkeys, (uint64_t) 1 << 16),
+                                               cmdLine.bloomFilterMaxMemory));
+        }
     }
 
     IndexDetails::~IndexDetails() {
@@ -266,6 +285,10 @@ namespace mongo {
         _descriptor->generateKeys(obj, keys);
     }
 
+    void IndexDetails::getKeysFromObject(const BSONObj &obj, KeySink &keys) const {
+        _descriptor->generateKeys(obj, keys);
+    }
+
     static bool anyElementNamesMatch( const BSONObj& a , const BSONObj& b ) {
         BSONObjIterator x(a);
         while ( x.more() ) {
@@ -323,6 +346,13 @@ namespace mongo {
             }
         }
 
+        // Adding the key to the bloom filter before the probe is safe: if this
+        // insert fails, the key only costs a false positive later.
+        const bool filtered = _bloomFilter && _bloomFilter->ready();
+        if (_bloomFilter && !testAndAddBloomFilterKey(key)) {
+            return;
+        }
+
         IndexDetails::Cursor c(*this, DB_SERIALIZABLE);
         DBC *cursor = c.dbc();
 
@@ -344,6 +374,272 @@ namespace mongo {
         if (!isUnique) {
             uassertedDupKey(key);
         }
+        if (filtered) {
+            _bloomFilter->noteFalsePositive();
+        }
+    }
+
+    bool IndexDetails::testAndAddBloomFilterKey(const BSONObj &key) const {
+        const bool maybePresent = _bloomFilter->testAndAdd(key);
+        if (_pendingBloomFilter) {
+            _pendingBloomFilter->add(key);
+        } else if (_bloomFilter->crowded() &&
+                   _bloomFilter->bytes() < cmdLine.bloomFilterMaxMemory &&
+                   _bloomFilter->claimRebuild()) {
+            // There's room for a bigger filter. At the limit, the crowded one
+            // is still right about most new keys, and its stats show how often.
+            populateBloomFilterInBackground(parentNS(), indexName(), true);
+        }
+        return maybePresent;
+    }
+
+    void IndexDetails::noteUniqueKey(const BSONObj &key) const {
+        if (_bloomFilter) {
+            testAndAddBloomFilterKey(key);
+        }
+    }
+
+    struct PopulateBloomFilterExtra : public ExceptionSaver {
+        BloomFilter &filter;
+        string lastKey;
+        PopulateBloomFilterExtra(BloomFilter &f) : filter(f) {}
+    };
+
+    static int populateBloomFilterCallback(const DBT *key, const DBT *val, void *extra) {
+        PopulateBloomFilterExtra *e = static_cast<PopulateBloomFilterExtra *>(extra);
+        try {
+            if (key != NULL) {
+                // The key's trailing pk is ignored, as in uniqueCheckCallback.
+                const storage::KeyV1 k(static_cast<const char *>(key->data));
+                e->filter.add(k.toBson());
+                e->lastKey.assign(static_cast<const char *>(key->data), key->size);
+            }
+            return 0;
+        } catch (const std::exception &ex) {
+            e->saveException(ex);
+        }
+        return -1;
+    }
+
+    bool IndexDetails::hasBloomFilter(const shared_ptr<BloomFilter> &f) const {
+        return f && (f == _bloomFilter || f == _pendingBloomFilter);
+    }
+
+    shared_ptr<BloomFilter> IndexDetails::startBloomFilterRebuild() {
+        if (!_bloomFilter || _pendingBloomFilter) {
+            return shared_ptr<BloomFilter>();
+        }
+        // Room for the index to double again. Building from scratch also
+        // drops the keys that have been deleted since the last build.
+        _pendingBloomFilter.reset(new BloomFilter(2 * _bloomFilter->keys(), cmdLine.bloomFilterMaxMemory));
+        TOKULOG(1) << "rebuilding the crowded bloom filter for " << indexNamespace()
+                   << ", " << _bloomFilter->bytes() << " bytes, with "
+                   << _pendingBloomFilter->bytes() << " bytes" << endl;
+        return _pendingBloomFilter;
+    }
+
+    // Keys read per chunk, between which the populator lets go of its lock.
+    static const int bloomFilterChunkKeys = 10000;
+
+    bool IndexDetails::populateBloomFilterChunk(BloomFilter &f, int isolation, string &resumeKey) const {
+        Client::Transaction txn(isolation | DB_TXN_READ_ONLY);
+        PopulateBloomFilterExtra extra(f);
+        IndexDetails::Cursor c(*this);
+        DBC *cursor = c.dbc();
+        int r;
+        if (resumeKey.empty()) {
+            r = cursor->c_getf_next(cursor, 0, populateBloomFilterCallback, &extra);
+        } else {
+            // Rereads the last key of the previous chunk, which adding again is harmless.
+            DBT kdbt = storage::make_dbt(resumeKey.data(), resumeKey.size());
+            r = cursor->c_getf_set_range(cursor, 0, &kdbt, populateBloomFilterCallback, &extra);
+        }
+        for (int n = 1; r == 0 && n < bloomFilterChunkKeys; n++) {
+            r = cursor->c_getf_next(cursor, 0, populateBloomFilterCallback, &extra);
+        }
+        if (r != 0 && r != DB_NOTFOUND) {
+            extra.throwException();
+            storage::handle_ydb_error(r);
+        }
+        txn.commit();
+        resumeKey = extra.lastKey;
+        return r == DB_NOTFOUND;
+    }
+
+    void IndexDetails::finishBloomFilter(const shared_ptr<BloomFilter> &f) {
+        if (f == _pendingBloomFilter) {
+            _bloomFilter = _pendingBloomFilter;
+            _pendingBloomFilter.reset();
+            _bloomFilterRebuilds++;
+        }
+        if (f == _bloomFilter) {
+            setBloomFilterReady();
+        }
+    }
+
+    void IndexDetails::abandonBloomFilterRebuild(const shared_ptr<BloomFilter> &f) {
+        if (f && f == _pendingBloomFilter) {
+            _pendingBloomFilter.reset();
+        }
+    }
+
+    /**
+     * Fills bloom filters from the keys already in their indexes, so that
+     * opening a collection doesn't wait for full scans of its unique indexes,
+     * and replaces crowded filters with bigger ones.  Until a filter is
+     * filled, it isn't trusted and every key is probed.
+     *
+     * Other transactions may hold uncommitted inserts and deletes on the
+     * index, made before the filter existed, so they never noted their keys.
+     * A snapshot sees keys whose deletes are uncommitted (and may abort), and
+     * read uncommitted sees keys whose inserts are, so a pass with each covers
+     * every key that could be in the index once those transactions end.
+     * Anything written after the filter was made is noted by its writer.
+     */
+    class BloomFilterPopulator : public BackgroundJob {
+    public:
+        BloomFilterPopulator() : BackgroundJob(false), _mutex("bloomFilterPopulator") { }
+        virtual string name() const { return "BloomFilterPopulator"; }
+
+        void enqueue(const string &ns, const string &index, bool rebuild) {
+            SimpleMutex::scoped_lock lk(_mutex);
+            _requests.push_back(Request(ns, index, rebuild));
+        }
+
+        virtual void run() {
+            Client::initThread("bloomFilterPopulator");
+            Client &client = cc();
+            while (!inShutdown()) {
+                Request req;
+                if (!next(req)) {
+                    sleepmillis(100);
+                    continue;
+                }
+                try {
+                    populate(req);
+                } catch (const DBException &e) {
+                    // Without a complete filter, every key is still probed.
+                    warning() << "could not populate the bloom filter for index " << req.index
+                              << " on " << req.ns << ", uniqueness checks will probe the index: "
+                              << e.what() << endl;
+                    abandon(req);
+                }
+            }
+            client.shutdown();
+        }
+
+    private:
+        struct Request {
+            Request() : rebuild(false) { }
+            Request(const string &n, const string &i, bool r) : ns(n), index(i), rebuild(r) { }
+            string ns;
+            string index;
+            bool rebuild;
+            shared_ptr<BloomFilter> filter;
+        };
+
+        bool next(Request &req) {
+            SimpleMutex::scoped_lock lk(_mutex);
+            if (_requests.empty()) {
+                return false;
+            }
+            req = _requests.front();
+            _requests.pop_front();
+            return true;
+        }
+
+        static IndexDetails *findIndex(const Request &req) {
+            NamespaceDetails *d = nsdetails(req.ns);
+            if (d == NULL) {
+                return NULL;
+            }
+            const int i = d->findIndexByName(req.index);
+            return i < 0 ? NULL : &d->idx(i);
+        }
+
+        void populate(Request &req) {
+            {
+                Client::WriteContext ctx(req.ns);
+                IndexDetails *idx = findIndex(req);
+                if (idx == NULL) {
+                    return;
+                }
+                req.filter = req.rebuild ? idx->startBloomFilterRebuild() : idx->bloomFilter();
+                if (!req.filter || req.filter->ready()) {
+                    return;
+                }
+            }
+
+            const int isolations[] = { DB_TXN_SNAPSHOT, DB_READ_UNCOMMITTED };
+            for (size_t i = 0; i < sizeof(isolations) / sizeof(isolations[0]); i++) {
+                string resumeKey;
+                for (bool done = false; !done; ) {
+                    if (inShutdown()) {
+                        return;
+                    }
+                    Client::ReadContext ctx(req.ns);
+                    IndexDetails *idx = findIndex(req);
+                    if (idx == NULL || !idx->hasBloomFilter(req.filter)) {
+                        return;
+                    }
+                    done = idx->populateBloomFilterChunk(*req.filter, isolations[i], resumeKey);
+                }
+            }
+
+            Client::WriteContext ctx(req.ns);
+            IndexDetails *idx = findIndex(req);
+            if (idx != NULL) {
+                idx->finishBloomFilter(req.filter);
+            }
+        }
+
+        void abandon(const Request &req) {
+            if (!req.rebuild || !req.filter) {
+                return;
+            }
+            try {
+                Client::WriteContext ctx(req.ns);
+                IndexDetails *idx = findIndex(req);
+                if (idx != NULL) {
+                    idx->abandonBloomFilterRebuild(req.filter);
+                }
+            } catch (const DBException &e) {
+                warning() << "could not abandon the bloom filter rebuild for index " << req.index
+                          << " on " << req.ns << ": " << e.what() << endl;
+            }
+        }
+
+        SimpleMutex _mutex;
+        deque<Request> _requests;
+    };
+
+    static SimpleMutex bloomFilterPopulatorMutex("bloomFilterPopulator");
+    static BloomFilterPopulator *bloomFilterPopulator = NULL;
+
+    void IndexDetails::populateBloomFilterInBackground(const string &ns, const string &index, bool rebuild) {
+        SimpleMutex::scoped_lock lk(bloomFilterPopulatorMutex);
+        if (bloomFilterPopulator == NULL) {
+            bloomFilterPopulator = new BloomFilterPopulator();
+            bloomFilterPopulator->go();
+        }
+        bloomFilterPopulator->enqueue(ns, index, rebuild);
+    }
+
+    void IndexDetails::setBloomFilterReady() {
+        if (_bloomFilter) {
+            TOKULOG(1) << "bloom filter ready for " << indexNamespace() << endl;
+            _bloomFilter->setReady();
+        }
+    }
+
+    void IndexDetails::appendBloomFilterStats(BSONObjBuilder &b) const {
+        if (_bloomFilter) {
+            BSONObjBuilder sub(b.subobjStart("bloomFilter"));
+            _bloomFilter->appendStats(sub);
+            sub.append("rebuilds", _bloomFilterRebuilds);
+            sub.appendBool("rebuilding", _pendingBloomFilter.get() != NULL);
+            sub.done();
+        }
     }
 
     void IndexDetails::uassertedDupKey(const BSONObj &key) const {
@@ -393,6 +689,22 @@ namespace mongo {
         }
     }
 
+    BSONObj IndexDetails::changeAttributes(const BSONObj &attrs) {
+        if (_db) {
+            _db->changeAttributes(attrs);
+        }
+        BSONObjBuilder b;
+        for (BSONObjIterator it(_info); it.more(); ) {
+            const BSONElement e = it.next();
+            if (!attrs.hasField(e.fieldName())) {
+                b.append(e);
+            }
+        }
+        b.appendElements(attrs);
+        _info = b.obj();
+        return _info;
+    }
+
     int IndexDetails::hot_opt_callback(void *extra, float progress) {
         int retval = 0;
         uint64_t iter = *(uint64_t *)extra;
@@ -430,6 +742,9 @@ namespace mongo {
               _pageSize(idx.getPageSize()),
               _accessStats(idx.getAccessStats()) {
         idx.getStat64(&_stats);
+        BSONObjBuilder b;
+        idx.appendBloomFilterStats(b);
+        _bloomFilterStats = b.obj();
     }
     
     BSONObj IndexStats::obj(int scale) const {
@@ -441,6 +756,10 @@ namespace mongo {
                                       ? 0.0
                                       : ((double)_stats.bt_dsize/_stats.bt_nkeys)));
         b.appendNumber("storageSize", (long long) _stats.bt_fsize / scale);
+        // uncompressed bytes per byte on disk, for choosing a compression method
+        b.appendNumber("compressionRatio", (_stats.bt_fsize == 0
+                                            ? 0.0
+                                            : ((double)_stats.bt_dsize/_stats.bt_fsize)));
         b.append("pageSize", _pageSize / scale);
         b.append("readPageSize", _readPageSize / scale);
         // fill compression
@@ -478,6 +797,7 @@ namespace mongo {
         b.appendNumber("nscannedObjects", _accessStats.nscannedObjects.load());
         b.appendNumber("inserts", _accessStats.inserts.load());
         b.appendNumber("deletes", _accessStats.deletes.load());
+        b.appendElements(_bloomFilterStats);
         return b.obj();
         // TODO: (Zardosht) Need to figure out how to display these dates
         /*
@@ -38,6 +38,7 @@ namespace mongo {
 
     class Cursor; 
     class NamespaceDetails;
+    class BloomFilter;
 
     // Represents an index of a collection.
     class IndexDetails : boost::noncopyable {
@@ -92,6 +93,7 @@ namespace mongo {
            keys will be left empty if key not found in the object.
         */
         void getKeysFromObject(const BSONObj &obj, BSONObjSet &keys) const;
+        void getKeysFromObject(const BSONObj &obj, KeySink &keys) const;
 
         BSONObj getKeyFromQuery(const BSONObj& query) const {
             return query.extractFieldsUnDotted(_keyPattern);
@@ -185,6 +187,11 @@ namespace mongo {
         uint32_t getPageSize() const;
         uint32_t getReadPageSize() const;
         void getStat64(DB_BTREE_STAT64* stats) const;
+
+        // Change the compression, pageSize and/or readPageSize of this index,
+        // for new writes, to whichever of those fields attrs has.
+        // @return the new info, which the caller must persist in the catalog.
+        BSONObj changeAttributes(const BSONObj &attrs);
         void optimize(const storage::Key &leftSKey, const storage::Key &rightSKey,
                       const bool sendOptimizeMessage);
         void acquireTableLock();
@@ -202,6 +209,44 @@ namespace mongo {
         void uniqueCheck(const BSONObj &key, const BSONObj *pk) const ;
         void uassertedDupKey(const BSONObj &key) const;
 
+        // A unique index created with { bloomFilter: true } keeps an in-memory
+        // bloom filter of its keys, so uniqueCheck() can skip the probe for keys
+        // that are definitely absent. Every key written to the index must be
+        // noted, whether or not it was checked.
+        void noteUniqueKey(const BSONObj &key) const;
+        // The caller noted every key in the index, so the bloom filter may be trusted.
+        void setBloomFilterReady();
+        // Appends the bloom filter's stats, if there is one.
+        void appendBloomFilterStats(BSONObjBuilder &b) const;
+
+        // A bloom filter is filled from the keys already in the index by a
+        // background thread, a chunk at a time, while its writers note new
+        // keys.  These are the steps it takes, each under a lock on the
+        // index's database that it takes afresh, so a dropped or reopened
+        // index just ends the job.
+        //
+        // Whether f is still the bloom filter being used or built for this index.
+        bool hasBloomFilter(const shared_ptr<BloomFilter> &f) const;
+        shared_ptr<BloomFilter> bloomFilter() const {
+            return _bloomFilter;
+        }
+        // Starts a bigger filter for writers to note keys in, alongside the
+        // current one. Requires a write lock. @return the new filter, or an
+        // empty pointer if there is nothing to rebuild.
+        shared_ptr<BloomFilter> startBloomFilterRebuild();
+        // Adds a chunk of the index's keys, read with the given isolation and
+        // starting at resumeKey, to f, and advances resumeKey.
+        // @return true once the end of the index is reached.
+        bool populateBloomFilterChunk(BloomFilter &f, int isolation, string &resumeKey) const;
+        // f holds every key in the index: trust it, in place of the current
+        // filter if it was a rebuild. Requires a write lock for a rebuild.
+        void finishBloomFilter(const shared_ptr<BloomFilter> &f);
+        // Requires a write lock.
+        void abandonBloomFilterRebuild(const shared_ptr<BloomFilter> &f);
+        // Queues the background thread to fill the index's filter, or to
+        // build a bigger one to replace it.
+        static void populateBloomFilterInBackground(const string &ns, const string &index, bool rebuild);
+
         template<class Callback>
         void getKeyAfterBytes(const storage::Key &startKey, uint64_t skipLen, Callback &cb) const;
 
@@ -273,8 +318,8 @@ namespace mongo {
         static int hot_opt_callback(void *extra, float progress);
 
         // Info about the index. Stored on disk in the database.ns dictionary
-        // for this database as a BSON object.
-        const BSONObj _info;
+        // for this database as a BSON object. Only changeAttributes() changes it.
+        BSONObj _info;
 
         // Precomputed values from _info, for speed.
         const BSONObj _keyPattern;
@@ -289,9 +334,18 @@ namespace mongo {
         // in by subclass constructors.
         scoped_ptr<Descriptor> _descriptor;
 
+        // Replaced only under a write lock; writers hold at least a read lock.
+        shared_ptr<BloomFilter> _bloomFilter;
+        shared_ptr<BloomFilter> _pendingBloomFilter;
+        int _bloomFilterRebuilds;
+
     private:
         mutable AccessStats _accessStats;
 
+        // Adds the key to the bloom filter, and to the one being built to
+        // replace it.  @return true if the key may already be in the index.
+        bool testAndAddBloomFilterKey(const BSONObj &key) const;
+
         // Must be called after constructor. Opens the ydb dictionary
         // using _descriptor, which is set by subclass constructors.
         //
@@ -338,6 +392,7 @@ namespace mongo {
         uint32_t _readPageSize;
         uint32_t _pageSize;
         const IndexDetails::AccessStats &_accessStats;
+        BSONObj _bloomFilterStats;
     };
 
     template<class Callback>
@@ -23,9 +23,12 @@
 #include "mongo/db/queryutil.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/cursor.h"
+#include "mongo/util/tracepoint.h"
 
 namespace mongo {
 
+    MONGO_TRACEPOINT_DECLARE(ydbCursorGet);
+
     RowBuffer::RowBuffer() :
         _size(_BUF_SIZE_PREFERRED),
         _current_offset(0),
@@ -154,6 +157,8 @@ namespace mongo {
                                                const BSONObj &startKey, const BSONObj &endKey,
                                                bool endKeyInclusive, int direction,
                                                int numWanted ) {
+        massert( 17024, "bug: partitioned collections must be scanned with a PartitionedCursor",
+                        d == NULL || !d->isPartitioned() );
         return shared_ptr<IndexCursor>( new IndexCursor( d, idx, startKey, endKey,
                                                          endKeyInclusive, direction,
                                                          numWanted ) );
@@ -163,6 +168,8 @@ namespace mongo {
                                                const shared_ptr< FieldRangeVector > &bounds,
                                                int singleIntervalLimit, int direction,
                                                int numWanted ) {
+        massert( 17025, "bug: partitioned collections must be scanned with a PartitionedCursor",
+                        d == NULL || !d->isPartitioned() );
         return shared_ptr<IndexCursor>( new IndexCursor( d, idx, bounds,
                                                          singleIntervalLimit, direction,
                                                          numWanted ) );
@@ -498,10 +505,13 @@ namespace mongo {
         const int rows_to_fetch = getf_fetch_count();
         struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
         DBC *cursor = _cursor.dbc();
-        if ( forward() ) {
-            r = cursor->c_getf_set_range(cursor, getf_flags(), &key_dbt, cursor_getf, &extra);
-        } else {
-            r = cursor->c_getf_set_range_reverse(cursor, getf_flags(), &key_dbt, cursor_getf, &extra);
+        {
+            MONGO_TRACE(ydbCursorGet);
+            if ( forward() ) {
+                r = cursor->c_getf_set_range(cursor, getf_flags(), &key_dbt, cursor_getf, &extra);
+            } else {
+                r = cursor->c_getf_set_range_reverse(cursor, getf_flags(), &key_dbt, cursor_getf, &extra);
+            }
         }
         if ( extra.ex != NULL ) {
             throw *extra.ex;
@@ -693,10 +703,13 @@ again:      while ( !allInclusive && ok() ) {
         const int rows_to_fetch = getf_fetch_count();
         struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
         DBC *cursor = _cursor.dbc();
-        if ( forward() ) {
-            r = cursor->c_getf_next(cursor, getf_flags(), cursor_getf, &extra);
-        } else {
-            r = cursor->c_getf_prev(cursor, getf_flags(), cursor_getf, &extra);
+        {
+            MONGO_TRACE(ydbCursorGet);
+            if ( forward() ) {
+                r = cursor->c_getf_next(cursor, getf_flags(), cursor_getf, &extra);
+            } else {
+                r = cursor->c_getf_prev(cursor, getf_flags(), cursor_getf, &extra);
+            }
         }
         if ( extra.ex != NULL ) {
             throw *extra.ex;
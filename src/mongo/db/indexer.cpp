@@ -16,13 +16,21 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/index.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/progress_meter.h"
 #include "mongo/util/stringutils.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -67,6 +75,8 @@ namespace mongo {
         uassert(12588, "cannot add index with a hot index build in progress",
                        !_d->_indexBuildInProgress);
 
+        _d->checkIndexSpec(_info);
+
         uassert(12523, "no index name specified",
                         _info["name"].ok());
 
@@ -93,7 +103,10 @@ namespace mongo {
 
         // Store the index in the _indexes array so that others know an
         // index with this name / key pattern exists and is being built.
-        _idx = IndexDetails::make(_info);
+        // A partitioned collection's indexes only describe its partitions'.
+        _idx = _d->isPartitioned()
+               ? shared_ptr<IndexDetails>(new IndexDetails(_info))
+               : IndexDetails::make(_info);
         _d->_indexes.push_back(_idx);
         _d->_indexBuildInProgress = true;
 
@@ -121,8 +134,11 @@ namespace mongo {
 
     void NamespaceDetails::HotIndexer::_prepare() {
         verify(_idx.get() != NULL);
-        // The primary key doesn't need to be built - there's no data.
-        if (_isSecondaryIndex) {
+        if (_d->isPartitioned()) {
+            // Each partition builds its own piece of the index.
+            _d->prepareHotIndexPartitions(_info, _partitionIndexers);
+        } else if (_isSecondaryIndex) {
+            // The primary key doesn't need to be built - there's no data.
             // Give the underlying DB a pointer to the multikey bool, which 
             // will be set during index creation if multikeys are generated.
             // see storage::generate_keys()
@@ -135,20 +151,126 @@ namespace mongo {
         }
     }
 
-    void NamespaceDetails::HotIndexer::build() {
-        Lock::assertAtLeastReadLocked(_d->_ns);
+    namespace {
+
+        // Runs the ydb indexers of one hot index build in turn, on a thread
+        // of its own so the client thread can report progress. They all use
+        // the build's transaction, and the ydb allows only one thread at a
+        // time in a transaction, so they never run side by side. The first
+        // failure stops the rest.
+        class DictionaryBuilds : boost::noncopyable {
+        public:
+            DictionaryBuilds(const vector<storage::Indexer *> &indexers) :
+                _indexers(indexers), _mutex("DictionaryBuilds"), _failed(false) {
+            }
+
+            void run() {
+                // The ydb calls back into us on this thread, when a row lock
+                // it waits for times out for instance, and those callbacks
+                // expect a Client.
+                Client::initThread("hotIndexBuild");
+                for (size_t i = 0; i < _indexers.size(); i++) {
+                    try {
+                        const int r = _indexers[i]->build();
+                        if (r != 0) {
+                            storage::handle_ydb_error(r);
+                        }
+                    } catch (const std::exception &ex) {
+                        fail(ex);
+                        break;
+                    }
+                }
+                cc().shutdown();
+                _exited.fetchAndAdd(1);
+            }
+
+            unsigned exited() const {
+                return _exited.load();
+            }
+
+            // @return thousandths done, summed over the indexers
+            unsigned long long progress() const {
+                unsigned long long progress = 0;
+                for (size_t i = 0; i < _indexers.size(); i++) {
+                    progress += _indexers[i]->progress();
+                }
+                return progress;
+            }
+
+            void throwIfFailed() const {
+                SimpleMutex::scoped_lock lk(_mutex);
+                if (_failed) {
+                    _exception.throwException();
+                }
+            }
+
+        private:
+            void fail(const std::exception &ex) {
+                SimpleMutex::scoped_lock lk(_mutex);
+                _failed = true;
+                _exception.saveException(ex);
+            }
 
+            const vector<storage::Indexer *> &_indexers;
+            AtomicUInt32 _exited;
+            mutable SimpleMutex _mutex;
+            bool _failed;
+            ExceptionSaver _exception;
+        };
+
+    } // namespace
+
+    void NamespaceDetails::HotIndexer::_buildDictionaries() {
+        vector<storage::Indexer *> indexers;
         if (_indexer.get() != NULL) {
-            const int r = _indexer->build();
-            if (r != 0) {
-                storage::handle_ydb_error(r);
+            indexers.push_back(_indexer.get());
+        }
+        for (size_t i = 0; i < _partitionIndexers.vector().size(); i++) {
+            HotIndexer *partitionIndexer = _partitionIndexers.vector()[i];
+            verify(partitionIndexer->_indexer.get() != NULL);
+            indexers.push_back(partitionIndexer->_indexer.get());
+        }
+
+        // Every ydb indexer walks its source dictionary and writes a
+        // dictionary of its own, so each partition of a partitioned collection
+        // is indexed by itself. Writers keep going through the ydb, which
+        // hands each of their keys to the right indexer.
+        DictionaryBuilds builds(indexers);
+        boost::thread thread(boost::bind(&DictionaryBuilds::run, &builds));
+
+        {
+            ProgressMeterHolder pm(cc().curop()->setMessage("index: (1/1) hot build",
+                                                            indexers.size() * 1000));
+            pm->setUnits("thousandths");
+            while (builds.exited() == 0) {
+                sleepmillis(100);
+                const unsigned long long progress = builds.progress();
+                if (progress > pm->done()) {
+                    pm.hit(progress - pm->done());
+                }
             }
+        }
+        thread.join();
+        builds.throwIfFailed();
+    }
+
+    void NamespaceDetails::HotIndexer::build() {
+        Lock::assertAtLeastReadLocked(_d->_ns);
+
+        if (_indexer.get() != NULL || !_partitionIndexers.vector().empty()) {
+            _buildDictionaries();
 
             // If the index is unique, check all adjacent keys for a duplicate.
             if (_idx->unique()) {
                 _d->checkIndexUniqueness(*_idx.get());
             }
-        } 
+            // The ydb indexer writes keys we never see, including some on behalf
+            // of other transactions, so a bloom filter on this index isn't trusted
+            // until the index is next opened and the filter populated.
+        } else {
+            // A new collection is empty, so writers will note every key.
+            _idx->setBloomFilterReady();
+        }
     }
 
     void NamespaceDetails::HotIndexer::_commit() {
@@ -161,6 +283,13 @@ namespace mongo {
                 _d->setIndexIsMultikey(_d->idxNo(*_idx.get()));
             }
         }
+        for (size_t i = 0; i < _partitionIndexers.vector().size(); i++) {
+            HotIndexer *partitionIndexer = _partitionIndexers.vector()[i];
+            partitionIndexer->commit();
+            if (partitionIndexer->_multiKeyTracker->isMultiKey()) {
+                _d->setIndexIsMultikey(_d->idxNo(*_idx.get()));
+            }
+        }
     }
 
     NamespaceDetails::ColdIndexer::ColdIndexer(NamespaceDetails *d, const BSONObj &info) :
@@ -184,6 +313,7 @@ namespace mongo {
                 }
                 for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
                     builder.insertPair(*ki, &pk, obj);
+                    _idx->noteUniqueKey(*ki);
                 }
                 killCurrentOp.checkForInterrupt(); // uasserts if we should stop
             }
@@ -195,6 +325,9 @@ namespace mongo {
                 _d->checkIndexUniqueness(*_idx);
             }
         }
+        // We hold the write lock, so every key is either one we just noted or
+        // will be noted by the writer that inserts it.
+        _idx->setBloomFilterReady();
     }
 
 } // namespace mongo
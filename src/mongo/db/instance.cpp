@@ -50,6 +50,7 @@
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/op_latencies.h"
 #include "mongo/db/storage/assert_ids.h"
 #include "mongo/db/storage/env.h"
 
@@ -298,6 +299,7 @@ namespace mongo {
     void mongoAbort(const char *msg) { 
         if( reportEventToSystem ) 
             reportEventToSystem(msg);
+        Logstream::stopAsync();
         rawOut(msg);
         ::abort();
     }
@@ -358,6 +360,10 @@ namespace mongo {
             c.getAuthenticationInfo()->startRequest();
         }
 
+        // transient buffers for this operation come from the client's arena
+        BufArena::Scope arenaScope( c.bufArena() );
+        const BufArena::Stats arenaBefore = c.bufArena().stats();
+
         // initialize the default OpSettings, 
         OpSettings settings;
         c.setOpSettings(settings);
@@ -457,6 +463,12 @@ namespace mongo {
         currentOp.ensureStarted();
         currentOp.done();
         debug.executionTime = currentOp.totalTimeMillis();
+        OpLatencies::global.record( currentOp.getNS() , op , debug.iscommand ,
+                                    currentOp.totalTimeMicros() );
+
+        debug.arenaAllocs = c.bufArena().stats().allocations - arenaBefore.allocations;
+        debug.arenaMallocs = c.bufArena().stats().mallocs - arenaBefore.mallocs;
+        bufArenaCounters.gotOp( op , debug.iscommand , debug.arenaAllocs , debug.arenaMallocs );
 
         logThreshold += currentOp.getExpectedLatencyMs();
 
@@ -779,59 +791,109 @@ namespace mongo {
         return ok;
     }
 
+    // The collection an insert into system.indexes builds an index on, if the build can
+    // lock just that collection (see Lock::CollectionWrite), or empty if it can't.
+    static string _indexedCollection(const char *ns, const vector<BSONObj> &objs) {
+        if (objs.size() != 1 || objs[0]["ns"].type() != String) {
+            return "";
+        }
+        const string coll = objs[0]["ns"].String();
+        if (!NamespaceString::validCollectionName(coll.c_str()) ||
+            nsToDatabaseSubstring(coll) != nsToDatabaseSubstring(ns)) {
+            return "";
+        }
+        return coll;
+    }
+
+    static Lock::ScopedLock *_indexBuildLock(const char *ns, const string &coll) {
+        return coll.empty()
+               ? static_cast<Lock::ScopedLock *>(new Lock::DBWrite(ns))
+               : static_cast<Lock::ScopedLock *>(new Lock::CollectionWrite(coll));
+    }
+
+    // Prepares a background index build. Performs index validation and marks
+    // the NamespaceDetails as having an index build in progress.
+    // @return false if the index already exists.
+    static bool _prepareHotIndex(const char *ns, Message &m, const vector<BSONObj> &objs,
+                                 scoped_ptr<Client::Transaction> &transaction,
+                                 scoped_ptr<NamespaceDetails::HotIndexer> &indexer) {
+        transaction.reset(new Client::Transaction(DB_SERIALIZABLE));
+        uassert(16902, "not master", isMasterNs(ns));
+
+        // System.indexes cannot be sharded.
+        verify(!handlePossibleShardedMessage(m, 0));
+
+        const BSONObj &info = objs[0];
+        const StringData &coll = info["ns"].Stringdata();
+
+        Client::Context ctx(ns);
+        NamespaceDetails *d = getAndMaybeCreateNS(coll, true);
+        if (d->findIndexByKeyPattern(info["key"].Obj()) >= 0) {
+            // No error or action if the index already exists. We need to commit
+            // the transaction in case this is an ensure index on the _id field
+            // and the ns was created by getAndMaybeCreateNS()
+            transaction->commit();
+            return false;
+        }
+        _insertObjects(ns, objs, false, 0, true);
+        indexer.reset(new NamespaceDetails::HotIndexer(d, info));
+        indexer->prepare();
+        return true;
+    }
+
     static void _buildHotIndex(const char *ns, Message &m, const vector<BSONObj> objs) {
         uassert(16905, "Can only build one index at a time.", objs.size() == 1);
 
+        // The build only changes the collection it indexes, so it only locks that
+        // collection, where it can, and ops on the rest of the database go on.
+        const string coll = _indexedCollection(ns, objs);
+
         scoped_ptr<Client::Transaction> transaction;
         scoped_ptr<NamespaceDetails::HotIndexer> indexer;
 
         // The indexer destructor must be called in a write lock
         class DestroyIndexerInWriteLock : boost::noncopyable {
         public:
-            DestroyIndexerInWriteLock(const char *ns,
+            DestroyIndexerInWriteLock(const char *ns, const string &coll,
                                       scoped_ptr<NamespaceDetails::HotIndexer> &indexer) :
-                _ns(ns), _indexer(indexer) {
+                _ns(ns), _coll(coll), _indexer(indexer) {
             }
             ~DestroyIndexerInWriteLock() {
-                Lock::DBWrite lk(_ns);
+                scoped_ptr<Lock::ScopedLock> lk(_indexBuildLock(_ns, _coll));
                 _indexer.reset();
             }
         private:
             const char *_ns;
+            const string &_coll;
             scoped_ptr<NamespaceDetails::HotIndexer> &_indexer;
-        } destroyIndexer(ns, indexer);
-
-        // Prepare the index build. Performs index validation and marks
-        // the NamespaceDetails as having an index build in progress.
-        {
-            Lock::DBWrite lk(ns);
-            transaction.reset(new Client::Transaction(DB_SERIALIZABLE));
-            uassert(16902, "not master", isMasterNs(ns));
-
-            // System.indexes cannot be sharded.
-            verify(!handlePossibleShardedMessage(m, 0));
-
-            const BSONObj &info = objs[0];
-            const StringData &coll = info["ns"].Stringdata();
+        } destroyIndexer(ns, coll, indexer);
 
-            Client::Context ctx(ns);
-            NamespaceDetails *d = getAndMaybeCreateNS(coll, true);
-            if (d->findIndexByKeyPattern(info["key"].Obj()) >= 0) {
-                // No error or action if the index already exists. We need to commit
-                // the transaction in case this is an ensure index on the _id field
-                // and the ns was created by getAndMaybeCreateNS()
-                transaction->commit();
-                return;
+        // Prepare the index build. If the collection or the database has to be
+        // created first, that needs the database write locked.
+        bool prepared = false;
+        bool retry = false;
+        try {
+            scoped_ptr<Lock::ScopedLock> lk(_indexBuildLock(ns, coll));
+            prepared = _prepareHotIndex(ns, m, objs, transaction, indexer);
+        }
+        catch (RetryWithWriteLock &e) {
+            if (coll.empty()) {
+                throw;
             }
-
-            _insertObjects(ns, objs, false, 0, true);
-            indexer.reset(new NamespaceDetails::HotIndexer(d, info));
-            indexer->prepare();
+            retry = true;
+        }
+        if (retry) {
+            Lock::DBWrite lk(ns);
+            indexer.reset();
+            prepared = _prepareHotIndex(ns, m, objs, transaction, indexer);
+        }
+        if (!prepared) {
+            return;
         }
 
         // Perform the index build
         {
-            Lock::DBRead lk(ns);
+            Lock::DBRead lk(coll.empty() ? string(ns) : coll);
             uassert(16906, "not master: after indexer setup but before build", isMasterNs(ns));
 
             Client::Context ctx(ns);
@@ -840,7 +902,7 @@ namespace mongo {
 
         // Commit the index build
         {
-            Lock::DBWrite lk(ns);
+            scoped_ptr<Lock::ScopedLock> lk(_indexBuildLock(ns, coll));
             uassert(16907, "not master: after indexer build but before commit", isMasterNs(ns));
 
             Client::Context ctx(ns);
@@ -890,9 +952,26 @@ namespace mongo {
         settings.setQueryCursorMode(WRITE_LOCK_CURSOR);
         cc().setOpSettings(settings);
 
-        if (str::contains(ns, ".system.indexes") && objs[0]["background"].trueValue()) {
-            _buildHotIndex(ns, m, objs);
-            return;
+        if (str::contains(ns, ".system.indexes")) {
+            if (objs[0]["background"].trueValue()) {
+                _buildHotIndex(ns, m, objs);
+                return;
+            }
+            // A foreground index build only needs its collection locked, unless the
+            // collection or the database has to be created first.
+            const string coll = _indexedCollection(ns, objs);
+            if (!coll.empty()) {
+                try {
+                    Lock::CollectionWrite lk(coll);
+                    lockedReceivedInsert(ns, m, objs, keepGoing);
+                    return;
+                }
+                catch (RetryWithWriteLock &e) {
+                }
+                Lock::DBWrite lk(ns);
+                lockedReceivedInsert(ns, m, objs, keepGoing);
+                return;
+            }
         }
 
         try {
@@ -1115,6 +1194,7 @@ namespace mongo {
                     // this means something horrible has happened
                     ::_exit( rc );
                 }
+                Logstream::stopAsync();
                 stringstream ss;
                 ss << "dbexit: " << why << "; exiting immediately";
                 tryToOutputFatal( ss.str() );
@@ -1152,6 +1232,7 @@ namespace mongo {
             return;
         }
 #endif
+        Logstream::stopAsync();
         tryToOutputFatal( "dbexit: really exiting now" );
         if ( c ) c->shutdown();
         ::_exit(rc);
@@ -15,6 +15,10 @@
 
 #include "mongo/db/json.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "mongo/db/jsobj.h"
 #include "mongo/platform/cstdint.h"
 #include "mongo/util/base64.h"
@@ -59,6 +63,59 @@ namespace mongo {
                  *SINGLEQUOTE = "'",
                  *DOUBLEQUOTE = "\"";
 
+    namespace {
+
+        // Characters allowed in an unquoted field name: ALPHA DIGIT "_$"
+        class FieldCharTable {
+        public:
+            FieldCharTable() {
+                memset(_table, 0, sizeof(_table));
+                for (const char* c = ALPHA DIGIT "_$"; *c != '\0'; ++c) {
+                    _table[static_cast<unsigned char>(*c)] = true;
+                }
+            }
+            bool operator[](char c) const {
+                return _table[static_cast<unsigned char>(c)];
+            }
+        private:
+            bool _table[256];
+        };
+        const FieldCharTable fieldChars;
+
+        /**
+         * @return the first character at or after q, and before end, that
+         * JParse::chars() must look at on its own: the terminal character, a
+         * backslash or a control character.  Everything before it is copied
+         * to the result as is.  Scans 16 bytes at a time where it can.
+         */
+        const char* skipPlainChars(const char* q, const char* end, char terminal) {
+#if defined(__SSE2__)
+            const __m128i terminals = _mm_set1_epi8(terminal);
+            const __m128i backslashes = _mm_set1_epi8('\\');
+            const __m128i maxControl = _mm_set1_epi8(0x1F);
+            while (q + 16 <= end) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+                const __m128i special =
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, terminals),
+                                              _mm_cmpeq_epi8(block, backslashes)),
+                                 // unsigned block <= 0x1F
+                                 _mm_cmpeq_epi8(_mm_max_epu8(block, maxControl), maxControl));
+                const int mask = _mm_movemask_epi8(special);
+                if (mask != 0) {
+                    return q + __builtin_ctz(mask);
+                }
+                q += 16;
+            }
+#endif
+            while (q < end && *q != terminal && *q != '\\' &&
+                   static_cast<unsigned char>(*q) > 0x1F) {
+                ++q;
+            }
+            return q;
+        }
+
+    } // namespace
+
     JParse::JParse(const char* str)
         : _buf(str), _input(str), _input_end(str + strlen(str)) {}
 
@@ -731,6 +788,36 @@ namespace mongo {
     }
 
     Status JParse::number(const StringData& fieldName, BSONObjBuilder& builder) {
+        // Fast path for plain integers that surely fit in 64 bits, which
+        // strtod and strtoll would agree on.
+        {
+            const char* q = _input;
+            const bool negative = (q < _input_end && *q == '-');
+            if (negative) {
+                ++q;
+            }
+            const char* digits = q;
+            long long val = 0;
+            while (q < _input_end && q - digits < 18 && *q >= '0' && *q <= '9') {
+                val = val * 10 + (*q++ - '0');
+            }
+            const size_t n = q - digits;
+            if (n > 0 && q < _input_end && !(*q >= '0' && *q <= '9') && *q != '.' && *q != 'e' && *q != 'E' &&
+                !(n == 1 && *digits == '0' && (*q == 'x' || *q == 'X'))) {
+                if (negative) {
+                    val = -val;
+                }
+                if (val == static_cast<int>(val)) {
+                    builder.append(fieldName, static_cast<int>(val));
+                }
+                else {
+                    builder.append(fieldName, val);
+                }
+                _input = q;
+                return Status::OK();
+            }
+        }
+
         char* endptrll;
         char* endptrd;
         long long retll;
@@ -788,7 +875,16 @@ namespace mongo {
             if (!match(*_input, ALPHA "_$")) {
                 return parseError("First character in field must be [A-Za-z$_]");
             }
-            return chars(result, "", ALPHA DIGIT "_$");
+            const char* q = _input;
+            while (q < _input_end && fieldChars[*q]) {
+                ++q;
+            }
+            if (q >= _input_end) {
+                return parseError("Unexpected end of input");
+            }
+            result->append(_input, q - _input);
+            _input = q;
+            return Status::OK();
         }
     }
 
@@ -828,9 +924,21 @@ namespace mongo {
         if (_input >= _input_end) {
             return parseError("Unexpected end of input");
         }
+        // A quoted string or regex ends at a single character, so runs of
+        // ordinary characters in it can be copied in bulk.
+        const bool singleTerminal = (allowedSet == NULL &&
+                                     terminalSet[0] != '\0' && terminalSet[1] == '\0');
         const char* q = _input;
         while (q < _input_end && !match(*q, terminalSet)) {
             MONGO_JSON_DEBUG("q: " << q);
+            if (singleTerminal) {
+                const char* run = skipPlainChars(q, _input_end, terminalSet[0]);
+                if (run != q) {
+                    result->append(q, run - q);
+                    q = run;
+                    continue;
+                }
+            }
             if (allowedSet != NULL) {
                 if (!match(*q, allowedSet)) {
                     _input = q;
@@ -34,23 +34,122 @@ namespace mongo {
     long long int HashKeyGenerator::makeSingleKey(const BSONElement &e,
                                                   const HashSeed &seed,
                                                   const HashVersion &v) {
-        massert( 16245, "Only HashVersion 0 has been defined", v == 0 );
-        return BSONElementHasher::hash64( e , seed );
+        massert( 16245, mongoutils::str::stream() << "Only HashVersions 0 through " << NEXT_HASH_VERSION - 1
+                                      << " have been defined", isValidHashVersion( v ) );
+        return BSONElementHasher::hash64( e , seed , v );
+    }
+
+    void BSONObjSetKeySink::add(const vector<BSONElement> &fields) {
+        BSONObjBuilder b(128);
+        for (vector<BSONElement>::const_iterator i = fields.begin(); i != fields.end(); ++i) {
+            b.appendAs(*i, "");
+        }
+        _keys.insert(b.obj());
+    }
+
+    void KeyCounter::add(const vector<BSONElement> &fields) {
+        if (_count > 1) {
+            return;
+        }
+        if (_count == 0) {
+            BSONObjBuilder b(_first);
+            for (vector<BSONElement>::const_iterator i = fields.begin(); i != fields.end(); ++i) {
+                b.appendAs(*i, "");
+            }
+            b.done();
+            _count = 1;
+            return;
+        }
+        // Equal keys count once, as they would in a BSONObjSet.
+        BSONObjIterator first(BSONObj(_first.buf()));
+        for (vector<BSONElement>::const_iterator i = fields.begin(); i != fields.end(); ++i) {
+            if (first.next().woCompare(*i, false) != 0) {
+                _count = 2;
+                return;
+            }
+        }
+    }
+
+    void KeyArena::reset(const BSONObj *pk) {
+        // Don't hang on to the memory of one huge multikey document forever.
+        static const int maxRetainedSize = 1 << 20;
+        _buf.reset(maxRetainedSize);
+        _keys.clear();
+        _pk = pk;
+    }
+
+    void KeyArena::add(const vector<BSONElement> &fields) {
+        _scratch.reset();
+        {
+            BSONObjBuilder b(_scratch);
+            for (vector<BSONElement>::const_iterator i = fields.begin(); i != fields.end(); ++i) {
+                b.appendAs(*i, "");
+            }
+            b.done();
+        }
+        const storage::KeyV1Owned key(BSONObj(_scratch.buf()));
+        const int offset = _buf.len();
+        _buf.appendBuf(key.data(), key.dataSize());
+        if (_pk != NULL) {
+            _buf.appendBuf(_pk->objdata(), _pk->objsize());
+        }
+        _keys.push_back(make_pair(offset, _buf.len() - offset));
+    }
+
+    class KeyArena::KeyLess {
+    public:
+        KeyLess(const char *buf, const Ordering &ordering) : _buf(buf), _ordering(ordering) { }
+        bool operator()(const pair<int, int> &a, const pair<int, int> &b) const {
+            return compare(a, b) < 0;
+        }
+        bool equal(const pair<int, int> &a, const pair<int, int> &b) const {
+            return compare(a, b) == 0;
+        }
+    private:
+        int compare(const pair<int, int> &a, const pair<int, int> &b) const {
+            // Every key carries the same pk (or none), so the KeyV1 part decides.
+            const storage::KeyV1 ka(_buf + a.first);
+            const storage::KeyV1 kb(_buf + b.first);
+            return ka.woCompare(kb, _ordering);
+        }
+        const char *_buf;
+        const Ordering &_ordering;
+    };
+
+    void KeyArena::sortAndDedup(const Ordering &ordering) {
+        if (_keys.size() < 2) {
+            return;
+        }
+        const KeyLess less(_buf.buf(), ordering);
+        std::sort(_keys.begin(), _keys.end(), less);
+        vector<pair<int, int> >::iterator last = _keys.begin();
+        for (vector<pair<int, int> >::iterator i = _keys.begin() + 1; i != _keys.end(); ++i) {
+            if (!less.equal(*last, *i)) {
+                *++last = *i;
+            }
+        }
+        _keys.erase(last + 1, _keys.end());
     }
 
     void HashKeyGenerator::getKeys(const BSONObj &obj, BSONObjSet &keys) {
+        BSONObjSetKeySink sink(keys);
+        getKeys(obj, sink);
+    }
+
+    void HashKeyGenerator::getKeys(const BSONObj &obj, KeySink &keys) {
         const char *hashedFieldPtr = _hashedField;
         const BSONElement &fieldVal = obj.getFieldDottedOrArray( hashedFieldPtr );
         uassert( storage::ASSERT_IDS::CannotHashArrays,
                  "Error: hashed indexes do not currently support array values",
                  fieldVal.type() != Array );
 
-        if (!fieldVal.eoo()) {
-            BSONObj key = BSON("" << makeSingleKey(fieldVal, _seed, _hashVersion));
-            keys.insert(key);
-        } else if (!_sparse) {
-            BSONObj key = BSON("" << makeSingleKey(nullElt, _seed, _hashVersion));
-            keys.insert(key);
+        if (!fieldVal.eoo() || !_sparse) {
+            const long long int h = makeSingleKey(fieldVal.eoo() ? nullElt : fieldVal, _seed, _hashVersion);
+            BSONObjBuilder b(32);
+            b.append("", h);
+            const BSONObj key = b.done();
+            const vector<BSONElement> fields(1, key.firstElement());
+            keys.add(fields);
         }
     }
 
@@ -61,14 +160,17 @@ namespace mongo {
 
     void KeyGenerator::getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
                                const bool sparse, BSONObjSet &keys) {
+        BSONObjSetKeySink sink(keys);
+        getKeys(obj, fieldNames, sparse, sink);
+    }
+
+    void KeyGenerator::getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
+                               const bool sparse, KeySink &keys) {
         vector<BSONElement> fixed( fieldNames.size() );
         _getKeys( fieldNames , fixed , obj, sparse, keys );
         if ( keys.empty() && ! sparse ) {
-            BSONObjBuilder nullKey;
-            for (size_t i = 0; i < fieldNames.size(); i++) {
-                nullKey.appendNull("");
-            }
-            keys.insert( nullKey.done() );
+            const vector<BSONElement> nullKey( fieldNames.size(), nullElt );
+            keys.add( nullKey );
         }
     }
         
@@ -99,7 +201,7 @@ namespace mongo {
         return BSONElement();
     }
         
-    void KeyGenerator::_getKeysArrEltFixed( vector<const char*> &fieldNames , vector<BSONElement> &fixed , const BSONElement &arrEntry, const bool sparse, BSONObjSet &keys, int numNotFound, const BSONElement &arrObjElt, const set< unsigned > &arrIdxs, bool mayExpandArrayUnembedded ) {
+    void KeyGenerator::_getKeysArrEltFixed( vector<const char*> &fieldNames , vector<BSONElement> &fixed , const BSONElement &arrEntry, const bool sparse, KeySink &keys, int numNotFound, const BSONElement &arrObjElt, const set< unsigned > &arrIdxs, bool mayExpandArrayUnembedded ) {
         // set up any terminal array values
         for( set<unsigned>::const_iterator j = arrIdxs.begin(); j != arrIdxs.end(); ++j ) {
             if ( *fieldNames[ *j ] == '\0' ) {
@@ -114,12 +216,12 @@ namespace mongo {
          * @param fieldNames - fields to index, may be postfixes in recursive calls
          * @param fixed - values that have already been identified for their index fields
          * @param obj - object from which keys should be extracted, based on names in fieldNames
-         * @param keys - set where index keys are written
+         * @param keys - sink where index keys are written
          * @param numNotFound - number of index fields that have already been identified as missing
          * @param array - array from which keys should be extracted, based on names in fieldNames
          *        If obj and array are both nonempty, obj will be one of the elements of array.
          */        
-    void KeyGenerator::_getKeys( vector<const char*> fieldNames , vector<BSONElement> fixed , const BSONObj &obj, const bool sparse, BSONObjSet &keys, int numNotFound, const BSONObj &array ) {
+    void KeyGenerator::_getKeys( vector<const char*> fieldNames , vector<BSONElement> fixed , const BSONObj &obj, const bool sparse, KeySink &keys, int numNotFound, const BSONObj &array ) {
         BSONElement arrElt;
         set<unsigned> arrIdxs;
         bool mayExpandArrayUnembedded = true;
@@ -166,11 +268,7 @@ namespace mongo {
             if ( sparse && numNotFound == (int) fieldNames.size() ) {
                 return;
             }            
-            BSONObjBuilder b(128);
-            for( vector< BSONElement >::iterator i = fixed.begin(); i != fixed.end(); ++i ) {
-                b.appendAs( *i, "" );
-            }
-            keys.insert( b.obj() );
+            keys.add( fixed );
         }
         else if ( arrElt.embeddedObject().firstElement().eoo() ) {
             // Empty array, so set matching fields to undefined.
@@ -22,9 +22,106 @@
 #include "mongo/pch.h"
 #include "mongo/db/hasher.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/storage/key.h"
 
 namespace mongo {
 
+    // Receives the keys produced by a key generator, one at a time.
+    class KeySink {
+    public:
+        virtual ~KeySink() {}
+
+        // @param fields one element per index field. Field names are ignored,
+        //        and the elements need only live until add() returns.
+        virtual void add(const vector<BSONElement> &fields) = 0;
+
+        virtual bool empty() const = 0;
+    };
+
+    // Collects keys as owned BSONObjs in a BSONObjSet.
+    class BSONObjSetKeySink : public KeySink {
+    public:
+        BSONObjSetKeySink(BSONObjSet &keys) : _keys(keys) { }
+
+        void add(const vector<BSONElement> &fields);
+
+        bool empty() const {
+            return _keys.empty();
+        }
+
+    private:
+        BSONObjSet &_keys;
+    };
+
+    // Counts the distinct keys generated for a document, up to two, which is
+    // all a multikey check needs, without keeping a set of them.
+    class KeyCounter : public KeySink {
+    public:
+        KeyCounter() : _first(64), _count(0) { }
+
+        void add(const vector<BSONElement> &fields);
+
+        bool empty() const {
+            return _count == 0;
+        }
+
+        // 0, 1, or 2 for two or more.
+        int count() const {
+            return _count;
+        }
+
+    private:
+        BufBuilder _first;
+        int _count;
+    };
+
+    // Collects keys already encoded in the dictionary key format (KeyV1,
+    // optionally followed by a primary key) in a single buffer that is
+    // reused from one document to the next, so generating keys costs no
+    // heap allocations once the buffers have grown to fit.
+    //
+    // Keys are appended in generation order. Call sortAndDedup() before
+    // using them as a set.
+    class KeyArena : public KeySink, boost::noncopyable {
+    public:
+        KeyArena() : _pk(NULL) { }
+
+        // Start over for a new document. Each key gets pk appended, if given.
+        // pk must stay valid until the next reset().
+        void reset(const BSONObj *pk = NULL);
+
+        void add(const vector<BSONElement> &fields);
+
+        bool empty() const {
+            return _keys.empty();
+        }
+
+        // Sort the keys by the index's ordering and drop duplicates.
+        void sortAndDedup(const Ordering &ordering);
+
+        size_t size() const {
+            return _keys.size();
+        }
+
+        const char *keyData(const size_t i) const {
+            return _buf.buf() + _keys[i].first;
+        }
+
+        size_t keySize(const size_t i) const {
+            return _keys[i].second;
+        }
+
+    private:
+        class KeyLess;
+
+        // Holds one key's BSON while it is encoded.
+        BufBuilder _scratch;
+        BufBuilder _buf;
+        // (offset, size) in _buf for each key.
+        vector<pair<int, int> > _keys;
+        const BSONObj *_pk;
+    };
+
     // Generates keys for a hashed index.
     class HashKeyGenerator {
     public:
@@ -37,6 +134,7 @@ namespace mongo {
         }
 
         void getKeys(const BSONObj &obj, BSONObjSet &keys);
+        void getKeys(const BSONObj &obj, KeySink &keys);
 
     private:
         static long long int makeSingleKey(const BSONElement &e,
@@ -65,6 +163,8 @@ namespace mongo {
         // One-time key generating function, because the implementation modifies fieldNames.
         static void getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
                             const bool sparse, BSONObjSet &keys);
+        static void getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
+                            const bool sparse, KeySink &keys);
     private:
 
         /**
@@ -74,7 +174,7 @@ namespace mongo {
                                                const char *&field, bool &arrayNestedArray );
         
         static void _getKeysArrEltFixed( vector<const char*> &fieldNames , vector<BSONElement> &fixed ,
-                                         const BSONElement &arrEntry, const bool sparse, BSONObjSet &keys, int numNotFound,
+                                         const BSONElement &arrEntry, const bool sparse, KeySink &keys, int numNotFound,
                                          const BSONElement &arrObjElt, const set< unsigned > &arrIdxs,
                                          bool mayExpandArrayUnembedded );
         
@@ -82,13 +182,13 @@ namespace mongo {
          * @param fieldNames - fields to index, may be postfixes in recursive calls
          * @param fixed - values that have already been identified for their index fields
          * @param obj - object from which keys should be extracted, based on names in fieldNames
-         * @param keys - set where index keys are written
+         * @param keys - sink where index keys are written
          * @param numNotFound - number of index fields that have already been identified as missing
          * @param array - array from which keys should be extracted, based on names in fieldNames
          *        If obj and array are both nonempty, obj will be one of the elements of array.
          */        
         static void _getKeys( vector<const char*> fieldNames , vector<BSONElement> fixed ,
-                              const BSONObj &obj, const bool sparse, BSONObjSet &keys, int numNotFound = 0,
+                              const BSONObj &obj, const bool sparse, KeySink &keys, int numNotFound = 0,
                               const BSONObj &array = BSONObj() );
 
         vector<const char *> _fieldNames;
@@ -32,7 +32,8 @@ namespace mongo {
             BSONElement fieldVal = doc.getFieldDotted( _pattern.firstElementFieldName() );
             return BSON( _pattern.firstElementFieldName() <<
                          BSONElementHasher::hash64( fieldVal ,
-                                                    BSONElementHasher::DEFAULT_HASH_SEED ) );
+                                                    BSONElementHasher::DEFAULT_HASH_SEED ,
+                                                    _hashVersion ) );
         }
 
         return doc.extractFields( _pattern );
@@ -177,7 +178,8 @@ namespace mongo {
                 if ( i->equality() ) {
                     // hash [a,a] --> [hash(a),hash(a)]
                     long long int h = BSONElementHasher::hash64( i->_lower._bound ,
-                                                             BSONElementHasher::DEFAULT_HASH_SEED );
+                                                                 BSONElementHasher::DEFAULT_HASH_SEED ,
+                                                                 _hashVersion );
                     ret.push_back( make_pair( BSON( field.fieldName() << h ) ,
                                               BSON( field.fieldName() << h ) ) );
                 } else {
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include "mongo/db/hasher.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/util/mongoutils/str.h"
 
@@ -44,10 +45,15 @@ namespace mongo {
      *    { a : 1 }
      *    { a : 1 , b  : -1 }
      *    { a : "hashed" }
+     *
+     *  A hashed field is hashed with the default seed and the given hash version.
      */
     class KeyPattern {
     public:
-        KeyPattern( const BSONObj& pattern ): _pattern( pattern ) {}
+        KeyPattern( const BSONObj& pattern , HashVersion hashVersion = HASH_VERSION_MD5 ):
+            _pattern( pattern ), _hashVersion( hashVersion ) {}
+
+        HashVersion hashVersion() const { return _hashVersion; }
 
         /*
          *  Returns a BSON representation of this KeyPattern.
@@ -150,6 +156,7 @@ namespace mongo {
 
     private:
         BSONObj _pattern;
+        HashVersion _hashVersion;
         bool isAscending( const BSONElement& fieldExpression ) const {
             return ( fieldExpression.isNumber()  && fieldExpression.numberInt() == 1 );
         }
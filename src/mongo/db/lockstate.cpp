@@ -74,6 +74,18 @@ namespace mongo {
         return false;
     }
 
+    bool LockState::isCollectionWriteLocked( const StringData& ns ) const {
+        for ( vector<string>::const_iterator i = _exclusiveCollections.begin(); i != _exclusiveCollections.end(); ++i ) {
+            // the collection itself, its indexes (coll.$name) and its partitions (coll$$pN)
+            if ( ns.startsWith( *i ) &&
+                 ( ns.size() == i->size() || ns[i->size()] == '$' ||
+                   ( ns[i->size()] == '.' && ns.size() > i->size() + 1 && ns[i->size() + 1] == '$' ) ) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void LockState::lockedStart( char newState ) {
         _threadState = newState;
     }
@@ -216,6 +228,15 @@ namespace mongo {
         _otherLock = 0;
     }
 
+    void LockState::lockedCollections( const vector<string>& collections ) {
+        fassert( 17055 , _exclusiveCollections.empty() );
+        _exclusiveCollections = collections;
+    }
+
+    void LockState::unlockedCollections() {
+        _exclusiveCollections.clear();
+    }
+
     LockStat* LockState::getRelevantLockStat() {
         if ( _whichNestable )
             return Lock::nestableLockStat( _whichNestable );
@@ -230,6 +251,64 @@ namespace mongo {
     }
 
 
+    CollectionLocks::CollectionLocks()
+        : _mapLock("collectionLocks"),
+          _shared(0),
+          _intentExclusive(0),
+          _intentExclusiveWaiting(0) {
+    }
+
+    CollectionLock* CollectionLocks::get( const StringData& collection ) {
+        {
+            SimpleRWLock::Shared lk( _mapLock );
+            map<string, CollectionLock*>::const_iterator i = _locks.find( collection.toString() );
+            if ( i != _locks.end() )
+                return i->second;
+        }
+        SimpleRWLock::Exclusive lk( _mapLock );
+        CollectionLock*& lock = _locks[collection.toString()];
+        if ( lock == 0 )
+            lock = new CollectionLock( collection.toString().c_str() );
+        return lock;
+    }
+
+    void CollectionLocks::lockShared() {
+        boost::mutex::scoped_lock lk( _m );
+        while ( _intentExclusive || _intentExclusiveWaiting )
+            _c.wait( lk );
+        _shared++;
+    }
+
+    void CollectionLocks::unlockShared() {
+        boost::mutex::scoped_lock lk( _m );
+        verify( _shared > 0 );
+        if ( --_shared == 0 )
+            _c.notify_all();
+    }
+
+    void CollectionLocks::lockIntentExclusive() {
+        boost::mutex::scoped_lock lk( _m );
+        _intentExclusiveWaiting++;
+        while ( _shared )
+            _c.wait( lk );
+        _intentExclusiveWaiting--;
+        _intentExclusive++;
+    }
+
+    void CollectionLocks::unlockIntentExclusive() {
+        boost::mutex::scoped_lock lk( _m );
+        verify( _intentExclusive > 0 );
+        if ( --_intentExclusive == 0 )
+            _c.notify_all();
+    }
+
+    void CollectionLocks::report( BSONObjBuilder& b ) {
+        SimpleRWLock::Shared lk( _mapLock );
+        for ( map<string, CollectionLock*>::const_iterator i = _locks.begin(); i != _locks.end(); ++i ) {
+            b.append( i->first , i->second->stats.report() );
+        }
+    }
+
     Acquiring::Acquiring( Lock::ScopedLock* lock,  LockState& ls )
         : _lock( lock ), _ls( ls ){
         _ls._lockPending = true;
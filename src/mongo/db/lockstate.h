@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <boost/thread/condition.hpp>
+
 #include "mongo/db/d_concurrency.h"
 
 namespace mongo {
@@ -49,6 +51,10 @@ namespace mongo {
         
         bool isLocked( const StringData& ns ); // rwRW
 
+        /** true if we hold ns's collection exclusively (Lock::CollectionWrite) */
+        bool isCollectionWriteLocked( const StringData& ns ) const;
+        bool hasCollectionWriteLock() const { return !_exclusiveCollections.empty(); }
+
         /** pending means we are currently trying to get a lock */
         bool hasLockPending() const { return _lockPending || _lockPendingParallelWriter; }
 
@@ -79,6 +85,8 @@ namespace mongo {
         void lockedOther( const string& db , int type , WrapperForRWLock* lock );
         void lockedOther( int type );  // "same lock as last time" case 
         void unlockedOther();
+        void lockedCollections( const vector<string>& collections );
+        void unlockedCollections();
 
         LockStat* getRelevantLockStat();
         void recordLockTime() { _scopedLk->recordTime(); }
@@ -97,6 +105,7 @@ namespace mongo {
         int _otherCount;               //   >0 means write lock, <0 read lock - XXX change name
         string _otherName;             // which database are we locking and working with (besides local/admin) 
         WrapperForRWLock* _otherLock;  // so we don't have to check the map too often (the map has a mutex)
+        vector<string> _exclusiveCollections; // in _otherName, locked by a Lock::CollectionWrite
 
         // for the nonrecursive case. otherwise there would be many
         // the first lock goes here
@@ -109,11 +118,68 @@ namespace mongo {
         friend class AcquiringParallelWriter;
     };
 
+    class CollectionLock : boost::noncopyable {
+        SimpleRWLock r;
+    public:
+        string name() const { return r.name; }
+        LockStat stats;
+        CollectionLock(const char *ns) : r(ns) { }
+        void lock()          { r.lock(); }
+        void lock_shared()   { r.lock_shared(); }
+        void unlock()        { r.unlock(); }
+        void unlock_shared() { r.unlock_shared(); }
+    };
+
+    /**
+     * The collection locks of a database other than local and admin, and
+     * the intent lock that sits between them and the database lock.  All of
+     * it is taken while holding the database lock shared, so Lock::DBWrite
+     * still excludes everything here.  Below that:
+     *
+     *   op on a collection (DBRead of db.coll)     IS on the database, S on the collection
+     *   DDL on a collection (CollectionWrite)      IX on the database, X on the collection
+     *   anything else (DBRead of just the db)      S on the database
+     *
+     * IS is the shared database lock alone.  Inserts, updates and deletes
+     * run in a DBRead as well, the ydb's row locks keep them apart, so they
+     * share their collection too.  S and IX exclude each other, and new S
+     * requests wait behind waiting IX ones so DDL isn't starved.
+     *
+     * Collection locks are created on first use and never deleted, like the
+     * database locks.
+     */
+    class CollectionLocks : boost::noncopyable {
+    public:
+        CollectionLocks();
+
+        /** @return the lock for collection, which must be a collection's ns */
+        CollectionLock* get(const StringData& collection);
+
+        void lockShared();
+        void unlockShared();
+        void lockIntentExclusive();
+        void unlockIntentExclusive();
+
+        /** appends each collection's LockStat report, by ns */
+        void report(BSONObjBuilder& b);
+
+    private:
+        SimpleRWLock _mapLock;
+        map<string, CollectionLock*> _locks;
+
+        boost::mutex _m;
+        boost::condition _c;
+        int _shared;
+        int _intentExclusive;
+        int _intentExclusiveWaiting;
+    };
+
     class WrapperForRWLock : boost::noncopyable { 
         SimpleRWLock r;
     public:
         string name() const { return r.name; }
         LockStat stats;
+        CollectionLocks collections;
         WrapperForRWLock(const char *name) : r(name) { }
         void lock()          { r.lock(); }
         void lock_shared()   { r.lock_shared(); }
@@ -360,7 +360,12 @@ namespace mongo {
     // If match succeeds on index key, then attempt to match full document.
     class CoveredIndexMatcher : boost::noncopyable {
     public:
-        CoveredIndexMatcher(const BSONObj &pattern, const BSONObj &indexKeyPattern);
+        /**
+         * @param pkPattern The collection's primary key, which secondary index keys embed.
+         *                  Its fields may be matched without reading the document too.
+         */
+        CoveredIndexMatcher(const BSONObj &pattern, const BSONObj &indexKeyPattern,
+                            const BSONObj &pkPattern = BSONObj());
         /**
          * This is the preferred method for matching against a cursor, as it
          * can handle both multi and single key cursors.
@@ -388,6 +393,18 @@ namespace mongo {
                             const shared_ptr<FieldRangeVector> &prevClauseFrv,
                             const BSONObj &nextClauseIndexKeyPattern );
         void init();
+        /** @return true if matcher, or one nested in it, has a clause on fieldName. */
+        static bool constrains( const Matcher &matcher, const char *fieldName );
+        /**
+         * @return the index key pattern, followed by the pk fields it lacks that
+         *         docMatcher constrains.
+         */
+        static BSONObj coveredKeyPattern( const BSONObj &indexKeyPattern, const BSONObj &pkPattern,
+                                          const Matcher &docMatcher, vector<bool> &pkFieldsToAppend );
+        /** @return the cursor's current key, followed by the pk fields it lacks. */
+        BSONObj coveredKey( const Cursor *cursor ) const;
+        const BSONObj _pkPattern;
+        vector<bool> _pkFieldsToAppend; // one entry per pk field, true iff appended to the key
         shared_ptr< Matcher > _docMatcher;
         Matcher _keyMatcher;
         vector<shared_ptr<FieldRangeVector> > _orDedupConstraints;
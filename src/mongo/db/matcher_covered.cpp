@@ -28,18 +28,97 @@
 
 namespace mongo {
 
+    bool CoveredIndexMatcher::constrains( const Matcher &matcher, const char *fieldName ) {
+        for( vector<ElementMatcher>::const_iterator i = matcher._basics.begin(); i != matcher._basics.end(); ++i ) {
+            if ( str::equals( i->_toMatch.fieldName(), fieldName ) ) {
+                return true;
+            }
+        }
+        for( vector<RegexMatcher>::const_iterator i = matcher._regexs.begin(); i != matcher._regexs.end(); ++i ) {
+            if ( str::equals( i->_fieldName, fieldName ) ) {
+                return true;
+            }
+        }
+        for( list< shared_ptr< Matcher > >::const_iterator i = matcher._andMatchers.begin(); i != matcher._andMatchers.end(); ++i ) {
+            if ( constrains( **i, fieldName ) ) {
+                return true;
+            }
+        }
+        for( list< shared_ptr< Matcher > >::const_iterator i = matcher._orMatchers.begin(); i != matcher._orMatchers.end(); ++i ) {
+            if ( constrains( **i, fieldName ) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    BSONObj CoveredIndexMatcher::coveredKeyPattern( const BSONObj &indexKeyPattern,
+                                                    const BSONObj &pkPattern,
+                                                    const Matcher &docMatcher,
+                                                    vector<bool> &pkFieldsToAppend ) {
+        pkFieldsToAppend.clear();
+        if ( indexKeyPattern.isEmpty() ) {
+            // Not an index scan, the key is never used.
+            return indexKeyPattern;
+        }
+        BSONObjBuilder b;
+        b.appendElements( indexKeyPattern );
+        bool appended = false;
+        BSONObjIterator i( pkPattern );
+        while ( i.more() ) {
+            BSONElement e = i.next();
+            // Only the pk fields the query looks at are worth copying into every key.
+            const bool append = !indexKeyPattern.hasField( e.fieldName() ) &&
+                                constrains( docMatcher, e.fieldName() );
+            if ( append ) {
+                b.append( e );
+                appended = true;
+            }
+            pkFieldsToAppend.push_back( append );
+        }
+        if ( !appended ) {
+            pkFieldsToAppend.clear();
+        }
+        return b.obj();
+    }
+
+    BSONObj CoveredIndexMatcher::coveredKey( const Cursor *cursor ) const {
+        const BSONObj key = cursor->currKey();
+        if ( _pkFieldsToAppend.empty() ) {
+            return key;
+        }
+        const BSONObj pk = cursor->currPK();
+        if ( pk.isEmpty() ) {
+            // No pk to match against, so the key alone can't decide.
+            return BSONObj();
+        }
+        BSONObjBuilder b( key.objsize() + pk.objsize() );
+        b.appendElements( key );
+        BSONObjIterator i( pk );
+        for ( size_t n = 0; i.more() && n < _pkFieldsToAppend.size(); n++ ) {
+            BSONElement e = i.next();
+            if ( _pkFieldsToAppend[n] ) {
+                b.append( e );
+            }
+        }
+        return b.obj();
+    }
+
     CoveredIndexMatcher::CoveredIndexMatcher( const BSONObj &jsobj,
-                                             const BSONObj &indexKeyPattern ) :
+                                             const BSONObj &indexKeyPattern,
+                                             const BSONObj &pkPattern ) :
+        _pkPattern( pkPattern.getOwned() ),
         _docMatcher( new Matcher( jsobj ) ),
-        _keyMatcher( *_docMatcher, indexKeyPattern ) {
+        _keyMatcher( *_docMatcher, coveredKeyPattern( indexKeyPattern, _pkPattern, *_docMatcher, _pkFieldsToAppend ) ) {
         init();
     }
 
     CoveredIndexMatcher::CoveredIndexMatcher( const CoveredIndexMatcher &prevClauseMatcher,
                                              const shared_ptr<FieldRangeVector> &prevClauseFrv,
                                              const BSONObj &nextClauseIndexKeyPattern ) :
+        _pkPattern( prevClauseMatcher._pkPattern ),
         _docMatcher( prevClauseMatcher._docMatcher ),
-        _keyMatcher( *_docMatcher, nextClauseIndexKeyPattern ),
+        _keyMatcher( *_docMatcher, coveredKeyPattern( nextClauseIndexKeyPattern, _pkPattern, *_docMatcher, _pkFieldsToAppend ) ),
         _orDedupConstraints( prevClauseMatcher._orDedupConstraints ) {
         if ( prevClauseFrv ) {
             _orDedupConstraints.push_back( prevClauseFrv );
@@ -54,8 +133,9 @@ namespace mongo {
     }
 
     bool CoveredIndexMatcher::matchesCurrent( Cursor * cursor , MatchDetails * details ) const {
-        const bool keyUsable = !cursor->indexKeyPattern().isEmpty() && !cursor->isMultiKey();
-        const BSONObj key = cursor->currKey();
+        bool keyUsable = !cursor->indexKeyPattern().isEmpty() && !cursor->isMultiKey();
+        const BSONObj key = keyUsable ? coveredKey( cursor ) : cursor->currKey();
+        keyUsable = keyUsable && !key.isEmpty();
         dassert( key.isValid() );
 
         LOG(5) << "CoveredIndexMatcher::matches() " << key.toString() << ", keyUsable " << keyUsable << endl;
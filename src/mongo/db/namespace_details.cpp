@@ -37,17 +37,23 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/ops/update.h"
+#include "mongo/db/stats/op_latencies.h"
 #include "mongo/db/storage/env.h"
 #include "mongo/db/storage/txn.h"
 #include "mongo/db/storage/key.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/scripting/engine.h"
+#include "mongo/util/tracepoint.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/db/repl/rs_optime.h"
 #include "mongo/db/repl/rs.h"
 
 namespace mongo {
 
+    MONGO_TRACEPOINT_DECLARE(ydbPut);
+    MONGO_TRACEPOINT_DECLARE(ydbDel);
+    MONGO_TRACEPOINT_DECLARE(ydbUpdate);
+
     NamespaceIndex *nsindex(const StringData& ns) {
         Database *database = cc().database();
         verify( database );
@@ -777,6 +783,449 @@ namespace mongo {
         scoped_ptr<storage::Loader> _loader;
     };
 
+    static void addIndexToCatalog(const BSONObj &info);
+    static BSONObj replaceNSField(const BSONObj &obj, const StringData &to);
+    static bool isOplogPartition(const StringData &ns);
+
+    // A PartitionedCollection stores its documents in a sequence of partitions. Each
+    // partition is a hidden IndexedCollection named <ns>$$p<id> that owns a contiguous
+    // range of the primary key: partition i holds the keys in (max(i - 1), max(i)], and
+    // the last partition's max is MaxKey. When the _id grows over time (ObjectIds, dates)
+    // new documents always go to the last partition, and the oldest data can be thrown
+    // away by dropping the first partition's dictionaries instead of deleting every
+    // document in it, which is what makes time-series style retention cheap.
+    //
+    // The PartitionedCollection has no dictionaries of its own. Its _indexes describe
+    // the indexes that every partition has, in the same order, so the query optimizer
+    // plans over the namespace as usual and PartitionedCursor (see cursor.cpp) scans
+    // the partitions. Partitions are cataloged in system.namespaces and system.indexes
+    // like any other collection, so dropDatabase and dropCollection clean them up.
+    //
+    // Uniqueness can only be enforced within a partition, so the primary key is the only
+    // unique index. The partition list is modified under a write lock only.
+    class PartitionedCollection : public NamespaceDetails {
+    public:
+        PartitionedCollection(const StringData &ns, const BSONObj &options) :
+            NamespaceDetails(ns, fromjson("{\"_id\":1}"), options, false),
+            _nextPartitionId(0) {
+            // The primary key index only describes the partitions' primary keys.
+            _indexes.push_back(shared_ptr<IndexDetails>(new IndexDetails(indexInfo(_pk, true, true))));
+            _nIndexes = 1;
+            computeIndexKeys();
+
+            // Start out with a single partition that accepts every primary key.
+            createPartition();
+            nsindex(_ns)->update_ns(_ns, serialize(), false);
+        }
+        PartitionedCollection(const BSONObj &serialized) :
+            NamespaceDetails(serialized, false),
+            _nextPartitionId(serialized["nextPartitionId"].Long()) {
+            std::vector<BSONElement> index_array = serialized["indexes"].Array();
+            for (std::vector<BSONElement>::iterator it = index_array.begin(); it != index_array.end(); it++) {
+                _indexes.push_back(shared_ptr<IndexDetails>(new IndexDetails(it->Obj())));
+            }
+            computeIndexKeys();
+
+            std::vector<BSONElement> partition_array = serialized["partitions"].Array();
+            for (std::vector<BSONElement>::iterator it = partition_array.begin(); it != partition_array.end(); it++) {
+                const BSONObj partition = it->Obj();
+                _partitions.push_back(Partition(partition["_id"].Long(), partition["max"].Obj()));
+            }
+            verify(!_partitions.empty());
+        }
+
+        BSONObj serialize() const {
+            BSONObjBuilder b;
+            b.appendElements(NamespaceDetails::serialize());
+            BSONArrayBuilder partitions(b.subarrayStart("partitions"));
+            for (vector<Partition>::const_iterator it = _partitions.begin(); it != _partitions.end(); it++) {
+                partitions.append(BSON("_id" << it->id << "max" << it->maxPK));
+            }
+            partitions.done();
+            b.append("nextPartitionId", _nextPartitionId);
+            return b.obj();
+        }
+
+        bool isPartitioned() const {
+            return true;
+        }
+
+        int numPartitions() const {
+            return _partitions.size();
+        }
+
+        NamespaceDetails *getPartition(const int i) const {
+            const string pns = partitionNs(_partitions[i].id);
+            NamespaceDetails *d = nsdetails(pns);
+            massert( 17010, str::stream() << "bug: partition " << pns << " does not exist", d != NULL );
+            return d;
+        }
+
+        const BSONObj &partitionMaxPK(const int i) const {
+            return _partitions[i].maxPK;
+        }
+
+        BSONObj addPartition(const BSONObj &newMaxPK) {
+            Lock::assertWriteLocked(_ns);
+            uassert( 17057, "Cannot add a partition while a background index build is in progress.",
+                            !_indexBuildInProgress );
+
+            // Note this ns in the rollback so if this transaction aborts, we'll
+            // close this ns, forcing the next user to reload in-memory metadata.
+            NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+            rollback.noteNs(_ns);
+
+            // Lock the last partition entirely so no other transaction has or gets
+            // uncommitted documents beyond the bound we are about to set.
+            Partition &last = _partitions.back();
+            NamespaceDetails *d = getPartition(_partitions.size() - 1);
+            d->acquireTableLock();
+            BSONObj currentMaxPK;
+            {
+                shared_ptr<Cursor> c = BasicCursor::make(d, -1);
+                if (c->ok()) {
+                    currentMaxPK = c->currPK().getOwned();
+                }
+            }
+
+            BSONObj maxPK;
+            if (newMaxPK.isEmpty()) {
+                uassert( 17011, "Cannot add a partition without a max when the last partition is empty.",
+                                !currentMaxPK.isEmpty() );
+                maxPK = currentMaxPK;
+            } else {
+                maxPK = newMaxPK.getOwned();
+                uassert( 17012, str::stream() << "New partition max " << maxPK <<
+                                " is less than the greatest _id in the last partition, " << currentMaxPK,
+                                currentMaxPK.isEmpty() || currentMaxPK.woCompare(maxPK, BSONObj(), false) <= 0 );
+                uassert( 17013, "New partition max must be less than MaxKey.",
+                                maxPK.woCompare(maxKey, BSONObj(), false) < 0 );
+                if (_partitions.size() > 1) {
+                    const BSONObj &prevMaxPK = _partitions[_partitions.size() - 2].maxPK;
+                    uassert( 17014, str::stream() << "New partition max " << maxPK <<
+                                    " must be greater than the previous partition's max, " << prevMaxPK,
+                                    prevMaxPK.woCompare(maxPK, BSONObj(), false) < 0 );
+                }
+            }
+
+            last.maxPK = maxPK;
+            createPartition();
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+            clearQueryCache();
+            return maxPK;
+        }
+
+        long long dropPartition(const long long id) {
+            Lock::assertWriteLocked(_ns);
+            uassert( 17058, "Cannot drop a partition while a background index build is in progress.",
+                            !_indexBuildInProgress );
+
+            int i = 0;
+            if (id >= 0) {
+                for ( ; i < (int) _partitions.size() && _partitions[i].id != id; i++) {
+                }
+                uassert( 17015, str::stream() << "No partition with id " << id << " in " << _ns,
+                                i < (int) _partitions.size() );
+            }
+            uassert( 17016, "Cannot drop the last partition of a partitioned collection.",
+                            i < (int) _partitions.size() - 1 );
+
+            NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+            rollback.noteNs(_ns);
+            ClientCursor::invalidate(_ns);
+
+            // The documents in the dropped range simply disappear. Any range left uncovered
+            // in the middle is absorbed by the next partition, since routing is done by max.
+            const long long droppedId = _partitions[i].id;
+            string errmsg;
+            BSONObjBuilder result;
+            dropCollection(partitionNs(droppedId), errmsg, result);
+            _partitions.erase(_partitions.begin() + i);
+
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+            clearQueryCache();
+            return droppedId;
+        }
+
+        void getPartitionInfo(BSONObjBuilder &result) const {
+            result.append("numPartitions", numPartitions());
+            BSONArrayBuilder partitions(result.subarrayStart("partitions"));
+            for (vector<Partition>::const_iterator it = _partitions.begin(); it != _partitions.end(); it++) {
+                partitions.append(BSON("_id" << it->id << "max" << it->maxPK.replaceFieldNames(_pk)));
+            }
+            partitions.done();
+        }
+
+        // Tailable cursors only exist on the oplog, whose partitions all share one
+        // gtid manager, so ask the last partition.
+        BSONObj minUnsafeKey() {
+            return getPartition(numPartitions() - 1)->minUnsafeKey();
+        }
+
+        // _id queries go to the one partition that may have the document.
+        bool mayFindById() const {
+            return true;
+        }
+
+        bool findById(const BSONObj &query, BSONObj &result) const {
+            dassert(query["_id"].ok());
+            const bool found = findByPK(query["_id"].wrap(""), result);
+            getPKIndex().noteQuery(found ? 1 : 0, 0);
+            return found;
+        }
+
+        bool findByPK(const BSONObj &pk, BSONObj &result) const {
+            return getPartition(partitionForPK(pk))->findByPK(pk, result);
+        }
+
+        void insertObject(BSONObj &obj, uint64_t flags) {
+            obj = addIdField(obj);
+            const BSONObj pk = obj["_id"].wrap("");
+            NamespaceDetails *d = getPartition(partitionForPK(pk));
+            d->insertObject(obj, flags);
+            noteMultikeyIndexes(d);
+        }
+
+        void deleteObject(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
+            getPartition(partitionForPK(pk))->deleteObject(pk, obj, flags);
+        }
+
+        void updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj, uint64_t flags) {
+            newObj = inheritIdField(oldObj, newObj);
+            NamespaceDetails *d = getPartition(partitionForPK(pk));
+            d->updateObject(pk, oldObj, newObj, flags);
+            noteMultikeyIndexes(d);
+        }
+
+        void empty() {
+            for (int i = 0; i < numPartitions(); i++) {
+                getPartition(i)->empty();
+            }
+            resetTransient();
+        }
+
+        void acquireTableLock() {
+            for (int i = 0; i < numPartitions(); i++) {
+                getPartition(i)->acquireTableLock();
+            }
+        }
+
+        void optimizeAll() {
+            for (int i = 0; i < numPartitions(); i++) {
+                getPartition(i)->optimizeAll();
+            }
+        }
+
+        void optimizePK(const BSONObj &leftPK, const BSONObj &rightPK) {
+            for (int i = 0; i < numPartitions(); i++) {
+                getPartition(i)->optimizePK(leftPK, rightPK);
+            }
+        }
+
+        void fillCollectionStats(struct NamespaceDetailsAccStats* accStats, BSONObjBuilder* result, int scale) const {
+            uint64_t count = 0;
+            uint64_t size = 0;
+            uint64_t storageSize = 0;
+            uint64_t indexSize = 0;
+            uint64_t indexStorageSize = 0;
+            BSONArrayBuilder partitions;
+            for (int i = 0; i < numPartitions(); i++) {
+                struct NamespaceDetailsAccStats stats;
+                BSONObjBuilder b;
+                b.append("_id", _partitions[i].id);
+                b.append("max", _partitions[i].maxPK.replaceFieldNames(_pk));
+                getPartition(i)->fillCollectionStats(&stats, &b, scale);
+                partitions.append(b.obj());
+                count += stats.count;
+                size += stats.size;
+                storageSize += stats.storageSize;
+                indexSize += stats.indexSize;
+                indexStorageSize += stats.indexStorageSize;
+            }
+
+            accStats->nIndexes = nIndexes();
+            accStats->count = count;
+            accStats->size = size;
+            accStats->storageSize = storageSize;
+            accStats->indexSize = indexSize;
+            accStats->indexStorageSize = indexStorageSize;
+            result->appendNumber("count", (long long) count);
+            result->append("nindexes", nIndexes());
+            result->append("nindexesbeingbuilt", nIndexesBeingBuilt());
+            result->appendNumber("size", (long long) size/scale);
+            result->appendNumber("storageSize", (long long) storageSize/scale);
+            result->appendNumber("totalIndexSize", (long long) indexSize/scale);
+            result->appendNumber("totalIndexStorageSize", (long long) indexStorageSize/scale);
+            result->appendBool("partitioned", true);
+            result->append("numPartitions", numPartitions());
+            result->append("partitions", partitions.arr());
+        }
+
+    private:
+        struct Partition {
+            Partition(const long long i, const BSONObj &max) : id(i), maxPK(max.getOwned()) { }
+            long long id;
+            // single element bson object, no field name
+            BSONObj maxPK;
+        };
+
+        string partitionNs(const long long id) const {
+            return str::stream() << _ns << "$$p" << id;
+        }
+
+        // @return the offset of the partition that owns the given primary key,
+        // which is the first partition whose max is not less than it.
+        int partitionForPK(const BSONObj &pk) const {
+            int lo = 0;
+            int hi = _partitions.size() - 1;
+            while (lo < hi) {
+                const int mid = (lo + hi) / 2;
+                if (pk.woCompare(_partitions[mid].maxPK, BSONObj(), false) <= 0) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            return lo;
+        }
+
+        // Create a new, empty last partition with every index this namespace has.
+        void createPartition() {
+            const long long id = _nextPartitionId++;
+            const string pns = partitionNs(id);
+            // The primary key takes its attributes from ours, which
+            // changeIndexAttributes() may have changed since creation.
+            const BSONObj attrFields = BSON("readPageSize" << 1 << "pageSize" << 1 << "compression" << 1);
+            BSONObjBuilder options;
+            for (BSONObjIterator it(_options); it.more(); ) {
+                const BSONElement e = it.next();
+                if (!str::equals(e.fieldName(), "create") && !str::equals(e.fieldName(), "partitioned") &&
+                    !attrFields.hasField(e.fieldName())) {
+                    options.append(e);
+                }
+            }
+            options.appendElements(getPKIndex().info().filterFieldsUndotted(attrFields, true));
+
+            // The oplog's partitions answer minUnsafeKey() for its tailable cursors.
+            shared_ptr<NamespaceDetails> partition(isOplogPartition(pns) ?
+                                                   new OplogCollection(pns, options.done()) :
+                                                   new IndexedCollection(pns, options.done()));
+            NamespaceIndex *ni = nsindex(_ns);
+            ni->add_ns(pns, partition);
+            NamespaceDetails *d = ni->details(pns);
+            d->addDefaultIndexesToCatalog();
+            for (int i = 1; i < _nIndexes; i++) {
+                const BSONObj info = replaceNSField(_indexes[i]->info(), pns);
+                if (d->ensureIndex(info)) {
+                    addIndexToCatalog(info);
+                }
+            }
+            _partitions.push_back(Partition(id, maxKey));
+        }
+
+        // A secondary index becomes multikey in whichever partition first sees an
+        // array, and the namespace must follow so that queries dedup their results.
+        void noteMultikeyIndexes(const NamespaceDetails *d) {
+            for (int i = 1; i < _nIndexes; i++) {
+                if (d->isMultikey(i) && !isMultikey(i)) {
+                    setIndexIsMultikey(i);
+                }
+            }
+        }
+
+        bool changeIndexAttributes(const StringData &name, const BSONObj &attrs) {
+            if (name != "*" && findIndexByName(name) < 0) {
+                return false;
+            }
+            for (int i = 0; i < numPartitions(); i++) {
+                const bool changed = getPartition(i)->changeIndexAttributes(name, attrs);
+                massert( 17034, str::stream() << "bug: index " << name << " missing from partition " <<
+                                partitionNs(_partitions[i].id), changed );
+            }
+            // Partitions created later take their index info from ours.
+            return NamespaceDetails::changeIndexAttributes(name, attrs);
+        }
+
+        void createIndex(const BSONObj &info) {
+            if (!Lock::isWriteLocked(_ns)) {
+                throw RetryWithWriteLock();
+            }
+
+            checkIndexSpec(info);
+
+            NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+            rollback.noteNs(_ns);
+
+            // Each partition's indexer validates the spec against the same set of indexes.
+            for (int i = 0; i < numPartitions(); i++) {
+                const BSONObj pinfo = replaceNSField(info, partitionNs(_partitions[i].id));
+                if (getPartition(i)->ensureIndex(pinfo)) {
+                    addIndexToCatalog(pinfo);
+                }
+            }
+            _indexes.push_back(shared_ptr<IndexDetails>(new IndexDetails(info)));
+            _nIndexes++;
+            for (int i = 0; i < numPartitions(); i++) {
+                noteMultikeyIndexes(getPartition(i));
+            }
+
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+            resetTransient();
+        }
+
+        void checkIndexSpec(const BSONObj &info) const {
+            uassert( 17017, "Partitioned collections do not support unique secondary indexes.",
+                            !info["unique"].trueValue() );
+            for (BSONObjIterator it(info["key"].Obj()); it.more(); ) {
+                uassert( 17018, "Partitioned collections do not support special (hashed, geo) indexes.",
+                                it.next().type() != String );
+            }
+        }
+
+        // The partitions' indexes are built side by side, each by its own ydb indexer, and
+        // committed along with ours. The partition list can't change until then.
+        void prepareHotIndexPartitions(const BSONObj &info, OwnedPointerVector<HotIndexer> &indexers) {
+            for (int i = 0; i < numPartitions(); i++) {
+                const BSONObj pinfo = replaceNSField(info, partitionNs(_partitions[i].id));
+                auto_ptr<HotIndexer> indexer(new HotIndexer(getPartition(i), pinfo));
+                indexer->prepare();
+                indexers.vector().push_back(indexer.release());
+                addIndexToCatalog(pinfo);
+            }
+        }
+
+        void dropIndex(const int idxNum) {
+            verify(idxNum < (int) _indexes.size());
+            IndexDetails &idx = *_indexes[idxNum];
+            const string name = idx.indexName();
+            if (isPKIndex(idx)) {
+                // The primary key only goes away with the collection, so drop every partition.
+                for (vector<Partition>::const_iterator it = _partitions.begin(); it != _partitions.end(); it++) {
+                    string errmsg;
+                    BSONObjBuilder result;
+                    dropCollection(partitionNs(it->id), errmsg, result);
+                }
+                _partitions.clear();
+            } else {
+                for (int i = 0; i < numPartitions(); i++) {
+                    const string pns = partitionNs(_partitions[i].id);
+                    string errmsg;
+                    BSONObjBuilder result;
+                    const bool dropped = getPartition(i)->dropIndexes(pns, name, errmsg, result, false);
+                    massert( 17019, str::stream() << "bug: could not drop index " << name <<
+                                    " from partition " << pns << ": " << errmsg, dropped );
+                }
+            }
+            removeFromSysIndexes(_ns, name);
+            _indexes.erase(_indexes.begin() + idxNum);
+            _nIndexes--;
+            resetTransient();
+        }
+
+        vector<Partition> _partitions;
+        long long _nextPartitionId;
+    };
+
     /* ------------------------------------------------------------------------- */
 
     BSONObj NamespaceDetails::indexInfo(const BSONObj &keyPattern, bool unique, bool clustering) const {
@@ -820,9 +1269,13 @@ namespace mongo {
     static bool isOplogCollection(const StringData &ns) {
         return ns == rsoplog;
     }
+    static bool isOplogPartition(const StringData &ns) {
+        return ns.startsWith(string(rsoplog) + "$$p");
+    }
 
     // Construct a brand new NamespaceDetails with a certain primary key and set of options.
-    NamespaceDetails::NamespaceDetails(const StringData &ns, const BSONObj &pkIndexPattern, const BSONObj &options) :
+    NamespaceDetails::NamespaceDetails(const StringData &ns, const BSONObj &pkIndexPattern, const BSONObj &options,
+                                       const bool createPKIndex) :
         _ns(ns.toString()),
         _options(options.copy()),
         _pk(pkIndexPattern.copy()),
@@ -831,13 +1284,13 @@ namespace mongo {
         _multiKeyIndexBits(0),
         _qcWriteCount(0) {
 
-        massert( 10356 ,  str::stream() << "invalid ns: " << ns , NamespaceString::validCollectionName(ns.rawData()));
-
         TOKULOG(1) << "Creating NamespaceDetails " << ns << endl;
 
-        // Create the primary key index, generating the info from the pk pattern and options.
-        BSONObj info = indexInfo(pkIndexPattern, true, true);
-        createIndex(info);
+        if (createPKIndex) {
+            // Create the primary key index, generating the info from the pk pattern and options.
+            BSONObj info = indexInfo(pkIndexPattern, true, true);
+            createIndex(info);
+        }
 
         try {
             // If this throws, it's safe to call close() because we just created the index.
@@ -852,7 +1305,11 @@ namespace mongo {
         computeIndexKeys();
     }
     shared_ptr<NamespaceDetails> NamespaceDetails::make(const StringData &ns, const BSONObj &options) {
-        if (isOplogCollection(ns)) {
+        // Partitions are the only namespaces with a '$' that hold documents, and they are
+        // constructed directly by their PartitionedCollection, never through here.
+        massert( 10356 ,  str::stream() << "invalid ns: " << ns , NamespaceString::validCollectionName(ns.rawData()));
+
+        if (isOplogCollection(ns) && !options["partitioned"].trueValue()) {
             return shared_ptr<NamespaceDetails>(new OplogCollection(ns, options));
         } else if (isSystemCatalog(ns)) {
             return shared_ptr<NamespaceDetails>(new SystemCatalogCollection(ns, options));
@@ -861,6 +1318,12 @@ namespace mongo {
             // We enforce the restriction because it's easier to implement. See SERVER-6937.
             uassert( 16852, "System profile must be a capped collection.", options["capped"].trueValue() );
             return shared_ptr<NamespaceDetails>(new ProfileCollection(ns, options));
+        } else if (options["partitioned"].trueValue()) {
+            uassert( 17007, "Partitioned collections cannot be capped or natural order.",
+                            !options["capped"].trueValue() && !options["natural"].trueValue() );
+            uassert( 17008, "System collections cannot be partitioned.",
+                            !NamespaceString(ns.toString()).isSystem() );
+            return shared_ptr<NamespaceDetails>(new PartitionedCollection(ns, options));
         } else if (options["capped"].trueValue()) {
             return shared_ptr<NamespaceDetails>(new CappedCollection(ns, options));
         } else if (options["natural"].trueValue()) {
@@ -871,7 +1334,7 @@ namespace mongo {
     }
 
     // Construct an existing NamespaceDetails given its serialized from (generated via serialize()).
-    NamespaceDetails::NamespaceDetails(const BSONObj &serialized) :
+    NamespaceDetails::NamespaceDetails(const BSONObj &serialized, const bool openIndexes) :
         _ns(serialized["ns"].String()),
         _options(serialized["options"].Obj().copy()),
         _pk(serialized["pk"].Obj().copy()),
@@ -880,16 +1343,19 @@ namespace mongo {
         _multiKeyIndexBits(static_cast<uint64_t>(serialized["multiKeyIndexBits"].Long())),
         _qcWriteCount(0) {
 
-        std::vector<BSONElement> index_array = serialized["indexes"].Array();
-        for (std::vector<BSONElement>::iterator it = index_array.begin(); it != index_array.end(); it++) {
-            shared_ptr<IndexDetails> idx(IndexDetails::make(it->Obj(), false));
-            _indexes.push_back(idx);
+        if (openIndexes) {
+            std::vector<BSONElement> index_array = serialized["indexes"].Array();
+            for (std::vector<BSONElement>::iterator it = index_array.begin(); it != index_array.end(); it++) {
+                shared_ptr<IndexDetails> idx(IndexDetails::make(it->Obj(), false));
+                _indexes.push_back(idx);
+            }
+            computeIndexKeys();
         }
-        computeIndexKeys();
     }
     shared_ptr<NamespaceDetails> NamespaceDetails::make(const BSONObj &serialized, const bool bulkLoad) {
         const StringData ns = serialized["ns"].Stringdata();
-        if (isOplogCollection(ns)) {
+        if ((isOplogCollection(ns) && !serialized["options"]["partitioned"].trueValue()) ||
+            isOplogPartition(ns)) {
             // We may bulk load the oplog since it's an IndexedCollection
             return bulkLoad ? shared_ptr<NamespaceDetails>(new BulkLoadedCollection(serialized)) :
                               shared_ptr<NamespaceDetails>(new OplogCollection(serialized));
@@ -899,6 +1365,9 @@ namespace mongo {
         } else if (isProfileCollection(ns)) {
             massert( 16870, "bug: Should not bulk load the profile collection", !bulkLoad );
             return shared_ptr<NamespaceDetails>(new ProfileCollection(serialized));
+        } else if (serialized["options"]["partitioned"].trueValue()) {
+            massert( 17009, "bug: Should not bulk load partitioned collections", !bulkLoad );
+            return shared_ptr<NamespaceDetails>(new PartitionedCollection(serialized));
         } else if (serialized["options"]["capped"].trueValue()) {
             massert( 16871, "bug: Should not bulk load capped collections", !bulkLoad );
             return shared_ptr<NamespaceDetails>(new CappedCollection(serialized));
@@ -1095,24 +1564,40 @@ namespace mongo {
             put_flags[i] = (isPK && doUniqueChecks ? DB_NOOVERWRITE : 0) |
                            (prelocked ? DB_PRELOCKED_WRITE : 0);
 
-            BSONObjSet idxKeys;
             if (!isPK) {
-                idx.getKeysFromObject(obj, idxKeys);
-                if (idx.unique() && doUniqueChecks) {
+                // Only unique indexes need the keys themselves here; the ydb
+                // generates the rows to put.
+                bool multikey;
+                if (idx.unique()) {
+                    BSONObjSet idxKeys;
+                    idx.getKeysFromObject(obj, idxKeys);
                     for (BSONObjSet::const_iterator o = idxKeys.begin(); o != idxKeys.end(); ++o) {
-                        idx.uniqueCheck(*o, &pk);
+                        if (doUniqueChecks) {
+                            idx.uniqueCheck(*o, &pk);
+                        } else {
+                            idx.noteUniqueKey(*o);
+                        }
                     }
+                    multikey = idxKeys.size() > 1;
+                } else {
+                    KeyCounter counter;
+                    idx.getKeysFromObject(obj, counter);
+                    multikey = counter.count() > 1;
                 }
-                if (idxKeys.size() > 1) {
+                if (multikey) {
                     setIndexIsMultikey(i);
                 }
             }
         }
 
         DB_ENV *env = storage::env;
-        const int r = env->put_multiple(env, dbs[0], cc().txn().db_txn(),
-                                        &src_key, &src_val,
-                                        n, dbs, keyArrays.arrays(), valArrays.arrays(), put_flags);
+        int r;
+        {
+            MONGO_TRACE(ydbPut);
+            r = env->put_multiple(env, dbs[0], cc().txn().db_txn(),
+                                  &src_key, &src_val,
+                                  n, dbs, keyArrays.arrays(), valArrays.arrays(), put_flags);
+        }
         if (r == EINVAL) {
             uasserted( 16900, str::stream() << "Indexed insertion failed." <<
                               " This may be due to keys > 32kb. Check the error log." );
@@ -1155,9 +1640,13 @@ namespace mongo {
         }
 
         DB_ENV *env = storage::env;
-        const int r = env->del_multiple(env, dbs[0], cc().txn().db_txn(),
-                                        &src_key, &src_val,
-                                        n, dbs, keyArrays.arrays(), del_flags);
+        int r;
+        {
+            MONGO_TRACE(ydbDel);
+            r = env->del_multiple(env, dbs[0], cc().txn().db_txn(),
+                                  &src_key, &src_val,
+                                  n, dbs, keyArrays.arrays(), del_flags);
+        }
         if (r != 0) {
             storage::handle_ydb_error(r);
         }
@@ -1224,20 +1713,31 @@ namespace mongo {
             update_flags[i] = prelocked ? DB_PRELOCKED_WRITE : 0;
 
             if (!isPK) {
-                BSONObjSet oldIdxKeys;
-                BSONObjSet newIdxKeys;
-                idx.getKeysFromObject(oldObj, oldIdxKeys);
-                idx.getKeysFromObject(newObj, newIdxKeys);
-                if (idx.unique() && doUniqueChecks) {
+                bool multikey;
+                if (idx.unique()) {
+                    BSONObjSet oldIdxKeys;
+                    BSONObjSet newIdxKeys;
+                    idx.getKeysFromObject(oldObj, oldIdxKeys);
+                    idx.getKeysFromObject(newObj, newIdxKeys);
                     // Only perform the unique check if the key actually changed.
                     for (BSONObjSet::iterator o = newIdxKeys.begin(); o != newIdxKeys.end(); ++o) {
                         const BSONObj &k = *o;
                         if (!orderedSetContains(oldIdxKeys, k)) {
-                            idx.uniqueCheck(k, &pk);
+                            if (doUniqueChecks) {
+                                idx.uniqueCheck(k, &pk);
+                            } else {
+                                idx.noteUniqueKey(k);
+                            }
                         }
                     }
+                    multikey = newIdxKeys.size() > 1;
+                } else {
+                    // The old keys only matter to the unique check.
+                    KeyCounter counter;
+                    idx.getKeysFromObject(newObj, counter);
+                    multikey = counter.count() > 1;
                 }
-                if (newIdxKeys.size() > 1) {
+                if (multikey) {
                     setIndexIsMultikey(i);
                 }
             }
@@ -1245,11 +1745,15 @@ namespace mongo {
 
         // The pk doesn't change, so old_src_key == new_src_key.
         DB_ENV *env = storage::env;
-        const int r = env->update_multiple(env, dbs[0], cc().txn().db_txn(),
-                                           &src_key, &old_src_val,
-                                           &src_key, &new_src_val,
-                                           n, dbs, update_flags,
-                                           n * 2, keyArrays.arrays(), n, valArrays.arrays());
+        int r;
+        {
+            MONGO_TRACE(ydbUpdate);
+            r = env->update_multiple(env, dbs[0], cc().txn().db_txn(),
+                                     &src_key, &old_src_val,
+                                     &src_key, &new_src_val,
+                                     n, dbs, update_flags,
+                                     n * 2, keyArrays.arrays(), n, valArrays.arrays());
+        }
         if (r == EINVAL) {
             uasserted( 16908, str::stream() << "Indexed insertion (on update) failed." <<
                               " This may be due to keys > 32kb. Check the error log." );
@@ -1473,6 +1977,37 @@ namespace mongo {
         }
     }
 
+    bool NamespaceDetails::changeIndexAttributes(const StringData &name, const BSONObj &attrs) {
+        Lock::assertWriteLocked(_ns);
+        TOKULOG(1) << "changeIndexAttributes " << name << " " << attrs << endl;
+
+        const int idxNum = findIndexByName(name);
+        if (name != "*" && idxNum < 0) {
+            return false;
+        }
+        uassert( 17033, "Cannot change index attributes: build in progress.",
+                        !_indexBuildInProgress || (name != "*" && idxNum < _nIndexes) );
+
+        // The new attributes only live in the in-memory IndexDetails until the
+        // nsindex is updated, so reload them from there if this transaction aborts.
+        NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+        rollback.noteNs(_ns);
+
+        for (int i = 0; i < _nIndexes; i++) {
+            if (name == "*" || i == idxNum) {
+                IndexDetails &idx = *_indexes[i];
+                const BSONObj info = idx.changeAttributes(attrs);
+                const StringData &indexns = info["ns"].Stringdata();
+                if (indexns.find(".system.indexes") == string::npos) {
+                    removeFromSysIndexes(indexns, idx.indexName());
+                    addIndexToCatalog(info);
+                }
+            }
+        }
+        nsindex(_ns)->update_ns(_ns, serialize(), true);
+        return true;
+    }
+
     bool NamespaceDetails::ensureIndex(const BSONObj &info) {
         const BSONObj keyPattern = info["key"].Obj();
         const int i = findIndexByKeyPattern(keyPattern);
@@ -1600,6 +2135,7 @@ namespace mongo {
 
         // If everything succeeds, kill the namespace from the nsindex.
         Top::global.collectionDropped(name);
+        OpLatencies::global.collectionDropped(name);
         nsindex(name)->kill_ns(name);
         result.append("ns", name);
     }
@@ -1668,6 +2204,8 @@ namespace mongo {
                         from != cc().bulkLoadNS() );
         uassert( 16918, "Cannot rename a collection with a background index build in progress",
                         !from_details->indexBuildInProgress() );
+        uassert( 17020, "Cannot rename a partitioned collection.",
+                        !from_details->isPartitioned() );
 
         // Kill open cursors before we close and rename the namespace
         ClientCursor::invalidate( from );
@@ -1770,6 +2308,8 @@ namespace mongo {
                         !options["capped"].trueValue() );
         uassert( 17000, "Cannot bulk load a natural order collection",
                         !options["natural"].trueValue() );
+        uassert( 17021, "Cannot bulk load a partitioned collection",
+                        !options["partitioned"].trueValue() );
 
         // Don't log the create. The begin/commit/abort load commands are already logged.
         string errmsg;
@@ -23,6 +23,7 @@
 
 #include "mongo/pch.h"
 
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/index.h"
@@ -151,7 +152,7 @@ namespace mongo {
         bool ensureIndex(const BSONObj &info);
 
         // Acquire a full table lock on each index.
-        void acquireTableLock();
+        virtual void acquireTableLock();
 
         int nIndexes() const {
             return _nIndexes;
@@ -264,15 +265,15 @@ namespace mongo {
         static BSONObj serialize(const StringData& ns, const BSONObj &options,
                                  const BSONObj &pk, unsigned long long multiKeyIndexBits,
                                  const BSONArray &indexes_array);
-        BSONObj serialize() const;
+        virtual BSONObj serialize() const;
 
-        void fillCollectionStats(struct NamespaceDetailsAccStats* accStats, BSONObjBuilder* result, int scale) const;
+        virtual void fillCollectionStats(struct NamespaceDetailsAccStats* accStats, BSONObjBuilder* result, int scale) const;
 
         // Find the first object that matches the query. Force index if requireIndex is true.
         bool findOne(const BSONObj &query, BSONObj &result, const bool requireIndex = false) const;
 
         // Find by primary key (single element bson object, no field name).
-        bool findByPK(const BSONObj &pk, BSONObj &result) const;
+        virtual bool findByPK(const BSONObj &pk, BSONObj &result) const;
 
         // return true if this namespace has an index on the _id field.
         bool hasIdIndex() const {
@@ -289,6 +290,12 @@ namespace mongo {
         virtual bool dropIndexes(const StringData& ns, const StringData& name, string &errmsg,
                                  BSONObjBuilder &result, bool mayDeleteIdIndex);
 
+        // Change the compression, pageSize and/or readPageSize of the named index,
+        // or of every index if name is "*", without rebuilding it. Existing data
+        // is rewritten with the new attributes as it is next written (or optimized).
+        // @return false if there is no such index.
+        virtual bool changeIndexAttributes(const StringData &name, const BSONObj &attrs);
+
         virtual void validateConnectionId(const ConnectionId &id) {
             // By default, the calling connection id is valid.
             // Other implementations may decide otherwise.
@@ -357,6 +364,57 @@ namespace mongo {
             msgasserted( 16773, "bug: should not call deleteObjectFromCappedWithPK into non-capped collection" );
         }
 
+        // Partitioned collections store their documents in a sequence of partitions, each
+        // of which is a hidden collection owning a contiguous range of the primary key.
+        // The namespace itself only describes the indexes; reads and writes are routed to
+        // the partitions. See PartitionedCollection in namespace_details.cpp.
+
+        // optional to implement, return true if the namespace is partitioned
+        virtual bool isPartitioned() const {
+            return false;
+        }
+
+        virtual int numPartitions() const {
+            msgasserted( 17001, "bug: should not call numPartitions on a non-partitioned collection" );
+        }
+
+        // @return the partition at the given offset, in primary key order.
+        virtual NamespaceDetails *getPartition(const int i) const {
+            msgasserted( 17002, "bug: should not call getPartition on a non-partitioned collection" );
+        }
+
+        // @return the inclusive upper bound on the primary keys stored in the given partition
+        // (single element bson object, no field name). The last partition's bound is MaxKey.
+        virtual const BSONObj &partitionMaxPK(const int i) const {
+            msgasserted( 17003, "bug: should not call partitionMaxPK on a non-partitioned collection" );
+        }
+
+        // Close the current last partition and start a new, empty one after it. The closed
+        // partition keeps every primary key up to newMaxPK, or up to its current maximum
+        // primary key if newMaxPK is empty.
+        // @return the upper bound the closed partition ended up with.
+        virtual BSONObj addPartition(const BSONObj &newMaxPK) {
+            uasserted( 17004, str::stream() << _ns << " is not a partitioned collection" );
+        }
+
+        // Drop the partition with the given id, or the oldest partition if id is negative.
+        // @return the id of the dropped partition.
+        virtual long long dropPartition(const long long id) {
+            uasserted( 17005, str::stream() << _ns << " is not a partitioned collection" );
+        }
+
+        virtual void getPartitionInfo(BSONObjBuilder &result) const {
+            uasserted( 17006, str::stream() << _ns << " is not a partitioned collection" );
+        }
+
+        class HotIndexer;
+
+        // Prepare a hot build of the index described by info on each partition, and note
+        // each partition's index in system.indexes. Must be write locked.
+        virtual void prepareHotIndexPartitions(const BSONObj &info, OwnedPointerVector<HotIndexer> &indexers) {
+            msgasserted( 17060, "bug: should not call prepareHotIndexPartitions on a non-partitioned collection" );
+        }
+
         class Indexer : boost::noncopyable {
         public:
             // Prepare an index build. Must be write locked.
@@ -386,12 +444,15 @@ namespace mongo {
 
             NamespaceDetails *_d;
             shared_ptr<IndexDetails> _idx;
-            const BSONObj &_info;
+            const BSONObj _info;
             const bool _isSecondaryIndex;
         };
 
         // Indexer for background (aka hot, aka online) indexing.
         // build() should be called read locked, not write locked.
+        //
+        // A partitioned collection's index is built by one indexer per
+        // partition, one partition after another.
         class HotIndexer : public Indexer {
         public:
             HotIndexer(NamespaceDetails *d, const BSONObj &info);
@@ -402,8 +463,12 @@ namespace mongo {
         private:
             void _prepare();
             void _commit();
+            // Run each ydb indexer of this build on its own thread,
+            // reporting their combined progress to the current op.
+            void _buildDictionaries();
             scoped_ptr<MultiKeyTracker> _multiKeyTracker;
             scoped_ptr<storage::Indexer> _indexer;
+            OwnedPointerVector<HotIndexer> _partitionIndexers;
         };
 
         // Indexer for foreground (aka cold, aka offline) indexing.
@@ -420,11 +485,16 @@ namespace mongo {
         };
 
     protected:
-        NamespaceDetails(const StringData& ns, const BSONObj &pkIndexPattern, const BSONObj &options);
-        explicit NamespaceDetails(const BSONObj &serialized);
+        // Subclasses that do not store documents themselves (see PartitionedCollection)
+        // construct without creating or opening any dictionaries.
+        NamespaceDetails(const StringData& ns, const BSONObj &pkIndexPattern, const BSONObj &options,
+                         const bool createPKIndex = true);
+        explicit NamespaceDetails(const BSONObj &serialized, const bool openIndexes = true);
 
         // create a new index with the given info for this namespace.
         virtual void createIndex(const BSONObj &info);
+        // uassert if this namespace cannot have the index described by info.
+        virtual void checkIndexSpec(const BSONObj &info) const { }
         void checkIndexUniqueness(const IndexDetails &idx);
 
         void insertIntoIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
@@ -455,11 +525,12 @@ namespace mongo {
 
         unsigned long long _multiKeyIndexBits;
 
-    private:
-        set<string> _indexKeys;
         void resetTransient();
         void computeIndexKeys();
-        void dropIndex(const int idxNum);
+        virtual void dropIndex(const int idxNum);
+
+    private:
+        set<string> _indexKeys;
 
         /* query cache (for query optimizer) */
         int _qcWriteCount;
@@ -580,11 +651,11 @@ namespace mongo {
         // - May not transition _nsdb from non-null to null in a DBRead lock.
         shared_ptr<storage::Dictionary> _nsdb;
 
-        // It isn't necessary to hold either of these locks in a a DBWrite lock.
-
         // This lock protects access to the _namespaces variable
         // With a DBRead lock and this shared lock, one can retrieve
-        // a NamespaceDetails that has already been opened
+        // a NamespaceDetails that has already been opened.
+        // Changes to _namespaces take it exclusively, even in a write lock,
+        // because a Lock::CollectionWrite only has the database read locked.
         SimpleRWLock _openRWLock;
     };
 
@@ -161,15 +161,21 @@ namespace mongo {
             throw RetryWithWriteLock();
         }
 
-        NamespaceDetailsMap::const_iterator it = _namespaces.find(ns);
-        if (it != _namespaces.end()) {
+        shared_ptr<NamespaceDetails> d;
+        {
+            SimpleRWLock::Exclusive lk(_openRWLock);
+            NamespaceDetailsMap::const_iterator it = _namespaces.find(ns);
+            if (it != _namespaces.end()) {
+                d = it->second;
+                const int r = _namespaces.erase(ns);
+                verify(r == 1);
+            }
+        }
+        if (d) {
             // Might not be in the _namespaces map if the ns exists but is closed.
-            // Note this ns in the rollback, since we are about to modify its entry.
+            // Note this ns in the rollback, since we modified its entry.
             NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
             rollback.noteNs(ns);
-            shared_ptr<NamespaceDetails> d = it->second;
-            const int r = _namespaces.erase(ns);
-            verify(r == 1);
             d->close();
         }
 
@@ -238,15 +244,19 @@ namespace mongo {
         }
 
         // Find and erase the old entry, if it exists.
-        NamespaceDetailsMap::const_iterator it = _namespaces.find(ns);
-        if (it != _namespaces.end()) {
-            // TODO: Handle the case where a client tries to close a load they didn't start.
-            shared_ptr<NamespaceDetails> d = it->second;
+        shared_ptr<NamespaceDetails> d;
+        {
+            SimpleRWLock::Exclusive lk(_openRWLock);
+            NamespaceDetailsMap::const_iterator it = _namespaces.find(ns);
+            if (it == _namespaces.end()) {
+                return false;
+            }
+            d = it->second;
             _namespaces.erase(ns);
-            d->close(aborting);
-            return true;
         }
-        return false;
+        // TODO: Handle the case where a client tries to close a load they didn't start.
+        d->close(aborting);
+        return true;
     }
 
     void NamespaceIndex::add_ns(const StringData& ns, shared_ptr<NamespaceDetails> details) {
@@ -261,6 +271,7 @@ namespace mongo {
         NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
         rollback.noteNs(ns);
 
+        SimpleRWLock::Exclusive lk(_openRWLock);
         verify(!_namespaces[ns]);
         _namespaces[ns] = details;
     }
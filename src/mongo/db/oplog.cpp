@@ -33,6 +33,7 @@
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/db/jsobjmanipulator.h"
+#include "mongo/db/curop.h"
 
 namespace mongo {
 
@@ -156,7 +157,8 @@ namespace mongo {
         string err;
         BSONObj o = b.done();
         bool ret;
-        ret = userCreateNS(oplogNS, o, err, false);
+        // The oplog expires a partition at a time, see rotateOplogPartitions().
+        ret = userCreateNS(oplogNS, BSON("partitioned" << true), err, false);
         verify(ret);
         ret = userCreateNS(rsOplogRefs, o, err, false);
         verify(ret);
@@ -215,8 +217,47 @@ namespace mongo {
         writeEntryToOplog(op);
     }
 
+    // Reports how far a secondary is through a spilled transaction's oplog.refs rows
+    // in currentOp, in an op of its own if the thread is already in one.
+    class SpilledTransactionProgress : boost::noncopyable {
+    public:
+        SpilledTransactionProgress(const char *what, const OID &oid) :
+            _what(what), _oid(oid), _refs(0), _ops(0) {
+            Client &c = cc();
+            _op = c.curop();
+            if (_op->active()) {
+                _nestedOp.reset(new CurOp(&c, _op));
+                _op = _nestedOp.get();
+            }
+            _op->reset();
+            update();
+        }
+        ~SpilledTransactionProgress() {
+            _op->done();
+        }
+        void hit(const size_t ops) {
+            _refs++;
+            _ops += ops;
+            update();
+        }
+    private:
+        void update() {
+            const string msg = str::stream() << _what << " " << _oid << ": " <<
+                                                _refs << " refs, " << _ops << " ops";
+            _op->setMessage(msg.c_str());
+        }
+
+        const char *_what;
+        const OID _oid;
+        long long _refs;
+        long long _ops;
+        scoped_ptr<CurOp> _nestedOp;
+        CurOp *_op;
+    };
+
     // Copy a range of documents to the local oplog.refs collection
     static void copyOplogRefsRange(OplogReader &r, OID oid) {
+        SpilledTransactionProgress progress("repl: copying spilled transaction", oid);
         shared_ptr<DBClientCursor> c = r.getOplogRefsCursor(oid);
         Client::ReadContext ctx(rsOplogRefs);
         while (c->more()) {
@@ -227,6 +268,7 @@ namespace mongo {
             }
             LOG(6) << "copyOplogRefsRange " << b << endl;
             writeEntryToOplogRefs(b);
+            progress.hit(b["ops"].Obj().nFields());
         }
     }
 
@@ -252,34 +294,49 @@ namespace mongo {
         }
     }
 
-    // find all oplog entries for a given OID in the oplog.refs collection and apply them
-    // TODO this should be a range query on oplog.refs where _id.oid == oid and applyOps to
-    // each entry found.  The locking of the query interleaved with the locking in the applyOps
-    // did not work, so it a sequence of point queries.  
-    // TODO verify that the query plan is a indexed lookup.
-    // TODO verify that the query plan does not fetch too many docs and then only process one of them.
+    // Read the oplog.refs entries for oid after seq, in order, until we have about
+    // txnMemLimit bytes of them, which is about what the primary held before spilling.
+    static void readOplogRefsBatch(const OID &oid, const long long seq, vector<BSONObj> &refs) {
+        Client::ReadContext ctx(rsOplogRefs);
+        NamespaceDetails *d = nsdetails(rsOplogRefs);
+        if (d == NULL) {
+            return;
+        }
+        const uint64_t limit = cmdLine.txnMemLimit;
+        uint64_t bytes = 0;
+        for (shared_ptr<Cursor> c(IndexCursor::make(d, d->getPKIndex(),
+                                                    BSON("" << BSON("oid" << oid << "seq" << seq + 1)),
+                                                    BSON("" << BSON("oid" << oid << "seq" << maxKey)),
+                                                    true, 1));
+             c->ok() && bytes < limit; c->advance()) {
+            const BSONObj ref = c->current().getOwned();
+            refs.push_back(ref);
+            bytes += ref.objsize();
+        }
+    }
+
+    // find all oplog entries for a given OID in the oplog.refs collection and apply them,
+    // a batch at a time. Applying locks other databases, which we may not do while
+    // holding the local lock, so each batch is read before any of it is applied.
     void applyRefOp(BSONObj entry) {
         OID oid = entry["ref"].OID();
         LOG(3) << "apply ref " << entry << " oid " << oid << endl;
+        SpilledTransactionProgress progress("repl: applying spilled transaction", oid);
         long long seq = 0; // note that 0 is smaller than any of the seq numbers
+        vector<BSONObj> refs;
         while (1) {
-            BSONObj entry;
-            {
-                Client::ReadContext ctx(rsOplogRefs);
-                // TODO: Should this be using rsOplogRefsDetails, verifying non-null?
-                NamespaceDetails *d = nsdetails(rsOplogRefs);
-                if (d == NULL || !d->findOne(BSON("_id" << BSON("$gt" << BSON("oid" << oid << "seq" << seq))), entry, true)) {
-                    break;
-                }
-            }
-            BSONElement e = entry.getFieldDotted("_id.seq");
-            seq = e.Long();
-            BSONElement eOID = entry.getFieldDotted("_id.oid");
-            if (oid != eOID.OID()) {
+            refs.clear();
+            readOplogRefsBatch(oid, seq, refs);
+            if (refs.empty()) {
                 break;
             }
-            LOG(3) << "apply " << entry << " seq=" << seq << endl;
-            applyOps(entry["ops"].Array());
+            for (vector<BSONObj>::const_iterator it = refs.begin(); it != refs.end(); ++it) {
+                seq = it->getFieldDotted("_id.seq").Long();
+                LOG(3) << "apply " << *it << " seq=" << seq << endl;
+                std::vector<BSONElement> ops = (*it)["ops"].Array();
+                applyOps(ops);
+                progress.hit(ops.size());
+            }
         }
     }
     
@@ -378,19 +435,26 @@ namespace mongo {
         transaction.commit(DB_TXN_NOSYNC);
     }
     
-    void purgeEntryFromOplog(BSONObj entry) {
-        verify(rsOplogDetails);
+    static void purgeRefs(const OID &oid) {
+        Helpers::removeRange(
+            rsOplogRefs,
+            BSON("_id" << BSON("oid" << oid << "seq" << minKey)),
+            BSON("_id" << BSON("oid" << oid << "seq" << maxKey)),
+            BSON("_id" << 1),
+            true,
+            false
+            );
+    }
+
+    static void purgeRefsOfEntry(const BSONObj &entry) {
         if (entry.hasElement("ref")) {
-            OID oid = entry["ref"].OID();
-            Helpers::removeRange(
-                rsOplogRefs,
-                BSON("_id" << BSON("oid" << oid << "seq" << minKey)),
-                BSON("_id" << BSON("oid" << oid << "seq" << maxKey)),
-                BSON("_id" << 1),
-                true,
-                false
-                );
+            purgeRefs(entry["ref"].OID());
         }
+    }
+
+    void purgeEntryFromOplog(BSONObj entry) {
+        verify(rsOplogDetails);
+        purgeRefsOfEntry(entry);
 
         BSONObj pk = entry["_id"].wrap("");
         uint64_t flags = (NamespaceDetails::NO_LOCKTREE);
@@ -404,6 +468,124 @@ namespace mongo {
         return hours * millisPerHour;
     }
 
+    bool oplogIsPartitioned() {
+        Lock::DBRead lk("local");
+        return rsOplogDetails != NULL && rsOplogDetails->isPartitioned();
+    }
+
+    // @return the first (direction 1) or last (-1) entry in an oplog partition, or
+    //         an empty object if it has none
+    static BSONObj partitionEndEntry(NamespaceDetails *partition, const int direction) {
+        shared_ptr<Cursor> c(BasicCursor::make(partition, direction));
+        return c->ok() ? c->current().getOwned() : BSONObj();
+    }
+
+    // The aborted transaction that changed the oplog's partitions closed its
+    // NamespaceDetails, which rsOplogDetails points to. Nobody else can use the
+    // cached pointer while we hold the write lock, so it must be good again
+    // before we let go.
+    static void reloadOplogDetails() {
+        Lock::assertWriteLocked("local");
+        Client::Context ctx(rsoplog, dbpath, false);
+        rsOplogDetails = nsdetails(rsoplog);
+        fassert(17068, rsOplogDetails != NULL);
+    }
+
+    uint64_t rotateOplogPartitions(const uint64_t expireMillis, const uint64_t minTime) {
+        // A 24th of the history we keep, so dropping whole partitions keeps at most
+        // about 4% more than asked for, but no less than an hour, so there are never
+        // many partitions to route through.
+        const uint64_t periodMillis = cmdLine.oplogPartitionPeriodMillis > 0 ?
+                cmdLine.oplogPartitionPeriodMillis :
+                std::max(expireMillis / 24, (uint64_t) 3600 * 1000);
+        uint64_t millisToWait = periodMillis;
+
+        // The oldest partition takes the oplog.refs rows of its spilled transactions
+        // with it. Finding them means reading the whole partition, so we do that
+        // before taking the lock that keeps everyone out of the oplog, and purge
+        // them only once we know the partition goes.
+        bool dropOldest = false;
+        BSONObj newest;
+        vector<OID> refs;
+        {
+            Client::ReadContext ctx(rsoplog);
+            Client::Transaction txn(DB_READ_UNCOMMITTED);
+            NamespaceDetails *d = nsdetails(rsoplog);
+            if (d != NULL && d->numPartitions() > 1) {
+                NamespaceDetails *oldest = d->getPartition(0);
+                newest = partitionEndEntry(oldest, -1);
+                const uint64_t ts = newest.isEmpty() ? 0 : newest["ts"]._numberLong();
+                if (ts > minTime) {
+                    millisToWait = ts - minTime + 1000;
+                } else {
+                    for (shared_ptr<Cursor> c(BasicCursor::make(oldest)); c->ok(); c->advance()) {
+                        const BSONObj entry = c->current();
+                        if (entry.hasElement("ref")) {
+                            refs.push_back(entry["ref"].OID());
+                        }
+                    }
+                    dropOldest = true;
+                }
+            }
+            txn.commit(DB_TXN_NOSYNC);
+        }
+
+        Lock::DBWrite lk("local");
+        Client::Context ctx(rsoplog);
+
+        // Oplog writers take no row locks and insert under the read lock, so now
+        // that we hold the write lock, every entry written so far is in the last
+        // partition, committed or not, and only a read uncommitted cursor sees them
+        // all. The new partition must start past the newest of them, or an entry
+        // whose transaction is still live would be left above its partition's max,
+        // where lookups by _id and tailing cursors would never find it. Entries
+        // written later with smaller GTIDs still go to the old partition, which
+        // tailing cursors don't leave until minUnsafeKey is past it.
+        BSONObj lastPK;
+        {
+            Client::Transaction txn(DB_READ_UNCOMMITTED);
+            NamespaceDetails *d = nsdetails(rsoplog);
+            shared_ptr<Cursor> c(BasicCursor::make(d->getPartition(d->numPartitions() - 1), -1));
+            if (c->ok()) {
+                lastPK = c->currPK().getOwned();
+            }
+            txn.commit(DB_TXN_NOSYNC);
+        }
+
+        try {
+            Client::Transaction txn(DB_SERIALIZABLE);
+            NamespaceDetails *d = nsdetails(rsoplog);
+            // Unless a late transaction wrote to it since, in which case we look again.
+            // The refs go in this transaction, so they stay if the drop fails.
+            if (dropOldest && d->numPartitions() > 1 &&
+                partitionEndEntry(d->getPartition(0), -1).woCompare(newest) == 0) {
+                for (vector<OID>::const_iterator it = refs.begin(); it != refs.end(); ++it) {
+                    purgeRefs(*it);
+                }
+                d->dropPartition(-1);
+                millisToWait = 0;
+            }
+
+            // Close the last partition once it has a period's worth of history.
+            const BSONObj first = partitionEndEntry(d->getPartition(d->numPartitions() - 1), 1);
+            if (!first.isEmpty()) {
+                const uint64_t ts = first["ts"]._numberLong();
+                const uint64_t now = curTimeMillis64();
+                if (ts + periodMillis <= now) {
+                    d->addPartition(lastPK);
+                } else {
+                    millisToWait = std::min(millisToWait, ts + periodMillis - now + 1000);
+                }
+            }
+            txn.commit(DB_TXN_NOSYNC);
+        }
+        catch (...) {
+            reloadOplogDetails();
+            throw;
+        }
+        return millisToWait;
+    }
+
     void hotOptimizeOplogTo(GTID gtid) {
         Client::ReadContext ctx(rsoplog);
 
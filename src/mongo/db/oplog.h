@@ -57,6 +57,16 @@ namespace mongo {
 
     // hot optimize oplog up to gtid, used by purge thread to vacuum stale entries
     void hotOptimizeOplogTo(GTID gtid);
+
+    // @return true if the oplog is stored in partitions, as new oplogs are. Oplogs
+    //         created before that are still purged an entry at a time.
+    bool oplogIsPartitioned();
+
+    // Drops the oldest partition of the oplog if everything in it is older than
+    // minTime, and starts a new partition once the last one spans enough of
+    // expireMillis. Used by the purge thread.
+    // @return how long to wait before there may be more to do, in milliseconds
+    uint64_t rotateOplogPartitions(uint64_t expireMillis, uint64_t minTime);
     
     /** puts obj in the oplog as a comment (a no-op).  Just for diags.
         convention is
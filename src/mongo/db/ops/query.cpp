@@ -29,9 +29,12 @@
 #include "../../s/d_logic.h"
 #include "../../server.h"
 #include "../queryoptimizercursor.h"
+#include "../../util/tracepoint.h"
 
 namespace mongo {
 
+    MONGO_TRACEPOINT_DECLARE(queryPlan);
+
     /* We cut off further objects once we cross this threshold; thus, you might get
        a little bit more than this, it is a threshold rather than a limit.
     */
@@ -204,8 +207,15 @@ namespace mongo {
                 exhaust = client_cursor->queryOptions() & QueryOption_Exhaust;
             } else if (!cursorPartOfMultiStatementTxn) {
                 // This cursor is done and it wasn't part of a multi-statement
-                // transaction. We can commit the transaction now.
-                cc().commitTopTxn();
+                // transaction. We can commit the transaction now, unless other
+                // cursors share it (parallelCollectionScan), in which case the
+                // last one of them to go ends it.
+                if (cc().txnStack().unique()) {
+                    cc().commitTopTxn();
+                } else {
+                    shared_ptr<Client::TransactionStack> shared;
+                    cc().swapTransactionStack(shared);
+                }
                 wts->release();
             }
         }
@@ -647,6 +657,7 @@ namespace mongo {
                                   const bool inMultiStatementTxn,
                                   Message &result ) {
 
+        MONGO_TRACE(queryPlan);
         const ParsedQuery &pq( *pq_shared );
         shared_ptr<Cursor> cursor;
         QueryPlanSummary queryPlan;
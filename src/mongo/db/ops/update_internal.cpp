@@ -21,6 +21,7 @@
 
 #include "mongo/db/oplog.h"
 #include "mongo/db/jsobjmanipulator.h"
+#include "mongo/util/buf_arena.h"
 #include "mongo/util/mongoutils/str.h"
 
 #include "update_internal.h"
@@ -656,7 +657,7 @@ namespace mongo {
 
     ModSetState::ModStateRange ModSetState::modsForRoot( const string& root ) {
         ModStateHolder::iterator mstart = _mods.lower_bound( root );
-        StringBuilder buf;
+        ArenaStringBuilder buf;
         buf << root << (char)255;
         ModStateHolder::iterator mend = _mods.lower_bound( buf.str() );
         return make_pair( mstart, mend );
@@ -1009,7 +1010,7 @@ namespace mongo {
                 n->_mods[s] = i->second;
                 continue;
             }
-            StringBuilder buf;
+            ArenaStringBuilder buf;
             buf << s.substr(0,idx+1) << elemMatchKey << s.substr(idx+2);
             string fixed = buf.str();
             DEBUGUPDATE( "fixed dynamic: " << s << " -->> " << fixed );
@@ -1032,7 +1033,7 @@ namespace mongo {
 
         bool modified = false;
 
-        StringBuilder buf;
+        ArenaStringBuilder buf;
         for ( size_t i=0; i<fullName.size(); i++ ) {
 
             char c = fullName[i];
@@ -368,15 +368,10 @@ namespace mongo {
         auto_ptr<KeyOnly> p( new KeyOnly() );
 
         int got = 0;
-        bool idCoveredByKey = false;
         BSONObjIterator i( keyPattern );
         while ( i.more() ) {
             BSONElement k = i.next();
 
-            if ( mongoutils::str::equals( k.fieldName(), "_id" ) ) {
-                idCoveredByKey = true;
-            }
-
             if ( _source[k.fieldName()].type() ) {
 
                 if ( strchr( k.fieldName() , '.' ) ) {
@@ -403,12 +398,34 @@ namespace mongo {
 
         }
 
-        if ( _includeID && ! idCoveredByKey && pkHasIdField ) {
-            // The _id field can be covered by the PK, and it isn't
-            // already covered by the key. Note that and we'll add
-            // the _id field during hydrate() later.
-            p->includeIDFromPK();
-            got++;
+        // Whatever the key doesn't cover may be covered by the pk, which
+        // follows the key in every secondary index.
+        BSONObjIterator j( pkPattern );
+        while ( j.more() ) {
+            BSONElement k = j.next();
+
+            if ( keyPattern[k.fieldName()].ok() ) {
+                p->addPKNo();
+            }
+            else if ( mongoutils::str::equals( k.fieldName() , "_id" ) ) {
+                if ( _includeID ) {
+                    p->addPKYes( "_id" );
+                    got++;
+                }
+                else {
+                    p->addPKNo();
+                }
+            }
+            else if ( _source[k.fieldName()].type() ) {
+                if ( strchr( k.fieldName() , '.' ) ) {
+                    return 0;
+                }
+                p->addPKYes( k.fieldName() );
+                got++;
+            }
+            else {
+                p->addPKNo();
+            }
         }
         
         int need = _source.nFields();
@@ -424,7 +441,7 @@ namespace mongo {
     BSONObj Projection::KeyOnly::hydrate( const BSONObj &key, const BSONObj &pk ) const {
         verify( _include.size() == _names.size() );
 
-        BSONObjBuilder b( key.objsize() + _stringSize + 16 );
+        BSONObjBuilder b( key.objsize() + pk.objsize() + _stringSize + 16 );
 
         BSONObjIterator i(key);
         unsigned n=0;
@@ -437,11 +454,15 @@ namespace mongo {
             n++;
         }
 
-        // This will be true if we need to include the _id field
-        // and it isn't covered by the key by itself. We'll take
-        // it from the PK in that case.
-        if ( _includeIDFromPK ) {
-            b.appendAs( pk.firstElement(), "_id" );
+        // Fields the key doesn't cover by itself are taken from the PK.
+        BSONObjIterator j(pk);
+        n=0;
+        while ( j.more() && n < _pkInclude.size() ) {
+            BSONElement e = j.next();
+            if ( _pkInclude[n] ) {
+                b.appendAs( e , _pkNames[n] );
+            }
+            n++;
         }
 
         return b.obj();
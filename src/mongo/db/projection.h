@@ -37,27 +37,31 @@ namespace mongo {
         class KeyOnly {
         public:
 
-            KeyOnly() : _stringSize(0), _includeIDFromPK(false) {}
+            KeyOnly() : _stringSize(0) {}
 
             BSONObj hydrate( const BSONObj &key, const BSONObj &pk ) const;
 
-            void addNo() { _add( false , "" ); }
-            void addYes( const string& name ) { _add( true , name ); }
-            void includeIDFromPK() { _includeIDFromPK = true; }
+            void addNo() { _add( _include, _names, false , "" ); }
+            void addYes( const string& name ) { _add( _include, _names, true , name ); }
+            // Secondary keys embed the primary key, so fields of the pk
+            // that the key lacks can be returned from it as well.
+            void addPKNo() { _add( _pkInclude, _pkNames, false , "" ); }
+            void addPKYes( const string& name ) { _add( _pkInclude, _pkNames, true , name ); }
 
         private:
 
-            void _add( bool b , const string& name ) {
-                _include.push_back( b );
-                _names.push_back( name );
+            void _add( vector<bool> &include, vector<string> &names, bool b , const string& name ) {
+                include.push_back( b );
+                names.push_back( name );
                 _stringSize += name.size();
             }
 
             vector<bool> _include; // one entry per field in key.  true iff should be in output
             vector<string> _names; // name of field since key doesn't have names
+            vector<bool> _pkInclude; // same, for each field in the pk
+            vector<string> _pkNames;
 
             int _stringSize;
-            bool _includeIDFromPK;
         };
 
         enum ArrayOpType {
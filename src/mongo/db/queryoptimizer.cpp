@@ -286,7 +286,13 @@ doneCheckOrder:
         }
                 
         verify( _index != NULL );
-        if ( _startOrEndSpec ) {
+        if ( _d->isPartitioned() ) {
+            if ( _startOrEndSpec ) {
+                return PartitionedCursor::make( _d, *_index, _startKey, _endKey, _endKeyInclusive, _direction >= 0 ? 1 : -1, numWanted );
+            }
+            return PartitionedCursor::make( _d, *_index, _frv, independentRangesSingleIntervalLimit(), _direction >= 0 ? 1 : -1, numWanted );
+        }
+        else if ( _startOrEndSpec ) {
             // we are sure to spec _endKeyInclusive
             return shared_ptr<Cursor>( IndexCursor::make( _d, *_index, _startKey, _endKey, _endKeyInclusive, _direction >= 0 ? 1 : -1, numWanted ) );
         }
@@ -474,7 +480,8 @@ doneCheckOrder:
     
     shared_ptr<CoveredIndexMatcher> QueryPlan::matcher() const {
         if ( !_matcher ) {
-            _matcher.reset( new CoveredIndexMatcher( originalQuery(), indexKey() ) );
+            _matcher.reset( new CoveredIndexMatcher( originalQuery(), indexKey(),
+                                                     _index ? _d->pkPattern() : BSONObj() ) );
         }
         return _matcher;
     }
@@ -612,6 +612,9 @@ namespace mongo {
                 if ( idxNo >= 0 ) {
                     IndexDetails& i = d->idx( idxNo );
                     BSONObj key = i.getKeyFromQuery( _query );
+                    if ( d->isPartitioned() ) {
+                        return PartitionedCursor::make( d, i, key, key, true, 1, numWanted );
+                    }
                     return shared_ptr<Cursor>( IndexCursor::make( d, i, key, key, true, 1, numWanted ) );
                 }
             }
@@ -35,6 +35,7 @@
 #include "../util/goodies.h"
 #include "repl.h"
 #include "../util/net/message.h"
+#include "../util/net/message_port.h"
 #include "../util/background.h"
 #include "../client/connpool.h"
 #include "commands.h"
@@ -119,6 +120,28 @@ namespace mongo {
         virtual bool canRunInMultiStmtTxn() const { return true; }
         virtual OpSettings getOpSettings() const { return OpSettings(); }
         CmdIsMaster() : Command("isMaster", true, "ismaster") { }
+
+        /**
+         * A client that sends { compression : [ <compressor>, ... ] } wants
+         * to compress messages both ways.  If it offers the compressor we
+         * use, our replies from now on are compressed with it, and we answer
+         * with it so the client compresses its requests too.
+         */
+        static void negotiateCompression( const BSONObj& offered , BSONObjBuilder& result ) {
+            AbstractMessagingPort* port = cc().port();
+            if ( cmdLine.networkCompressor == MessageCompressor::NONE || port == NULL ) {
+                return;
+            }
+            BSONForEach( e , offered ) {
+                MessageCompressor::Id id;
+                if ( e.type() == String && MessageCompressor::forName( e.valuestr() , &id ) &&
+                     id == cmdLine.networkCompressor ) {
+                    port->setCompressor( id );
+                    result.append( "compression" , BSON_ARRAY( MessageCompressor::name( id ) ) );
+                    return;
+                }
+            }
+        }
         virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
             /* currently request to arbiter is (somewhat arbitrarily) an ismaster request that is not
                authenticated.
@@ -128,6 +151,11 @@ namespace mongo {
             bool authed = cc().getAuthenticationInfo()->isAuthorizedReads("admin");
             appendReplicationInfo( result , authed );
 
+            BSONElement compression = cmdObj["compression"];
+            if ( compression.type() == Array ) {
+                negotiateCompression( compression.Obj() , result );
+            }
+
             result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
             result.appendDate("localTime", jsTime());
             return true;
@@ -45,6 +45,9 @@ namespace mongo {
 
         int slavedelay;
 
+        // number of connections initial sync clones collections over at once
+        int initialSyncStreams;
+
         set<string> discoveredSeeds;
         mutex discoveredSeeds_mx;
 
@@ -54,6 +57,7 @@ namespace mongo {
             : fastsync(),
             autoresync(false),
             slavedelay(),
+            initialSyncStreams(4),
             discoveredSeeds(),
             discoveredSeeds_mx("ReplSettings::discoveredSeeds") {
         }
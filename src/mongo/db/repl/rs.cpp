@@ -1090,75 +1090,88 @@ namespace mongo {
                 const uint64_t ageAllowed = expireMillis + (3600*1000);
                 const uint64_t minTime = curTimeMillis64() - ageAllowed;
                 uint64_t millisToWait = 0;
-                // delete some entries from the oplog. We use a cursor
-                // to get up to 1000 entries and delete them, all with a single
-                // transaction.
-                try {
-                    Client::ReadContext ctx(rsoplog);
-                    Client::Transaction transaction(DB_READ_UNCOMMITTED);
-                    NamespaceDetails *d = nsdetails(rsoplog);
-                    vector<BSONObj> docs;
-                    // We set the default wait time to 2 seconds.
-                    // If we find nothing in the oplog, we will wait 2 seconds
-                    millisToWait = 2000;
-                    if (d != NULL) {
-                        BSONObjBuilder query;
-                        BSONObjBuilder q(query.subobjStart("_id"));
-                        addGTIDToBSON("$gte", _lastPurgedGTID, q);
-                        q.doneFast();
-                        shared_ptr<Cursor> c(
-                            getOptimizedCursor(
-                                rsoplog,
-                                query.done(),
-                                BSONObj(),
-                                QueryPlanSelectionPolicy::indexOnly()
-                                )
-                            );
-                        // add entries to docs from a cursor
-                        while (c->ok()) {
-                            BSONObj curr = c->current();
-                            uint64_t ts = curr["ts"]._numberLong();
-                            if (ts > minTime) {
-                                // we only set millisToWait, which has us sleep,
-                                // if we are not deleting anything in this loop.
-                                // If we are deleting even just one entry,
-                                // we do not sleep.
-                                if (docs.empty()) {
-                                    // set the time to way to be 1 second longer
-                                    // than when the next entry expires, so that
-                                    // when we wake up, we can hopefully
-                                    // delete a bunch of entries in bulk
-                                    boost::unique_lock<boost::mutex> lock(_purgeMutex);
-                                    _lastPurgedGTID = getGTIDFromBSON("_id", curr);
-                                    millisToWait = ts - minTime + 1000;
+                if (oplogIsPartitioned()) {
+                    // Expired history goes a partition at a time, and the
+                    // optimize thread has nothing to vacuum.
+                    try {
+                        millisToWait = rotateOplogPartitions(expireMillis, minTime);
+                    }
+                    catch (...) {
+                        log() << "exception caught rotating oplog partitions: " << rsLog;
+                        millisToWait = 2000;
+                    }
+                }
+                else {
+                    // delete some entries from the oplog. We use a cursor
+                    // to get up to 1000 entries and delete them, all with a single
+                    // transaction.
+                    try {
+                        Client::ReadContext ctx(rsoplog);
+                        Client::Transaction transaction(DB_READ_UNCOMMITTED);
+                        NamespaceDetails *d = nsdetails(rsoplog);
+                        vector<BSONObj> docs;
+                        // We set the default wait time to 2 seconds.
+                        // If we find nothing in the oplog, we will wait 2 seconds
+                        millisToWait = 2000;
+                        if (d != NULL) {
+                            BSONObjBuilder query;
+                            BSONObjBuilder q(query.subobjStart("_id"));
+                            addGTIDToBSON("$gte", _lastPurgedGTID, q);
+                            q.doneFast();
+                            shared_ptr<Cursor> c(
+                                getOptimizedCursor(
+                                    rsoplog,
+                                    query.done(),
+                                    BSONObj(),
+                                    QueryPlanSelectionPolicy::indexOnly()
+                                    )
+                                );
+                            // add entries to docs from a cursor
+                            while (c->ok()) {
+                                BSONObj curr = c->current();
+                                uint64_t ts = curr["ts"]._numberLong();
+                                if (ts > minTime) {
+                                    // we only set millisToWait, which has us sleep,
+                                    // if we are not deleting anything in this loop.
+                                    // If we are deleting even just one entry,
+                                    // we do not sleep.
+                                    if (docs.empty()) {
+                                        // set the time to way to be 1 second longer
+                                        // than when the next entry expires, so that
+                                        // when we wake up, we can hopefully
+                                        // delete a bunch of entries in bulk
+                                        boost::unique_lock<boost::mutex> lock(_purgeMutex);
+                                        _lastPurgedGTID = getGTIDFromBSON("_id", curr);
+                                        millisToWait = ts - minTime + 1000;
+                                    }
+                                    break;
                                 }
-                                break;
-                            }
-                            docs.push_back(curr.copy());
-                            if (curr.hasElement("ref") || docs.size() > 1000) {
-                                break;
+                                docs.push_back(curr.copy());
+                                if (curr.hasElement("ref") || docs.size() > 1000) {
+                                    break;
+                                }
+                                c->advance();
                             }
-                            c->advance();
                         }
-                    }
 
-                    if (!docs.empty()) {
-                        // we are deleting something, so let's not sleep
-                        millisToWait = 0;
-                        for (vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); ++it) {
-                            // delete the row
-                            purgeEntryFromOplog(*it);                            
-                        }
-                        {
-                            boost::unique_lock<boost::mutex> lock(_purgeMutex);
-                            _lastPurgedGTID = getGTIDFromBSON("_id", docs.back());
+                        if (!docs.empty()) {
+                            // we are deleting something, so let's not sleep
+                            millisToWait = 0;
+                            for (vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); ++it) {
+                                // delete the row
+                                purgeEntryFromOplog(*it);                            
+                            }
+                            {
+                                boost::unique_lock<boost::mutex> lock(_purgeMutex);
+                                _lastPurgedGTID = getGTIDFromBSON("_id", docs.back());
+                            }
                         }
+                        transaction.commit(DB_TXN_NOSYNC);
+                    }
+                    catch (...) {
+                        log() << "exception cought in purgeOplog thread: " << rsLog;
+                        millisToWait = 2000;
                     }
-                    transaction.commit(DB_TXN_NOSYNC);
-                }
-                catch (...) {
-                    log() << "exception cought in purgeOplog thread: " << rsLog;
-                    millisToWait = 2000;
                 }
                 // do a timed_wait, if necessary
                 // at this point, we have use a transaction to delete
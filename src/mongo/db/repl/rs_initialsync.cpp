@@ -100,6 +100,11 @@ namespace mongo {
         options.syncData = true;
         options.syncIndexes = syncIndexes;
 
+        // The streams all read conn's snapshot, so the clone is still as of
+        // one point in time and the oplog window _fillGaps catches up on is
+        // the one recorded in that snapshot's replInfo.
+        options.parallelStreams = replSettings.initialSyncStreams;
+
         string err;
         return cloneFrom(master, options, conn, err);
     }
@@ -437,7 +442,9 @@ namespace mongo {
                 sethbmsg("initial sync clone all databases", 0);
             
                 shared_ptr<DBClientConnection> conn(r.conn_shared());
-                RemoteTransaction rtxn(*conn, "mvcc");
+                // Read only, so the parallel clone's cursors, which share it,
+                // may be read over several connections at once.
+                RemoteTransaction rtxn(*conn, "mvcc", true);
 
                 list<string> dbs = conn->getDatabaseNamesForRepl();
 
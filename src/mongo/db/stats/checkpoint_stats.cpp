@@ -0,0 +1,91 @@
+// checkpoint_stats.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/checkpoint_stats.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+    CheckpointStats CheckpointStats::global;
+
+    CheckpointStats::CheckpointStats(size_t maxHistory) :
+        _maxHistory(maxHistory), _mutex("CheckpointStats"),
+        _count(0), _totalMillis(0), _totalBytesWritten(0), _maxMillis(0) {
+    }
+
+    void CheckpointStats::record(const CheckpointRecord& cp) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _count++;
+        _totalMillis += cp.millis;
+        if (cp.bytesWritten > 0) {
+            _totalBytesWritten += cp.bytesWritten;
+        }
+        _maxMillis = std::max(_maxMillis, cp.millis);
+
+        if (_maxHistory > 0) {
+            if (_history.size() >= _maxHistory) {
+                _history.pop_front();
+            }
+            _history.push_back(cp);
+        }
+    }
+
+    void CheckpointStats::appendRecord(BSONObjBuilder& b, const CheckpointRecord& cp) {
+        b.appendDate("start", cp.start);
+        b.appendNumber("millis", cp.millis);
+        b.appendNumber("beginMicros", cp.beginMicros);
+        b.appendNumber("bytesWritten", cp.bytesWritten);
+        b.appendNumber("uncompressedBytesWritten", cp.uncompressedBytesWritten);
+        b.appendNumber("nodesWritten", cp.nodesWritten);
+        b.appendBool("requested", cp.requested);
+    }
+
+    void CheckpointStats::append(BSONObjBuilder& b) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        b.appendNumber("count", _count);
+        b.appendNumber("totalMillis", _totalMillis);
+        b.appendNumber("maxMillis", _maxMillis);
+        b.appendNumber("totalBytesWritten", _totalBytesWritten);
+        BSONArrayBuilder history(b.subarrayStart("history"));
+        for (std::deque<CheckpointRecord>::const_reverse_iterator i = _history.rbegin(); i != _history.rend(); ++i) {
+            BSONObjBuilder cb(history.subobjStart());
+            appendRecord(cb, *i);
+            cb.done();
+        }
+        history.done();
+    }
+
+    unsigned long long CheckpointStats::pacedIntervalMillis(unsigned long long bytesWritten,
+                                                            unsigned long long checkpointMillis,
+                                                            unsigned long long targetBytesPerSecond,
+                                                            unsigned long long periodMillis) {
+        if (targetBytesPerSecond == 0) {
+            return periodMillis;
+        }
+        // Writing bytesWritten at the target takes this long, checkpoint and quiet period together.
+        const unsigned long long cycleMillis = bytesWritten * 1000 / targetBytesPerSecond;
+        const unsigned long long interval = cycleMillis > checkpointMillis ? cycleMillis - checkpointMillis : 0;
+        const unsigned long long minInterval = std::max(periodMillis / MIN_PACED_PERIOD_FRACTION,
+                                                        (unsigned long long) MIN_PACED_INTERVAL_MILLIS);
+        return std::min(std::max(interval, minInterval), periodMillis);
+    }
+
+} // namespace mongo
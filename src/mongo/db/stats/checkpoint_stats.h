@@ -0,0 +1,111 @@
+// checkpoint_stats.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <deque>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * What one checkpoint cost.  The counts come from the ydb's engine
+     * status, as the difference across the checkpoint, and are -1 if this
+     * ydb doesn't report them.
+     */
+    struct CheckpointRecord {
+        CheckpointRecord() : millis(0), beginMicros(-1), bytesWritten(-1),
+                             uncompressedBytesWritten(-1), nodesWritten(-1),
+                             requested(false) { }
+
+        Date_t start;
+        long long millis;
+        /** how long clients were held up while the checkpoint began */
+        long long beginMicros;
+        /** bytes of tree nodes written for the checkpoint, as stored on disk */
+        long long bytesWritten;
+        long long uncompressedBytesWritten;
+        /**
+         * leaf and nonleaf nodes written for the checkpoint: the nodes that
+         * were dirty when it began, whether or not a client's write to
+         * them had them cloned first
+         */
+        long long nodesWritten;
+        /** run by the checkpoint command, rather than on schedule */
+        bool requested;
+    };
+
+    /**
+     * The last maxHistory checkpoints and totals over all of them, for
+     * serverStatus.  storage/env.cpp runs checkpoints and records them here.
+     */
+    class CheckpointStats : boost::noncopyable {
+    public:
+        static const size_t DEFAULT_MAX_HISTORY = 20;
+
+        /**
+         * paced checkpoints never begin closer together than this, nor than
+         * 1/MIN_PACED_PERIOD_FRACTION of the period: each one stalls clients
+         * as it begins, so a quiet server is no reason to run them back to back
+         */
+        static const unsigned long long MIN_PACED_INTERVAL_MILLIS = 1000;
+        static const unsigned long long MIN_PACED_PERIOD_FRACTION = 4;
+
+        explicit CheckpointStats(size_t maxHistory = DEFAULT_MAX_HISTORY);
+
+        void record(const CheckpointRecord& cp);
+
+        /** totals, then the history, newest first */
+        void append(BSONObjBuilder& b) const;
+
+        /**
+         * How long after a checkpoint that wrote bytesWritten in
+         * checkpointMillis the next one should begin, so that checkpoints
+         * write about targetBytesPerSecond on average: a checkpoint that
+         * wrote a lot is followed by a longer quiet period, and when little
+         * gets dirty, checkpoints come somewhat more often and each one
+         * writes less.
+         * The result is between 1/MIN_PACED_PERIOD_FRACTION of periodMillis
+         * (and at least MIN_PACED_INTERVAL_MILLIS) and periodMillis, which
+         * still bounds how much log recovery may have to replay.
+         */
+        static unsigned long long pacedIntervalMillis(unsigned long long bytesWritten,
+                                                      unsigned long long checkpointMillis,
+                                                      unsigned long long targetBytesPerSecond,
+                                                      unsigned long long periodMillis);
+
+        static CheckpointStats global;
+
+    private:
+        static void appendRecord(BSONObjBuilder& b, const CheckpointRecord& cp);
+
+        const size_t _maxHistory;
+
+        mutable SimpleMutex _mutex;
+        std::deque<CheckpointRecord> _history;
+        long long _count;
+        long long _totalMillis;
+        long long _totalBytesWritten;
+        long long _maxMillis;
+    };
+
+} // namespace mongo
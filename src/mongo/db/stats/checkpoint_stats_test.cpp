@@ -0,0 +1,86 @@
+// checkpoint_stats_test.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "mongo/db/stats/checkpoint_stats.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+
+    CheckpointRecord checkpoint(unsigned long long start, long long millis, long long bytes) {
+        CheckpointRecord cp;
+        cp.start = Date_t(start);
+        cp.millis = millis;
+        cp.bytesWritten = bytes;
+        cp.nodesWritten = bytes / 1000;
+        return cp;
+    }
+
+    TEST(CheckpointStats, KeepsTheLastFew) {
+        CheckpointStats stats(3);
+        for (int i = 1; i <= 5; i++) {
+            stats.record(checkpoint(i * 60000, i * 100, i * 1000000));
+        }
+        BSONObjBuilder b;
+        stats.append(b);
+        BSONObj o = b.obj();
+        ASSERT_EQUALS(5, o["count"].numberLong());
+        ASSERT_EQUALS(1500, o["totalMillis"].numberLong());
+        ASSERT_EQUALS(500, o["maxMillis"].numberLong());
+        ASSERT_EQUALS(15000000, o["totalBytesWritten"].numberLong());
+
+        std::vector<BSONElement> history = o["history"].Array();
+        ASSERT_EQUALS(3U, history.size());
+        ASSERT_EQUALS(500, history[0]["millis"].numberLong());
+        ASSERT_EQUALS(300, history[2]["millis"].numberLong());
+        ASSERT_EQUALS(5000, history[0]["nodesWritten"].numberLong());
+        ASSERT_EQUALS(300000ULL, history[2]["start"].date().millis);
+    }
+
+    TEST(CheckpointStats, UnreportedBytesArentTotaled) {
+        CheckpointStats stats;
+        stats.record(checkpoint(0, 10, -1));
+        stats.record(checkpoint(1000, 10, 5000));
+        BSONObjBuilder b;
+        stats.append(b);
+        BSONObj o = b.obj();
+        ASSERT_EQUALS(5000, o["totalBytesWritten"].numberLong());
+        ASSERT_EQUALS(-1, o["history"].Array()[1]["bytesWritten"].numberLong());
+    }
+
+    TEST(CheckpointStats, Pacing) {
+        const unsigned long long mb = 1 << 20;
+        // no target, no pacing
+        ASSERT_EQUALS(60000ULL, CheckpointStats::pacedIntervalMillis(100 * mb, 1000, 0, 60000));
+        // 300MB at 10MB/s is a 30 second cycle, 2 of which the checkpoint took
+        ASSERT_EQUALS(28000ULL, CheckpointStats::pacedIntervalMillis(300 * mb, 2000, 10 * mb, 60000));
+        // never longer than the period
+        ASSERT_EQUALS(60000ULL, CheckpointStats::pacedIntervalMillis(10000 * mb, 2000, 10 * mb, 60000));
+        // nor shorter than a fraction of it, even if the checkpoint took longer than its share
+        ASSERT_EQUALS(15000ULL, CheckpointStats::pacedIntervalMillis(mb, 0, 10 * mb, 60000));
+        ASSERT_EQUALS(15000ULL, CheckpointStats::pacedIntervalMillis(100 * mb, 20000, 10 * mb, 60000));
+        // or the minimum, for short periods
+        ASSERT_EQUALS(CheckpointStats::MIN_PACED_INTERVAL_MILLIS,
+                      CheckpointStats::pacedIntervalMillis(mb, 0, 10 * mb, 2000));
+        // and a period that short is all there is
+        ASSERT_EQUALS(500ULL, CheckpointStats::pacedIntervalMillis(mb, 0, 10 * mb, 500));
+    }
+
+} // namespace
@@ -125,7 +125,45 @@ namespace mongo {
         _lock.unlock();
     }
 
+    const char* BufArenaCounters::_names[] = { "insert", "query", "update", "delete", "getmore", "command" };
+
+    BufArenaCounters::BufArenaCounters() {
+        for ( int i = 0; i < NUM_TYPES; i++ ) {
+            _ops[i] = _allocs[i] = _mallocs[i] = 0;
+        }
+    }
+
+    void BufArenaCounters::gotOp( int op , bool isCommand , long long allocs , long long mallocs ) {
+        OpType t;
+        switch ( op ) {
+        case dbInsert: t = OP_INSERT; break;
+        case dbQuery: t = isCommand ? OP_COMMAND : OP_QUERY; break;
+        case dbUpdate: t = OP_UPDATE; break;
+        case dbDelete: t = OP_DELETE; break;
+        case dbGetMore: t = OP_GETMORE; break;
+        default: return;
+        }
+        _lock.lock();
+        _ops[t]++;
+        _allocs[t] += allocs;
+        _mallocs[t] += mallocs;
+        _lock.unlock();
+    }
+
+    void BufArenaCounters::append( BSONObjBuilder& b ) {
+        _lock.lock();
+        for ( int i = 0; i < NUM_TYPES; i++ ) {
+            BSONObjBuilder bb( b.subobjStart( _names[i] ) );
+            bb.appendNumber( "ops" , _ops[i] );
+            bb.appendNumber( "allocs" , _allocs[i] );
+            bb.appendNumber( "mallocs" , _mallocs[i] );
+            bb.done();
+        }
+        _lock.unlock();
+    }
+
     OpCounters globalOpCounters;
     OpCounters replOpCounters;
     NetworkCounter networkCounter;
+    BufArenaCounters bufArenaCounters;
 }
@@ -96,4 +96,26 @@ namespace mongo {
     };
 
     extern NetworkCounter networkCounter;
+
+    /**
+     * what each type of operation drew from its client's BufArena: the
+     * buffers it served, and the mallocs it took to serve them
+     */
+    class BufArenaCounters {
+    public:
+        BufArenaCounters();
+        void gotOp( int op , bool isCommand , long long allocs , long long mallocs );
+        void append( BSONObjBuilder& b );
+    private:
+        enum OpType { OP_INSERT, OP_QUERY, OP_UPDATE, OP_DELETE, OP_GETMORE, OP_COMMAND, NUM_TYPES };
+        static const char* _names[NUM_TYPES];
+
+        long long _ops[NUM_TYPES];
+        long long _allocs[NUM_TYPES];
+        long long _mallocs[NUM_TYPES];
+
+        SpinLock _lock;
+    };
+
+    extern BufArenaCounters bufArenaCounters;
 }
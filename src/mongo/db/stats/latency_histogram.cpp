@@ -0,0 +1,246 @@
+// latency_histogram.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/latency_histogram.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace LatencyBuckets {
+
+        namespace {
+            int highestBit(unsigned long long v) {
+#if defined(__GNUC__)
+                return 63 - __builtin_clzll(v);
+#else
+                int b = 0;
+                while (v >>= 1) {
+                    b++;
+                }
+                return b;
+#endif
+            }
+        }
+
+        int bucketFor(unsigned long long micros) {
+            const unsigned long long top = (1ULL << MAX_BITS) - 1;
+            if (micros > top) {
+                micros = top;
+            }
+            if (micros < (unsigned long long) SUB_BUCKETS) {
+                return (int) micros;
+            }
+            const int b = highestBit(micros);
+            // the SUB_BITS bits under the highest one pick the sub-bucket
+            return (b - SUB_BITS + 1) * SUB_BUCKETS +
+                   (int) ((micros >> (b - SUB_BITS)) - SUB_BUCKETS);
+        }
+
+        unsigned long long lowerBound(int bucket) {
+            if (bucket < SUB_BUCKETS) {
+                return bucket;
+            }
+            const int b = bucket / SUB_BUCKETS + SUB_BITS - 1;
+            const unsigned long long sub = bucket % SUB_BUCKETS;
+            return (SUB_BUCKETS + sub) << (b - SUB_BITS);
+        }
+
+        unsigned long long upperBound(int bucket) {
+            if (bucket == NUM_BUCKETS - 1) {
+                return (1ULL << MAX_BITS) - 1;
+            }
+            return lowerBound(bucket + 1) - 1;
+        }
+
+    } // namespace LatencyBuckets
+
+    LatencyDistribution::LatencyDistribution() :
+        _counts(LatencyBuckets::NUM_BUCKETS, 0), _count(0), _sum(0), _max(0) {
+    }
+
+    void LatencyDistribution::add(unsigned long long micros) {
+        _counts[LatencyBuckets::bucketFor(micros)]++;
+        _count++;
+        _sum += micros;
+        _max = std::max(_max, micros);
+    }
+
+    void LatencyDistribution::merge(const LatencyDistribution& other) {
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            _counts[i] += other._counts[i];
+        }
+        _count += other._count;
+        _sum += other._sum;
+        _max = std::max(_max, other._max);
+    }
+
+    bool LatencyDistribution::merge(const BSONObj& appended, std::string& errmsg) {
+        BSONElement buckets = appended["buckets"];
+        if (buckets.type() != Array) {
+            errmsg = mongoutils::str::stream() << "no latency buckets in " << appended;
+            return false;
+        }
+        // check everything before changing anything
+        std::vector<std::pair<int, long long> > parsed;
+        BSONForEach(e, buckets.Obj()) {
+            if (e.type() != Array) {
+                errmsg = mongoutils::str::stream() << "bad latency bucket " << e;
+                return false;
+            }
+            BSONObj pair = e.Obj();
+            BSONElement lower = pair["0"];
+            BSONElement n = pair["1"];
+            if (!lower.isNumber() || !n.isNumber() || lower.numberLong() < 0) {
+                errmsg = mongoutils::str::stream() << "bad latency bucket " << e;
+                return false;
+            }
+            const int bucket = LatencyBuckets::bucketFor(lower.numberLong());
+            if (LatencyBuckets::lowerBound(bucket) != (unsigned long long) lower.numberLong()) {
+                errmsg = mongoutils::str::stream() << "latency bucket " << e << " isn't one of ours";
+                return false;
+            }
+            parsed.push_back(std::make_pair(bucket, n.numberLong()));
+        }
+        for (std::vector<std::pair<int, long long> >::const_iterator it = parsed.begin();
+             it != parsed.end(); ++it) {
+            _counts[it->first] += it->second;
+            _count += it->second;
+        }
+        _sum += appended["totalMicros"].numberLong();
+        _max = std::max(_max, (unsigned long long) appended["max"].numberLong());
+        return true;
+    }
+
+    unsigned long long LatencyDistribution::percentile(double p) const {
+        if (_count == 0) {
+            return 0;
+        }
+        long long rank = (long long) ceil(p * _count);
+        if (rank < 1) {
+            rank = 1;
+        }
+        long long seen = 0;
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            seen += _counts[i];
+            if (seen >= rank) {
+                return std::min(LatencyBuckets::upperBound(i), _max);
+            }
+        }
+        return _max;
+    }
+
+    void LatencyDistribution::appendSummary(BSONObjBuilder& b) const {
+        b.appendNumber("count", _count);
+        b.appendNumber("totalMicros", _sum);
+        b.appendNumber("max", (long long) _max);
+        b.appendNumber("p50", (long long) percentile(0.50));
+        b.appendNumber("p95", (long long) percentile(0.95));
+        b.appendNumber("p99", (long long) percentile(0.99));
+        b.appendNumber("p999", (long long) percentile(0.999));
+    }
+
+    void LatencyDistribution::appendBuckets(BSONObjBuilder& b) const {
+        appendSummary(b);
+        BSONArrayBuilder arr(b.subarrayStart("buckets"));
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            if (_counts[i] != 0) {
+                BSONArrayBuilder pair(arr.subarrayStart());
+                pair.append((long long) LatencyBuckets::lowerBound(i));
+                pair.append(_counts[i]);
+                pair.done();
+            }
+        }
+        arr.done();
+    }
+
+    LatencyHistogram::LatencyHistogram() {
+    }
+
+    void LatencyHistogram::record(unsigned long long micros) {
+        _counts[LatencyBuckets::bucketFor(micros)].fetchAndAdd(1);
+        _sum.fetchAndAdd(micros);
+        unsigned long long max = _max.load();
+        while (micros > max) {
+            const unsigned long long found = _max.compareAndSwap(max, micros);
+            if (found == max) {
+                break;
+            }
+            max = found;
+        }
+    }
+
+    void LatencyHistogram::addTo(LatencyDistribution& out) const {
+        // Recording doesn't stop while we read, so the count is of the
+        // buckets as we read them.
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            const long long n = _counts[i].load();
+            out._counts[i] += n;
+            out._count += n;
+        }
+        out._sum += _sum.load();
+        out._max = std::max(out._max, _max.load());
+    }
+
+    void LatencyHistogram::reset() {
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            _counts[i].store(0);
+        }
+        _sum.store(0);
+        _max.store(0);
+    }
+
+    namespace {
+        int currentStripe() {
+#if defined(__linux__)
+            const int cpu = sched_getcpu();
+            if (cpu >= 0) {
+                return cpu % StripedLatencyHistogram::NUM_STRIPES;
+            }
+#endif
+            // Elsewhere, spreading by the address of something on this
+            // thread's stack does nearly as well.
+            int local;
+            return (int) ((reinterpret_cast<size_t>(&local) >> 16) %
+                          StripedLatencyHistogram::NUM_STRIPES);
+        }
+    }
+
+    void StripedLatencyHistogram::record(unsigned long long micros) {
+        _stripes[currentStripe()].record(micros);
+    }
+
+    void StripedLatencyHistogram::addTo(LatencyDistribution& out) const {
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            _stripes[i].addTo(out);
+        }
+    }
+
+    void StripedLatencyHistogram::reset() {
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            _stripes[i].reset();
+        }
+    }
+
+} // namespace mongo
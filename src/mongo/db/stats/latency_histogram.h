@@ -0,0 +1,131 @@
+// latency_histogram.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * Latencies in microseconds, bucketed HDR style: values below 16 get a
+     * bucket each, and every power of two above that is split into 16
+     * buckets, so a bucket's width is at most 1/16th of its values (two
+     * significant hex digits).  Values of 2^36 micros (about 19 hours) and
+     * up land in the last bucket.
+     *
+     * Every histogram has the same buckets, so histograms from different
+     * threads, CPUs or servers merge by adding counts.
+     */
+    namespace LatencyBuckets {
+        const int SUB_BITS = 4;
+        const int MAX_BITS = 36;
+        const int SUB_BUCKETS = 1 << SUB_BITS;
+        const int NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+        int bucketFor(unsigned long long micros);
+        unsigned long long lowerBound(int bucket);
+        /** the largest value that lands in bucket */
+        unsigned long long upperBound(int bucket);
+    }
+
+    /**
+     * A plain copy of a histogram, for reporting and merging.
+     */
+    class LatencyDistribution {
+    public:
+        LatencyDistribution();
+
+        void add(unsigned long long micros);
+        void merge(const LatencyDistribution& other);
+
+        /**
+         * Add a distribution appended by appendBuckets(), from this server
+         * or another one.
+         * @return false, with errmsg set, if it isn't one
+         */
+        bool merge(const BSONObj& appended, std::string& errmsg);
+
+        /**
+         * @return a value no more than one bucket's width above the p-th
+         *         quantile, for p in [0, 1]
+         */
+        unsigned long long percentile(double p) const;
+
+        long long count() const { return _count; }
+        long long totalMicros() const { return _sum; }
+
+        /** count, total, max and the usual percentiles */
+        void appendSummary(BSONObjBuilder& b) const;
+        /** the summary plus the nonzero buckets, which merge() takes back */
+        void appendBuckets(BSONObjBuilder& b) const;
+
+    private:
+        friend class LatencyHistogram;
+
+        std::vector<long long> _counts;
+        long long _count;
+        long long _sum;
+        unsigned long long _max;
+    };
+
+    /**
+     * A histogram any number of threads may record into at once, without
+     * locks: every bucket is its own atomic counter.
+     */
+    class LatencyHistogram : boost::noncopyable {
+    public:
+        LatencyHistogram();
+
+        void record(unsigned long long micros);
+
+        /** add what's been recorded so far to out */
+        void addTo(LatencyDistribution& out) const;
+
+        /** start over; records made meanwhile may or may not survive */
+        void reset();
+
+    private:
+        AtomicWord<unsigned long long> _counts[LatencyBuckets::NUM_BUCKETS];
+        AtomicWord<unsigned long long> _sum;
+        AtomicWord<unsigned long long> _max;
+    };
+
+    /**
+     * A LatencyHistogram per CPU (or so), for the histograms every operation
+     * records into, so that CPUs don't fight over the cache lines of the
+     * busy buckets.
+     */
+    class StripedLatencyHistogram : boost::noncopyable {
+    public:
+        static const int NUM_STRIPES = 16;
+
+        void record(unsigned long long micros);
+        void addTo(LatencyDistribution& out) const;
+        void reset();
+
+    private:
+        LatencyHistogram _stripes[NUM_STRIPES];
+    };
+
+} // namespace mongo
@@ -0,0 +1,112 @@
+// latency_histogram_test.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+
+    TEST(LatencyBuckets, BoundsRoundTrip) {
+        for (int i = 0; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            ASSERT_EQUALS(i, LatencyBuckets::bucketFor(LatencyBuckets::lowerBound(i)));
+            ASSERT_EQUALS(i, LatencyBuckets::bucketFor(LatencyBuckets::upperBound(i)));
+            if (i > 0) {
+                ASSERT_EQUALS(LatencyBuckets::upperBound(i - 1) + 1, LatencyBuckets::lowerBound(i));
+            }
+        }
+    }
+
+    TEST(LatencyBuckets, RelativeWidth) {
+        for (int i = LatencyBuckets::SUB_BUCKETS; i < LatencyBuckets::NUM_BUCKETS; i++) {
+            const unsigned long long width =
+                LatencyBuckets::upperBound(i) - LatencyBuckets::lowerBound(i) + 1;
+            ASSERT_LESS_THAN_OR_EQUALS(width * LatencyBuckets::SUB_BUCKETS,
+                                       LatencyBuckets::lowerBound(i));
+        }
+        // everything too big shares the last bucket
+        ASSERT_EQUALS(LatencyBuckets::NUM_BUCKETS - 1, LatencyBuckets::bucketFor(~0ULL));
+    }
+
+    TEST(LatencyDistribution, Percentiles) {
+        LatencyDistribution d;
+        ASSERT_EQUALS(0U, d.percentile(0.99));
+        for (unsigned long long i = 1; i <= 1000; i++) {
+            d.add(i);
+        }
+        ASSERT_EQUALS(1000, d.count());
+        ASSERT_EQUALS(500500, d.totalMicros());
+        ASSERT_EQUALS(1000U, d.percentile(1.0));
+        // within a bucket's width (1/16th) above the exact answer
+        ASSERT_GREATER_THAN_OR_EQUALS(d.percentile(0.5), 500U);
+        ASSERT_LESS_THAN_OR_EQUALS(d.percentile(0.5), 500U + 500U / 16);
+        ASSERT_GREATER_THAN_OR_EQUALS(d.percentile(0.99), 990U);
+        ASSERT_LESS_THAN_OR_EQUALS(d.percentile(0.99), 1000U);
+    }
+
+    TEST(LatencyDistribution, MergeFromBSON) {
+        LatencyHistogram h1;
+        LatencyHistogram h2;
+        LatencyDistribution expected;
+        for (unsigned long long i = 0; i < 5000; i++) {
+            const unsigned long long v = (i * 7919) % 100000;
+            (i % 2 ? h1 : h2).record(v);
+            expected.add(v);
+        }
+
+        LatencyDistribution merged;
+        std::string errmsg;
+        for (int i = 0; i < 2; i++) {
+            LatencyDistribution d;
+            (i ? h1 : h2).addTo(d);
+            BSONObjBuilder b;
+            d.appendBuckets(b);
+            ASSERT_TRUE(merged.merge(b.obj(), errmsg));
+        }
+
+        ASSERT_EQUALS(expected.count(), merged.count());
+        ASSERT_EQUALS(expected.totalMicros(), merged.totalMicros());
+        ASSERT_EQUALS(expected.percentile(0.5), merged.percentile(0.5));
+        ASSERT_EQUALS(expected.percentile(0.999), merged.percentile(0.999));
+    }
+
+    TEST(LatencyDistribution, MergeRejectsForeignBuckets) {
+        LatencyDistribution d;
+        d.add(100);
+        std::string errmsg;
+        ASSERT_FALSE(d.merge(BSON("count" << 1), errmsg));
+        // 33 is inside the bucket 32-33, not the start of one
+        ASSERT_FALSE(d.merge(BSON("buckets" << BSON_ARRAY(BSON_ARRAY(16 << 1) << BSON_ARRAY(33 << 1))),
+                             errmsg));
+        ASSERT_EQUALS(1, d.count());
+    }
+
+    TEST(StripedLatencyHistogram, AddsEveryStripe) {
+        StripedLatencyHistogram h;
+        for (int i = 0; i < 1000; i++) {
+            h.record(i);
+        }
+        LatencyDistribution d;
+        h.addTo(d);
+        ASSERT_EQUALS(1000, d.count());
+        ASSERT_EQUALS(999U, d.percentile(1.0));
+    }
+
+} // namespace
@@ -0,0 +1,188 @@
+// lock_contention.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/lock_contention.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace mongo {
+
+    LockContentionProfile LockContentionProfile::global;
+
+    LockContentionProfile::LockContentionProfile(size_t maxEntries, size_t maxRecent) :
+        _maxEntries(maxEntries), _maxRecent(maxRecent),
+        _enabled(0), _thresholdMillis(100), _sampleMillis(20),
+        _mutex("LockContentionProfile"), _evicted(0) {
+    }
+
+    bool LockContentionProfile::Key::operator<(const Key& other) const {
+        int c = ns.compare(other.ns);
+        if (c != 0) {
+            return c < 0;
+        }
+        c = index.compare(other.index);
+        if (c != 0) {
+            return c < 0;
+        }
+        return pattern < other.pattern;
+    }
+
+    void LockContentionProfile::record(const LockWait& wait) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        EntryMap::iterator i = _entries.find(Key(wait));
+        if (i == _entries.end()) {
+            if (_maxEntries == 0) {
+                return;
+            }
+            if (_entries.size() >= _maxEntries) {
+                evictOne_inlock();
+            }
+            i = _entries.insert(make_pair(Key(wait), Entry())).first;
+        }
+        Entry& e = i->second;
+        if (wait.timedOut) {
+            e.timeouts++;
+            e.timeoutMillis += wait.waitMillis;
+        }
+        else {
+            e.waits.add((unsigned long long) wait.waitMillis * 1000);
+        }
+        e.last = wait;
+
+        if (_maxRecent > 0) {
+            if (_recent.size() >= _maxRecent) {
+                _recent.pop_front();
+            }
+            _recent.push_back(wait);
+        }
+    }
+
+    void LockContentionProfile::evictOne_inlock() {
+        EntryMap::iterator oldest = _entries.begin();
+        for (EntryMap::iterator i = _entries.begin(); i != _entries.end(); ++i) {
+            if (i->second.last.when.millis < oldest->second.last.when.millis) {
+                oldest = i;
+            }
+        }
+        if (oldest != _entries.end()) {
+            _entries.erase(oldest);
+            _evicted++;
+        }
+    }
+
+    void LockContentionProfile::reset() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _entries.clear();
+        _recent.clear();
+        _evicted = 0;
+    }
+
+    size_t LockContentionProfile::size() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _entries.size();
+    }
+
+    void LockContentionProfile::appendWait(BSONObjBuilder& b, const LockWait& wait) {
+        b.append("ns", wait.ns);
+        b.append("index", wait.index);
+        if (!wait.pattern.empty()) {
+            b.append("pattern", wait.pattern);
+        }
+        b.appendNumber("blockedTxnid", wait.blockedTxnid);
+        b.appendNumber("blockingTxnid", wait.blockingTxnid);
+        b.append("bounds", wait.bounds);
+        b.appendNumber("waitMillis", wait.waitMillis);
+        b.appendDate("when", wait.when);
+        if (wait.timedOut) {
+            b.appendBool("timedOut", true);
+        }
+    }
+
+    void LockContentionProfile::append(BSONObjBuilder& b, int limit) const {
+        b.appendBool("enabled", enabled());
+        b.append("thresholdMillis", (int) thresholdMillis());
+        b.append("sampleMillis", (int) sampleMillis());
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        // longest total wait first, timeouts included
+        vector<pair<long long, const EntryMap::value_type*> > sorted;
+        sorted.reserve(_entries.size());
+        for (EntryMap::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+            const long long total = i->second.waits.totalMicros() +
+                                    i->second.timeoutMillis * 1000;
+            sorted.push_back(make_pair(-total, &*i));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        const size_t shown = std::min(sorted.size(), (size_t) std::max(limit, 0));
+        BSONArrayBuilder arr(b.subarrayStart("contention"));
+        for (size_t i = 0; i < shown; i++) {
+            const Key& key = sorted[i].second->first;
+            const Entry& e = sorted[i].second->second;
+            BSONObjBuilder eb(arr.subobjStart());
+            eb.append("ns", key.ns);
+            eb.append("index", key.index);
+            eb.append("pattern", key.pattern);
+            {
+                BSONObjBuilder wb(eb.subobjStart("waits"));
+                e.waits.appendSummary(wb);
+                wb.done();
+            }
+            eb.appendNumber("timeouts", e.timeouts);
+            {
+                BSONObjBuilder lb(eb.subobjStart("last"));
+                appendWait(lb, e.last);
+                lb.done();
+            }
+            eb.done();
+        }
+        arr.done();
+        b.appendBool("truncated", shown < sorted.size());
+        b.appendNumber("evicted", _evicted);
+
+        BSONArrayBuilder recent(b.subarrayStart("recent"));
+        for (std::deque<LockWait>::const_reverse_iterator i = _recent.rbegin(); i != _recent.rend(); ++i) {
+            BSONObjBuilder wb(recent.subobjStart());
+            appendWait(wb, *i);
+            wb.done();
+        }
+        recent.done();
+    }
+
+    void LockContentionProfile::parseDictionaryName(const StringData& dname, std::string* ns, std::string* index) {
+        const size_t dollar = dname.find(".$");
+        if (dollar == string::npos) {
+            *ns = dname.toString();
+            index->clear();
+            return;
+        }
+        StringData coll = dname.substr(0, dollar);
+        // partitions of a partitioned collection count as the collection
+        const size_t partition = coll.find("$$p");
+        if (partition != string::npos) {
+            coll = coll.substr(0, partition);
+        }
+        *ns = coll.toString();
+        *index = dname.substr(dollar + 2).toString();
+    }
+
+} // namespace mongo
@@ -0,0 +1,143 @@
+// lock_contention.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * One wait for a row lock in the ydb locktree.
+     */
+    struct LockWait {
+        LockWait() : blockedTxnid(0), blockingTxnid(0), waitMillis(0), timedOut(false) { }
+
+        /** the collection the dictionary belongs to */
+        std::string ns;
+        /** the index name, or the whole dictionary name if it isn't a collection's index */
+        std::string index;
+        /** QueryPattern of the blocked operation, empty if it isn't known */
+        std::string pattern;
+
+        long long blockedTxnid;
+        long long blockingTxnid;
+        /** the key range asked for, as [ left, right ] */
+        BSONObj bounds;
+
+        long long waitMillis;
+        Date_t when;
+        /** the request gave up after lockTimeout, rather than being granted */
+        bool timedOut;
+    };
+
+    /**
+     * Row lock contention, aggregated by (namespace, index, query pattern).
+     *
+     * storage/env.cpp samples the ydb's pending lock requests while the
+     * profiler is on, and records every wait that lasted at least
+     * thresholdMillis once it is over.  Requests that time out are recorded
+     * from the lock timeout callback instead, and only counted as timeouts;
+     * the sampler leaves them out.
+     *
+     * The table holds at most maxEntries patterns; when it is full, the one
+     * that waited least recently makes room.  The last maxRecent waits are
+     * kept whole, blocking transaction and key range included.
+     */
+    class LockContentionProfile : boost::noncopyable {
+    public:
+        static const size_t DEFAULT_MAX_ENTRIES = 500;
+        static const size_t DEFAULT_MAX_RECENT = 100;
+
+        explicit LockContentionProfile(size_t maxEntries = DEFAULT_MAX_ENTRIES,
+                                       size_t maxRecent = DEFAULT_MAX_RECENT);
+
+        bool enabled() const { return _enabled.load() != 0; }
+        void setEnabled(bool enabled) { _enabled.store(enabled ? 1 : 0); }
+        /** waits shorter than this aren't recorded */
+        unsigned thresholdMillis() const { return _thresholdMillis.load(); }
+        void setThresholdMillis(unsigned millis) { _thresholdMillis.store(millis); }
+        /** how often the pending lock requests are sampled */
+        unsigned sampleMillis() const { return _sampleMillis.load(); }
+        void setSampleMillis(unsigned millis) { _sampleMillis.store(millis); }
+
+        void record(const LockWait& wait);
+        void reset();
+
+        size_t size() const;
+
+        /**
+         * Appends the settings, the limit patterns that waited longest in
+         * total, and the recent waits, newest first.
+         */
+        void append(BSONObjBuilder& b, int limit) const;
+
+        /**
+         * Splits a dictionary name, "db.coll.$index" or "db.coll$$pN.$index"
+         * for a partition, into the collection and index name.  Anything
+         * else is its own ns with an empty index.
+         */
+        static void parseDictionaryName(const StringData& dname, std::string* ns, std::string* index);
+
+        static LockContentionProfile global;
+
+    private:
+        struct Key {
+            Key(const LockWait& wait) : ns(wait.ns), index(wait.index), pattern(wait.pattern) { }
+            bool operator<(const Key& other) const;
+            std::string ns;
+            std::string index;
+            std::string pattern;
+        };
+
+        struct Entry {
+            Entry() : timeouts(0), timeoutMillis(0) { }
+            LatencyDistribution waits;
+            long long timeouts;
+            long long timeoutMillis;
+            LockWait last;
+        };
+
+        typedef std::map<Key, Entry> EntryMap;
+
+        void evictOne_inlock();
+        static void appendWait(BSONObjBuilder& b, const LockWait& wait);
+
+        const size_t _maxEntries;
+        const size_t _maxRecent;
+
+        AtomicUInt32 _enabled;
+        AtomicUInt32 _thresholdMillis;
+        AtomicUInt32 _sampleMillis;
+
+        mutable SimpleMutex _mutex;
+        EntryMap _entries;
+        std::deque<LockWait> _recent;
+        long long _evicted;
+    };
+
+} // namespace mongo
@@ -0,0 +1,116 @@
+// lock_contention_test.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+
+#include "mongo/db/stats/lock_contention.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+
+    LockWait wait(const std::string& ns, const std::string& pattern, long long millis,
+                  unsigned long long when, bool timedOut = false) {
+        LockWait w;
+        w.ns = ns;
+        w.index = "_id_";
+        w.pattern = pattern;
+        w.blockedTxnid = 2;
+        w.blockingTxnid = 1;
+        w.bounds = BSON_ARRAY(BSON("$primaryKey" << 1) << BSON("$primaryKey" << 1));
+        w.waitMillis = millis;
+        w.when = Date_t(when);
+        w.timedOut = timedOut;
+        return w;
+    }
+
+    TEST(LockContentionProfile, ParseDictionaryName) {
+        std::string ns, index;
+        LockContentionProfile::parseDictionaryName("test.foo.$_id_", &ns, &index);
+        ASSERT_EQUALS("test.foo", ns);
+        ASSERT_EQUALS("_id_", index);
+
+        LockContentionProfile::parseDictionaryName("test.foo$$p3.$a_1", &ns, &index);
+        ASSERT_EQUALS("test.foo", ns);
+        ASSERT_EQUALS("a_1", index);
+
+        LockContentionProfile::parseDictionaryName("$ydb_internal", &ns, &index);
+        ASSERT_EQUALS("$ydb_internal", ns);
+        ASSERT_EQUALS("", index);
+    }
+
+    TEST(LockContentionProfile, Aggregates) {
+        LockContentionProfile profile;
+        profile.record(wait("test.foo", "{ a: 1 }", 100, 1));
+        profile.record(wait("test.foo", "{ a: 1 }", 300, 2));
+        profile.record(wait("test.foo", "{ a: 1 }", 4000, 3, true));
+        profile.record(wait("test.foo", "{ b: 1 }", 50, 4));
+        profile.record(wait("test.bar", "{ a: 1 }", 1000, 5));
+        ASSERT_EQUALS(3U, profile.size());
+
+        BSONObjBuilder b;
+        profile.append(b, 10);
+        BSONObj o = b.obj();
+        std::vector<BSONElement> entries = o["contention"].Array();
+        ASSERT_EQUALS(3U, entries.size());
+
+        // the timeout puts test.foo { a: 1 } first
+        BSONObj first = entries[0].Obj();
+        ASSERT_EQUALS("test.foo", first["ns"].String());
+        ASSERT_EQUALS("{ a: 1 }", first["pattern"].String());
+        ASSERT_EQUALS(2, first["waits"]["count"].numberLong());
+        ASSERT_EQUALS(400000, first["waits"]["totalMicros"].numberLong());
+        ASSERT_EQUALS(1, first["timeouts"].numberLong());
+        ASSERT_EQUALS("test.bar", entries[1].Obj()["ns"].String());
+        ASSERT_EQUALS("{ b: 1 }", entries[2].Obj()["pattern"].String());
+
+        std::vector<BSONElement> recent = o["recent"].Array();
+        ASSERT_EQUALS(5U, recent.size());
+        ASSERT_EQUALS(1000, recent[0].Obj()["waitMillis"].numberLong());
+
+        BSONObjBuilder limited;
+        profile.append(limited, 1);
+        BSONObj l = limited.obj();
+        ASSERT_EQUALS(1U, l["contention"].Array().size());
+        ASSERT(l["truncated"].trueValue());
+
+        profile.reset();
+        ASSERT_EQUALS(0U, profile.size());
+    }
+
+    TEST(LockContentionProfile, Bounded) {
+        LockContentionProfile profile(2, 3);
+        profile.record(wait("test.a", "", 100, 1));
+        profile.record(wait("test.b", "", 100, 2));
+        profile.record(wait("test.a", "", 100, 3));
+        // test.b waited least recently, so it goes
+        profile.record(wait("test.c", "", 100, 4));
+        ASSERT_EQUALS(2U, profile.size());
+
+        BSONObjBuilder b;
+        profile.append(b, 10);
+        BSONObj o = b.obj();
+        ASSERT_EQUALS(1, o["evicted"].numberLong());
+        std::vector<BSONElement> entries = o["contention"].Array();
+        for (size_t i = 0; i < entries.size(); i++) {
+            ASSERT_NOT_EQUALS("test.b", entries[i].Obj()["ns"].String());
+        }
+        ASSERT_EQUALS(3U, o["recent"].Array().size());
+    }
+
+} // namespace
@@ -0,0 +1,136 @@
+// op_latencies.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/op_latencies.h"
+
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+    const char* OpLatencies::_names[] = { "queries", "getmore", "insert", "update", "remove", "commands" };
+
+    OpLatencies::NamespaceLatencies::~NamespaceLatencies() {
+        for (int i = 0; i < NUM_TYPES; i++) {
+            delete _types[i].load();
+        }
+    }
+
+    void OpLatencies::NamespaceLatencies::record(int type, unsigned long long micros) {
+        LatencyHistogram* h = _types[type].load();
+        if (h == NULL) {
+            LatencyHistogram* made = new LatencyHistogram();
+            h = _types[type].compareAndSwap(NULL, made);
+            if (h == NULL) {
+                h = made;
+            }
+            else {
+                // someone else made it first
+                delete made;
+            }
+        }
+        h->record(micros);
+    }
+
+    void OpLatencies::record(const StringData& ns, int op, bool isCommand, unsigned long long micros) {
+        int type;
+        switch (op) {
+        case dbQuery: type = isCommand ? OP_COMMAND : OP_QUERY; break;
+        case dbGetMore: type = OP_GETMORE; break;
+        case dbInsert: type = OP_INSERT; break;
+        case dbUpdate: type = OP_UPDATE; break;
+        case dbDelete: type = OP_REMOVE; break;
+        default: return;
+        }
+
+        _global[type].record(micros);
+
+        if (ns.empty() || ns[0] == '?') {
+            return;
+        }
+        {
+            SimpleRWLock::Shared lk(_lock);
+            NamespaceMap::const_iterator it = _namespaces.find(ns);
+            if (it != _namespaces.end()) {
+                it->second->record(type, micros);
+                return;
+            }
+        }
+        SimpleRWLock::Exclusive lk(_lock);
+        NamespaceLatencies*& nl = _namespaces[ns];
+        if (nl == NULL) {
+            nl = new NamespaceLatencies();
+        }
+        nl->record(type, micros);
+    }
+
+    void OpLatencies::collectionDropped(const StringData& ns) {
+        SimpleRWLock::Exclusive lk(_lock);
+        NamespaceMap::const_iterator it = _namespaces.find(ns);
+        if (it != _namespaces.end()) {
+            delete it->second;
+            _namespaces.erase(ns);
+        }
+    }
+
+    void OpLatencies::appendGlobal(BSONObjBuilder& b, bool summary) const {
+        for (int i = 0; i < NUM_TYPES; i++) {
+            LatencyDistribution d;
+            _global[i].addTo(d);
+            BSONObjBuilder bb(b.subobjStart(_names[i]));
+            if (summary) {
+                d.appendSummary(bb);
+            }
+            else {
+                d.appendBuckets(bb);
+            }
+            bb.done();
+        }
+    }
+
+    void OpLatencies::appendNamespaces(BSONObjBuilder& b) const {
+        SimpleRWLock::Shared lk(_lock);
+
+        // sorted for the user, like Top
+        vector<string> names;
+        for (NamespaceMap::const_iterator it = _namespaces.begin(); it != _namespaces.end(); ++it) {
+            names.push_back(it->first);
+        }
+        std::sort(names.begin(), names.end());
+
+        for (size_t n = 0; n < names.size(); n++) {
+            const NamespaceLatencies* nl = _namespaces.find(names[n])->second;
+            BSONObjBuilder nb(b.subobjStart(names[n]));
+            for (int i = 0; i < NUM_TYPES; i++) {
+                const LatencyHistogram* h = nl->get(i);
+                if (h != NULL) {
+                    LatencyDistribution d;
+                    h->addTo(d);
+                    BSONObjBuilder bb(nb.subobjStart(_names[i]));
+                    d.appendBuckets(bb);
+                    bb.done();
+                }
+            }
+            nb.done();
+        }
+    }
+
+    OpLatencies OpLatencies::global;
+
+} // namespace mongo
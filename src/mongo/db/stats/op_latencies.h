@@ -0,0 +1,76 @@
+// op_latencies.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/util/concurrency/rwlock.h"
+#include "mongo/util/string_map.h"
+
+namespace mongo {
+
+    /**
+     * Latency histograms of completed operations, by type of operation, for
+     * the whole server and for each namespace.
+     *
+     * Top has the totals; this has the shape, so p99 and p99.9 can be read
+     * off it.  Recording an operation takes no locks beyond a shared lock
+     * on the map of namespaces.
+     */
+    class OpLatencies : boost::noncopyable {
+    public:
+        enum OpType { OP_QUERY, OP_GETMORE, OP_INSERT, OP_UPDATE, OP_REMOVE, OP_COMMAND, NUM_TYPES };
+        static const char* typeName(int type) { return _names[type]; }
+
+        OpLatencies() : _lock("OpLatencies") { }
+
+        void record(const StringData& ns, int op, bool isCommand, unsigned long long micros);
+        void collectionDropped(const StringData& ns);
+
+        /** the whole server's latencies by type, without buckets if summary */
+        void appendGlobal(BSONObjBuilder& b, bool summary) const;
+        /** each namespace's latencies by type, with buckets */
+        void appendNamespaces(BSONObjBuilder& b) const;
+
+        static OpLatencies global;
+
+    private:
+        static const char* _names[NUM_TYPES];
+
+        // A namespace's histograms are made the first time it sees an
+        // operation of their type.
+        class NamespaceLatencies : boost::noncopyable {
+        public:
+            ~NamespaceLatencies();
+            void record(int type, unsigned long long micros);
+            const LatencyHistogram* get(int type) const { return _types[type].load(); }
+        private:
+            AtomicWord<LatencyHistogram*> _types[NUM_TYPES];
+        };
+
+        StripedLatencyHistogram _global[NUM_TYPES];
+
+        // guards the map itself, not the histograms in it
+        mutable SimpleRWLock _lock;
+        typedef StringMap<NamespaceLatencies*> NamespaceMap;
+        NamespaceMap _namespaces;
+    };
+
+} // namespace mongo
@@ -21,6 +21,7 @@
 #include "mongo/db/stats/top.h"
 #include "mongo/util/net/message.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/stats/op_latencies.h"
 
 namespace mongo {
 
@@ -162,7 +163,11 @@ namespace mongo {
         TopCmd() : WebInformationCommand("top") {}
 
         virtual bool adminOnly() const { return true; }
-        virtual void help( stringstream& help ) const { help << "usage by collection, in micros "; }
+        virtual void help( stringstream& help ) const {
+            help << "usage by collection, in micros\n"
+                 << "{ top : 1, latencies : true } adds latency histograms by operation type, "
+                 << "for the server and each collection";
+        }
 
         virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
             {
@@ -171,6 +176,21 @@ namespace mongo {
                 Top::global.append( b );
                 b.done();
             }
+            if ( cmdObj["latencies"].trueValue() ) {
+                BSONObjBuilder b( result.subobjStart( "latencies" ) );
+                b.append( "note" , "all times in microseconds" );
+                {
+                    BSONObjBuilder bb( b.subobjStart( "global" ) );
+                    OpLatencies::global.appendGlobal( bb , false );
+                    bb.done();
+                }
+                {
+                    BSONObjBuilder bb( b.subobjStart( "namespaces" ) );
+                    OpLatencies::global.appendNamespaces( bb );
+                    bb.done();
+                }
+                b.done();
+            }
             return true;
         }
 
@@ -21,6 +21,7 @@
 #include "mongo/pch.h"
 #include "mongo/db/client.h"
 #include "mongo/db/curop.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/timer.h"
 
@@ -34,6 +35,10 @@ namespace mongo {
             void setPollMessagePrefix(const string &msg) {
                 _poll_extra.msg_prefix = msg;
             }
+            // How far along the build is, in thousandths, as of its last poll.
+            unsigned progress() const {
+                return _poll_extra.progress.load();
+            }
 
             struct poll_function_extra : public ExceptionSaver {
                 poll_function_extra() :
@@ -45,11 +50,13 @@ namespace mongo {
                 Timer timer;
                 long long lastReportSeconds;
                 double lastReportProgress;
+                AtomicUInt32 progress;
             };
             static int poll_function(void *extra, float progress) {
                 poll_function_extra *info = static_cast<poll_function_extra *>(extra);
                 try {
                     killCurrentOp.checkForInterrupt(info->c); // uasserts if we should stop
+                    info->progress.store((unsigned) (progress * 1000));
 
                     // Report every 1% of progress, but no more than once a second.
                     if (progress > info->lastReportProgress + 0.01) {
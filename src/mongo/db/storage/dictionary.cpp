@@ -91,55 +91,73 @@ namespace mongo {
             }
         }
 
+        // Attributes of a dictionary that may be given in its index info.
+        // Any that are missing (or null) are left as they were.
+        struct DictionaryAttributes {
+            int readPageSize;
+            int pageSize;
+            TOKU_COMPRESSION_METHOD compression;
+            bool hasReadPageSize;
+            bool hasPageSize;
+            bool hasCompression;
+
+            DictionaryAttributes(const string &dname, const BSONObj &info) :
+                readPageSize(65536),
+                pageSize(4 * 1024 * 1024),
+                compression(TOKU_ZLIB_WITHOUT_CHECKSUM_METHOD),
+                hasReadPageSize(false), hasPageSize(false), hasCompression(false) {
+                BSONElement e;
+                e = info["readPageSize"];
+                if (e.ok() && !e.isNull()) {
+                    readPageSize = e.numberInt();
+                    uassert(16743, "readPageSize must be a number > 0.", e.isNumber () && readPageSize > 0);
+                    hasReadPageSize = true;
+                    TOKULOG(1) << "db " << dname << ", using read page size " << readPageSize << endl;
+                }
+                e = info["pageSize"];
+                if (e.ok() && !e.isNull()) {
+                    pageSize = e.numberInt();
+                    uassert(16445, "pageSize must be a number > 0.", e.isNumber () && pageSize > 0);
+                    hasPageSize = true;
+                    TOKULOG(1) << "db " << dname << ", using page size " << pageSize << endl;
+                }
+                e = info["compression"];
+                if (e.ok() && !e.isNull()) {
+                    uassert(17063, "compression must be one of: lzma, quicklz, zlib, none.", e.type() == String);
+                    std::string str = e.String();
+                    if (str == "lzma") {
+                        compression = TOKU_LZMA_METHOD;
+                    } else if (str == "quicklz") {
+                        compression = TOKU_QUICKLZ_METHOD;
+                    } else if (str == "zlib") {
+                        compression = TOKU_ZLIB_WITHOUT_CHECKSUM_METHOD;
+                    } else if (str == "none") {
+                        compression = TOKU_NO_COMPRESSION;
+                    } else {
+                        uassert(16442, "compression must be one of: lzma, quicklz, zlib, none.", false);
+                    }
+                    hasCompression = true;
+                    TOKULOG(1) << "db " << dname << ", using compression method \"" << str << "\"" << endl;
+                }
+            }
+        };
+
         void Dictionary::open(const BSONObj &info,
                               const mongo::Descriptor &descriptor, const bool may_create,
                               const bool hot_index) {
-            int readPageSize = 65536;
-            int pageSize = 4 * 1024 * 1024;
-            TOKU_COMPRESSION_METHOD compression = TOKU_ZLIB_WITHOUT_CHECKSUM_METHOD;
-            BSONObj key_pattern = info["key"].Obj();
-            
-            BSONElement e;
-            e = info["readPageSize"];
-            if (e.ok() && !e.isNull()) {
-                readPageSize = e.numberInt();
-                uassert(16743, "readPageSize must be a number > 0.", e.isNumber () && readPageSize > 0);
-                TOKULOG(1) << "db " << _dname << ", using read page size " << readPageSize << endl;
-            }
-            e = info["pageSize"];
-            if (e.ok() && !e.isNull()) {
-                pageSize = e.numberInt();
-                uassert(16445, "pageSize must be a number > 0.", e.isNumber () && pageSize > 0);
-                TOKULOG(1) << "db " << _dname << ", using page size " << pageSize << endl;
-            }
-            e = info["compression"];
-            if (e.ok() && !e.isNull()) {
-                std::string str = e.String();
-                if (str == "lzma") {
-                    compression = TOKU_LZMA_METHOD;
-                } else if (str == "quicklz") {
-                    compression = TOKU_QUICKLZ_METHOD;
-                } else if (str == "zlib") {
-                    compression = TOKU_ZLIB_WITHOUT_CHECKSUM_METHOD;
-                } else if (str == "none") {
-                    compression = TOKU_NO_COMPRESSION;
-                } else {
-                    uassert(16442, "compression must be one of: lzma, quicklz, zlib, none.", false);
-                }
-                TOKULOG(1) << "db " << _dname << ", using compression method \"" << str << "\"" << endl;
-            }
+            const DictionaryAttributes attrs(_dname, info);
 
-            int r = _db->set_readpagesize(_db, readPageSize);
+            int r = _db->set_readpagesize(_db, attrs.readPageSize);
             if (r != 0) {
                 handle_ydb_error(r);
             }
 
-            r = _db->set_pagesize(_db, pageSize);
+            r = _db->set_pagesize(_db, attrs.pageSize);
             if (r != 0) {
                 handle_ydb_error(r);
             }
 
-            r = _db->set_compression_method(_db, compression);
+            r = _db->set_compression_method(_db, attrs.compression);
             if (r != 0) {
                 handle_ydb_error(r);
             }
@@ -172,6 +190,30 @@ namespace mongo {
             }
         }
 
+        void Dictionary::changeAttributes(const BSONObj &info) {
+            // Parse everything before changing anything, so a bad value changes nothing.
+            const DictionaryAttributes attrs(_dname, info);
+
+            if (attrs.hasReadPageSize) {
+                const int r = _db->change_readpagesize(_db, attrs.readPageSize);
+                if (r != 0) {
+                    handle_ydb_error(r);
+                }
+            }
+            if (attrs.hasPageSize) {
+                const int r = _db->change_pagesize(_db, attrs.pageSize);
+                if (r != 0) {
+                    handle_ydb_error(r);
+                }
+            }
+            if (attrs.hasCompression) {
+                const int r = _db->change_compression_method(_db, attrs.compression);
+                if (r != 0) {
+                    handle_ydb_error(r);
+                }
+            }
+        }
+
         int Dictionary::close() {
             int r = 0;
             if (_db) {
@@ -41,6 +41,12 @@ namespace mongo {
 
             int close();
 
+            // Change the compression method, pageSize and/or readPageSize of an
+            // open dictionary, for whichever of those fields info has. Only nodes
+            // written from now on are affected; existing nodes are rewritten with
+            // the new attributes as they are next flushed (or by optimize).
+            void changeAttributes(const BSONObj &info);
+
             class NeedsCreate : std::exception {};
 
         private:
@@ -36,11 +36,20 @@
 #include "mongo/db/client.h"
 #include "mongo/db/cmdline.h"
 #include "mongo/db/descriptor.h"
+#include "mongo/db/keygenerator.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/querypattern.h"
+#include "mongo/db/queryutil.h"
+#include "mongo/db/stats/checkpoint_stats.h"
+#include "mongo/db/stats/lock_contention.h"
 #include "mongo/db/storage/assert_ids.h"
 #include "mongo/db/storage/exception.h"
 #include "mongo/db/storage/key.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/background.h"
 #include "mongo/util/log.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -105,6 +114,11 @@ namespace mongo {
             dbt_array->size++;
         }
 
+        // Keys are copied out of the arena into DBTs that the ydb owns and
+        // reuses, so one arena per thread keeps key generation for puts and
+        // deletes free of per-key allocations.
+        static boost::thread_specific_ptr<KeyArena> generateKeysArena;
+
         static int generate_keys(DB *dest_db, DB *src_db,
                                  DBT_ARRAY *dest_keys,
                                  const DBT *src_key, const DBT *src_val) {
@@ -121,17 +135,23 @@ namespace mongo {
                 // because the one and only key is src_key
                 verify(dest_db != src_db);
 
-                // Generate keys for a secondary index.
-                BSONObjSet keys;
-                descriptor.generateKeys(obj, keys);
-                dbt_array_clear_and_resize(dest_keys, keys.size());
-                for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); i++) {
-                    const Key sKey(*i, &pk);
-                    dbt_array_push(dest_keys, sKey.buf(), sKey.size());
+                // Generate keys for a secondary index, already in the
+                // dictionary key format, into this thread's arena.
+                KeyArena *keys = generateKeysArena.get();
+                if (keys == NULL) {
+                    keys = new KeyArena();
+                    generateKeysArena.reset(keys);
+                }
+                keys->reset(&pk);
+                descriptor.generateKeys(obj, *keys);
+                keys->sortAndDedup(descriptor.ordering());
+                dbt_array_clear_and_resize(dest_keys, keys->size());
+                for (size_t i = 0; i < keys->size(); i++) {
+                    dbt_array_push(dest_keys, keys->keyData(i), keys->keySize(i));
                 }
                 // Set the multiKey bool if it's provided and we generated multiple keys.
                 // See NamespaceDetails::Indexer::Indexer()
-                if (dest_db->app_private != NULL && keys.size() > 1) {
+                if (dest_db->app_private != NULL && keys->size() > 1) {
                     bool *multiKey = reinterpret_cast<bool *>(dest_db->app_private);
                     if (!*multiKey) {
                         *multiKey = true;
@@ -200,6 +220,10 @@ namespace mongo {
                                               const DBT *left_key, const DBT *right_key,
                                               uint64_t blocking_txnid);
 
+        static void stop_lock_contention_sampler();
+        static void start_checkpointer();
+        static void stop_checkpointer();
+
         void startup(void) {
             tokulog() << "startup" << endl;
 
@@ -301,12 +325,13 @@ namespace mongo {
                 handle_ydb_error_fatal(r);
             }
 
-            const int checkpoint_period = cmdLine.checkpointPeriod;
-            r = env->checkpointing_set_period(env, checkpoint_period);
+            // Our Checkpointer runs checkpoints instead of the ydb's own thread.
+            r = env->checkpointing_set_period(env, 0);
             if (r != 0) {
                 handle_ydb_error_fatal(r);
             }
-            TOKULOG(1) << "checkpoint period set to " << checkpoint_period << " seconds." << endl;
+            TOKULOG(1) << "checkpoint period set to " << cmdLine.checkpointPeriod << " seconds, "
+                       << "target bandwidth " << (uint64_t) cmdLine.checkpointTargetBandwidth << " bytes/sec." << endl;
 
             const int cleaner_period = cmdLine.cleanerPeriod;
             r = env->cleaner_set_period(env, cleaner_period);
@@ -321,12 +346,16 @@ namespace mongo {
                 handle_ydb_error_fatal(r);
             }
             TOKULOG(1) << "cleaner iterations set to " << cleaner_iterations << "." << endl;
+
+            start_checkpointer();
         }
 
         void shutdown(void) {
             tokulog() << "shutdown" << endl;
             // It's possible for startup to fail before storage::startup() is called
             if (env != NULL) {
+                stop_lock_contention_sampler();
+                stop_checkpointer();
                 int r = env->close(env, 0);
                 if (r != 0) {
                     handle_ydb_error_fatal(r);
@@ -480,10 +509,53 @@ namespace mongo {
             }
         }
 
+        // The QueryPattern of what op is running, for the contention profile.
+        static string query_pattern(CurOp *op) {
+            if (op == NULL || !op->haveQuery()) {
+                return "";
+            }
+            const string ns = op->getNS();
+            const BSONObj query = op->query();
+            try {
+                if (NamespaceString(ns).isCommand()) {
+                    return mongoutils::str::stream() << "{ command: " << query.firstElementFieldName() << " }";
+                }
+                BSONObj filter = query;
+                if (query["$query"].isABSONObj()) {
+                    filter = query["$query"].Obj();
+                } else if (query["query"].isABSONObj()) {
+                    filter = query["query"].Obj();
+                }
+                return FieldRangeSet(ns.c_str(), filter, true, true).pattern().toString();
+            } catch (const DBException &) {
+                // not a query we can make a pattern of, still worth counting
+                return "";
+            }
+        }
+
+        static LockWait make_lock_wait(DB *db, uint64_t requesting_txnid,
+                                       const DBT *left_key, const DBT *right_key,
+                                       uint64_t blocking_txnid) {
+            LockWait wait;
+            LockContentionProfile::parseDictionaryName(get_index_name(db), &wait.ns, &wait.index);
+            wait.blockedTxnid = requesting_txnid;
+            wait.blockingTxnid = blocking_txnid;
+            BSONArrayBuilder bounds;
+            pretty_bounds(db, left_key, right_key, bounds);
+            wait.bounds = bounds.arr();
+            return wait;
+        }
+
+        // Requests lock_not_granted_callback recorded as timeouts, so the
+        // sampler doesn't record them again as waits.
+        static SimpleMutex timedOutRequestsMutex("timedOutLockRequests");
+        static set<uint64_t> timedOutRequests;
+
         static void lock_not_granted_callback(DB *db, uint64_t requesting_txnid,
                                               const DBT *left_key, const DBT *right_key,
                                               uint64_t blocking_txnid) {
-            CurOp *op = cc().curop();
+            // The ydb may wait for locks on threads of its own.
+            CurOp *op = haveClient() ? cc().curop() : NULL;
             if (op != NULL) {
                 BSONObjBuilder info;
                 info.append("index", get_index_name(db));
@@ -494,6 +566,356 @@ namespace mongo {
                 bounds.done();
                 op->debug().lockNotGrantedInfo = info.obj();
             }
+            LockContentionProfile &profile = LockContentionProfile::global;
+            if (profile.enabled()) {
+                LockWait wait = make_lock_wait(db, requesting_txnid, left_key, right_key, blocking_txnid);
+                wait.pattern = query_pattern(op);
+                wait.waitMillis = cmdLine.lockTimeout;
+                wait.when = Date_t(curTimeMillis64());
+                wait.timedOut = true;
+                profile.record(wait);
+                SimpleMutex::scoped_lock lk(timedOutRequestsMutex);
+                timedOutRequests.insert(requesting_txnid);
+            }
+        }
+
+        /**
+         * Samples the pending row lock requests every sampleMillis while the
+         * contention profiler is on.  A request seen waiting for at least
+         * thresholdMillis is followed until it's gone, and then recorded with
+         * the longest wait seen, so waits are short by up to sampleMillis.
+         *
+         * Requests are known by their transaction, which waits for one lock
+         * at a time.  The blocked operation's query pattern is looked up
+         * among the clients' root transactions; a child transaction's
+         * operation goes unnamed.
+         */
+        class LockContentionSampler : public BackgroundJob {
+        public:
+            LockContentionSampler() : BackgroundJob(false) { }
+            virtual string name() const { return "LockContentionSampler"; }
+
+            virtual void run() {
+                Client::initThread("lockContentionSampler");
+                Client &client = cc();
+                LockContentionProfile &profile = LockContentionProfile::global;
+                while (!inShutdown() && !_stop.load()) {
+                    if (profile.enabled()) {
+                        try {
+                            sample(profile);
+                        } catch (const DBException &e) {
+                            warning() << "lock contention sampler: " << e.what() << endl;
+                        }
+                    } else {
+                        _waiting.clear();
+                        _ending.clear();
+                        SimpleMutex::scoped_lock lk(timedOutRequestsMutex);
+                        timedOutRequests.clear();
+                    }
+                    sleepmillis(std::max(profile.sampleMillis(), 1U));
+                }
+                client.shutdown();
+            }
+
+            void stop() { _stop.store(1); }
+
+        private:
+            struct Waiter {
+                Waiter() : startTime(0) { }
+                uint64_t startTime;
+                LockWait wait;
+            };
+            typedef map<uint64_t, Waiter> WaiterMap;
+
+            struct iterate_lock_requests : public ExceptionSaver {
+                iterate_lock_requests(const WaiterMap &w, uint64_t n, uint64_t t) :
+                    waiting(w), now(n), threshold(t) { }
+                static int callback(DB *db, uint64_t requesting_txnid,
+                                    const DBT *left_key, const DBT *right_key,
+                                    uint64_t blocking_txnid, uint64_t start_time,
+                                    void *extra) {
+                    iterate_lock_requests *info = reinterpret_cast<iterate_lock_requests *>(extra);
+                    try {
+                        if (start_time > info->now || info->now - start_time < info->threshold) {
+                            return 0;
+                        }
+                        Waiter &w = info->current[requesting_txnid];
+                        WaiterMap::const_iterator prev = info->waiting.find(requesting_txnid);
+                        if (prev != info->waiting.end() && prev->second.startTime == start_time) {
+                            w = prev->second;
+                        } else {
+                            w.startTime = start_time;
+                            w.wait = make_lock_wait(db, requesting_txnid, left_key, right_key, blocking_txnid);
+                        }
+                        w.wait.blockingTxnid = blocking_txnid;
+                        w.wait.waitMillis = info->now - start_time;
+                        return 0;
+                    } catch (const std::exception &ex) {
+                        info->saveException(ex);
+                    }
+                    return -1;
+                }
+                const WaiterMap &waiting;
+                const uint64_t now;
+                const uint64_t threshold;
+                WaiterMap current;
+            };
+
+            void sample(LockContentionProfile &profile) {
+                // Taken before looking at the pending requests, so every
+                // request in it is already over, and ends now if not before.
+                set<uint64_t> timedOut;
+                {
+                    SimpleMutex::scoped_lock lk(timedOutRequestsMutex);
+                    timedOut.swap(timedOutRequests);
+                }
+
+                const uint64_t now = curTimeMillis64();
+                iterate_lock_requests e(_waiting, now, profile.thresholdMillis());
+                const int r = env->iterate_pending_lock_requests(env, iterate_lock_requests::callback, &e);
+                if (r != 0) {
+                    e.throwException();
+                    handle_ydb_error(r);
+                }
+
+                // Name the operations that just started waiting, outside the
+                // ydb's iteration so clientsMutex is never taken inside it.
+                map<long long, Waiter *> unnamed;
+                for (WaiterMap::iterator i = e.current.begin(); i != e.current.end(); ++i) {
+                    WaiterMap::const_iterator prev = _waiting.find(i->first);
+                    if (prev == _waiting.end() || prev->second.startTime != i->second.startTime) {
+                        unnamed[(long long) i->first] = &i->second;
+                    }
+                }
+                if (!unnamed.empty()) {
+                    scoped_lock bl(Client::clientsMutex);
+                    for (set<Client *>::const_iterator i = Client::clients.begin(); i != Client::clients.end(); ++i) {
+                        map<long long, Waiter *>::iterator w = unnamed.find((*i)->rootTransactionId());
+                        if (w != unnamed.end()) {
+                            w->second->wait.pattern = query_pattern((*i)->curop());
+                        }
+                    }
+                }
+
+                // Requests that were gone last time after waiting about
+                // lockTimeout, and haven't been recorded as timeouts since,
+                // were granted after all.
+                for (WaiterMap::const_iterator i = _ending.begin(); i != _ending.end(); ++i) {
+                    if (timedOut.count(i->first) == 0) {
+                        profile.record(i->second.wait);
+                    }
+                }
+                _ending.clear();
+
+                // Whatever isn't waiting anymore, or is waiting for something
+                // else now, is done.  Timeouts were recorded by the callback.
+                for (WaiterMap::const_iterator i = _waiting.begin(); i != _waiting.end(); ++i) {
+                    WaiterMap::const_iterator cur = e.current.find(i->first);
+                    if (cur == e.current.end() || cur->second.startTime != i->second.startTime) {
+                        if (timedOut.count(i->first) != 0) {
+                            continue;
+                        }
+                        LockWait wait = i->second.wait;
+                        wait.when = Date_t(now);
+                        if (now - i->second.startTime >= cmdLine.lockTimeout) {
+                            // It may have timed out, and the callback not run yet.
+                            _ending[i->first] = i->second;
+                            _ending[i->first].wait = wait;
+                        } else {
+                            profile.record(wait);
+                        }
+                    }
+                }
+                _waiting.swap(e.current);
+            }
+
+            AtomicUInt32 _stop;
+            WaiterMap _waiting;
+            // gone after about lockTimeout, decided next sample
+            WaiterMap _ending;
+        };
+
+        static SimpleMutex lockContentionSamplerMutex("lockContentionSampler");
+        static LockContentionSampler *lockContentionSampler = NULL;
+
+        void start_lock_contention_sampler() {
+            SimpleMutex::scoped_lock lk(lockContentionSamplerMutex);
+            if (lockContentionSampler == NULL) {
+                lockContentionSampler = new LockContentionSampler();
+                lockContentionSampler->go();
+            }
+        }
+
+        static void stop_lock_contention_sampler() {
+            SimpleMutex::scoped_lock lk(lockContentionSamplerMutex);
+            if (lockContentionSampler != NULL) {
+                lockContentionSampler->stop();
+                lockContentionSampler->wait();
+            }
+        }
+
+        // The engine status counters a checkpoint's cost is measured with.
+        static const char *checkpoint_status_keys[] = {
+            "CP_BEGIN_TIME",
+            "FT_DISK_FLUSH_LEAF_FOR_CHECKPOINT",
+            "FT_DISK_FLUSH_NONLEAF_FOR_CHECKPOINT",
+            "FT_DISK_FLUSH_LEAF_BYTES_FOR_CHECKPOINT",
+            "FT_DISK_FLUSH_NONLEAF_BYTES_FOR_CHECKPOINT",
+            "FT_DISK_FLUSH_LEAF_UNCOMPRESSED_BYTES_FOR_CHECKPOINT",
+            "FT_DISK_FLUSH_NONLEAF_UNCOMPRESSED_BYTES_FOR_CHECKPOINT",
+            NULL
+        };
+        typedef map<string, long long> StatusCounters;
+
+        static StatusCounters get_checkpoint_status_counters() {
+            uint64_t num_rows;
+            uint64_t max_rows;
+            uint64_t panic;
+            size_t panic_string_len = 128;
+            char panic_string[panic_string_len];
+            fs_redzone_state redzone_state;
+
+            int r = env->get_engine_status_num_rows(env, &max_rows);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            TOKU_ENGINE_STATUS_ROW_S mystat[max_rows];
+            r = env->get_engine_status(env, mystat, max_rows, &num_rows, &redzone_state, &panic, panic_string, panic_string_len, TOKU_ENGINE_STATUS);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            StatusCounters counters;
+            for (uint64_t i = 0; i < num_rows; i++) {
+                TOKU_ENGINE_STATUS_ROW row = &mystat[i];
+                for (const char **key = checkpoint_status_keys; *key != NULL; key++) {
+                    if (!mongoutils::str::equals(row->keyname, *key)) {
+                        continue;
+                    }
+                    if (row->type == UINT64) {
+                        counters[*key] = (long long) row->value.num;
+                    } else if (row->type == PARCOUNT) {
+                        counters[*key] = (long long) read_partitioned_counter(row->value.parcount);
+                    }
+                    break;
+                }
+            }
+            return counters;
+        }
+
+        // How much the named counters grew between before and after, or -1 if
+        // this ydb doesn't have one of them.
+        static long long counter_delta(const StatusCounters &before, const StatusCounters &after,
+                                       const char *key, const char *otherKey = NULL) {
+            long long delta = 0;
+            for (const char *k = key; k != NULL; k = (k == key ? otherKey : NULL)) {
+                StatusCounters::const_iterator b = before.find(k);
+                StatusCounters::const_iterator a = after.find(k);
+                if (b == before.end() || a == after.end() || a->second < b->second) {
+                    return -1;
+                }
+                delta += a->second - b->second;
+            }
+            return delta;
+        }
+
+        static SimpleMutex checkpointMutex("checkpoint");
+
+        // Runs a checkpoint and records what it cost in CheckpointStats::global.
+        static CheckpointRecord run_checkpoint(bool requested) {
+            // Only one at a time, so the counters' growth is all this checkpoint's.
+            SimpleMutex::scoped_lock lk(checkpointMutex);
+            const StatusCounters before = get_checkpoint_status_counters();
+            CheckpointRecord cp;
+            cp.start = jsTime();
+            cp.requested = requested;
+            Timer t;
+            // The zeros mean nothing (bdb-API artifacts).
+            int r = env->txn_checkpoint(env, 0, 0, 0);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            cp.millis = t.millis();
+            const StatusCounters after = get_checkpoint_status_counters();
+            cp.beginMicros = counter_delta(before, after, "CP_BEGIN_TIME");
+            cp.nodesWritten = counter_delta(before, after, "FT_DISK_FLUSH_LEAF_FOR_CHECKPOINT",
+                                            "FT_DISK_FLUSH_NONLEAF_FOR_CHECKPOINT");
+            cp.bytesWritten = counter_delta(before, after, "FT_DISK_FLUSH_LEAF_BYTES_FOR_CHECKPOINT",
+                                            "FT_DISK_FLUSH_NONLEAF_BYTES_FOR_CHECKPOINT");
+            cp.uncompressedBytesWritten = counter_delta(before, after, "FT_DISK_FLUSH_LEAF_UNCOMPRESSED_BYTES_FOR_CHECKPOINT",
+                                                        "FT_DISK_FLUSH_NONLEAF_UNCOMPRESSED_BYTES_FOR_CHECKPOINT");
+            CheckpointStats::global.record(cp);
+            TOKULOG(1) << "checkpoint took " << cp.millis << "ms, wrote " << cp.nodesWritten
+                       << " nodes, " << cp.bytesWritten << " bytes" << endl;
+            return cp;
+        }
+
+        /**
+         * Runs checkpoints in place of the ydb's checkpointer thread, so each
+         * one's cost is recorded and, with cmdLine.checkpointTargetBandwidth
+         * set, the next one can be scheduled by it (see
+         * CheckpointStats::pacedIntervalMillis).  Otherwise checkpoints are
+         * cmdLine.checkpointPeriod apart, as the ydb would run them.  Both
+         * are reread at least once a second, so setParameter takes effect
+         * without waiting out the old period.
+         */
+        class Checkpointer : public BackgroundJob {
+        public:
+            Checkpointer() : BackgroundJob(false) { }
+            virtual string name() const { return "Checkpointer"; }
+
+            virtual void run() {
+                Client::initThread("checkpointer");
+                Client &client = cc();
+                CheckpointRecord last;
+                Timer sinceLast;
+                while (!inShutdown() && !_stop.load()) {
+                    const unsigned long long periodMillis = cmdLine.checkpointPeriod * 1000ULL;
+                    if (periodMillis == 0) {
+                        // never checkpoint, until someone sets a period
+                        sleepmillis(1000);
+                        sinceLast.reset();
+                        continue;
+                    }
+                    const unsigned long long interval = last.bytesWritten < 0
+                            ? periodMillis
+                            : CheckpointStats::pacedIntervalMillis(last.bytesWritten, last.millis,
+                                                                   cmdLine.checkpointTargetBandwidth,
+                                                                   periodMillis);
+                    const unsigned long long elapsed = sinceLast.millis();
+                    if (elapsed < interval) {
+                        sleepmillis(std::min(interval - elapsed, 1000ULL));
+                        continue;
+                    }
+                    try {
+                        last = run_checkpoint(false);
+                    } catch (const DBException &e) {
+                        warning() << "checkpointer: " << e.what() << endl;
+                    }
+                    sinceLast.reset();
+                }
+                client.shutdown();
+            }
+
+            void stop() { _stop.store(1); }
+
+        private:
+            AtomicUInt32 _stop;
+        };
+
+        static Checkpointer *checkpointer = NULL;
+
+        static void start_checkpointer() {
+            if (checkpointer == NULL) {
+                checkpointer = new Checkpointer();
+                checkpointer->go();
+            }
+        }
+
+        static void stop_checkpointer() {
+            if (checkpointer != NULL) {
+                checkpointer->stop();
+                checkpointer->wait();
+            }
         }
 
         void get_pending_lock_request_status(BSONObjBuilder &status) {
@@ -601,11 +1023,7 @@ namespace mongo {
         }
 
         void checkpoint() {
-            // Run a checkpoint. The zeros mean nothing (bdb-API artifacts).
-            int r = env->txn_checkpoint(env, 0, 0, 0);
-            if (r != 0) {
-                handle_ydb_error(r);
-            }
+            run_checkpoint(true);
         }
 
         void set_log_flush_interval(uint32_t period_ms) {
@@ -615,14 +1033,16 @@ namespace mongo {
         }
 
         void set_checkpoint_period(uint32_t period_seconds) {
+            // The Checkpointer picks this up.
             cmdLine.checkpointPeriod = period_seconds;
-            int r = env->checkpointing_set_period(env, period_seconds);
-            if (r != 0) {
-                handle_ydb_error(r);
-            }
             TOKULOG(1) << "checkpoint period set to " << period_seconds << " seconds." << endl;
         }
 
+        void set_checkpoint_target_bandwidth(uint64_t bytes_per_second) {
+            cmdLine.checkpointTargetBandwidth = bytes_per_second;
+            TOKULOG(1) << "checkpoint target bandwidth set to " << bytes_per_second << " bytes/sec." << endl;
+        }
+
         void set_cleaner_period(uint32_t period_seconds) {
             cmdLine.cleanerPeriod = period_seconds;
             int r = env->cleaner_set_period(env, period_seconds);
@@ -38,11 +38,15 @@ namespace mongo {
         void get_status(BSONObjBuilder &status);
         void get_pending_lock_request_status(BSONObjBuilder &status);
         void get_live_transaction_status(BSONObjBuilder &status);
+        // Starts sampling pending lock requests for LockContentionProfile::global, once.
+        void start_lock_contention_sampler();
         void log_flush();
         void checkpoint();
 
         void set_log_flush_interval(uint32_t period_ms);
         void set_checkpoint_period(uint32_t period_seconds);
+        // 0 goes back to checkpointing every checkpoint period.
+        void set_checkpoint_target_bandwidth(uint64_t bytes_per_second);
         void set_cleaner_period(uint32_t period_seconds);
         void set_cleaner_iterations(uint32_t num_iterations);
 
@@ -20,6 +20,10 @@
 
 #include <db.h>
 
+#include <boost/scoped_array.hpp>
+
+#include "mongo/util/buf_arena.h"
+
 // The dictionary key format is as follows:
 //
 //    Primary key:
@@ -105,7 +109,7 @@ namespace mongo {
             KeyV1Owned(const KeyV1& rhs);
 
         private:
-            StackBufBuilder b;
+            StackArenaBufBuilder b;
             void traditional(const BSONObj& obj); // store as traditional bson not as compact format
         };
 
@@ -209,6 +213,7 @@ namespace mongo {
             }
 
             void reset(const BSONObj &other, const BSONObj *pk) {
+                _owned.reset();
                 _b.reset();
                 KeyV1Owned otherOwned(other);
                 _b.appendBuf(otherOwned.data(), otherOwned.dataSize());
@@ -220,6 +225,7 @@ namespace mongo {
             }
 
             void reset(const KeyV1 &other, const BSONObj *pk) {
+                _owned.reset();
                 _b.reset();
                 _b.appendBuf(other.data(), other.dataSize());
                 if (pk != NULL) {
@@ -229,6 +235,17 @@ namespace mongo {
                 _size = _b.len();
             }
 
+            // Copies the key into a heap buffer of its own, like
+            // BSONObj::getOwned(). A key held past the current call would
+            // otherwise pin a whole block of the operation's BufArena.
+            void makeOwned() {
+                char *owned = new char[_size];
+                memcpy(owned, _buf, _size);
+                _owned.reset(owned);
+                _buf = owned;
+                _b.reset(StackAllocator::SZ);
+            }
+
             BSONObj key() const {
                 BufBuilder bb;
                 return key(bb).getOwned();
@@ -254,7 +271,8 @@ namespace mongo {
             }
 
         private:
-            StackBufBuilder _b;
+            StackArenaBufBuilder _b;
+            boost::scoped_array<char> _owned;
             const char *_buf;
             size_t _size;
         };
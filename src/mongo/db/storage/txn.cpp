@@ -23,9 +23,12 @@
 #include "mongo/db/client.h"
 #include "mongo/db/cmdline.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/util/tracepoint.h"
 
 namespace mongo {
 
+    MONGO_TRACEPOINT_DECLARE(ydbCommit);
+
     namespace storage {
 
         static DB_TXN *start_txn(DB_TXN *parent, int flags) {
@@ -38,6 +41,7 @@ namespace mongo {
         }
 
         static void commit_txn(DB_TXN *db_txn, int flags) {
+            MONGO_TRACE(ydbCommit);
             int r = db_txn->commit(db_txn, flags);
             if (r != 0) {
                 handle_ydb_error(r);
@@ -60,10 +60,12 @@ namespace mongo {
 
                 // We cannot be holding a read lock at this point, since we're in one of two situations:
                 // - Single-statement txn is aborting. If it did fileops, it had to hold a write lock,
-                //   and therefore it still is.
+                //   and therefore it still is. That may be a Lock::CollectionWrite, which holds the
+                //   collection exclusively but the database only read locked.
                 // - Multi-statement txn is aborting. The only way to do this is through a command that
                 //   takes no lock, therefore we're not read locked.
-                verify(!Lock::isReadLocked());
+                const bool collectionLocked = Lock::isCollectionWriteLocked(ns);
+                verify(collectionLocked || !Lock::isReadLocked());
 
                 // If something is already write locked we must be in the single-statement case, so
                 // assert that the write locked namespace is this one.
@@ -73,7 +75,7 @@ namespace mongo {
 
                 // The ydb requires that a txn closes any dictionaries it created beforeaborting.
                 // Hold a write lock while trying to close the namespace in the nsindex.
-                Lock::DBWrite lk(ns);
+                scoped_ptr<Lock::DBWrite> lk(collectionLocked ? NULL : new Lock::DBWrite(ns));
                 if (dbHolder().__isLoaded(ns, dbpath)) {
                     scoped_ptr<Client::Context> ctx(cc().getContext() == NULL ?
                                                     new Client::Context(ns) : NULL);
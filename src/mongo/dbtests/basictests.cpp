@@ -22,6 +22,8 @@
 
 #include "dbtests.h"
 #include "mongo/util/base64.h"
+#include "mongo/db/storage/key.h"
+#include "mongo/util/buf_arena.h"
 #include "mongo/util/array.h"
 #include "mongo/util/text.h"
 #include "mongo/util/queue.h"
@@ -190,6 +192,108 @@ namespace BasicTests {
 
     }
 
+    namespace BufArenaTests {
+
+        /** Stack-scoped builders reuse the same block over and over. */
+        class Reuse {
+        public:
+            void run() {
+                BufArena arena;
+                BufArena::Scope scope( arena );
+                for ( int i = 0; i < 10000; i++ ) {
+                    ArenaStringBuilder sb;
+                    sb << "x" << i;
+                    ArenaBufBuilder bb;
+                    for ( int j = 0; j < 100; j++ ) {
+                        bb.appendNum( j );
+                    }
+                    ASSERT_EQUALS( 400, bb.len() );
+                    ASSERT_EQUALS( 99, reinterpret_cast<const int*>( bb.buf() )[99] );
+                    ASSERT_EQUALS( string( str::stream() << "x" << i ), sb.str() );
+                }
+                ASSERT( arena.stats().allocations >= 20000 );
+                ASSERT_EQUALS( 1, arena.stats().mallocs );
+            }
+        };
+
+        /** Buffers that outlive the operation are still good, and freed later. */
+        class OutlivesScope {
+        public:
+            void run() {
+                BufArena arena;
+                scoped_ptr<StackArenaBufBuilder> b;
+                {
+                    BufArena::Scope scope( arena );
+                    b.reset( new StackArenaBufBuilder() );
+                    for ( int i = 0; i < 1000; i++ ) {
+                        b->appendNum( i );
+                    }
+                    {
+                        // nested operations share the arena, and don't reset it
+                        BufArena::Scope nested( arena );
+                        ArenaBufBuilder other;
+                        other.appendNum( 1 );
+                    }
+                    ASSERT_EQUALS( 999, reinterpret_cast<const int*>( b->buf() )[999] );
+                }
+                {
+                    BufArena::Scope scope( arena );
+                    ArenaBufBuilder other( 4000 );
+                    memset( other.skip( 4000 ), 0xff, 4000 );
+                    ASSERT_EQUALS( 999, reinterpret_cast<const int*>( b->buf() )[999] );
+                }
+                ASSERT_EQUALS( 0, reinterpret_cast<const int*>( b->buf() )[0] );
+                b.reset();
+            }
+        };
+
+        /** With no arena installed the buffers come from malloc. */
+        class NoArena {
+        public:
+            void run() {
+                ASSERT( BufArena::current() == NULL );
+                StackArenaBufBuilder b;
+                for ( int i = 0; i < 1000; i++ ) {
+                    b.appendNum( i );
+                }
+                ASSERT_EQUALS( 999, reinterpret_cast<const int*>( b.buf() )[999] );
+                BufArena arena;
+                {
+                    BufArena::Scope scope( arena );
+                    ASSERT( BufArena::current() == &arena );
+                    // grown inside the arena from a malloc'd buffer
+                    b.appendNum( 1000 );
+                    ASSERT_EQUALS( 1000, reinterpret_cast<const int*>( b.buf() )[1000] );
+                }
+                ASSERT( BufArena::current() == NULL );
+                ASSERT_EQUALS( 0, arena.stats().allocations );
+            }
+        };
+
+        /** A key copied out of the arena doesn't keep its block from being reused. */
+        class OwnedKey {
+        public:
+            void run() {
+                BufArena arena;
+                const BSONObj big = BSON( "" << string( 4000, 'x' ) );
+                scoped_ptr<storage::Key> key;
+                {
+                    BufArena::Scope scope( arena );
+                    key.reset( new storage::Key( big, NULL ) );
+                    key->makeOwned();
+                }
+                {
+                    BufArena::Scope scope( arena );
+                    ArenaBufBuilder other( 4000 );
+                    memset( other.skip( 4000 ), 0xff, 4000 );
+                }
+                ASSERT_EQUALS( 1, arena.stats().mallocs );
+                ASSERT_EQUALS( string( 4000, 'x' ), key->key().firstElement().String() );
+            }
+        };
+
+    } // namespace BufArenaTests
+
     class sleeptest {
     public:
 
@@ -658,6 +762,11 @@ namespace BasicTests {
             add< stringbuildertests::reset1 >();
             add< stringbuildertests::reset2 >();
 
+            add< BufArenaTests::Reuse >();
+            add< BufArenaTests::OutlivesScope >();
+            add< BufArenaTests::NoArena >();
+            add< BufArenaTests::OwnedKey >();
+
             add< sleeptest >();
             add< SleepBackoffTest >();
             add< AssertTests >();
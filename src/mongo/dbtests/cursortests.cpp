@@ -638,9 +638,71 @@ namespace CursorTests {
                     // pin is destroyed safely, even though its ClientCursor was already destroyed.
                 }
             };
+
+            /** A cursor's idle time starts over when it's unpinned. */
+            class UnpinResetsIdleTime : public Base {
+            public:
+                void run() {
+                    ClientCursor::idleTimeReport( 300000 );
+                    {
+                        ClientCursor::Pin pin( cursorid() );
+                        ASSERT_LESS_THAN_OR_EQUALS( 300000U, pin.c()->idleTime() );
+                        ASSERT( !pin.c()->shouldTimeout( 300001 ) );
+                    }
+                    ClientCursor::Pin pin( cursorid() );
+                    ASSERT_EQUALS( 0U, pin.c()->idleTime() );
+                }
+            };
             
         } // namespace Pin
 
+        /** Cursors spread over the registry's partitions, and are all found again. */
+        class Registry {
+        public:
+            Registry() :
+                _transaction(DB_SERIALIZABLE),
+                _ctx( ns() ) {
+            }
+            ~Registry() {
+                _transaction.commit();
+            }
+            void run() {
+                const unsigned before = ClientCursor::numCursors();
+                vector<ClientCursor*> cursors;
+                set<CursorId> ids;
+                set<CursorId> partitions;
+                for ( int i = 0; i < 200; i++ ) {
+                    cursors.push_back( new ClientCursor( 0, BasicCursor::make( nsdetails(ns()) ), ns() ) );
+                    CursorId id = cursors.back()->cursorid();
+                    ASSERT( id > 0 );
+                    ids.insert( id );
+                    partitions.insert( id & 63 );
+                }
+                ASSERT_EQUALS( 200U, ids.size() );
+                ASSERT_LESS_THAN( 32U, partitions.size() );
+                ASSERT_EQUALS( before + 200, ClientCursor::numCursors() );
+
+                for ( set<CursorId>::const_iterator i = ids.begin(); i != ids.end(); ++i ) {
+                    ClientCursor::Pin pin( *i );
+                    ASSERT( pin.c() );
+                    ASSERT_EQUALS( *i, pin.c()->cursorid() );
+                }
+
+                set<CursorId> found;
+                ClientCursor::find( ns(), found );
+                ASSERT( std::includes( found.begin(), found.end(), ids.begin(), ids.end() ) );
+
+                ASSERT( ClientCursor::erase( cursors[0]->cursorid() ) );
+                ASSERT_EQUALS( before + 199, ClientCursor::numCursors() );
+                ClientCursor::invalidate( ns() );
+                ASSERT_EQUALS( before, ClientCursor::numCursors() );
+            }
+        private:
+            Client::Transaction _transaction;
+            Client::WriteContext _ctx;
+        };
+
+
     } // namespace ClientCursor
     
     class All : public Suite {
@@ -665,6 +727,8 @@ namespace CursorTests {
             add<ClientCursor::Pin::PinCursor>();
             add<ClientCursor::Pin::PinTwice>();
             add<ClientCursor::Pin::CursorDeleted>();
+            add<ClientCursor::Pin::UnpinResetsIdleTime>();
+            add<ClientCursor::Registry>();
         }
     } myall;
 } // namespace CursorTests
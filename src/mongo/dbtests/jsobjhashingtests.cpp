@@ -21,6 +21,7 @@
 #include "mongo/db/hasher.h"
 #include "mongo/db/json.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
 
 namespace JsobjHashingTests {
 
@@ -156,6 +157,94 @@ namespace JsobjHashingTests {
         }
     };
 
+    /** The squashing rules don't depend on the hash function. */
+    class Murmur3HashingTest {
+    public:
+        long long hash( const BSONObj& o , int seed = 0 ) {
+            return BSONElementHasher::hash64( o.firstElement() , seed , HASH_VERSION_MURMUR3 );
+        }
+        void run() {
+            //the value the server checks at startup
+            ASSERT_EQUALS( 8715208212397937794LL , hash( BSON( "check" << 42 ) ) );
+
+            //not the same function as version 0
+            BSONObj p1 = BSON( "a" << 3 );
+            ASSERT_NOT_EQUALS( BSONElementHasher::hash64( p1.firstElement() , 0 ) , hash( p1 ) );
+
+            //numbers squash the same way
+            ASSERT_EQUALS( hash( p1 ) , hash( BSON( "a" << 3LL ) ) );
+            ASSERT_EQUALS( hash( p1 ) , hash( BSON( "a" << 3.1 ) ) );
+            ASSERT_NOT_EQUALS( hash( p1 ) , hash( BSON( "a" << 4 ) ) );
+            ASSERT_NOT_EQUALS( hash( p1 ) , hash( BSON( "a" << "3" ) ) );
+            ASSERT_EQUALS( hash( fromjson( "{x : {a : 3 , b : [ 3.1, {c : 3}]}}" ) ) ,
+                           hash( fromjson( "{x : {a : 3.1 , b : [3, {c : 3.0}]}}" ) ) );
+            ASSERT_NOT_EQUALS( hash( fromjson( "{a : {'0' : 0 , '1' : 1}}" ) ) ,
+                               hash( fromjson( "{a : [0,1]}" ) ) );
+
+            //seed makes a difference
+            ASSERT_NOT_EQUALS( hash( p1 ) , hash( p1 , 1 ) );
+
+            //so do oids
+            ASSERT_NOT_EQUALS( hash( BSONObjBuilder().genOID().obj() ) ,
+                               hash( BSONObjBuilder().genOID().obj() ) );
+
+            //long strings go through the heap part of the buffer
+            string big( 4096 , 'x' );
+            string big2 = big;
+            big2[4000] = 'y';
+            ASSERT_NOT_EQUALS( hash( BSON( "a" << big ) ) , hash( BSON( "a" << big2 ) ) );
+            ASSERT_EQUALS( hash( BSON( "a" << big ) ) , hash( BSON( "b" << big ) ) );
+        }
+    };
+
+    /** Sequential keys, the usual shard key, should spread evenly over chunks. */
+    class Murmur3DistributionTest {
+    public:
+        void run() {
+            const int buckets = 64;
+            const int n = buckets * 1000;
+            vector<int> counts( buckets , 0 );
+            for ( int i = 0; i < n; i++ ) {
+                BSONObj o = BSON( "a" << i );
+                unsigned long long h = BSONElementHasher::hash64( o.firstElement() , 0 ,
+                                                                  HASH_VERSION_MURMUR3 );
+                // top bits, as chunk ranges split the hash space
+                counts[h >> 58]++;
+            }
+            // chi-squared with 63 degrees of freedom is under 110 well beyond p = 0.999
+            double chi2 = 0;
+            const double expected = n / buckets;
+            for ( int b = 0; b < buckets; b++ ) {
+                chi2 += ( counts[b] - expected ) * ( counts[b] - expected ) / expected;
+            }
+            ASSERT_LESS_THAN( chi2 , 110.0 );
+        }
+    };
+
+    /** Not an assertion, just something to look at in the log. */
+    class HashingThroughput {
+    public:
+        void run() {
+            vector<BSONObj> keys;
+            for ( int i = 0; i < 10000; i++ ) {
+                keys.push_back( BSON( "a" << i ) );
+                keys.push_back( BSON( "a" << OID::gen() ) );
+                keys.push_back( BSON( "a" << ( string( "user" ) + BSONObjBuilder::numStr( i ) ) ) );
+            }
+            for ( int v = HASH_VERSION_MD5; v < NEXT_HASH_VERSION; v++ ) {
+                long long sum = 0;
+                Timer t;
+                for ( int pass = 0; pass < 10; pass++ ) {
+                    for ( vector<BSONObj>::const_iterator it = keys.begin(); it != keys.end(); ++it ) {
+                        sum += BSONElementHasher::hash64( it->firstElement() , 0 , v );
+                    }
+                }
+                const double ns = t.micros() * 1000.0 / ( 10 * keys.size() );
+                log() << "hashVersion " << v << ": " << ns << " ns/key (" << sum << ")" << endl;
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "jsobjhashing" ) {
@@ -163,6 +252,9 @@ namespace JsobjHashingTests {
 
         void setupTests() {
             add< BSONElementHashingTest >();
+            add< Murmur3HashingTest >();
+            add< Murmur3DistributionTest >();
+            add< HashingThroughput >();
         }
     } myall;
 
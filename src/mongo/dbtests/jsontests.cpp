@@ -21,6 +21,7 @@
 #include "pch.h"
 #include "../db/jsobj.h"
 #include "../db/json.h"
+#include "../platform/random.h"
 
 #include "dbtests.h"
 
@@ -1457,6 +1458,137 @@ namespace JsonTests {
             }
         };
 
+
+        class NumberBoundaries {
+        public:
+            void run() {
+                ASSERT_EQUALS( NumberInt, fromjson( "{ a : -0 }" )[ "a" ].type() );
+                ASSERT_EQUALS( 0, fromjson( "{ a : -0 }" )[ "a" ].numberInt() );
+                ASSERT_EQUALS( NumberInt, fromjson( "{ a : 2147483647 }" )[ "a" ].type() );
+                ASSERT_EQUALS( NumberInt, fromjson( "{ a : -2147483648 }" )[ "a" ].type() );
+                ASSERT_EQUALS( NumberLong, fromjson( "{ a : 2147483648 }" )[ "a" ].type() );
+                ASSERT_EQUALS( 2147483648LL, fromjson( "{ a : 2147483648 }" )[ "a" ].numberLong() );
+                ASSERT_EQUALS( 999999999999999999LL,
+                               fromjson( "{ a : 999999999999999999 }" )[ "a" ].numberLong() );
+                ASSERT_EQUALS( -1000000000000000000LL,
+                               fromjson( "{ a : -1000000000000000000 }" )[ "a" ].numberLong() );
+                ASSERT_EQUALS( NumberDouble, fromjson( "{ a : 9223372036854775808 }" )[ "a" ].type() );
+                ASSERT_EQUALS( NumberDouble, fromjson( "{ a : 0x10 }" )[ "a" ].type() );
+                ASSERT_EQUALS( 16.0, fromjson( "{ a : 0x10 }" )[ "a" ].numberDouble() );
+                ASSERT_EQUALS( NumberDouble, fromjson( "{ a : 1e3 }" )[ "a" ].type() );
+                ASSERT_EQUALS( NumberDouble, fromjson( "{ a : 12. }" )[ "a" ].type() );
+                ASSERT_EQUALS( NumberInt, fromjson( "{ a : [ 1,2 ] }" )[ "a" ].Obj()[ "1" ].type() );
+                ASSERT_THROWS( fromjson( "{ a : 12" ), MsgAssertionException );
+            }
+        };
+
+        /**
+         * Round trips random documents, with strings long enough to cross the
+         * blocks the parser scans at once, through jsonString and fromjson.
+         */
+        class RandomRoundTrip {
+        public:
+            void run() {
+                PseudoRandom rand( 1234 );
+                for ( int i = 0; i < 1000; ++i ) {
+                    BSONObjBuilder b;
+                    int nfields = rand.nextInt32( 8 ) + 1;
+                    for ( int j = 0; j < nfields; ++j ) {
+                        string name = str::stream() << "f" << j;
+                        switch ( rand.nextInt32( 5 ) ) {
+                        case 0: {
+                            string val;
+                            int len = rand.nextInt32( 100 );
+                            for ( int k = 0; k < len; ++k ) {
+                                val += static_cast<char>( rand.nextInt32( 255 ) + 1 );
+                            }
+                            b.append( name, val );
+                            break;
+                        }
+                        case 1:
+                            b.append( name, rand.nextInt32( 2000000 ) - 1000000 );
+                            break;
+                        case 2:
+                            b.append( name, ( static_cast<long long>( rand.nextInt32( 1 << 30 ) ) << 33 ) +
+                                            rand.nextInt32( 1 << 30 ) );
+                            break;
+                        case 3:
+                            b.append( name, -( static_cast<long long>( rand.nextInt32( 1 << 30 ) + 2 ) << 30 ) );
+                            break;
+                        default:
+                            b.append( name, ( 2 * rand.nextInt32( 1000000 ) + 1 ) / 64.0 );
+                            break;
+                        }
+                    }
+                    BSONObj o = b.obj();
+                    ASSERT_EQUALS( o, fromjson( o.jsonString( Strict ) ) );
+                    ASSERT_EQUALS( o, fromjson( o.jsonString( TenGen ) ) );
+                }
+            }
+        };
+
+        class RandomUnquotedFields {
+        public:
+            void run() {
+                const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_$";
+                PseudoRandom rand( 5678 );
+                for ( int i = 0; i < 200; ++i ) {
+                    string name( 1, chars[ rand.nextInt32( 26 ) ] );
+                    int len = rand.nextInt32( 40 );
+                    for ( int k = 0; k < len; ++k ) {
+                        name += chars[ rand.nextInt32( sizeof( chars ) - 1 ) ];
+                    }
+                    BSONObj o = fromjson( "{ " + name + " : 1, " + name + "x:2}" );
+                    ASSERT_EQUALS( BSON( name << 1 << name + "x" << 2 ), o );
+                }
+            }
+        };
+
+        /** Raw control characters are rejected wherever they fall in a string. */
+        class ControlCharacters {
+        public:
+            void run() {
+                for ( int len = 0; len < 40; ++len ) {
+                    for ( int c = 1; c <= 0x1F; c += 7 ) {
+                        string val( len, 'x' );
+                        val += static_cast<char>( c );
+                        val += "yyyyyyyyyyyyyyyyyyyy";
+                        ASSERT_THROWS( fromjson( "{ a : \"" + val + "\" }" ), MsgAssertionException );
+                        ASSERT_THROWS( fromjson( "{ a : '" + val + "' }" ), MsgAssertionException );
+                    }
+                    // an escaped quote or backslash at every offset
+                    string val( len, 'x' );
+                    ASSERT_EQUALS( BSON( "a" << val + "\"z\\" + val ),
+                                   fromjson( "{ a : \"" + val + "\\\"z\\\\" + val + "\" }" ) );
+                    ASSERT_THROWS( fromjson( "{ a : \"" + val ), MsgAssertionException );
+                }
+            }
+        };
+
+        /** Not a correctness test: logs how fast a large document parses. */
+        class Throughput {
+        public:
+            void run() {
+                BSONObjBuilder b;
+                for ( int i = 0; i < 1000; ++i ) {
+                    BSONObjBuilder sub( b.subobjStart( BSONObjBuilder::numStr( i ) ) );
+                    sub.append( "name", string( 64, 'a' + i % 26 ) );
+                    sub.append( "count", i );
+                    sub.append( "total", i * 1000000007LL );
+                    sub.append( "ratio", i / 3.0 );
+                    sub.done();
+                }
+                const string json = b.obj().jsonString();
+                const int iterations = 50;
+                Timer t;
+                for ( int i = 0; i < iterations; ++i ) {
+                    ASSERT( fromjson( json ).valid() );
+                }
+                const unsigned long long micros = std::max( t.micros(), 1ULL );
+                log() << "fromjson: " << ( json.size() * iterations ) / micros << " MB/s" << endl;
+            }
+        };
+
     } // namespace FromJsonTests
 
     class All : public Suite {
@@ -1590,6 +1722,11 @@ namespace JsonTests {
             add< FromJsonTests::EmbeddedDatesFormat3 >();
             add< FromJsonTests::NullString >();
             add< FromJsonTests::NullFieldUnquoted >();
+            add< FromJsonTests::NumberBoundaries >();
+            add< FromJsonTests::RandomRoundTrip >();
+            add< FromJsonTests::RandomUnquotedFields >();
+            add< FromJsonTests::ControlCharacters >();
+            add< FromJsonTests::Throughput >();
         }
     } myall;
 
@@ -21,6 +21,7 @@
 #include "mongo/pch.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/json.h"
+#include "mongo/db/keygenerator.h"
 #include "mongo/db/queryutil.h"
 
 #include "mongo/dbtests/dbtests.h"
@@ -933,6 +934,69 @@ namespace NamespaceTests {
         protected:
             BSONObj key() const { return BSON( "1" << 1 ); }
         };
+
+        /** A KeyArena holds the same keys as a BSONObjSet, encoded with the pk. */
+        class KeyArenaMatchesKeySet {
+        public:
+            void run() {
+                const BSONObj keyPattern = BSON( "a" << 1 << "b" << 1 );
+                const Ordering ordering = Ordering::make( keyPattern );
+                const BSONObj pk = BSON( "" << 7 );
+                KeyArena arena;
+                check( arena, fromjson( "{a:[3,1,2,1,3.0],b:5}" ), pk, ordering );
+                check( arena, fromjson( "{a:[],b:[]}" ), pk, ordering );
+                check( arena, fromjson( "{b:'x'}" ), pk, ordering );
+                check( arena, fromjson( "{a:{c:1},b:[null,null,'y']}" ), pk, ordering );
+            }
+        private:
+            void check( KeyArena &arena, const BSONObj &obj, const BSONObj &pk, const Ordering &ordering ) {
+                vector<const char *> fields;
+                fields.push_back( "a" );
+                fields.push_back( "b" );
+                BSONObjSet keys;
+                vector<const char *> setFields( fields );
+                KeyGenerator::getKeys( obj, setFields, false, keys );
+
+                arena.reset( &pk );
+                KeyGenerator::getKeys( obj, fields, false, arena );
+                arena.sortAndDedup( ordering );
+
+                ASSERT_EQUALS( keys.size(), arena.size() );
+                size_t i = 0;
+                for ( BSONObjSet::const_iterator k = keys.begin(); k != keys.end(); ++k, ++i ) {
+                    const storage::Key sKey( *k, &pk );
+                    const storage::Key aKey( arena.keyData( i ), true );
+                    ASSERT_EQUALS( aKey.size(), arena.keySize( i ) );
+                    ASSERT_EQUALS( 0, sKey.woCompare( aKey, ordering ) );
+                }
+            }
+        };
+
+        /** A KeyCounter agrees with a BSONObjSet on whether a document is multikey. */
+        class KeyCounterMatchesKeySet {
+        public:
+            void run() {
+                check( fromjson( "{a:[3,1,2,1,3.0],b:5}" ) );
+                check( fromjson( "{a:[1,1.0,1],b:5}" ) );
+                check( fromjson( "{a:[],b:[]}" ) );
+                check( fromjson( "{b:'x'}" ) );
+                check( fromjson( "{a:1,b:[null,null]}" ) );
+                check( fromjson( "{a:{c:1},b:[null,null,'y']}" ) );
+            }
+        private:
+            void check( const BSONObj &obj ) {
+                vector<const char *> fields;
+                fields.push_back( "a" );
+                fields.push_back( "b" );
+                BSONObjSet keys;
+                vector<const char *> setFields( fields );
+                KeyGenerator::getKeys( obj, setFields, false, keys );
+
+                KeyCounter counter;
+                KeyGenerator::getKeys( obj, fields, false, counter );
+                ASSERT_EQUALS( (int) min<size_t>( keys.size(), 2 ), counter.count() );
+            }
+        };
         
     } // namespace IndexDetailsTests
 
@@ -1114,6 +1178,8 @@ namespace NamespaceTests {
             add< IndexDetailsTests::CompoundMissing >();
             add< IndexDetailsTests::Suitability >();
             add< IndexDetailsTests::NumericFieldSuitability >();
+            add< IndexDetailsTests::KeyArenaMatchesKeySet >();
+            add< IndexDetailsTests::KeyCounterMatchesKeySet >();
             add< NamespaceDetailsTests::SetIndexIsMultikey >();
             add< NamespaceDetailsTests::ClearQueryCache >();
         }
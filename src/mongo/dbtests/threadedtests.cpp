@@ -852,6 +852,39 @@ namespace ThreadedTests {
         }
     };
 
+    // DDL on one collection (Lock::CollectionWrite) holds up ops on that collection and
+    // anything that reads the whole database, but not ops on the other collections.
+    class CollectionWriteTest : public ThreadedTest<4> {
+    private:
+        virtual void validate() { }
+        virtual void subthread(int x) {
+            Client::initThread("ctest");
+            if( x == 1 ) {
+                Lock::CollectionWrite lk("ctest.a");
+                ASSERT( Lock::isWriteLocked("ctest.a") );
+                ASSERT( Lock::isWriteLocked("ctest.a.$x_1") );
+                ASSERT( Lock::isWriteLocked("ctest.a$$p0") );
+                ASSERT( !Lock::isWriteLocked("ctest.ab") );
+                ASSERT( !Lock::isWriteLocked("ctest") );
+                ASSERT( Lock::atLeastReadLocked("ctest.b") );
+                sleepmillis(300);
+            }
+            if( x == 2 ) {
+                sleepmillis(100);
+                Timer t;
+                Lock::DBRead lk("ctest.b");
+                ASSERT( t.millis() < 100 );
+            }
+            if( x == 3 || x == 4 ) {
+                sleepmillis(100);
+                Timer t;
+                Lock::DBRead lk(x == 3 ? "ctest.a" : "ctest");
+                ASSERT( t.millis() > 50 );
+            }
+            cc().shutdown();
+        }
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -934,6 +967,7 @@ namespace ThreadedTests {
             add< WriteLocksAreGreedy >();
             add< QLockTest >();
             add< QLockTest >();
+            add< CollectionWriteTest >();
 
             // Slack is a test to see how long it takes for another thread to pick up
             // and begin work after another relinquishes the lock.  e.g. a spin lock 
@@ -582,7 +582,8 @@ namespace mongo {
         // Need the ns early, to construct the lock
         // TODO: Construct lock on demand?  Not sure why we need to keep it around
         _ns( collDoc["_id"].type() == String ? collDoc["_id"].String() : "" ),
-        _key( collDoc["key"].type() == Object ? collDoc["key"].Obj().getOwned() : BSONObj() ),
+        _key( collDoc["key"].type() == Object ? collDoc["key"].Obj().getOwned() : BSONObj() ,
+              collDoc["hashVersion"].numberInt() ),
         _unique( collDoc["unique"].trueValue() ),
         _chunkRanges(),
         _mutex("ChunkManager"),
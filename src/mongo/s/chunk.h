@@ -419,6 +419,9 @@ namespace mongo {
         void getInfo( BSONObjBuilder& b ) const {
             b.append( "key" , _key.key() );
             b.appendBool( "unique" , _unique );
+            // absent means HASH_VERSION_MD5, which is all older versions know
+            if ( _key.hashVersion() != HASH_VERSION_MD5 )
+                b.append( "hashVersion" , _key.hashVersion() );
             _version.addEpochToBSON( b, "lastmod" );
         }
 
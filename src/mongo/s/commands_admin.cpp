@@ -35,6 +35,7 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/op_latencies.h"
 
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
@@ -164,6 +165,13 @@ namespace mongo {
 
                 result.append( "shardCursorType" , shardedCursorTypes.getObj() );
 
+                {
+                    BSONObjBuilder bb( result.subobjStart( "opLatencies" ) );
+                    bb.append( "note" , "all times in microseconds, as seen by this mongos" );
+                    OpLatencies::global.appendGlobal( bb , true );
+                    bb.done();
+                }
+
                 {
                     BSONObjBuilder asserts( result.subobjStart( "asserts" ) );
                     asserts.append( "regular" , assertionCount.regular );
@@ -177,6 +185,11 @@ namespace mongo {
                 {
                     BSONObjBuilder bb( result.subobjStart( "network" ) );
                     networkCounter.append( bb );
+                    {
+                        BSONObjBuilder cb( bb.subobjStart( "compression" ) );
+                        MessageCompressor::appendStats( cb );
+                        cb.done();
+                    }
                     bb.done();
                 }
 
@@ -237,6 +250,88 @@ namespace mongo {
             }
         } fsyncCmd;
 
+        class TopCmd : public GridAdminCmd {
+        public:
+            TopCmd() : GridAdminCmd( "top" ) {}
+            virtual void help( stringstream& help ) const {
+                help << "{ top : 1, latencies : true } latency histograms by operation type, "
+                     << "for the cluster and each collection, merged from every shard";
+            }
+
+            // type name -> distribution
+            typedef map<string, LatencyDistribution> ByType;
+
+            static bool mergeTypes( const BSONObj& from , ByType& into , string& errmsg ) {
+                BSONForEach( e , from ) {
+                    if ( e.type() != Object )
+                        continue;
+                    if ( ! into[e.fieldName()].merge( e.Obj() , errmsg ) )
+                        return false;
+                }
+                return true;
+            }
+
+            static void appendTypes( BSONObjBuilder& b , const ByType& types ) {
+                for ( ByType::const_iterator i = types.begin(); i != types.end(); ++i ) {
+                    BSONObjBuilder bb( b.subobjStart( i->first ) );
+                    i->second.appendBuckets( bb );
+                    bb.done();
+                }
+            }
+
+            bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
+                if ( ! cmdObj["latencies"].trueValue() ) {
+                    errmsg = "only { top : 1, latencies : true } is supported through mongos";
+                    return false;
+                }
+
+                ByType global;
+                map<string, ByType> namespaces;
+                BSONArrayBuilder shardNames;
+
+                vector<Shard> shards;
+                Shard::getAllShards( shards );
+                for ( vector<Shard>::iterator i=shards.begin(); i!=shards.end(); i++ ) {
+                    Shard s = *i;
+
+                    BSONObj x = s.runCommand( "admin" , BSON( "top" << 1 << "latencies" << true ) );
+                    if ( ! x["ok"].trueValue() ) {
+                        errmsg = str::stream() << "top failed on " << s.getName() << ": " << x;
+                        return false;
+                    }
+
+                    BSONObj latencies = x["latencies"].Obj();
+                    if ( ! mergeTypes( latencies["global"].Obj() , global , errmsg ) )
+                        return false;
+                    BSONForEach( ns , latencies["namespaces"].Obj() ) {
+                        if ( ! mergeTypes( ns.Obj() , namespaces[ns.fieldName()] , errmsg ) )
+                            return false;
+                    }
+                    shardNames.append( s.getName() );
+                }
+
+                BSONObjBuilder b( result.subobjStart( "latencies" ) );
+                b.append( "note" , "all times in microseconds, as seen by the shards" );
+                {
+                    BSONObjBuilder bb( b.subobjStart( "global" ) );
+                    appendTypes( bb , global );
+                    bb.done();
+                }
+                {
+                    BSONObjBuilder bb( b.subobjStart( "namespaces" ) );
+                    for ( map<string, ByType>::const_iterator i = namespaces.begin(); i != namespaces.end(); ++i ) {
+                        BSONObjBuilder nb( bb.subobjStart( i->first ) );
+                        appendTypes( nb , i->second );
+                        nb.done();
+                    }
+                    bb.done();
+                }
+                b.append( "shards" , shardNames.arr() );
+                b.done();
+                return true;
+            }
+        } topCmd;
+
         // ------------ database level commands -------------
 
         class MoveDatabasePrimaryCommand : public GridAdminCmd {
@@ -484,6 +579,12 @@ namespace mongo {
                     return false;
                 }
 
+                // A hashed shard key may ask for a hash function other than MD5 (see
+                // HashVersions).  If it doesn't, it takes the one of the existing hashed index
+                // it will use, if any.
+                BSONElement hashVersionElt = cmdObj["hashVersion"];
+                HashVersion hashVersion = HASH_VERSION_MD5;
+
                 // Currently the allowable shard keys are either
                 // i) a hashed single field, e.g. { a : "hashed" }, or
                 // ii) a compound list of ascending fields, e.g. { a : 1 , b : 1 }
@@ -504,7 +605,18 @@ namespace mongo {
                         errmsg = "hashed shard keys cannot be declared unique.";
                         return false;
                     }
+                    if ( hashVersionElt.ok() ) {
+                        hashVersion = hashVersionElt.numberInt();
+                        if ( !hashVersionElt.isNumber() || !isValidHashVersion( hashVersion ) ) {
+                            errmsg = str::stream() << "unknown hashVersion " << hashVersionElt;
+                            return false;
+                        }
+                    }
                 } else {
+                    if ( hashVersionElt.ok() ) {
+                        errmsg = "hashVersion only applies to hashed shard keys";
+                        return false;
+                    }
                     // case ii)
                     BSONForEach(e, proposedKey) {
                         if (!e.isNumber() || e.number() != 1.0) {
@@ -539,6 +651,14 @@ namespace mongo {
                     return false;
                 }
 
+                //check that collection is not partitioned
+                if ( res["options"].type() == Object &&
+                     res["options"].embeddedObject()["partitioned"].trueValue() ) {
+                    errmsg = "can't shard partitioned collection";
+                    conn->done();
+                    return false;
+                }
+
                 // The proposed shard key must be validated against the set of existing indexes.
                 // In particular, we must ensure the following constraints
                 //
@@ -601,6 +721,17 @@ namespace mongo {
                     BSONObj currentKey = idx["key"].embeddedObject();
                     // Check 2.i. and 2.ii.
                     if ( ! idx["sparse"].trueValue() && proposedKey.isPrefixOf( currentKey ) ) {
+                        if ( currentKey.firstElementType() == mongo::String ) {
+                            // a hashed index is only useful if it hashes the way the shard
+                            // key will
+                            const HashVersion indexHashVersion = idx["hashVersion"].numberInt();
+                            if ( !hashVersionElt.ok() ) {
+                                hashVersion = indexHashVersion;
+                            }
+                            else if ( indexHashVersion != hashVersion ) {
+                                continue;
+                            }
+                        }
                         BSONElement ce = cmdObj["clustering"];
                         if (idx["clustering"].trueValue()) {
                             if (ce.ok() && !ce.trueValue()) {
@@ -687,13 +818,29 @@ namespace mongo {
                 else {
                     BSONElement ce = cmdObj["clustering"];
                     bool clustering = (ce.ok() ? ce.trueValue() : true);
-                    // call ensureIndex with cache=false, see SERVER-1691
-                    bool ensureSuccess = conn->get()->ensureIndex(ns,
-                                                                  proposedKey,
-                                                                  careAboutUnique,
-                                                                  clustering,
-                                                                  "",
-                                                                  false);
+                    bool ensureSuccess;
+                    if ( hashVersion == HASH_VERSION_MD5 ) {
+                        // call ensureIndex with cache=false, see SERVER-1691
+                        ensureSuccess = conn->get()->ensureIndex(ns,
+                                                                 proposedKey,
+                                                                 careAboutUnique,
+                                                                 clustering,
+                                                                 "",
+                                                                 false);
+                    }
+                    else {
+                        // ensureIndex has no way to pass the hashVersion, so build the spec
+                        BSONObjBuilder spec;
+                        spec.append( "ns" , ns );
+                        spec.append( "key" , proposedKey );
+                        spec.append( "name" , conn->get()->genIndexName( proposedKey ) );
+                        if ( clustering ) {
+                            spec.appendBool( "clustering" , true );
+                        }
+                        spec.append( "hashVersion" , hashVersion );
+                        conn->get()->insert( indexNS , spec.obj() );
+                        ensureSuccess = conn->get()->getLastError().empty();
+                    }
                     if ( ! ensureSuccess ) {
                         errmsg = "ensureIndex failed to create index on primary shard";
                         conn->done();
@@ -771,7 +918,8 @@ namespace mongo {
 
                 tlog() << "CMD: shardcollection: " << cmdObj << endl;
 
-                config->shardCollection( ns , proposedKey , careAboutUnique , &initSplits );
+                config->shardCollection( ns , ShardKeyPattern( proposedKey , hashVersion ) ,
+                                         careAboutUnique , &initSplits );
 
                 result << "collectionsharded" << ns;
 
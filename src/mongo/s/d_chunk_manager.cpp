@@ -184,6 +184,7 @@ namespace mongo {
         uassert( 13542 , str::stream() << "collection doesn't have a key: " << collectionDoc , ! e.eoo() && e.isABSONObj() );
 
         _key = e.Obj().getOwned();
+        _hashVersion = collectionDoc["hashVersion"].numberInt();
     }
 
     void ShardChunkManager::_fillChunks( DBClientCursorInterface* cursor ) {
@@ -245,7 +246,7 @@ namespace mongo {
         if ( _rangesMap.size() == 0 )
             return false;
         
-        KeyPattern pat( _key );
+        KeyPattern pat( _key , _hashVersion );
         return _belongsToMe( cc->extractKey( pat ) );
     }
 
@@ -253,7 +254,7 @@ namespace mongo {
         if ( _rangesMap.size() == 0 )
             return false;
 
-        KeyPattern pat( _key );
+        KeyPattern pat( _key , _hashVersion );
         return _belongsToMe( pat.extractSingleKey( doc ) );
     }
 
@@ -326,6 +327,7 @@ namespace mongo {
 
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
 
         if ( _chunksMap.size() == 1 ) {
             // if left with no chunks, just reset version
@@ -382,6 +384,7 @@ namespace mongo {
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
 
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
         p->_chunksMap = this->_chunksMap;
         p->_chunksMap.insert( make_pair( min.getOwned() , max.getOwned() ) );
         p->_version = version;
@@ -416,6 +419,7 @@ namespace mongo {
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
 
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
         p->_chunksMap = this->_chunksMap;
         p->_version = version; // will increment second, third, ... chunks below
 
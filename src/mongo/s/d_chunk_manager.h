@@ -21,6 +21,7 @@
 
 #include "mongo/pch.h"
 
+#include "../db/hasher.h"
 #include "../db/jsobj.h"
 #include "util.h"
 
@@ -132,6 +133,7 @@ namespace mongo {
         ShardChunkVersion getVersion() const { return _version; }
         ShardChunkVersion getCollVersion() const { return _collVersion; }
         BSONObj getKey() const { return _key.getOwned(); }
+        HashVersion hashVersion() const { return _hashVersion; }
         unsigned getNumChunks() const { return _chunksMap.size(); }
 
         string toString() const;
@@ -149,6 +151,8 @@ namespace mongo {
 
         // key pattern for chunks under this range
         BSONObj _key;
+        // how a hashed key pattern hashes its field
+        HashVersion _hashVersion;
 
         // a map from a min key into the chunk's (or range's) max boundary
         typedef map< BSONObj, BSONObj , BSONObjCmp > RangeMap;
@@ -167,7 +171,7 @@ namespace mongo {
         void _assertChunkExists( const BSONObj& min , const BSONObj& max ) const;
 
         /** can only be used in the cloning calls */
-        ShardChunkManager() {}
+        ShardChunkManager() : _hashVersion( HASH_VERSION_MD5 ) {}
     };
 
 }  // namespace mongo
@@ -261,8 +261,9 @@ namespace mongo {
     bool isInRange( const BSONObj& obj ,
                     const BSONObj& min ,
                     const BSONObj& max ,
-                    const BSONObj& shardKeyPattern ) {
-        ShardKeyPattern shardKey( shardKeyPattern );
+                    const BSONObj& shardKeyPattern ,
+                    const HashVersion hashVersion = HASH_VERSION_MD5 ) {
+        ShardKeyPattern shardKey( shardKeyPattern , hashVersion );
         BSONObj k = shardKey.extractKey( obj );
         return k.woCompare( min ) >= 0 && k.woCompare( max ) < 0;
     }
@@ -280,12 +281,14 @@ namespace mongo {
                   _migrateLogDetails(NULL),
                   _migrateLogRefDetails(NULL),
                   _nextMigrateLogId(0),
-                  _snapshotTaken(false) {}
+                  _snapshotTaken(false),
+                  _hashVersion(HASH_VERSION_MD5) {}
 
         void start( const std::string& ns ,
                     const BSONObj& min ,
                     const BSONObj& max ,
-                    const BSONObj& shardKeyPattern ) {
+                    const BSONObj& shardKeyPattern ,
+                    const HashVersion hashVersion ) {
 
             //
             // Do not hold _workLock
@@ -305,6 +308,7 @@ namespace mongo {
             _min = min;
             _max = max;
             _shardKeyPattern = shardKeyPattern;
+            _hashVersion = hashVersion;
 
             verify( _clonePKs.size() == 0 );
             verify( _deleted.size() == 0 );
@@ -418,7 +422,7 @@ namespace mongo {
             if (mongoutils::str::equals(opstr, OpLogHelpers::OP_STR_INSERT) ||
                 mongoutils::str::equals(opstr, OpLogHelpers::OP_STR_DELETE) ||
                 mongoutils::str::equals(opstr, OpLogHelpers::OP_STR_UPDATE)) {
-                return isInRange(obj, _min, _max, _shardKeyPattern);
+                return isInRange(obj, _min, _max, _shardKeyPattern, _hashVersion);
             }
             return false;
         }
@@ -429,7 +433,7 @@ namespace mongo {
             // But we call shouldLogOp first to avoid doing the comparison if, say, we're in the wrong ns and we can stop early.
             bool should = shouldLogOp(opstr, ns, oldObj);
             if (should) {
-                ShardKeyPattern shardKey(_shardKeyPattern);
+                ShardKeyPattern shardKey(_shardKeyPattern, _hashVersion);
                 BSONObj oldKey = shardKey.extractKey(oldObj);
                 BSONObj newKey = shardKey.extractKey(newObj);
                 verify(oldKey.equal(newKey));
@@ -539,6 +543,11 @@ namespace mongo {
                     _txn.reset();
                     return false;
                 }
+                if (d->isPartitioned()) {
+                    errmsg = "can't migrate chunks of a partitioned collection";
+                    _txn.reset();
+                    return false;
+                }
 
                 const IndexDetails *idx = d->findIndexByPrefix( _shardKeyPattern ,
                                                                 true );  /* require single key */
@@ -621,6 +630,7 @@ namespace mongo {
         BSONObj _min;
         BSONObj _max;
         BSONObj _shardKeyPattern;
+        HashVersion _hashVersion;
 
         // we need the lock in case there is a malicious _migrateClone for example
         // even though it shouldn't be needed under normal operation
@@ -664,8 +674,9 @@ namespace mongo {
         MigrateStatusHolder( const std::string& ns ,
                              const BSONObj& min ,
                              const BSONObj& max ,
-                             const BSONObj& shardKeyPattern ) {
-            migrateFromStatus.start( ns , min , max , shardKeyPattern );
+                             const BSONObj& shardKeyPattern ,
+                             const HashVersion hashVersion ) {
+            migrateFromStatus.start( ns , min , max , shardKeyPattern , hashVersion );
         }
         ~MigrateStatusHolder() {
             migrateFromStatus.done();
@@ -1008,7 +1019,7 @@ namespace mongo {
                 return false;
             }
 
-            MigrateStatusHolder statusHolder( ns , min , max , shardKeyPattern );
+            MigrateStatusHolder statusHolder( ns , min , max , shardKeyPattern , chunkManager->hashVersion() );
             {
                 scoped_ptr<ScopedDbConnection> connTo(
                         ScopedDbConnection::getScopedDbConnection( toShard.getConnString() ) );
@@ -1911,6 +1922,11 @@ namespace mongo {
             verify( ! isInRange( BSON( "x" << 3 ) , min , max , hashedKey ) );
             verify( ! isInRange( BSON( "x" << 4 ) , min2 , max2 , hashedKey ) );
 
+            BSONObj min3 = BSON( "x" << BSONElementHasher::hash64( obj.firstElement() , 0 , HASH_VERSION_MURMUR3 ) - 2 );
+            BSONObj max3 = BSON( "x" << BSONElementHasher::hash64( obj.firstElement() , 0 , HASH_VERSION_MURMUR3 ) + 2 );
+            verify( isInRange( BSON( "x" << 3 ) , min3 , max3 , hashedKey , HASH_VERSION_MURMUR3 ) );
+            verify( ! isInRange( BSON( "x" << 3 ) , min2 , max2 , hashedKey , HASH_VERSION_MURMUR3 ) );
+
             LOG(1) << "isInRangeTest passed" << migrateLog;
         }
     } isInRangeTest;
@@ -91,6 +91,10 @@ namespace mongo {
                 errmsg = "ns not found";
                 return false;
             }
+            if ( d->isPartitioned() ) {
+                errmsg = "can't shard partitioned collection";
+                return false;
+            }
 
             const IndexDetails *idx = d->findIndexByPrefix( keyPattern ,
                                                             true );  /* require single key */
@@ -223,6 +227,7 @@ namespace mongo {
                 // middle of them, we fall back to just using a cursor from this point forward.
                 if (!_idx.isIdIndex()) {
                     _chunkMin.reset(*endKey, endPK);
+                    _chunkMin.makeOwned();
                     _justSkipped += skipped;
                 }
                 _useCursor = true;
@@ -235,6 +240,7 @@ namespace mongo {
             _splitPoints.push_back(_lastSplitKey);
             BSONObj modSplitKey = Helpers::modifiedRangeBound(_lastSplitKey, _idx.keyPattern(), -1);
             _chunkMin.reset(modSplitKey, _idx.isIdIndex() ? NULL : &minKey);
+            _chunkMin.makeOwned();
         }
 
         void slowFindSplitPoint(long long targetChunkSize) {
@@ -258,6 +264,7 @@ namespace mongo {
                         _splitPoints.push_back(_lastSplitKey);
                         BSONObj modSplitKey = Helpers::modifiedRangeBound(_lastSplitKey, _idx.keyPattern(), -1);
                         _chunkMin.reset(modSplitKey, _idx.isIdIndex() ? NULL : &minKey);
+                        _chunkMin.makeOwned();
                         return;
                     }
                 }
@@ -284,6 +291,9 @@ namespace mongo {
                   _lastSplitKey()
         {
             massert(16799, "shard key pattern must be a prefix of the index key pattern", chunkPattern.isPrefixOf(_idx.keyPattern()));
+            // These are kept across the ydb's callbacks, so keep them out of the arena.
+            _chunkMin.makeOwned();
+            _chunkMax.makeOwned();
         }
 
         // Functors that wrap the above callbacks
@@ -394,6 +404,10 @@ namespace mongo {
                 errmsg = "ns not found";
                 return false;
             }
+            if ( d->isPartitioned() ) {
+                errmsg = "can't shard partitioned collection";
+                return false;
+            }
 
             const IndexDetails *idx = d->findIndexByPrefix( keyPattern ,
                                                             true ); /* require single key */
@@ -888,6 +902,9 @@ namespace mongo {
                 for (int i=1; i >= 0 ; i--){ // high chunk more likely to have only one obj
 
                     NamespaceDetails *d = nsdetails( ns.c_str() );
+                    if ( d == NULL || d->isPartitioned() ) {
+                        break;
+                    }
 
                     const IndexDetails *idx = d->findIndexByPrefix( keyPattern ,
                                                                     true ); /* exclude multikeys */
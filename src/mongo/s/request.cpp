@@ -23,6 +23,7 @@
 #include "../db/commands.h"
 #include "../db/dbmessage.h"
 #include "../db/stats/counters.h"
+#include "../db/stats/op_latencies.h"
 
 #include "../client/connpool.h"
 
@@ -158,6 +159,7 @@ namespace mongo {
 
         globalOpCounters.gotOp( op , iscmd );
         _counter->gotOp( op , iscmd );
+        OpLatencies::global.record( getns() , op , iscmd , t.micros() );
     }
 
     bool Request::isCommand() const {
@@ -272,6 +272,7 @@ static bool runMongosServer( bool doUpgrade ) {
 
     // Mongos shouldn't lazily kill cursors, otherwise we can end up with extras from migration
     DBClientConnection::setLazyKillCursor( false );
+    DBClientConnection::setCompressor( cmdLine.networkCompressor );
 
     ReplicaSetMonitor::setConfigChangeHook( boost::bind( &ConfigServer::replicaSetChange , &configServer , _1 ) );
 
@@ -564,5 +565,6 @@ void mongo::dbexit( ExitCode rc, const char *why ) {
           << " rc:" << rc
           << " " << ( why ? why : "" )
           << endl;
+    Logstream::stopAsync();
     ::_exit(rc);
 }
@@ -31,7 +31,10 @@ namespace mongo {
     */
     class ShardKeyPattern {
     public:
-        ShardKeyPattern( BSONObj p = BSONObj() );
+        ShardKeyPattern( BSONObj p = BSONObj() , HashVersion hashVersion = HASH_VERSION_MD5 );
+
+        /** the hash function of a hashed shard key, see hasher.h */
+        HashVersion hashVersion() const { return pattern.hashVersion(); }
 
         /**
            global min is the lowest possible value for this key
@@ -26,6 +26,7 @@
 #include <boost/thread/thread.hpp>
 
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/namespacestring.h"
 #include "mongo/scripting/bson_template_evaluator.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/md5.h"
@@ -66,11 +67,13 @@ namespace mongo {
     void BenchRunEventCounter::reset() {
         _numEvents = 0;
         _totalTimeMicros = 0;
+        _latencies = LatencyDistribution();
     }
 
     void BenchRunEventCounter::updateFrom(const BenchRunEventCounter &other) {
         _numEvents += other._numEvents;
         _totalTimeMicros += other._totalTimeMicros;
+        _latencies.merge(other._latencies);
     }
 
     BenchRunStats::BenchRunStats() {
@@ -88,7 +91,10 @@ namespace mongo {
         insertCounter.reset();
         deleteCounter.reset();
         queryCounter.reset();
+        readModifyWriteCounter.reset();
+        commitCounter.reset();
 
+        opsPerSecond.clear();
         trappedErrors.clear();
     }
 
@@ -102,11 +108,24 @@ namespace mongo {
         insertCounter.updateFrom(other.insertCounter);
         deleteCounter.updateFrom(other.deleteCounter);
         queryCounter.updateFrom(other.queryCounter);
+        readModifyWriteCounter.updateFrom(other.readModifyWriteCounter);
+        commitCounter.updateFrom(other.commitCounter);
+
+        if (opsPerSecond.size() < other.opsPerSecond.size())
+            opsPerSecond.resize(other.opsPerSecond.size());
+        for (size_t i = 0; i < other.opsPerSecond.size(); ++i)
+            opsPerSecond[i] += other.opsPerSecond[i];
 
         for (size_t i = 0; i < other.trappedErrors.size(); ++i)
             trappedErrors.push_back(other.trappedErrors[i]);
     }
 
+    void BenchRunStats::countOp(int second) {
+        if (opsPerSecond.size() <= size_t(second))
+            opsPerSecond.resize(second + 1);
+        ++opsPerSecond[second];
+    }
+
     BenchRunConfig::BenchRunConfig() {
         initializeToDefaults();
     }
@@ -129,6 +148,7 @@ namespace mongo {
         noWatchPattern.reset();
 
         ops = BSONObj();
+        workload.reset();
 
         throwGLE = false;
         breakOnTrap = true;
@@ -193,7 +213,13 @@ namespace mongo {
             this->noWatchPattern = shared_ptr< pcrecpp::RE >( new pcrecpp::RE( regex, flags2options( flags ) ) );
         }
 
-        this->ops = args["ops"].Obj().getOwned();
+        if ( ! args["workload"].eoo() ) {
+            uassert( 17051, "workload must be an object", args["workload"].type() == Object );
+            this->workload.reset( new BenchWorkload( args["workload"].Obj() ) );
+        }
+        else {
+            this->ops = args["ops"].Obj().getOwned();
+        }
     }
 
     DBClientBase *BenchRunConfig::createConnection() const {
@@ -296,6 +322,25 @@ namespace mongo {
         return b.obj();
     }
 
+    static void runBenchCommand( DBClientBase* conn, const string& db, const BSONObj& cmd ) {
+        BSONObj result;
+        if ( ! conn->runCommand( db, cmd, result ) )
+            throw DBException( (string)"From benchRun " + cmd.firstElementFieldName() +
+                               causedBy( result["errmsg"].str() ),
+                               result["code"].eoo() ? 0 : result["code"].numberInt() );
+    }
+
+    static void checkLastError( DBClientBase* conn ) {
+        BSONObj result = conn->getLastErrorDetailed();
+        if( ! result["err"].eoo() && result["err"].type() == String )
+            throw DBException( (string)"From benchRun GLE" + causedBy( result["err"].String() ),
+                               result["code"].eoo() ? 0 : result["code"].Int() );
+    }
+
+    static string collectionName( const string& ns ) {
+        return ns.substr( ns.find( '.' ) + 1 );
+    }
+
     BenchRunWorker::BenchRunWorker(const BenchRunConfig *config, BenchRunState *brState)
         : _config(config), _brState(brState) {
     }
@@ -563,11 +608,38 @@ namespace mongo {
                     else if ( op == "dropIndex" ) {
                         conn->dropIndex( ns , e["key"].Obj()  );
                     }
+                    else if ( op == "beginTransaction" ) {
+                        BSONObjBuilder cmd;
+                        cmd.append( "beginTransaction" , 1 );
+                        if ( ! e["isolation"].eoo() )
+                            cmd.append( e["isolation"] );
+                        runBenchCommand( conn, nsToDatabase( ns ), cmd.done() );
+                    }
+                    else if ( op == "commitTransaction" ) {
+                        BenchRunEventTrace _bret(&_stats.commitCounter);
+                        runBenchCommand( conn, nsToDatabase( ns ), BSON( "commitTransaction" << 1 ) );
+                    }
+                    else if ( op == "rollbackTransaction" ) {
+                        runBenchCommand( conn, nsToDatabase( ns ), BSON( "rollbackTransaction" << 1 ) );
+                    }
+                    else if ( op == "beginLoad" ) {
+                        // must be inside a transaction, like the command
+                        BSONObj indexes = e["indexes"].eoo() ? BSONArray() : e["indexes"].Obj();
+                        BSONObj options = e["options"].eoo() ? BSONObj() : e["options"].Obj();
+                        runBenchCommand( conn, nsToDatabase( ns ),
+                                         BSON( "beginLoad" << 1 << "ns" << collectionName( ns ) <<
+                                               "indexes" << BSONArray( indexes ) << "options" << options ) );
+                    }
+                    else if ( op == "commitLoad" || op == "abortLoad" ) {
+                        runBenchCommand( conn, nsToDatabase( ns ), BSON( op << 1 ) );
+                    }
                     else {
                         log() << "don't understand op: " << op << endl;
                         _stats.error = true;
                         return;
                     }
+
+                    _stats.countOp( timer.seconds() );
                 }
                 catch( DBException& ex ){
                     if( ! _config->hideErrors || e["showError"].trueValue() ){
@@ -614,6 +686,115 @@ namespace mongo {
         conn->getLastError();
     }
 
+    void BenchRunWorker::generateWorkloadOnConnection( DBClientBase* conn ) {
+        verify( conn );
+        const BenchWorkload& workload = *_config->workload;
+        BenchWorkloadKeys& keys = _brState->workloadKeys();
+        const string db = nsToDatabase( workload.ns );
+        mongo::Timer timer;
+
+        BenchRandom random( curTimeMicros64() ^ reinterpret_cast<size_t>( this ) );
+        KeyChooser keyChooser( workload.distribution );
+        ZipfianGenerator scanLengths;
+
+        // Each transaction is transactionSize operations, and its commit is timed on its own.
+        bool inTransaction = false;
+        int opsInTransaction = 0;
+
+        while ( !shouldStop() ) {
+            const BenchWorkload::Op op = workload.chooseOp( random );
+            try {
+                if ( workload.transactionSize > 0 && ! inTransaction ) {
+                    runBenchCommand( conn, db, BSON( "beginTransaction" << 1 <<
+                                                     "isolation" << workload.isolation ) );
+                    inTransaction = true;
+                    opsInTransaction = 0;
+                }
+
+                switch ( op ) {
+                case BenchWorkload::READ: {
+                    const string key = BenchWorkload::key( keyChooser.next( random, keys.inserted.load() ) );
+                    const BSONObj fields = workload.fields( random );
+                    BenchRunEventTrace _bret(&_stats.findOneCounter);
+                    conn->findOne( workload.ns, QUERY( "_id" << key ), &fields );
+                    break;
+                }
+                case BenchWorkload::UPDATE: {
+                    const string key = BenchWorkload::key( keyChooser.next( random, keys.inserted.load() ) );
+                    const BSONObj update = workload.update( random );
+                    BenchRunEventTrace _bret(&_stats.updateCounter);
+                    conn->update( workload.ns, QUERY( "_id" << key ), update );
+                    checkLastError( conn );
+                    break;
+                }
+                case BenchWorkload::INSERT: {
+                    const BSONObj doc = workload.record( keys.nextInsert.fetchAndAdd( 1 ), random );
+                    {
+                        BenchRunEventTrace _bret(&_stats.insertCounter);
+                        conn->insert( workload.ns, doc );
+                        checkLastError( conn );
+                    }
+                    // Inserts finish out of order, so this can run ahead of the records
+                    // actually there by a few; reading one that isn't yet just finds nothing.
+                    keys.inserted.fetchAndAdd( 1 );
+                    break;
+                }
+                case BenchWorkload::SCAN: {
+                    const string key = BenchWorkload::key( keyChooser.next( random, keys.inserted.load() ) );
+                    const int length = workload.chooseScanLength( random, scanLengths );
+                    const BSONObj fields = workload.fields( random );
+                    BenchRunEventTrace _bret(&_stats.queryCounter);
+                    auto_ptr<DBClientCursor> cursor =
+                            conn->query( workload.ns, Query( BSON( "_id" << GTE << key ) ).hint( BSON( "_id" << 1 ) ),
+                                         length, 0, &fields, 0, length );
+                    cursor->itcount();
+                    break;
+                }
+                case BenchWorkload::READ_MODIFY_WRITE: {
+                    const string key = BenchWorkload::key( keyChooser.next( random, keys.inserted.load() ) );
+                    const BSONObj fields = workload.fields( random );
+                    const BSONObj update = workload.update( random );
+                    BenchRunEventTrace _bret(&_stats.readModifyWriteCounter);
+                    conn->findOne( workload.ns, QUERY( "_id" << key ), &fields );
+                    conn->update( workload.ns, QUERY( "_id" << key ), update );
+                    checkLastError( conn );
+                    break;
+                }
+                }
+
+                if ( inTransaction && ++opsInTransaction == workload.transactionSize ) {
+                    inTransaction = false;
+                    BenchRunEventTrace _bret(&_stats.commitCounter);
+                    runBenchCommand( conn, db, BSON( "commitTransaction" << 1 ) );
+                }
+
+                _stats.countOp( timer.seconds() );
+            }
+            catch( DBException& ex ){
+                if ( inTransaction ) {
+                    inTransaction = false;
+                    try {
+                        runBenchCommand( conn, db, BSON( "rollbackTransaction" << 1 ) );
+                    }
+                    catch( DBException& ) {
+                        // the error may have ended it already
+                    }
+                }
+
+                if( ! _config->hideErrors )
+                    log() << "Error in benchRun thread for workload op " << BenchWorkload::opName( op ) << causedBy( ex ) << endl;
+                if( ! _config->handleErrors ) return;
+
+                _stats.errCount++;
+            }
+        }
+
+        if ( inTransaction ) {
+            BenchRunEventTrace _bret(&_stats.commitCounter);
+            runBenchCommand( conn, db, BSON( "commitTransaction" << 1 ) );
+        }
+    }
+
     namespace {
         class BenchRunWorkerStateGuard : private boost::noncopyable {
         public:
@@ -642,7 +823,10 @@ namespace mongo {
                     uasserted(15932, "Authenticating to connection for benchThread failed: " + errmsg);
                 }
             }
-            generateLoadOnConnection( conn.get() );
+            if ( _config->workload )
+                generateWorkloadOnConnection( conn.get() );
+            else
+                generateLoadOnConnection( conn.get() );
         }
         catch( DBException& e ){
             error() << "DBException not handled in benchRun thread" << causedBy( e ) << endl;
@@ -657,7 +841,11 @@ namespace mongo {
 
     BenchRunner::BenchRunner( BenchRunConfig *config )
         : _brState(config->parallel),
-          _config(config) {
+          _config(config),
+          _loadMicros(0) {
+
+        if ( _config->workload )
+            _brState.workloadKeys().reset( _config->workload->recordCount );
 
         _oid.init();
         boost::mutex::scoped_lock lk(_staticMutex);
@@ -684,6 +872,8 @@ namespace mongo {
                                "required to use benchRun with auth enabled");
                  }
              }
+             if ( _config->workload && _config->workload->load )
+                 loadWorkload( conn.get() );
              // Get initial stats
              conn->simpleCommand( "admin" , &before , "serverStatus" );
              before = before.getOwned();
@@ -699,6 +889,51 @@ namespace mongo {
          _brState.waitForState(BenchRunState::BRS_RUNNING);
      }
 
+     void BenchRunner::loadWorkload( DBClientBase *conn ) {
+         const BenchWorkload &workload = *_config->workload;
+         const string db = nsToDatabase( workload.ns );
+         BenchRandom random( curTimeMicros64() );
+         mongo::Timer timer;
+
+         if ( workload.bulkLoad ) {
+             runBenchCommand( conn, db, BSON( "beginTransaction" << 1 ) );
+             runBenchCommand( conn, db, BSON( "beginLoad" << 1 << "ns" << collectionName( workload.ns ) <<
+                                              "indexes" << BSONArray() << "options" << BSONObj() ) );
+         }
+
+         try {
+             vector<BSONObj> batch;
+             int batchBytes = 0;
+             for ( long long i = 0; i < workload.recordCount; i++ ) {
+                 batch.push_back( workload.record( i, random ) );
+                 batchBytes += batch.back().objsize();
+                 if ( batchBytes > 8 * 1024 * 1024 || batch.size() == 1000 || i + 1 == workload.recordCount ) {
+                     conn->insert( workload.ns, batch );
+                     batch.clear();
+                     batchBytes = 0;
+                 }
+             }
+             checkLastError( conn );
+
+             if ( workload.bulkLoad ) {
+                 runBenchCommand( conn, db, BSON( "commitLoad" << 1 ) );
+                 runBenchCommand( conn, db, BSON( "commitTransaction" << 1 ) );
+             }
+         }
+         catch ( DBException & ) {
+             if ( workload.bulkLoad ) {
+                 BSONObj ignored;
+                 conn->runCommand( db, BSON( "abortLoad" << 1 ), ignored );
+                 conn->runCommand( db, BSON( "rollbackTransaction" << 1 ), ignored );
+             }
+             throw;
+         }
+
+         _loadMicros = timer.micros();
+         log() << "benchRun loaded " << workload.recordCount << " records into " << workload.ns
+               << " in " << _loadMicros / 1000 << "ms" << endl;
+     }
+
      void BenchRunner::stop() {
          _brState.tellWorkersToFinish();
          _brState.waitForState(BenchRunState::BRS_FINISHED);
@@ -762,6 +997,16 @@ namespace mongo {
                         static_cast<double>(counter.getTotalTimeMicros()) / counter.getNumEvents());
      }
 
+     static void appendLatenciesIfAvailable(
+             BSONObjBuilder &buf, const std::string &name, const BenchRunEventCounter &counter) {
+
+         if (counter.getNumEvents() > 0) {
+             BSONObjBuilder b(buf.subobjStart(name));
+             counter.getLatencies().appendSummary(b);
+             b.done();
+         }
+     }
+
      BSONObj BenchRunner::finish( BenchRunner* runner ) {
 
          runner->stop();
@@ -789,6 +1034,28 @@ namespace mongo {
          appendAverageMicrosIfAvailable(buf, "updateLatencyAverageMicros", stats.updateCounter);
          appendAverageMicrosIfAvailable(buf, "queryLatencyAverageMicros", stats.queryCounter);
 
+         {
+             BSONObjBuilder latencies(buf.subobjStart("latencies"));
+             appendLatenciesIfAvailable(latencies, "findOne", stats.findOneCounter);
+             appendLatenciesIfAvailable(latencies, "insert", stats.insertCounter);
+             appendLatenciesIfAvailable(latencies, "delete", stats.deleteCounter);
+             appendLatenciesIfAvailable(latencies, "update", stats.updateCounter);
+             appendLatenciesIfAvailable(latencies, "query", stats.queryCounter);
+             appendLatenciesIfAvailable(latencies, "readModifyWrite", stats.readModifyWriteCounter);
+             appendLatenciesIfAvailable(latencies, "commitTransaction", stats.commitCounter);
+             latencies.done();
+         }
+
+         {
+             BSONArrayBuilder timeline(buf.subarrayStart("opsPerSecond"));
+             for (size_t i = 0; i < stats.opsPerSecond.size(); ++i)
+                 timeline.append(stats.opsPerSecond[i]);
+             timeline.done();
+         }
+
+         if (runner->_loadMicros > 0)
+             buf.append("loadSeconds", runner->_loadMicros / 1000000.0);
+
          {
              BSONObjIterator i( after );
              while ( i.more() ) {
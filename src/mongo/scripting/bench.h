@@ -26,6 +26,8 @@
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/scripting/bench_workload.h"
 #include "mongo/util/timer.h"
 
 namespace mongo {
@@ -107,6 +109,11 @@ namespace mongo {
          */
         BSONObj ops;
 
+        /**
+         * A YCSB-style workload to run instead of "ops", or NULL.  See bench_workload.h.
+         */
+        boost::shared_ptr< BenchWorkload > workload;
+
         bool throwGLE;
         bool breakOnTrap;
 
@@ -142,6 +149,7 @@ namespace mongo {
         void countOne(unsigned long long timeMicros) {
             ++_numEvents;
             _totalTimeMicros += timeMicros;
+            _latencies.add(timeMicros);
         }
 
         /**
@@ -154,9 +162,15 @@ namespace mongo {
          */
         unsigned long long getNumEvents() const { return _numEvents; }
 
+        /**
+         * Get the distribution of the observed events' durations.
+         */
+        const LatencyDistribution &getLatencies() const { return _latencies; }
+
     private:
         unsigned long long _numEvents;
         unsigned long long _totalTimeMicros;
+        LatencyDistribution _latencies;
     };
 
     /**
@@ -218,6 +232,12 @@ namespace mongo {
 
         void updateFrom( const BenchRunStats &other );
 
+        /**
+         * Count one completed operation, "second" seconds into the run, in the throughput
+         * timeline.
+         */
+        void countOp( int second );
+
         bool error;
         unsigned long long errCount;
 
@@ -226,6 +246,11 @@ namespace mongo {
         BenchRunEventCounter insertCounter;
         BenchRunEventCounter deleteCounter;
         BenchRunEventCounter queryCounter;
+        BenchRunEventCounter readModifyWriteCounter;
+        BenchRunEventCounter commitCounter;
+
+        /// Operations completed in each second of the run.
+        std::vector<int> opsPerSecond;
 
         std::map<std::string, long long> opcounters;
         std::vector<BSONObj> trappedErrors;
@@ -285,12 +310,16 @@ namespace mongo {
          */
         void onWorkerFinished();
 
+        /// Record numbers shared by the workers of a workload run.
+        BenchWorkloadKeys &workloadKeys() { return _workloadKeys; }
+
     private:
         boost::mutex _mutex;
         boost::condition _stateChangeCondition;
         unsigned _numUnstartedWorkers;
         unsigned _numActiveWorkers;
         AtomicUInt _isShuttingDown;
+        BenchWorkloadKeys _workloadKeys;
     };
 
     /**
@@ -329,6 +358,9 @@ namespace mongo {
         /// The function that actually sets about generating the load described in "_config".
         void generateLoadOnConnection( DBClientBase *conn );
 
+        /// Like generateLoadOnConnection(), for the operations of "_config->workload".
+        void generateWorkloadOnConnection( DBClientBase *conn );
+
         /// Predicate, used to decide whether or not it's time to terminate the worker.
         bool shouldStop() const;
 
@@ -401,6 +433,9 @@ namespace mongo {
         static BSONObj benchRunSync(const BSONObj& argsFake, void* data);
 
     private:
+        /// Insert the records of "_config->workload" before the run starts.
+        void loadWorkload( DBClientBase *conn );
+
         // TODO: Same as for createWithConfig.
         static boost::mutex _staticMutex;
         static map< OID, BenchRunner* > _activeRuns;
@@ -412,6 +447,9 @@ namespace mongo {
 
         BSONObj before;
         BSONObj after;
+
+        /// How long loadWorkload() took, or 0 if there was nothing to load.
+        unsigned long long _loadMicros;
     };
 
 }  // namespace mongo
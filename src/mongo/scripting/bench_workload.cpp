@@ -0,0 +1,378 @@
+// bench_workload.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/scripting/bench_workload.h"
+
+#include <cmath>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    BenchRandom::BenchRandom(unsigned long long seed) : _state(seed != 0 ? seed : 0x9E3779B97F4A7C15ULL) {
+    }
+
+    unsigned long long BenchRandom::next() {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 2685821657736338717ULL;
+    }
+
+    double BenchRandom::nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    const double ZipfianGenerator::ZIPFIAN_CONSTANT = 0.99;
+
+    ZipfianGenerator::ZipfianGenerator(double theta) :
+        _theta(theta),
+        _alpha(1.0 / (1.0 - theta)),
+        _zeta2(1.0 + std::pow(0.5, theta)),
+        _n(0),
+        _zetan(0),
+        _eta(0) {
+    }
+
+    void ZipfianGenerator::setItemCount(long long n) {
+        if (n < _n) {
+            _n = 0;
+            _zetan = 0;
+        }
+        for (long long i = _n + 1; i <= n; i++) {
+            _zetan += 1.0 / std::pow((double) i, _theta);
+        }
+        _n = n;
+        _eta = (1.0 - std::pow(2.0 / n, 1.0 - _theta)) / (1.0 - _zeta2 / _zetan);
+    }
+
+    long long ZipfianGenerator::next(BenchRandom& random, long long n) {
+        if (n <= 1) {
+            return 0;
+        }
+        if (n != _n) {
+            setItemCount(n);
+        }
+        const double u = random.nextDouble();
+        const double uz = u * _zetan;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < _zeta2) {
+            return 1;
+        }
+        const long long k = (long long) (n * std::pow(_eta * u - _eta + 1.0, _alpha));
+        return std::min(std::max(k, 0LL), n - 1);
+    }
+
+    bool KeyChooser::parseDistribution(const std::string& name, Distribution* out) {
+        if (name == "uniform") {
+            *out = UNIFORM;
+        }
+        else if (name == "zipfian") {
+            *out = ZIPFIAN;
+        }
+        else if (name == "latest") {
+            *out = LATEST;
+        }
+        else if (name == "hotspot") {
+            *out = HOTSPOT;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    KeyChooser::KeyChooser(Distribution distribution, double hotSetFraction, double hotOpFraction) :
+        _distribution(distribution),
+        _hotSetFraction(hotSetFraction),
+        _hotOpFraction(hotOpFraction) {
+    }
+
+    long long KeyChooser::next(BenchRandom& random, long long n) {
+        switch (_distribution) {
+        case UNIFORM:
+            return random.nextLong(n);
+        case ZIPFIAN:
+            return _zipfian.next(random, n);
+        case LATEST:
+            return n - 1 - _zipfian.next(random, n);
+        case HOTSPOT: {
+            const long long hot = std::max(1LL, (long long) (n * _hotSetFraction));
+            if (hot >= n) {
+                return random.nextLong(n);
+            }
+            if (random.nextDouble() < _hotOpFraction) {
+                return random.nextLong(hot);
+            }
+            return hot + random.nextLong(n - hot);
+        }
+        }
+        verify(false);
+        return 0;
+    }
+
+    namespace {
+
+        struct Preset {
+            const char* type;
+            double read;
+            double update;
+            double insert;
+            double scan;
+            double readModifyWrite;
+            KeyChooser::Distribution distribution;
+        };
+
+        // YCSB's core workloads
+        const Preset presets[] = {
+            // update heavy
+            { "a", 0.50, 0.50, 0.00, 0.00, 0.00, KeyChooser::ZIPFIAN },
+            // read mostly
+            { "b", 0.95, 0.05, 0.00, 0.00, 0.00, KeyChooser::ZIPFIAN },
+            // read only
+            { "c", 1.00, 0.00, 0.00, 0.00, 0.00, KeyChooser::ZIPFIAN },
+            // read latest
+            { "d", 0.95, 0.00, 0.05, 0.00, 0.00, KeyChooser::LATEST },
+            // short ranges
+            { "e", 0.00, 0.00, 0.05, 0.95, 0.00, KeyChooser::ZIPFIAN },
+            // read-modify-write
+            { "f", 0.50, 0.00, 0.00, 0.00, 0.50, KeyChooser::ZIPFIAN },
+        };
+
+        void setDouble(const BSONObj& args, const char* field, double* out) {
+            BSONElement e = args[field];
+            if (!e.eoo()) {
+                uassert(17045, mongoutils::str::stream() << "workload " << field << " must be a non-negative number",
+                        e.isNumber() && e.number() >= 0);
+                *out = e.number();
+            }
+        }
+
+        void setInt(const BSONObj& args, const char* field, long long min, long long* out) {
+            BSONElement e = args[field];
+            if (!e.eoo()) {
+                uassert(17046, mongoutils::str::stream() << "workload " << field << " must be a number, at least " << min,
+                        e.isNumber() && e.numberLong() >= min);
+                *out = e.numberLong();
+            }
+        }
+
+        void setInt(const BSONObj& args, const char* field, long long min, int* out) {
+            long long value = *out;
+            setInt(args, field, min, &value);
+            *out = (int) value;
+        }
+
+        void setBool(const BSONObj& args, const char* field, bool* out) {
+            BSONElement e = args[field];
+            if (!e.eoo()) {
+                *out = e.trueValue();
+            }
+        }
+
+        std::string fieldName(long long i) {
+            return mongoutils::str::stream() << "field" << i;
+        }
+
+        KeyChooser::Distribution parseDistribution(const BSONElement& e) {
+            KeyChooser::Distribution d;
+            uassert(17044, mongoutils::str::stream() << "unknown workload distribution: " << e,
+                    e.type() == String && KeyChooser::parseDistribution(e.String(), &d));
+            return d;
+        }
+
+    } // namespace
+
+    BenchWorkload::BenchWorkload(const BSONObj& args) :
+        readProportion(0.95),
+        updateProportion(0.05),
+        insertProportion(0),
+        scanProportion(0),
+        readModifyWriteProportion(0),
+        recordCount(1000),
+        load(false),
+        bulkLoad(false),
+        distribution(KeyChooser::ZIPFIAN),
+        maxScanLength(100),
+        zipfianScanLength(false),
+        fieldCount(10),
+        fieldLength(100),
+        readAllFields(true),
+        writeAllFields(false),
+        transactionSize(0),
+        isolation("mvcc") {
+
+        uassert(17042, "workload needs an ns", args["ns"].type() == String);
+        ns = args["ns"].String();
+
+        BSONElement type = args["type"];
+        if (!type.eoo()) {
+            const Preset* preset = NULL;
+            for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+                if (type.type() == String && mongoutils::str::equals(presets[i].type, type.valuestrsafe())) {
+                    preset = &presets[i];
+                }
+            }
+            uassert(17043, mongoutils::str::stream() << "unknown workload type " << type
+                    << ", expected one of \"a\" through \"f\"", preset != NULL);
+            readProportion = preset->read;
+            updateProportion = preset->update;
+            insertProportion = preset->insert;
+            scanProportion = preset->scan;
+            readModifyWriteProportion = preset->readModifyWrite;
+            distribution = preset->distribution;
+        }
+
+        setDouble(args, "readProportion", &readProportion);
+        setDouble(args, "updateProportion", &updateProportion);
+        setDouble(args, "insertProportion", &insertProportion);
+        setDouble(args, "scanProportion", &scanProportion);
+        setDouble(args, "readModifyWriteProportion", &readModifyWriteProportion);
+        uassert(17048, "workload proportions are all zero",
+                readProportion + updateProportion + insertProportion + scanProportion + readModifyWriteProportion > 0);
+
+        setInt(args, "recordCount", 0, &recordCount);
+        setBool(args, "load", &load);
+        setBool(args, "bulkLoad", &bulkLoad);
+        uassert(17047, "a workload that doesn't only insert needs a positive recordCount",
+                recordCount > 0 || readProportion + updateProportion + scanProportion + readModifyWriteProportion == 0);
+
+        if (!args["distribution"].eoo()) {
+            distribution = parseDistribution(args["distribution"]);
+        }
+        setInt(args, "maxScanLength", 1, &maxScanLength);
+        if (!args["scanLengthDistribution"].eoo()) {
+            KeyChooser::Distribution d = parseDistribution(args["scanLengthDistribution"]);
+            uassert(17049, "scanLengthDistribution must be uniform or zipfian",
+                    d == KeyChooser::UNIFORM || d == KeyChooser::ZIPFIAN);
+            zipfianScanLength = d == KeyChooser::ZIPFIAN;
+        }
+
+        setInt(args, "fieldCount", 1, &fieldCount);
+        setInt(args, "fieldLength", 1, &fieldLength);
+        setBool(args, "readAllFields", &readAllFields);
+        setBool(args, "writeAllFields", &writeAllFields);
+
+        setInt(args, "transactionSize", 0, &transactionSize);
+        if (!args["isolation"].eoo()) {
+            uassert(17050, "workload isolation must be a string", args["isolation"].type() == String);
+            isolation = args["isolation"].String();
+        }
+    }
+
+    const char* BenchWorkload::opName(Op op) {
+        switch (op) {
+        case READ: return "read";
+        case UPDATE: return "update";
+        case INSERT: return "insert";
+        case SCAN: return "scan";
+        case READ_MODIFY_WRITE: return "readModifyWrite";
+        }
+        return "unknown";
+    }
+
+    BenchWorkload::Op BenchWorkload::chooseOp(BenchRandom& random) const {
+        double u = random.nextDouble() *
+                (readProportion + updateProportion + insertProportion + scanProportion + readModifyWriteProportion);
+        if ((u -= readProportion) < 0) {
+            return READ;
+        }
+        if ((u -= updateProportion) < 0) {
+            return UPDATE;
+        }
+        if ((u -= insertProportion) < 0) {
+            return INSERT;
+        }
+        if ((u -= scanProportion) < 0) {
+            return SCAN;
+        }
+        if (readModifyWriteProportion > 0) {
+            return READ_MODIFY_WRITE;
+        }
+        // rounding put us past the end
+        return readProportion > 0 ? READ : updateProportion > 0 ? UPDATE : insertProportion > 0 ? INSERT : SCAN;
+    }
+
+    int BenchWorkload::chooseScanLength(BenchRandom& random, ZipfianGenerator& zipfian) const {
+        if (zipfianScanLength) {
+            return 1 + (int) zipfian.next(random, maxScanLength);
+        }
+        return 1 + (int) random.nextLong(maxScanLength);
+    }
+
+    std::string BenchWorkload::key(long long keynum) {
+        // FNV-1a, 64 bit, over the bytes of keynum
+        unsigned long long hash = 0xCBF29CE484222325ULL;
+        for (int i = 0; i < 8; i++) {
+            hash ^= (keynum >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+        return mongoutils::str::stream() << "user" << hash;
+    }
+
+    std::string BenchWorkload::fieldValue(BenchRandom& random) const {
+        std::string value(fieldLength, ' ');
+        unsigned long long bits = 0;
+        for (int i = 0; i < fieldLength; i++) {
+            if (i % 8 == 0) {
+                bits = random.next();
+            }
+            // printable, from ' ' to '~'
+            value[i] = (char) (' ' + (bits & 0xff) % 95);
+            bits >>= 8;
+        }
+        return value;
+    }
+
+    BSONObj BenchWorkload::record(long long keynum, BenchRandom& random) const {
+        BSONObjBuilder b(fieldCount * (fieldLength + 16) + 64);
+        b.append("_id", key(keynum));
+        for (int i = 0; i < fieldCount; i++) {
+            b.append(fieldName(i), fieldValue(random));
+        }
+        return b.obj();
+    }
+
+    BSONObj BenchWorkload::update(BenchRandom& random) const {
+        BSONObjBuilder b;
+        BSONObjBuilder set(b.subobjStart("$set"));
+        if (writeAllFields) {
+            for (int i = 0; i < fieldCount; i++) {
+                set.append(fieldName(i), fieldValue(random));
+            }
+        }
+        else {
+            set.append(fieldName(random.nextLong(fieldCount)), fieldValue(random));
+        }
+        set.done();
+        return b.obj();
+    }
+
+    BSONObj BenchWorkload::fields(BenchRandom& random) const {
+        if (readAllFields) {
+            return BSONObj();
+        }
+        return BSON(fieldName(random.nextLong(fieldCount)) << 1);
+    }
+
+}  // namespace mongo
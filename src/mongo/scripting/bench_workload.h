@@ -0,0 +1,189 @@
+// bench_workload.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * YCSB-style workloads for benchRun.  Instead of a fixed list of ops, a
+ * workload describes a mix of reads, updates, inserts, scans and
+ * read-modify-writes over a table of records, and which records they touch:
+ *
+ *   benchRun( { workload : { type : "a", ns : "test.usertable", recordCount : 100000,
+ *                            load : true, distribution : "zipfian" },
+ *               parallel : 8, seconds : 60, host : ... } )
+ *
+ * The six core workloads are built in (type "a" through "f"), and any of
+ * their settings can be overridden.  Everything here is free of I/O, so the
+ * generators can be tested on their own; bench.cpp does the talking.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * A small, fast xorshift64* generator.  Not thread safe; each worker
+     * has its own.
+     */
+    class BenchRandom {
+    public:
+        explicit BenchRandom(unsigned long long seed);
+
+        unsigned long long next();
+        /** uniform in [0, 1) */
+        double nextDouble();
+        /** uniform in [0, n), n > 0 */
+        long long nextLong(long long n) { return (long long) (next() % (unsigned long long) n); }
+
+    private:
+        unsigned long long _state;
+    };
+
+    /**
+     * Zipfian-distributed integers in [0, n), with 0 the most popular
+     * (Gray et al., "Quickly Generating Billion-Record Synthetic Databases").
+     * n may grow between calls, as records are inserted; the zeta constant
+     * is extended incrementally rather than recomputed.
+     */
+    class ZipfianGenerator {
+    public:
+        static const double ZIPFIAN_CONSTANT;
+
+        explicit ZipfianGenerator(double theta = ZIPFIAN_CONSTANT);
+
+        long long next(BenchRandom& random, long long n);
+
+    private:
+        void setItemCount(long long n);
+
+        const double _theta;
+        const double _alpha;
+        const double _zeta2;
+        long long _n;
+        double _zetan;
+        double _eta;
+    };
+
+    /**
+     * Picks which of the n records an operation touches.
+     *
+     *   uniform - all records alike
+     *   zipfian - a few popular records, scattered over the key space
+     *   latest  - zipfian, but the most recently inserted are the popular ones
+     *   hotspot - hotOpFraction of the operations go to the first hotSetFraction of the records
+     */
+    class KeyChooser {
+    public:
+        enum Distribution { UNIFORM, ZIPFIAN, LATEST, HOTSPOT };
+
+        /** @return false if name isn't a distribution */
+        static bool parseDistribution(const std::string& name, Distribution* out);
+
+        explicit KeyChooser(Distribution distribution,
+                            double hotSetFraction = 0.2, double hotOpFraction = 0.8);
+
+        /** a record number in [0, n), n > 0 */
+        long long next(BenchRandom& random, long long n);
+
+    private:
+        const Distribution _distribution;
+        const double _hotSetFraction;
+        const double _hotOpFraction;
+        ZipfianGenerator _zipfian;
+    };
+
+    /**
+     * Record numbers shared by all the workers of one run: the next one to
+     * insert, and how many inserts have been acknowledged, which is how many
+     * records reads may pick from.
+     */
+    struct BenchWorkloadKeys {
+        void reset(long long recordCount) {
+            nextInsert.store(recordCount);
+            inserted.store(recordCount);
+        }
+
+        AtomicInt64 nextInsert;
+        AtomicInt64 inserted;
+    };
+
+    /**
+     * The description of a workload, from benchRun's "workload" option.
+     */
+    class BenchWorkload {
+    public:
+        enum Op { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE };
+
+        /** Parses a workload description, uasserting if it's bad. */
+        explicit BenchWorkload(const BSONObj& args);
+
+        static const char* opName(Op op);
+
+        /** the mix of operations, drawn by proportion */
+        Op chooseOp(BenchRandom& random) const;
+
+        /** how many records a scan reads */
+        int chooseScanLength(BenchRandom& random, ZipfianGenerator& zipfian) const;
+
+        /** _id of record number keynum: hashed, so inserts are scattered */
+        static std::string key(long long keynum);
+
+        /** a whole record, with random field values */
+        BSONObj record(long long keynum, BenchRandom& random) const;
+
+        /** an update that rewrites one field, or all of them */
+        BSONObj update(BenchRandom& random) const;
+
+        /** what reads and scans return: every field, or just one */
+        BSONObj fields(BenchRandom& random) const;
+
+        std::string ns;
+
+        double readProportion;
+        double updateProportion;
+        double insertProportion;
+        double scanProportion;
+        double readModifyWriteProportion;
+
+        /** records already in ns, or loaded by BenchRunner before the run when load is set */
+        long long recordCount;
+        bool load;
+        /** load with beginLoad/commitLoad (ns must not exist yet) instead of inserts */
+        bool bulkLoad;
+
+        KeyChooser::Distribution distribution;
+        int maxScanLength;
+        bool zipfianScanLength;
+
+        int fieldCount;
+        int fieldLength;
+        bool readAllFields;
+        bool writeAllFields;
+
+        /** operations per multi-statement transaction, or 0 for none */
+        int transactionSize;
+        std::string isolation;
+
+    private:
+        std::string fieldValue(BenchRandom& random) const;
+    };
+
+}  // namespace mongo
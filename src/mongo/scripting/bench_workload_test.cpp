@@ -0,0 +1,136 @@
+// bench_workload_test.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <set>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/scripting/bench_workload.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+
+    const long long N = 1000;
+    const int DRAWS = 200000;
+
+    std::vector<long long> histogram(KeyChooser::Distribution d, long long n) {
+        BenchRandom random(42);
+        KeyChooser chooser(d);
+        std::vector<long long> counts(n);
+        for (int i = 0; i < DRAWS; i++) {
+            const long long k = chooser.next(random, n);
+            ASSERT_GREATER_THAN_OR_EQUALS(k, 0);
+            ASSERT_LESS_THAN(k, n);
+            counts[k]++;
+        }
+        return counts;
+    }
+
+    TEST(BenchWorkloadTest, Uniform) {
+        std::vector<long long> counts = histogram(KeyChooser::UNIFORM, N);
+        for (long long i = 0; i < N; i++) {
+            // expect 200 each
+            ASSERT_GREATER_THAN(counts[i], 100);
+            ASSERT_LESS_THAN(counts[i], 300);
+        }
+    }
+
+    TEST(BenchWorkloadTest, Zipfian) {
+        std::vector<long long> counts = histogram(KeyChooser::ZIPFIAN, N);
+        // with theta 0.99 and 1000 items, item 0 gets about 13%, item 1 half that
+        ASSERT_GREATER_THAN(counts[0], DRAWS / 10);
+        ASSERT_GREATER_THAN(counts[0], counts[1]);
+        ASSERT_GREATER_THAN(counts[1], counts[N - 1] * 10);
+    }
+
+    TEST(BenchWorkloadTest, Latest) {
+        std::vector<long long> counts = histogram(KeyChooser::LATEST, N);
+        ASSERT_GREATER_THAN(counts[N - 1], DRAWS / 10);
+        ASSERT_GREATER_THAN(counts[N - 1], counts[0] * 10);
+    }
+
+    TEST(BenchWorkloadTest, Hotspot) {
+        std::vector<long long> counts = histogram(KeyChooser::HOTSPOT, N);
+        long long hot = 0;
+        for (long long i = 0; i < N / 5; i++) {
+            hot += counts[i];
+        }
+        // 80% of the operations on the first 20% of the records
+        ASSERT_GREATER_THAN(hot, DRAWS * 3 / 4);
+        ASSERT_LESS_THAN(hot, DRAWS * 17 / 20);
+    }
+
+    TEST(BenchWorkloadTest, ZipfianGrows) {
+        BenchRandom random(7);
+        ZipfianGenerator zipfian;
+        for (long long n = 1; n < 5000; n++) {
+            ASSERT_LESS_THAN(zipfian.next(random, n), n);
+        }
+        // and shrinks
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_LESS_THAN(zipfian.next(random, 10), 10);
+        }
+    }
+
+    TEST(BenchWorkloadTest, Presets) {
+        BenchWorkload e(BSON("type" << "e" << "ns" << "test.usertable"));
+        ASSERT_EQUALS(0.95, e.scanProportion);
+        ASSERT_EQUALS(0.05, e.insertProportion);
+        ASSERT_EQUALS(0.0, e.readProportion);
+
+        BenchWorkload d(BSON("type" << "d" << "ns" << "test.usertable" << "distribution" << "uniform"));
+        ASSERT_EQUALS(KeyChooser::UNIFORM, d.distribution);
+
+        ASSERT_THROWS(BenchWorkload(BSON("type" << "g" << "ns" << "test.usertable")), UserException);
+        ASSERT_THROWS(BenchWorkload(BSON("type" << "a")), UserException);
+        ASSERT_THROWS(BenchWorkload(BSON("ns" << "test.usertable" << "distribution" << "normal")),
+                      UserException);
+        ASSERT_THROWS(BenchWorkload(BSON("ns" << "test.usertable" << "recordCount" << 0)),
+                      UserException);
+    }
+
+    TEST(BenchWorkloadTest, ChooseOp) {
+        BenchWorkload a(BSON("type" << "a" << "ns" << "test.usertable"));
+        BenchRandom random(1);
+        int reads = 0;
+        for (int i = 0; i < 10000; i++) {
+            const BenchWorkload::Op op = a.chooseOp(random);
+            ASSERT(op == BenchWorkload::READ || op == BenchWorkload::UPDATE);
+            reads += op == BenchWorkload::READ;
+        }
+        ASSERT_GREATER_THAN(reads, 4500);
+        ASSERT_LESS_THAN(reads, 5500);
+    }
+
+    TEST(BenchWorkloadTest, Records) {
+        BenchWorkload w(BSON("ns" << "test.usertable" << "fieldCount" << 3 << "fieldLength" << 20));
+        BenchRandom random(3);
+        BSONObj record = w.record(17, random);
+        ASSERT_EQUALS(BenchWorkload::key(17), record["_id"].String());
+        ASSERT_EQUALS(4, record.nFields());
+        ASSERT_EQUALS(20U, record["field2"].String().size());
+
+        std::set<std::string> keys;
+        for (long long i = 0; i < 10000; i++) {
+            keys.insert(BenchWorkload::key(i));
+        }
+        ASSERT_EQUALS(10000U, keys.size());
+    }
+
+} // namespace
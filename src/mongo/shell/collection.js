@@ -33,14 +33,17 @@ DBCollection.prototype.help = function () {
     print("\tdb." + shortName + ".find().help() - show DBCursor help");
     print("\tdb." + shortName + ".count()");
     print("\tdb." + shortName + ".copyTo(newColl) - duplicates collection by copying all documents to newColl; no indexes are copied.");
+    print("\tdb." + shortName + ".addPartition([newMax]) - for partitioned collections, starts a new partition; newMax is e.g. { _id: <value> }");
     print("\tdb." + shortName + ".convertToCapped(maxBytes) - calls {convertToCapped:'" + shortName + "', size:maxBytes}} command");
     print("\tdb." + shortName + ".dataSize()");
     print("\tdb." + shortName + ".distinct( key ) - e.g. db." + shortName + ".distinct( 'x' )");
     print("\tdb." + shortName + ".drop() drop the collection");
     print("\tdb." + shortName + ".dropIndex(index) - e.g. db." + shortName + ".dropIndex( \"indexName\" ) or db." + shortName + ".dropIndex( { \"indexKey\" : 1 } )");
     print("\tdb." + shortName + ".dropIndexes()");
+    print("\tdb." + shortName + ".dropPartition([id]) - for partitioned collections, drops the oldest partition (or the one with the given id)");
     print("\tdb." + shortName + ".ensureIndex(keypattern[,options]) - options is an object with these possible fields: name, unique, dropDups");
     print("\tdb." + shortName + ".reIndex()");
+    print("\tdb." + shortName + ".changeIndexAttributes(index, attrs) - attrs has any of compression, pageSize, readPageSize; index may be \"*\"");
     print("\tdb." + shortName + ".find([query],[fields]) - query is an optional query filter. fields is optional set of fields to return.");
     print("\t                                              e.g. db." + shortName + ".find( {x:77} , {name:1, x:1} )");
     print("\tdb." + shortName + ".find(...).count()");
@@ -51,9 +54,11 @@ DBCollection.prototype.help = function () {
     print("\tdb." + shortName + ".findAndModify( { update : ... , remove : bool [, query: {}, sort: {}, 'new': false] } )");
     print("\tdb." + shortName + ".getDB() get DB object associated with collection");
     print("\tdb." + shortName + ".getIndexes()");
+    print("\tdb." + shortName + ".getPartitionInfo() - for partitioned collections, lists the partitions");
     print("\tdb." + shortName + ".group( { key : ..., initial: ..., reduce : ...[, cond: ...] } )");
     print("\tdb." + shortName + ".insert(obj)");
     print("\tdb." + shortName + ".mapReduce( mapFunction , reduceFunction , <optional params> )");
+    print("\tdb." + shortName + ".parallelCollectionScan(n) - up to n cursors over disjoint ranges, reading one snapshot");
     print("\tdb." + shortName + ".remove(query)");
     print("\tdb." + shortName + ".renameCollection( newName , <dropTarget> ) renames the collection.");
     print("\tdb." + shortName + ".runCommand( name , <options> ) runs a db command with the given name where the first param is the collection name");
@@ -350,6 +355,14 @@ DBCollection.prototype.reIndex = function() {
     return this._db.runCommand({ reIndex: this.getName() });
 }
 
+DBCollection.prototype.changeIndexAttributes = function( index , attrs ) {
+    var cmd = { changeIndexAttributes: this.getName(), index: index };
+    for ( var k in attrs ) {
+        cmd[k] = attrs[k];
+    }
+    return this._db.runCommand( cmd );
+}
+
 DBCollection.prototype.dropIndexes = function(){
     this.resetIndexCache();
 
@@ -378,6 +391,31 @@ DBCollection.prototype.drop = function(){
     return true;
 }
 
+DBCollection.prototype.addPartition = function( newMax ){
+    var cmd = { addPartition: this.getName() };
+    if ( newMax )
+        cmd.newMax = newMax;
+    return this._db.runCommand( cmd );
+}
+
+DBCollection.prototype.dropPartition = function( id ){
+    var cmd = { dropPartition: this.getName() };
+    if ( id != undefined )
+        cmd.id = id;
+    return this._db.runCommand( cmd );
+}
+
+DBCollection.prototype.getPartitionInfo = function(){
+    return this._db.runCommand( { getPartitionInfo: this.getName() } );
+}
+
+DBCollection.prototype.parallelCollectionScan = function( numCursors ){
+    var res = this._db.runCommand( { parallelCollectionScan: this.getName(), numCursors: numCursors } );
+    assert.commandWorked( res, "parallelCollectionScan failed" );
+    var mongo = this._mongo;
+    return res.cursors.map( function( c ) { return new DBCommandCursor( mongo, c ); } );
+}
+
 DBCollection.prototype.findAndModify = function(args){
     var cmd = { findandmodify: this.getName() };
     for (var key in args){
@@ -18,21 +18,29 @@
 
 #include "mongo/pch.h"
 
+#include <deque>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <signal.h>
 #include <string.h>
 
+#include <boost/bind.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "mongo/tools/tool.h"
 
 #include "mongo/base/string_data.h"
 #include "mongo/client/connpool.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/queue.h"
 #include "mongo/util/timer.h"
+#include "third_party/murmurhash3/MurmurHash3.h"
 
 using namespace mongo;
 
@@ -44,64 +52,545 @@ static string fmtOpTime(const OpTime &t) {
     return ss.str();
 }
 
+/**
+ * One oplog entry's write to a single document, on its way to a worker.
+ */
+struct ReplayOp {
+    ReplayOp() : seq(0), op(0), flag(false) {}
+    // position in the stream of entries; 0 tells a worker to stop
+    unsigned long long seq;
+    char op;
+    string ns;
+    BSONObj o;
+    BSONObj o2;
+    // upsert for an update, justOne for a delete
+    bool flag;
+    // the whole entry, which o and o2 point into
+    BSONObj entry;
+};
+
+static size_t replayOpSize(const ReplayOp &op) {
+    return op.entry.isEmpty() ? 1 : op.entry.objsize();
+}
+
+/**
+ * Applies writes in the order they were queued, on one connection.  Runs
+ * its own thread once started; otherwise the dispatcher applies what's
+ * queued itself, with applyQueued().
+ *
+ * Inserts are applied so they can be applied twice, the way vanilla
+ * applyOperation does: a batch that hits a duplicate key is redone as
+ * upserts by _id, one document at a time.  After a failure, the other
+ * workers have applied entries past the point we resume from, and this is
+ * what lets the next run apply them again.
+ *
+ * Workers apply different documents' writes in a different order than the
+ * oplog, so a unique secondary index can report a duplicate that applying
+ * in order wouldn't.  A threaded worker that hits one keeps what it
+ * couldn't apply and pauses, and the dispatcher retries it alone once the
+ * other workers have caught up (see deferred() and retryDeferred()).
+ */
+class ReplayWorker : boost::noncopyable {
+    // enough for a few full insert batches
+    static const size_t MAX_QUEUED = 64 << 20;
+
+    enum Result { APPLIED, DUPLICATE_KEY, FAILED };
+
+    mongo::DBClientBase &_conn;
+    AtomicWord<long long> &_applied;
+    const bool _threaded;
+    BlockingQueue<ReplayOp> _queue;
+    AtomicWord<unsigned long long> _doneThrough;
+    AtomicWord<unsigned> _failed;
+    // set by the thread when it has ops in _deferred, cleared by the dispatcher
+    AtomicWord<unsigned> _paused;
+    AtomicWord<unsigned> _stopping;
+    // what the thread couldn't apply, only touched by the dispatcher while paused
+    vector<ReplayOp> _deferred;
+    scoped_ptr<boost::thread> _thread;
+    // What the dispatcher has queued here and not yet seen applied.  Only
+    // the dispatcher touches it.
+    deque<unsigned long long> _pending;
+
+    static bool isDuplicateKey(const BSONObj &res) {
+        const int code = res["code"].numberInt();
+        return code == 11000 || code == 11001;
+    }
+
+    Result lastResult(const ReplayOp &op, bool logDuplicate) {
+        const BSONObj res = _conn.getLastErrorDetailed(nsToDatabase(op.ns), false, false);
+        const string err = DBClientWithCommands::getLastErrorString(res);
+        if (err.empty()) {
+            return APPLIED;
+        }
+        const bool dup = isDuplicateKey(res);
+        if (!dup || logDuplicate) {
+            log() << "replay of operation " << op.entry << " failed: " << err << endl;
+        }
+        return dup ? DUPLICATE_KEY : FAILED;
+    }
+
+    Result applyOne(const ReplayOp &op, bool logDuplicate) {
+        if (op.op == 'i') {
+            const BSONElement id = op.o["_id"];
+            if (id.eoo()) {
+                _conn.insert(op.ns, op.o);
+            }
+            else {
+                _conn.update(op.ns, QUERY("_id" << id), op.o, true, false);
+            }
+        }
+        else if (op.op == 'u') {
+            _conn.update(op.ns, op.o2, op.o, op.flag, false);
+        }
+        else {
+            _conn.remove(op.ns, op.o, op.flag);
+        }
+        const Result r = lastResult(op, logDuplicate);
+        if (r == APPLIED) {
+            _applied.fetchAndAdd(1);
+            _doneThrough.store(op.seq);
+        }
+        return r;
+    }
+
+    bool apply(const ReplayOp &first) {
+        // keeps the entries the batched objects point into
+        vector<ReplayOp> ops(1, first);
+        if (first.op == 'i') {
+            // semes like enough room for headers/metadata
+            static const size_t MAX_SIZE = BSONObjMaxUserSize - (4<<10);
+            vector<BSONObj> objs(1, first.o);
+            size_t size = first.o.objsize();
+            ReplayOp next;
+            while (_queue.peek(next) && next.seq != 0 && next.op == 'i' && next.ns == first.ns &&
+                   size + next.o.objsize() <= MAX_SIZE) {
+                _queue.tryPop(next);
+                ops.push_back(next);
+                objs.push_back(next.o);
+                size += next.o.objsize();
+            }
+            _conn.insert(first.ns, objs);
+            const Result r = lastResult(first, false);
+            if (r == APPLIED) {
+                _applied.fetchAndAdd(objs.size());
+                _doneThrough.store(ops.back().seq);
+                return true;
+            }
+            if (r == FAILED) {
+                _failed.store(1);
+                return false;
+            }
+            // Some of them are already there, so write them one at a time.
+        }
+        for (size_t i = 0; i < ops.size(); i++) {
+            const Result r = applyOne(ops[i], !_threaded);
+            if (r == DUPLICATE_KEY && _threaded) {
+                _deferred.assign(ops.begin() + i, ops.end());
+                _paused.store(1);
+                return false;
+            }
+            if (r != APPLIED) {
+                _failed.store(1);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run(int id) {
+        setThreadName(string(mongoutils::str::stream() << "replay" << id).c_str());
+        for (ReplayOp op = _queue.blockingPop(); op.seq != 0; op = _queue.blockingPop()) {
+            if (_failed.load()) {
+                // drop everything after a failure, the resume point is before it
+                continue;
+            }
+            try {
+                apply(op);
+            }
+            catch (DBException &e) {
+                log() << "replay of operation " << op.entry << " failed: " << e.what() << endl;
+                _failed.store(1);
+            }
+            while (_paused.load() && !_stopping.load()) {
+                sleepmillis(1);
+            }
+            if (_paused.load()) {
+                // stopped without a retry, so what was deferred wasn't applied
+                _failed.store(1);
+            }
+        }
+    }
+
+  public:
+    ReplayWorker(mongo::DBClientBase &conn, AtomicWord<long long> &applied, bool threaded)
+            : _conn(conn), _applied(applied), _threaded(threaded),
+              _queue(threaded ? MAX_QUEUED : std::numeric_limits<size_t>::max(), replayOpSize) {}
+
+    ~ReplayWorker() {
+        stop();
+    }
+
+    void start(int id) {
+        _thread.reset(new boost::thread(boost::bind(&ReplayWorker::run, this, id)));
+    }
+
+    /** Apply everything queued and stop the thread, if there is one. */
+    void stop() {
+        if (_thread) {
+            _stopping.store(1);
+            _queue.push(ReplayOp());
+            _thread->join();
+            _thread.reset();
+        }
+    }
+
+    void push(const ReplayOp &op) {
+        _pending.push_back(op.seq);
+        _queue.push(op);
+    }
+
+    /** Like push(), but returns false instead of waiting for room. */
+    bool tryPush(const ReplayOp &op) {
+        if (!_queue.tryPush(op)) {
+            return false;
+        }
+        _pending.push_back(op.seq);
+        return true;
+    }
+
+    /** For a worker without a thread: apply what's been pushed. */
+    bool applyQueued() {
+        ReplayOp op;
+        while (!_failed.load() && _queue.tryPop(op)) {
+            try {
+                apply(op);
+            }
+            catch (DBException &) {
+                // don't apply anything after it on the way out
+                _failed.store(1);
+                throw;
+            }
+        }
+        return !_failed.load();
+    }
+
+    bool failed() const { return _failed.load() != 0; }
+    size_t queuedBytes() const { return _queue.size(); }
+
+    /** @return the first entry waiting for retryDeferred(), or 0 */
+    unsigned long long deferred() const {
+        return _paused.load() ? _deferred.front().seq : 0;
+    }
+
+    /**
+     * Apply what hit a duplicate key, in this thread, and let the worker go
+     * on.  Only for the dispatcher, once everything else handed out before
+     * it has been applied.
+     */
+    bool retryDeferred() {
+        LOG(1) << "retrying " << _deferred.size() << " operations alone, starting with "
+               << _deferred.front().entry << endl;
+        for (vector<ReplayOp>::const_iterator it = _deferred.begin(); it != _deferred.end(); ++it) {
+            Result r = FAILED;
+            try {
+                r = applyOne(*it, true);
+            }
+            catch (DBException &e) {
+                log() << "replay of operation " << it->entry << " failed: " << e.what() << endl;
+            }
+            if (r != APPLIED) {
+                _failed.store(1);
+                break;
+            }
+        }
+        _deferred.clear();
+        _paused.store(0);
+        return !_failed.load();
+    }
+
+    /** @return the first entry queued here but not yet applied, or 0 */
+    unsigned long long oldestPending() {
+        const unsigned long long done = _doneThrough.load();
+        while (!_pending.empty() && _pending.front() <= done) {
+            _pending.pop_front();
+        }
+        return _pending.empty() ? 0 : _pending.front();
+    }
+};
+
+/**
+ * Replays a vanilla oplog.  Writes to different documents go to different
+ * workers by a hash of the namespace and _id, so each document's writes
+ * stay in order while different documents' writes run concurrently.
+ * Commands, index builds and anything that can't be pinned to one
+ * document wait for every worker to finish what it has, and run alone, as
+ * do writes a worker deferred after a duplicate key.
+ *
+ * maxOpTimeSynced() is the last entry before which everything has been
+ * applied, which is where to resume from.
+ */
 class VanillaOplogPlayer : boost::noncopyable {
     mongo::DBClientBase &_conn;
     string _host;
     OpTime _maxOpTimeSynced;
     OpTime _thisTime;
-    vector<BSONObj> _insertBuf;
-    string _insertNs;
-    size_t _insertSize;
-    OpTime _insertMaxTime;
 
     volatile bool &_running;
     bool &_logAtExit;
 
-    void pushInsert(const StringData &ns, const BSONObj &o) {
-        uassert(16863, "cannot append an earlier optime", _thisTime > _insertMaxTime);
-        // semes like enough room for headers/metadata
-        static const size_t MAX_SIZE = BSONObjMaxUserSize - (4<<10);
-        if (ns != _insertNs || _insertSize + o.objsize() > MAX_SIZE) {
-            flushInserts();
-            _insertNs = ns.toString();
+    AtomicWord<long long> _applied;
+    // runs on _conn, in this thread: everything if there are no workers,
+    // otherwise the writes that have to run alone
+    ReplayWorker _serial;
+    vector<shared_ptr<ReplayWorker> > _workers;
+    unsigned long long _seq;
+    // entries not yet known to be applied, oldest first
+    deque<pair<unsigned long long, OpTime> > _unsynced;
+    // capped collections keep their insertion order, so they aren't split up
+    map<string, bool> _capped;
+
+    bool isCapped(const string &ns) {
+        map<string, bool>::const_iterator it = _capped.find(ns);
+        if (it == _capped.end()) {
+            BSONObj info = _conn.findOne(nsToDatabase(ns) + ".system.namespaces", BSON("name" << ns));
+            it = _capped.insert(make_pair(ns, info["options"]["capped"].trueValue())).first;
+        }
+        return it->second;
+    }
+
+    ReplayWorker &workerFor(const StringData &ns, const BSONElement &id) {
+        uint32_t h = 0;
+        MurmurHash3_x86_32(ns.rawData(), ns.size(), h, &h);
+        if (!isCapped(ns.toString())) {
+            MurmurHash3_x86_32(id.value(), id.valuesize(), h, &h);
+        }
+        return *_workers[h % _workers.size()];
+    }
+
+    void noteEntry() {
+        _unsynced.push_back(make_pair(++_seq, _thisTime));
+    }
+
+    void advanceSynced() {
+        unsigned long long safe = _seq;
+        unsigned long long p = _serial.oldestPending();
+        if (p != 0) {
+            safe = std::min(safe, p - 1);
+        }
+        for (vector<shared_ptr<ReplayWorker> >::const_iterator it = _workers.begin(); it != _workers.end(); ++it) {
+            p = (*it)->oldestPending();
+            if (p != 0) {
+                safe = std::min(safe, p - 1);
+            }
+        }
+        while (!_unsynced.empty() && _unsynced.front().first <= safe) {
+            _maxOpTimeSynced = _unsynced.front().second;
+            _unsynced.pop_front();
+        }
+    }
+
+    bool failed() const {
+        if (_serial.failed()) {
+            return true;
         }
-        _insertBuf.push_back(o.getOwned());
-        _insertSize += o.objsize();
-        _insertMaxTime = _thisTime;
+        for (vector<shared_ptr<ReplayWorker> >::const_iterator it = _workers.begin(); it != _workers.end(); ++it) {
+            if ((*it)->failed()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool applyCommand(const StringData &dbname, const BSONObj &o) {
+        BSONObj info;
+        bool ok = _conn.runCommand(dbname.toString(), o, info);
+        if (!ok) {
+            StringData fieldName = o.firstElementFieldName();
+            BSONElement errmsgElt = info["errmsg"];
+            StringData errmsg = errmsgElt.type() == String ? errmsgElt.Stringdata() : "";
+            bool isDropIndexes = (fieldName == "dropIndexes" || fieldName == "deleteIndexes");
+            if (((fieldName == "drop" || isDropIndexes) && errmsg == "ns not found") ||
+                (isDropIndexes && (errmsg == "index not found" || errmsg.find("can't find index with key:") == 0))) {
+                // This is actually ok.  We don't mind dropping something that's not there.
+                LOG(1) << "Tried to replay " << o << ", got " << info << ", ignoring." << endl;
+            }
+            else {
+                log() << "replay of command " << o << " failed: " << info << endl;
+                return false;
+            }
+        }
+        // a drop or convertToCapped may have changed what's capped
+        _capped.clear();
+        return true;
+    }
+
+    bool applyIndexInsert(const BSONObj &obj, const StringData &dbname, const string &nsstr, BSONObj o) {
+        // For now, we need to strip out any background fields from
+        // ensureIndex.  Once we do hot indexing we can do something more
+        // like what vanilla applyOperation_inlock does.
+        if (o["background"].trueValue()) {
+            BSONObjBuilder builder;
+            BSONObjIterator it(o);
+            while (it.more()) {
+                BSONElement e = it.next();
+                if (strncmp(e.fieldName(), "background", sizeof("background")) != 0) {
+                    builder.append(e);
+                }
+            }
+            o = builder.obj();
+        }
+        // We need to warn very carefully about dropDups.
+        const bool droppedDropDups = o["dropDups"].trueValue();
+        if (droppedDropDups) {
+            BSONObjBuilder builder;
+            BSONObjIterator it(o);
+            while (it.more()) {
+                BSONElement e = it.next();
+                if (strncmp(e.fieldName(), "dropDups", sizeof("dropDups")) != 0) {
+                    builder.append(e);
+                }
+            }
+            o = builder.obj();
+            warning() << "Detected an ensureIndex with dropDups: true in " << o << "." << endl;
+            warning() << "This option is not supported in TokuMX, because it deletes arbitrary data." << endl;
+            warning() << "If it were replayed, it could result in a completely different data set than the source database." << endl;
+            warning() << "We will attempt to replay it without dropDups, but if that fails, you must restart your migration process." << endl;
+        }
+        _conn.insert(nsstr, o);
+        string err = _conn.getLastError(dbname.toString(), false, false);
+        if (!err.empty()) {
+            log() << "replay of operation " << obj << " failed: " << err << endl;
+            if (droppedDropDups) {
+                warning() << "You cannot continue processing this replication stream.  You need to restart the migration process." << endl;
+                _running = false;
+                _logAtExit = false;
+                return true;
+            }
+            return false;
+        }
+        _applied.fetchAndAdd(1);
+        return true;
     }
 
   public:
+    /**
+     * @param workerConns connections for the workers, one each; with none,
+     *                    everything is applied on conn in this thread
+     */
     VanillaOplogPlayer(mongo::DBClientBase &conn, const string &host, const OpTime &maxOpTimeSynced,
-                       volatile bool &running, bool &logAtExit)
+                       volatile bool &running, bool &logAtExit,
+                       const vector<shared_ptr<DBClientBase> > &workerConns)
             : _conn(conn), _host(host), _maxOpTimeSynced(maxOpTimeSynced),
-              _running(running), _logAtExit(logAtExit) {}
+              _running(running), _logAtExit(logAtExit),
+              _serial(conn, _applied, false), _seq(0) {
+        for (size_t i = 0; i < workerConns.size(); i++) {
+            _workers.push_back(shared_ptr<ReplayWorker>(new ReplayWorker(*workerConns[i], _applied, true)));
+            _workers.back()->start(i);
+        }
+    }
 
-    void flushInserts() {
-        if (!_insertBuf.empty()) {
-            _conn.insert(_insertNs, _insertBuf);
-            verify(_maxOpTimeSynced < _insertMaxTime);
-            _maxOpTimeSynced = _insertMaxTime;
+    /**
+     * Wait for everything handed out so far to be applied, retrying what
+     * the workers deferred, oldest first, once the rest is done.
+     * @return false if any of it failed
+     */
+    bool flush() {
+        _serial.applyQueued();
+        while (true) {
+            ReplayWorker *retry = NULL;
+            bool busy = false;
+            for (vector<shared_ptr<ReplayWorker> >::const_iterator it = _workers.begin(); it != _workers.end(); ++it) {
+                ReplayWorker *w = it->get();
+                if (w->failed()) {
+                    continue;
+                }
+                const unsigned long long d = w->deferred();
+                if (d != 0) {
+                    if (retry == NULL || d < retry->deferred()) {
+                        retry = w;
+                    }
+                }
+                else if (w->oldestPending() != 0) {
+                    busy = true;
+                }
+            }
+            if (busy) {
+                sleepmillis(1);
+            }
+            else if (retry != NULL) {
+                retry->retryDeferred();
+            }
+            else {
+                break;
+            }
         }
-        _insertBuf.clear();
-        _insertSize = 0;
-        _insertNs = "";
-        _insertMaxTime = OpTime();
+        advanceSynced();
+        return !failed();
+    }
+
+    bool anyDeferred() const {
+        for (vector<shared_ptr<ReplayWorker> >::const_iterator it = _workers.begin(); it != _workers.end(); ++it) {
+            if ((*it)->deferred() != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Queue op on a worker.  A paused worker doesn't make room in its queue,
+     * so while waiting, retry what the workers deferred.
+     */
+    bool dispatch(ReplayWorker &w, const ReplayOp &op) {
+        while (!w.tryPush(op)) {
+            if (failed()) {
+                return false;
+            }
+            if (anyDeferred()) {
+                if (!flush()) {
+                    return false;
+                }
+            }
+            else {
+                sleepmillis(1);
+            }
+        }
+        return true;
+    }
+
+    /** Apply the inserts held back for batching, without waiting for the workers. */
+    bool applyBatched() {
+        return _serial.applyQueued();
+    }
+
+    /** Apply what the workers have and stop them, before exiting. */
+    void stop() {
+        flush();
+        for (vector<shared_ptr<ReplayWorker> >::const_iterator it = _workers.begin(); it != _workers.end(); ++it) {
+            (*it)->stop();
+        }
+        advanceSynced();
     }
 
     const OpTime &maxOpTimeSynced() const { return _maxOpTimeSynced; }
     const OpTime &thisTime() const { return _thisTime; }
     string maxOpTimeSyncedStr() const { return fmtOpTime(_maxOpTimeSynced); }
     string thisTimeStr() const { return fmtOpTime(_thisTime); }
+    long long applied() const { return _applied.load(); }
 
     bool processObj(const BSONObj &obj) {
+        if (failed() || (anyDeferred() && !flush())) {
+            return false;
+        }
         if (obj.hasField("$err")) {
             log() << "error getting oplog: " << obj << endl;
             return false;
         }
 
-        static const char *names[] = {"ts", "op", "ns", "o", "b"};
-        BSONElement fields[5];
-        obj.getFields(5, names, fields);
+        static const char *names[] = {"ts", "op", "ns", "o", "b", "o2"};
+        BSONElement fields[6];
+        obj.getFields(6, names, fields);
 
         BSONElement &tsElt = fields[0];
         if (!tsElt.ok()) {
@@ -121,12 +610,11 @@ class VanillaOplogPlayer : boost::noncopyable {
         }
         StringData op = opElt.Stringdata();
 
-        // nop
-        if (op == "n") {
-            return true;
-        }
-        // "presence of a database"
-        if (op == "db") {
+        // nop, or "presence of a database"
+        if (op == "n" || op == "db") {
+            noteEntry();
+            advanceSynced();
+            _thisTime = OpTime();
             return true;
         }
         if (op != "c" && op != "i" && op != "u" && op != "d") {
@@ -134,10 +622,6 @@ class VanillaOplogPlayer : boost::noncopyable {
             return false;
         }
 
-        if (op != "i" && !_insertBuf.empty()) {
-            flushInserts();
-        }
-
         BSONElement &nsElt = fields[2];
         if (!nsElt.ok()) {
             log() << "oplog format error: " << obj << " missing 'ns' field." << endl;
@@ -157,107 +641,80 @@ class VanillaOplogPlayer : boost::noncopyable {
             log() << "oplog format error: " << obj << " missing 'o' field." << endl;
             return false;
         }
-        BSONObj o = obj["o"].Obj();
+        BSONObj o = oElt.Obj();
 
         if (op == "c") {
             if (collname != "$cmd") {
                 log() << "oplog format error: invalid namespace '" << ns << "' for command in op " << obj << "." << endl;
                 return false;
             }
-            BSONObj info;
-            bool ok = _conn.runCommand(dbname.toString(), o, info);
-            if (!ok) {
-                StringData fieldName = o.firstElementFieldName();
-                BSONElement errmsgElt = info["errmsg"];
-                StringData errmsg = errmsgElt.type() == String ? errmsgElt.Stringdata() : "";
-                bool isDropIndexes = (fieldName == "dropIndexes" || fieldName == "deleteIndexes");
-                if (((fieldName == "drop" || isDropIndexes) && errmsg == "ns not found") ||
-                    (isDropIndexes && (errmsg == "index not found" || errmsg.find("can't find index with key:") == 0))) {
-                    // This is actually ok.  We don't mind dropping something that's not there.
-                    LOG(1) << "Tried to replay " << o << ", got " << info << ", ignoring." << endl;
-                }
-                else {
-                    log() << "replay of command " << o << " failed: " << info << endl;
-                    return false;
-                }
+            if (!flush() || !applyCommand(dbname, o)) {
+                return false;
+            }
+        }
+        else if (op == "i" && collname == "system.indexes") {
+            // Can't ensure multiple indexes in the same batch, nor while
+            // writes to the collection are still going on.
+            if (!flush() || !applyIndexInsert(obj, dbname, ns.toString(), o)) {
+                return false;
             }
         }
         else {
-            string nsstr = ns.toString();
+            ReplayOp rop;
+            rop.op = op[0];
+            rop.ns = ns.toString();
+            rop.o = o;
+            rop.entry = obj;
+            BSONElement id;
             if (op == "i") {
-                if (collname == "system.indexes") {
-                    // Can't ensure multiple indexes in the same batch.
-                    flushInserts();
-
-                    // For now, we need to strip out any background fields from
-                    // ensureIndex.  Once we do hot indexing we can do something more
-                    // like what vanilla applyOperation_inlock does.
-                    if (o["background"].trueValue()) {
-                        BSONObjBuilder builder;
-                        BSONObjIterator it(o);
-                        while (it.more()) {
-                            BSONElement e = it.next();
-                            if (strncmp(e.fieldName(), "background", sizeof("background")) != 0) {
-                                builder.append(e);
-                            }
-                        }
-                        o = builder.obj();
-                    }
-                    // We need to warn very carefully about dropDups.
-                    if (o["dropDups"].trueValue()) {
-                        BSONObjBuilder builder;
-                        BSONObjIterator it(o);
-                        while (it.more()) {
-                            BSONElement e = it.next();
-                            if (strncmp(e.fieldName(), "dropDups", sizeof("dropDups")) != 0) {
-                                builder.append(e);
-                            }
-                        }
-                        warning() << "Detected an ensureIndex with dropDups: true in " << o << "." << endl;
-                        warning() << "This option is not supported in TokuMX, because it deletes arbitrary data." << endl;
-                        warning() << "If it were replayed, it could result in a completely different data set than the source database." << endl;
-                        warning() << "We will attempt to replay it without dropDups, but if that fails, you must restart your migration process." << endl;
-                        _conn.insert(nsstr, o);
-                        string err = _conn.getLastError(dbname.toString(), false, false);
-                        if (!err.empty()) {
-                            log() << "replay of operation " << obj << " failed: " << err << endl;
-                            warning() << "You cannot continue processing this replication stream.  You need to restart the migration process." << endl;
-                            _running = false;
-                            _logAtExit = false;
-                            return true;
-                        }
-                    }
-                }
-                pushInsert(nsstr, o);
-                // Don't call GLE or update _maxOpTimeSynced yet.
-                _thisTime = OpTime();
-                return true;
+                id = o["_id"];
             }
             else if (op == "u") {
-                BSONElement o2Elt = obj["o2"];
+                BSONElement &o2Elt = fields[5];
                 if (!o2Elt.ok()) {
                     log() << "oplog format error: " << obj << " missing 'o2' field." << endl;
                     return false;
                 }
-                BSONElement &bElt = fields[4];
-                bool upsert = bElt.booleanSafe();
-                BSONObj o2 = o2Elt.Obj();
-                _conn.update(nsstr, o2, o, upsert, false);
-            }
-            else if (op == "d") {
-                BSONElement &bElt = fields[4];
-                bool justOne = bElt.booleanSafe();
-                _conn.remove(nsstr, o, justOne);
-            }
-            string err = _conn.getLastError(dbname.toString(), false, false);
-            if (!err.empty()) {
-                log() << "replay of operation " << obj << " failed: " << err << endl;
+                rop.o2 = o2Elt.Obj();
+                rop.flag = fields[4].booleanSafe();
+                id = rop.o2["_id"];
+            }
+            else {
+                rop.flag = fields[4].booleanSafe();
+                id = o["_id"];
+            }
+
+            noteEntry();
+            rop.seq = _seq;
+            if (_workers.empty()) {
+                // Inserts wait to be batched, unless there are plenty already.
+                _serial.push(rop);
+                if ((rop.op != 'i' || _serial.queuedBytes() >= BSONObjMaxUserSize) &&
+                    !_serial.applyQueued()) {
+                    return false;
+                }
+            }
+            else if (id.eoo()) {
+                // could touch any document, so let everything before it finish
+                if (!flush()) {
+                    return false;
+                }
+                _serial.push(rop);
+                if (!_serial.applyQueued()) {
+                    return false;
+                }
+            }
+            else if (!dispatch(workerFor(ns, id), rop)) {
                 return false;
             }
+            advanceSynced();
+            _thisTime = OpTime();
+            return true;
         }
 
         // If we got here, we completed the operation successfully.
-        _maxOpTimeSynced = _thisTime;
+        noteEntry();
+        advanceSynced();
         _thisTime = OpTime();
         return true;
     }
@@ -265,11 +722,107 @@ class VanillaOplogPlayer : boost::noncopyable {
 
 class OplogTool : public Tool {
     static const char *_tsFilename;
+    // fetched entries waiting to be dispatched
+    static const size_t MAX_FETCHED = 32 << 20;
     bool _logAtExit;
+    vector<shared_ptr<DBClientBase> > _workerConns;
     scoped_ptr<VanillaOplogPlayer> _player;
     scoped_ptr<ScopedDbConnection> _rconn;
+    // for report(), while _rconn is busy tailing
+    scoped_ptr<ScopedDbConnection> _reportConn;
     string _oplogns;
     mutable Timer _reportingTimer;
+    mutable long long _appliedAtReport;
+
+    static size_t fetchedSize(const BSONObj &obj) {
+        return obj.objsize();
+    }
+
+    void releaseConnections() {
+        if (_rconn) {
+            _rconn->done();
+            _rconn.reset();
+        }
+        if (_reportConn) {
+            _reportConn->done();
+            _reportConn.reset();
+        }
+    }
+
+    /** Stop applying, save our place and hang up. */
+    int finish(int ret) {
+        if (_player) {
+            try {
+                _player->stop();
+            }
+            catch (DBException &e) {
+                warning() << "Caught exception " << e.what() << " while finishing up." << endl;
+                ret = -1;
+            }
+        }
+        if (_logAtExit) {
+            logPosition();
+        }
+        releaseConnections();
+        return _logAtExit ? ret : -1;
+    }
+
+    void fetch(DBClientCursor *cursor, BlockingQueue<BSONObj> *fetched,
+               const AtomicWord<unsigned> *stop, string *error) {
+        setThreadName("fetcher");
+        try {
+            while (running && !stop->load() && cursor->more()) {
+                fetched->push(cursor->next().getOwned());
+            }
+        }
+        catch (std::exception &e) {
+            *error = e.what();
+        }
+        // the end
+        fetched->push(BSONObj());
+    }
+
+    /**
+     * Replay everything the cursor returns.  Another thread drives the
+     * cursor, so the next batch is on its way while this one is applied.
+     * @return false if an entry couldn't be replayed
+     */
+    bool replay(DBClientCursor &cursor, int reportingPeriod) {
+        BlockingQueue<BSONObj> fetched(MAX_FETCHED, fetchedSize);
+        string fetchError;
+        AtomicWord<unsigned> stopFetching;
+        boost::thread fetcher(boost::bind(&OplogTool::fetch, this, &cursor, &fetched,
+                                          &stopFetching, &fetchError));
+
+        bool ok = true;
+        for (BSONObj obj = fetched.blockingPop(); !obj.isEmpty(); obj = fetched.blockingPop()) {
+            if (!ok || !running) {
+                // The fetcher stops at its next entry.  Throw away what it
+                // already has, so it isn't left waiting for room to push the end.
+                stopFetching.store(1);
+                continue;
+            }
+            LOG(2) << obj << endl;
+            ok = _player->processObj(obj);
+            if (ok && fetched.empty()) {
+                // caught up with the source for now
+                ok = _player->applyBatched();
+            }
+            if (!ok) {
+                stopFetching.store(1);
+            }
+            if (_reportingTimer.seconds() >= reportingPeriod) {
+                report();
+            }
+        }
+        fetcher.join();
+
+        if (ok) {
+            ok = _player->flush();
+        }
+        uassert(17041, str::stream() << "error reading the oplog: " << fetchError, fetchError.empty());
+        return ok;
+    }
 
 public:
     void logPosition() const {
@@ -299,13 +852,15 @@ public:
     }
     static volatile bool running;
 
-    OplogTool() : Tool("2toku"), _logAtExit(true), _player(), _reportingTimer() {
+    OplogTool() : Tool("2toku"), _logAtExit(true), _player(), _reportingTimer(), _appliedAtReport(0) {
         addFieldOptions();
         add_options()
         ("ts" , po::value<string>() , "max OpTime already applied (secs:inc)" )
         ("from", po::value<string>() , "host to pull from" )
         ("oplogns", po::value<string>()->default_value( "local.oplog.rs" ) , "ns to pull from" )
         ("reportingPeriod", po::value<int>()->default_value(10) , "seconds between progress reports" )
+        ("numThreads", po::value<int>()->default_value(4) ,
+         "threads applying operations; each document's operations stay in order" )
         ;
     }
 
@@ -316,14 +871,21 @@ public:
     void report() const {
         const OpTime &maxOpTimeSynced = _player->maxOpTimeSynced();
         LOG(0) << "synced up to " << fmtOpTime(maxOpTimeSynced);
-        if (!_rconn) {
+        const long long applied = _player->applied();
+        const unsigned long long micros = _reportingTimer.micros();
+        if (micros > 0) {
+            LOG(0) << " (" << (applied - _appliedAtReport) * 1000000 / micros << " ops/sec)";
+        }
+        _appliedAtReport = applied;
+        _reportingTimer.reset();
+        if (!_reportConn) {
             LOG(0) << endl;
             return;
         }
         Query lastQuery;
         lastQuery.sort("$natural", -1);
         BSONObj lastFields = BSON("ts" << 1);
-        BSONObj lastObj = _rconn->conn().findOne(_oplogns, lastQuery, &lastFields);
+        BSONObj lastObj = _reportConn->conn().findOne(_oplogns, lastQuery, &lastFields);
         BSONElement tsElt = lastObj["ts"];
         if (!tsElt.ok()) {
             warning() << "couldn't find last oplog entry on remote host" << endl;
@@ -345,7 +907,6 @@ public:
                 LOG(0) << ", less than 1 second behind source." << endl;
             }
         }
-        _reportingTimer.reset();
     }
 
     int run() {
@@ -356,11 +917,34 @@ public:
 
         _oplogns = getParam("oplogns");
 
+        int numThreads = getParam("numThreads", 4);
+        if (numThreads < 1) {
+            log() << "numThreads must be at least 1" << endl;
+            return -1;
+        }
+        if (numThreads > 1 && hasParam("dbpath")) {
+            warning() << "applying with one thread because of --dbpath" << endl;
+            numThreads = 1;
+        }
+
         Client::initThread( "mongo2toku" );
 
         LOG(1) << "going to connect" << endl;
         
         _rconn.reset(ScopedDbConnection::getScopedDbConnection(getParam("from")));
+        _reportConn.reset(ScopedDbConnection::getScopedDbConnection(getParam("from")));
+        if (numThreads > 1) {
+            try {
+                for (int i = 0; i < numThreads; i++) {
+                    _workerConns.push_back(shared_ptr<DBClientBase>(newConnection()));
+                }
+            }
+            catch (std::exception &e) {
+                log() << "couldn't open connections for applying: " << e.what() << endl;
+                releaseConnections();
+                return -1;
+            }
+        }
 
         LOG(1) << "connected" << endl;
 
@@ -383,6 +967,7 @@ public:
             if (tsString.empty()) {
                 warning() << "No starting OpTime provided. "
                           << "Please find the right starting point and run again with --ts." << endl;
+                releaseConnections();
                 return -1;
             }
             unsigned secs, i;
@@ -390,11 +975,13 @@ public:
             int r = sscanf(tsString.c_str(), "%u:%u", &secs, &i);
             if (r != 2) {
                 warning() << "need to specify --ts as <secs>:<inc>" << endl;
+                releaseConnections();
                 return -1;
             }
             maxOpTimeSynced = OpTime(secs, i);
 
-            _player.reset(new VanillaOplogPlayer(conn(), _host, maxOpTimeSynced, running, _logAtExit));
+            _player.reset(new VanillaOplogPlayer(conn(), _host, maxOpTimeSynced, running, _logAtExit,
+                                                 _workerConns));
         }
 
         const int reportingPeriod = getParam("reportingPeriod", 10);
@@ -428,10 +1015,7 @@ public:
                     BSONElement tsElt = firstObj["ts"];
                     if (!tsElt.ok()) {
                         log() << "oplog format error: " << firstObj << " missing 'ts' field." << endl;
-                        logPosition();
-                        _rconn->done();
-                        _rconn.reset();
-                        return -1;
+                        return finish(-1);
                     }
                     OpTime firstTime(tsElt.date());
                     if (firstTime != _player->maxOpTimeSynced()) {
@@ -439,62 +1023,29 @@ public:
                                   << ", but didn't find anything before " << fmtOpTime(firstTime) << "!" << endl;
                         warning() << "This may mean your oplog has been truncated past the point you are trying to resume from." << endl;
                         warning() << "Either retry with a different value of --ts, or restart your migration procedure." << endl;
-                        _rconn->done();
-                        _rconn.reset();
+                        _player.reset();
+                        releaseConnections();
                         return -1;
                     }
                 }
 
                 report();
 
-                while (running && cursor->more()) {
-                    while (running && cursor->moreInCurrentBatch()) {
-                        BSONObj obj = cursor->next();
-                        LOG(2) << obj << endl;
-
-                        bool ok = _player->processObj(obj);
-                        if (!ok) {
-                            logPosition();
-                            _rconn->done();
-                            _rconn.reset();
-                            return -1;
-                        }
-                    }
-                    _player->flushInserts();
-
-                    if (_reportingTimer.seconds() >= reportingPeriod) {
-                        report();
-                    }
+                if (!replay(*cursor, reportingPeriod)) {
+                    return finish(-1);
                 }
             }
         }
         catch (DBException &e) {
             warning() << "Caught exception " << e.what() << " while processing.  Exiting..." << endl;
-            logPosition();
-            _rconn->done();
-            _rconn.reset();
-            return -1;
+            return finish(-1);
         }
         catch (...) {
             warning() << "Caught unknown exception while processing.  Exiting..." << endl;
-            logPosition();
-            _rconn->done();
-            _rconn.reset();
-            return -1;
+            return finish(-1);
         }
 
-        if (_logAtExit) {
-            logPosition();
-
-            _rconn->done();
-            _rconn.reset();
-            return 0;
-        }
-        else {
-            _rconn->done();
-            _rconn.reset();
-            return -1;
-        }
+        return finish(0);
     }
 };
 
@@ -26,9 +26,14 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/convenience.hpp>
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/base/initializer.h"
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/tools/tool.h"
+#include "mongo/util/queue.h"
 
 using namespace mongo;
 
@@ -51,6 +56,7 @@ public:
         ("oplog", "Use oplog for point-in-time snapshotting" )
         ("repair", "try to recover a crashed database" )
         ("forceTableScan", "force a table scan (do not use $snapshot)" )
+        ("numThreads", po::value<int>()->default_value(1), "number of collections, or ranges of a large collection, to dump concurrently" )
         ;
     }
 
@@ -67,11 +73,53 @@ public:
         out << "Export MongoDB data to BSON files.\n" << endl;
     }
 
+    // A collection's output file, shared by the threads dumping its ranges.
+    struct CollectionFile : boost::noncopyable {
+        CollectionFile(const string& ns_, const boost::filesystem::path& path_, unsigned long long count) :
+            ns(ns_), path(path_), lock("CollectionFile"), out(fopen(path.string().c_str(), "wb")),
+            m(count), rangesLeft(0) {
+            uassert(17066, errnoWithPrefix("couldn't open file"), out);
+            m.setUnits("objects");
+        }
+        ~CollectionFile() {
+            if (out) {
+                fclose(out);
+            }
+        }
+
+        const string ns;
+        const boost::filesystem::path path;
+        mongo::mutex lock;
+        FILE* out;
+        ProgressMeter m;
+        int rangesLeft;
+    };
+
+    // A range of a collection's primary key, dumped by one thread.  Empty
+    // bounds mean the start or the end of the collection.
+    struct Range {
+        shared_ptr<CollectionFile> file;
+        BSONObj min;
+        BSONObj max;
+    };
+
     // This is a functor that writes a BSONObj to a file
     struct Writer {
-        Writer(FILE* out, ProgressMeter* m) :_out(out), _m(m) {}
+        Writer(FILE* out, ProgressMeter* m, mongo::mutex* lock = NULL) :_out(out), _m(m), _lock(lock) {}
 
         void operator () (const BSONObj& obj) {
+            if (_lock) {
+                // Whole objects from each range, in any order, make a valid
+                // file for restore.
+                scoped_lock lk(*_lock);
+                write(obj);
+            }
+            else {
+                write(obj);
+            }
+        }
+
+        void write(const BSONObj& obj) {
             size_t toWrite = obj.objsize();
             size_t written = 0;
 
@@ -90,20 +138,29 @@ public:
 
         FILE* _out;
         ProgressMeter* _m;
+        mongo::mutex* _lock;
     };
 
     void doCollection( const string coll , FILE* out , ProgressMeter *m ) {
+        doCollection( conn(true), coll, BSONObj(), BSONObj(), Writer(out, m) );
+    }
+
+    void doCollection( DBClientBase& connBase, const string coll , const BSONObj& min, const BSONObj& max, Writer writer ) {
         Query q = _query;
 
         int queryOptions = QueryOption_SlaveOk | QueryOption_NoCursorTimeout;
         if (startsWith(coll.c_str(), "local.oplog."))
             queryOptions |= QueryOption_OplogReplay;
+        else if ( !min.isEmpty() || !max.isEmpty() ) {
+            q.hint(BSON("_id" << 1));
+            if ( !min.isEmpty() )
+                q.minKey(min);
+            if ( !max.isEmpty() )
+                q.maxKey(max);
+        }
         else if ( _query.isEmpty() && !hasParam("dbpath") && !hasParam("forceTableScan") ) {
             q.snapshot();
         }
-        
-        DBClientBase& connBase = conn(true);
-        Writer writer(out, m);
 
         // use low-latency "exhaust" mode if going over the network
         if (!_usingMongos && typeid(connBase) == typeid(DBClientConnection&)) {
@@ -134,6 +191,111 @@ public:
         log() << "\t\t " << m.done() << " objects" << endl;
     }
 
+    // Split points that cut the collection's primary key into about n
+    // ranges of equal size.  splitVector estimates them from the fractal
+    // tree without reading the collection.  If it can't (on mongos, or an
+    // old server), the collection is dumped as one range.
+    vector<BSONObj> splitPoints( const string& ns , int n ) {
+        vector<BSONObj> points;
+        if ( n <= 1 || _usingMongos || startsWith(ns.c_str(), "local.oplog.") ) {
+            return points;
+        }
+
+        NamespaceString nss( ns );
+        BSONObj stats;
+        if ( !conn( true ).runCommand( nss.db , BSON( "collStats" << nss.coll ) , stats ) ) {
+            return points;
+        }
+        const long long size = stats["size"].numberLong();
+        // Not worth splitting small collections.
+        static const long long minRangeSize = 64 << 20;
+        const long long ranges = std::min( (long long) n , size / minRangeSize );
+        if ( ranges <= 1 ) {
+            return points;
+        }
+
+        BSONObj res;
+        if ( !conn( true ).runCommand( nss.db , BSON( "splitVector" << ns <<
+                                                      "keyPattern" << BSON( "_id" << 1 ) <<
+                                                      "maxChunkSizeBytes" << size / ranges ) , res ) ) {
+            LOG(1) << "\tnot splitting " << ns << ": " << res << endl;
+            return points;
+        }
+        BSONObjIterator it( res["splitKeys"].Obj() );
+        while ( it.more() ) {
+            points.push_back( it.next().Obj().getOwned() );
+        }
+        return points;
+    }
+
+    void dumpRanges( BlockingQueue<shared_ptr<Range> >* ranges , int id ) {
+        setThreadName( string( str::stream() << "dump" << id ).c_str() );
+        scoped_ptr<DBClientBase> c;
+        try {
+            c.reset( newConnection() );
+        }
+        catch ( std::exception& e ) {
+            error() << "couldn't open a connection for dumping: " << e.what() << endl;
+            _failed.store(1);
+        }
+        for ( shared_ptr<Range> r = ranges->blockingPop(); r; r = ranges->blockingPop() ) {
+            if ( c ) {
+                dumpRange( *c , *r );
+            }
+        }
+    }
+
+    void dumpRange( DBClientBase& c , Range& r ) {
+        CollectionFile& file = *r.file;
+        try {
+            doCollection( c , file.ns , r.min , r.max , Writer( file.out , &file.m , &file.lock ) );
+        }
+        catch ( std::exception& e ) {
+            error() << "error dumping " << file.ns << ": " << e.what() << endl;
+            _failed.store(1);
+        }
+        scoped_lock lk( file.lock );
+        if ( --file.rangesLeft == 0 ) {
+            log() << "\t" << file.ns << " to " << file.path.string() << " done, "
+                  << file.m.done() << " objects" << endl;
+        }
+    }
+
+    // Dump the collections with _numThreads connections, splitting large
+    // collections by primary key so one big collection doesn't leave the
+    // other threads idle.
+    void writeCollectionFiles( const vector<pair<string, boost::filesystem::path> >& colls ) {
+        BlockingQueue<shared_ptr<Range> > ranges;
+        vector<shared_ptr<CollectionFile> > files;
+        for ( vector<pair<string, boost::filesystem::path> >::const_iterator it = colls.begin(); it != colls.end(); ++it ) {
+            const string& ns = it->first;
+            log() << "\t" << ns << " to " << it->second.string() << endl;
+            shared_ptr<CollectionFile> file( new CollectionFile( ns , it->second ,
+                                                                 conn( true ).count( ns.c_str() , BSONObj() , QueryOption_SlaveOk ) ) );
+            files.push_back( file );
+
+            const vector<BSONObj> points = splitPoints( ns , _numThreads );
+            file->rangesLeft = points.size() + 1;
+            for ( size_t i = 0; i <= points.size(); i++ ) {
+                shared_ptr<Range> r( new Range() );
+                r->file = file;
+                r->min = i == 0 ? BSONObj() : points[i - 1];
+                r->max = i == points.size() ? BSONObj() : points[i];
+                ranges.push( r );
+            }
+            if ( !points.empty() ) {
+                log() << "\t\t split into " << points.size() + 1 << " ranges" << endl;
+            }
+        }
+
+        boost::thread_group threads;
+        for ( int i = 0; i < _numThreads; i++ ) {
+            ranges.push( shared_ptr<Range>() );
+            threads.create_thread( boost::bind( &Dump::dumpRanges , this , &ranges , i ) );
+        }
+        threads.join_all();
+    }
+
     void writeMetadataFile( const string coll, boost::filesystem::path outputFile, 
                             map<string, BSONObj> options, multimap<string, BSONObj> indexes ) {
         log() << "\tMetadata for " << coll << " to " << outputFile.string() << endl;
@@ -229,12 +391,21 @@ public:
             collections.push_back(name);
         }
         
+        vector<pair<string, boost::filesystem::path> > collectionFiles;
         for (vector<string>::iterator it = collections.begin(); it != collections.end(); ++it) {
             string name = *it;
             const string filename = name.substr( db.size() + 1 );
-            writeCollectionFile( name , outdir / ( filename + ".bson" ) );
+            if ( _numThreads > 1 ) {
+                collectionFiles.push_back( make_pair( name , outdir / ( filename + ".bson" ) ) );
+            }
+            else {
+                writeCollectionFile( name , outdir / ( filename + ".bson" ) );
+            }
             writeMetadataFile( name, outdir / (filename + ".metadata.json"), collectionOptions, indexes);
         }
+        if ( !collectionFiles.empty() ) {
+            writeCollectionFiles( collectionFiles );
+        }
 
     }
 
@@ -322,6 +493,16 @@ public:
 
         _usingMongos = isMongos();
 
+        _numThreads = getParam( "numThreads" , 1 );
+        if ( _numThreads < 1 ) {
+            log() << "numThreads must be at least 1" << endl;
+            return -1;
+        }
+        if ( _numThreads > 1 && hasParam( "dbpath" ) ) {
+            warning() << "dumping with one thread because of --dbpath" << endl;
+            _numThreads = 1;
+        }
+
         boost::filesystem::path root( out );
         string db = _db;
 
@@ -368,10 +549,16 @@ public:
             writeCollectionFile( opLogName , root / "oplog.bson" );
         }
 
+        if ( _failed.load() ) {
+            error() << "dump failed, see errors above" << endl;
+            return -1;
+        }
         return 0;
     }
 
     bool _usingMongos;
+    int _numThreads;
+    AtomicWord<unsigned> _failed;
     BSONObj _query;
 };
 
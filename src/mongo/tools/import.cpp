@@ -22,15 +22,20 @@
 #include "mongo/db/namespacestring.h"
 #include "mongo/tools/tool.h"
 #include "mongo/util/text.h"
+#include "mongo/util/queue.h"
+#include "mongo/util/timer.h"
 #include "mongo/base/initializer.h"
 #include "mongo/client/remote_loader.h"
+#include "mongo/platform/atomic_word.h"
 
 #include <fstream>
 #include <iostream>
+#include <streambuf>
 
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace mongo;
 using std::string;
@@ -50,8 +55,50 @@ class Import : public Tool {
     bool _doimport;
     bool _jsonArray;
     bool _doBulkLoad;
+    bool _stopOnError;
+    bool _ordered;
+    int _numParseThreads;
+    int _numInsertionWorkers;
     vector<string> _upsertFields;
     static const int BUF_SIZE;
+    static const int CHUNK_SIZE;
+
+    // The import pipeline: a reader splits the input into chunks that end on
+    // record boundaries, parser threads turn each chunk into a batch of
+    // objects, and writers send each batch as one multi-document insert.
+    // Chunks are numbered so that an ordered import can write batches back
+    // in input order.
+    struct Chunk {
+        long long seq;
+        string data;
+    };
+    struct Batch {
+        long long seq;
+        vector<BSONObj> objs;
+    };
+    static size_t chunkSize(const shared_ptr<Chunk> &c) {
+        return c ? c->data.size() : 0;
+    }
+    static size_t batchSize(const shared_ptr<Batch> &b) {
+        return b ? b->objs.size() : 0;
+    }
+
+    // Lets a parser read a chunk with the same istream code that reads files,
+    // without copying it.
+    class ChunkStreambuf : public std::streambuf {
+    public:
+        ChunkStreambuf(string &data) {
+            char *p = data.empty() ? NULL : &data[0];
+            setg(p, p, p + data.size());
+        }
+    };
+
+    // A null chunk or batch marks the end of the stream for one consumer.
+    scoped_ptr<BlockingQueue<shared_ptr<Chunk> > > _chunks;
+    scoped_ptr<BlockingQueue<shared_ptr<Batch> > > _batches;
+    AtomicWord<long long> _num;
+    AtomicWord<int> _errors;
+    AtomicWord<unsigned> _stopped;
 
     void csvTokenizeRow(const string& row, vector<string>& tokens) {
         bool inQuotes = false;
@@ -175,9 +222,8 @@ class Import : public Tool {
      * file, unless the file is a CSV and contains a newline within a quoted string entry.
      * Returns a true if a BSONObj was successfully created and false if not.
      */
-    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
+    bool parseRow(istream* in, char* buffer, BSONObj& o, int& numBytesRead) {
+        char* line = buffer;
 
         numBytesRead = getLine(in, line);
         line += numBytesRead;
@@ -269,6 +315,252 @@ class Import : public Tool {
         return true;
     }
 
+    void noteError() {
+        _errors.fetchAndAdd(1);
+        if (_stopOnError) {
+            _stopped.store(1);
+        }
+    }
+
+    bool stopped() const {
+        return _stopped.load() != 0;
+    }
+
+    // Position just past the last complete record in data, or string::npos
+    // if there isn't one.  A newline inside a quoted CSV field doesn't end
+    // a record.
+    size_t recordBoundary(const string& data) const {
+        if (_type != CSV) {
+            const size_t nl = data.rfind('\n');
+            return nl == string::npos ? nl : nl + 1;
+        }
+        size_t boundary = string::npos;
+        bool insideQuotes = false;
+        for (size_t i = 0; i < data.size(); i++) {
+            if (data[i] == '"') {
+                insideQuotes = !insideQuotes;
+            }
+            else if (data[i] == '\n' && !insideQuotes) {
+                boundary = i + 1;
+            }
+        }
+        return boundary;
+    }
+
+    void readChunks(istream* in, ProgressMeter* pm) {
+        long long seq = 0;
+        long long bytesRead = 0;
+        time_t start = time(0);
+        string data;
+        try {
+            while (!stopped() && in->good()) {
+                const size_t oldSize = data.size();
+                data.resize(oldSize + CHUNK_SIZE);
+                in->read(&data[oldSize], CHUNK_SIZE);
+                data.resize(oldSize + in->gcount());
+                uassert( 17064 ,  "unknown error reading file" , !in->bad() );
+
+                const size_t boundary = in->good() ? recordBoundary(data) : data.size();
+                if (boundary == string::npos) {
+                    uassert(17065, str::stream() << "input line too long (max length: "
+                            << BUF_SIZE << ")", data.size() < (size_t) BUF_SIZE);
+                    continue;
+                }
+
+                shared_ptr<Chunk> chunk(new Chunk());
+                chunk->seq = seq++;
+                chunk->data.assign(data, 0, boundary);
+                data.erase(0, boundary);
+                _chunks->push(chunk);
+
+                bytesRead += boundary;
+                if (pm->hit(boundary)) {
+                    const long long num = _num.load();
+                    log() << "\t\t\t" << num << "\t" << ( num / std::max(time(0) - start, (time_t) 1) ) << "/second" << endl;
+                }
+            }
+        }
+        catch (std::exception& e) {
+            log() << "exception reading input at byte " << bytesRead << ": " << e.what() << endl;
+            _errors.fetchAndAdd(1);
+            _stopped.store(1);
+        }
+        for (int i = 0; i < _numParseThreads; i++) {
+            _chunks->push(shared_ptr<Chunk>());
+        }
+    }
+
+    void parseChunks(int id, double* mbPerSec) {
+        setThreadName(string(str::stream() << "importParser" << id).c_str());
+        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
+        long long bytesParsed = 0;
+        long long micros = 0;
+        for (shared_ptr<Chunk> chunk = _chunks->blockingPop(); chunk; chunk = _chunks->blockingPop()) {
+            shared_ptr<Batch> batch(new Batch());
+            batch->seq = chunk->seq;
+            if (!stopped()) {
+                Timer t;
+                ChunkStreambuf sb(chunk->data);
+                istream in(&sb);
+                while (in.rdstate() == 0) {
+                    try {
+                        BSONObj o;
+                        int len = 0;
+                        if (parseRow(&in, buffer.get(), o, len)) {
+                            batch->objs.push_back(o);
+                        }
+                    }
+                    catch (std::exception& e) {
+                        log() << "exception:" << e.what() << endl;
+                        log() << buffer.get() << endl;
+                        noteError();
+                        if (stopped()) {
+                            break;
+                        }
+                    }
+                }
+                micros += t.micros();
+                bytesParsed += chunk->data.size();
+            }
+            // Ordered writers wait for every sequence number, so even an
+            // empty batch goes through.
+            _batches->push(batch);
+        }
+        *mbPerSec = micros == 0 ? 0.0 : (bytesParsed / (1024.0 * 1024.0)) / (micros / 1000000.0);
+        LOG(1) << "parser thread " << id << " parsed " << bytesParsed << " bytes in "
+               << (micros / 1000) << "ms" << endl;
+    }
+
+    void readAndParse(istream* in, ProgressMeter* pm, vector<double>* parseRates) {
+        setThreadName("importReader");
+        boost::thread_group parsers;
+        for (int i = 0; i < _numParseThreads; i++) {
+            parsers.create_thread(boost::bind(&Import::parseChunks, this, i, &(*parseRates)[i]));
+        }
+        readChunks(in, pm);
+        parsers.join_all();
+        for (int i = 0; i < _numInsertionWorkers; i++) {
+            _batches->push(shared_ptr<Batch>());
+        }
+    }
+
+    void importObjects(DBClientBase& c, const string& ns, const vector<BSONObj>& objs) {
+        if (!_upsert) {
+            c.insert(ns, objs, _stopOnError ? 0 : InsertOption_ContinueOnError);
+            return;
+        }
+        for (vector<BSONObj>::const_iterator o = objs.begin(); o != objs.end(); ++o) {
+            bool doUpsert = true;
+            BSONObjBuilder b;
+            for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
+                BSONElement e = o->getFieldDotted(it->c_str());
+                if (e.eoo()) {
+                    doUpsert = false;
+                    break;
+                }
+                b.appendAs(e, *it);
+            }
+
+            if (doUpsert) {
+                c.update(ns, Query(b.obj()), *o, true);
+            }
+            else {
+                c.insert(ns.c_str(), *o);
+            }
+        }
+    }
+
+    void writeBatch(DBClientBase& c, const string& ns, const shared_ptr<Batch>& batch) {
+        if (stopped()) {
+            return;
+        }
+        try {
+            if (_doimport && !batch->objs.empty()) {
+                importObjects(c, ns, batch->objs);
+            }
+            _num.fetchAndAdd(batch->objs.size());
+        }
+        catch (std::exception& e) {
+            log() << "exception:" << e.what() << endl;
+            noteError();
+        }
+    }
+
+    void writeBatches(DBClientBase* c, const string& ns) {
+        // Batches waiting for an earlier one, when writing in order.
+        map<long long, shared_ptr<Batch> > pending;
+        long long nextSeq = 0;
+        for (shared_ptr<Batch> batch = _batches->blockingPop(); batch; batch = _batches->blockingPop()) {
+            if (!_ordered) {
+                writeBatch(*c, ns, batch);
+                continue;
+            }
+            pending[batch->seq] = batch;
+            for (map<long long, shared_ptr<Batch> >::iterator it = pending.begin();
+                 it != pending.end() && it->first == nextSeq; pending.erase(it++), nextSeq++) {
+                writeBatch(*c, ns, it->second);
+            }
+        }
+        c->getLastError();
+    }
+
+    void runWriter(const string& ns, int id) {
+        setThreadName(string(str::stream() << "importWriter" << id).c_str());
+        try {
+            scoped_ptr<DBClientBase> c(newConnection());
+            writeBatches(c.get(), ns);
+            return;
+        }
+        catch (std::exception& e) {
+            log() << "exception in writer " << id << ": " << e.what() << endl;
+            _errors.fetchAndAdd(1);
+            _stopped.store(1);
+        }
+        // Keep draining so the parsers don't block on a full queue.
+        for (shared_ptr<Batch> batch = _batches->blockingPop(); batch; batch = _batches->blockingPop()) {
+        }
+    }
+
+    int importJSONArray(istream* in, const string& ns, ProgressMeter& pm) {
+        time_t start = time(0);
+        int num = 0;
+        int errors = 0;
+        int len = 0;
+        // the whole array must be on one line
+        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
+        char* line = buffer.get();
+        int bytesProcessed = getLine(in, line);
+        line += bytesProcessed;
+        len += bytesProcessed;
+        while (true) {
+            try {
+                BSONObj o;
+                if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
+                    break;
+                }
+                len += bytesProcessed;
+                line += bytesProcessed;
+
+                if (_doimport) {
+                    importObjects(conn(), ns, vector<BSONObj>(1, o));
+                }
+                num++;
+            }
+            catch ( std::exception& e ) {
+                log() << "exception:" << e.what() << endl;
+                log() << line << endl;
+                errors++;
+                break;
+            }
+
+            if ( pm.hit( len + 1 ) ) {
+                log() << "\t\t\t" << num << "\t" << ( num / std::max(time(0) - start, (time_t) 1) ) << "/second" << endl;
+            }
+        }
+        _num.store(num);
+        return errors;
+    }
+
 public:
     Import() : Tool( "import" ) {
         addFieldOptions();
@@ -282,9 +574,13 @@ public:
         ("upsertFields", po::value<string>(), "comma-separated fields for the query part of the upsert. You should make sure this is indexed" )
         ("stopOnError", "stop importing at first error rather than continuing" )
         ("jsonArray", "load a json array, not one item per line. Currently limited to 16MB." )
+        ("numParseThreads", po::value<int>(), "number of threads parsing the input (default 1)" )
+        ("numInsertionWorkers", po::value<int>(), "number of connections inserting documents, requires --unordered if more than 1 (default 1)" )
+        ("unordered", "documents may be inserted in any order" )
+        ("noBulkLoad", "don't use a bulk load, even if the collection doesn't exist yet" )
         ;
         add_hidden_options()
-        ("noimport", "don't actually import. useful for benchmarking parser" )
+        ("noimport", "don't actually import. useful for benchmarking parser, reports MB/s per parser thread" )
         ;
         addPositionArg( "file" , 1 );
         _type = JSON;
@@ -293,6 +589,10 @@ public:
         _upsert = false;
         _doimport = true;
         _jsonArray = false;
+        _stopOnError = false;
+        _ordered = true;
+        _numParseThreads = 1;
+        _numInsertionWorkers = 1;
     }
 
     virtual void printExtraHelp( ostream & out ) {
@@ -302,7 +602,6 @@ public:
     int run() {
         string filename = getParam( "file" );
         long long fileSize = 0;
-        int headerRows = 0;
 
         istream * in = &cin;
 
@@ -386,10 +685,7 @@ public:
 
         if ( _type == CSV || _type == TSV ) {
             _headerLine = hasParam( "headerline" );
-            if ( _headerLine ) {
-                headerRows = 1;
-            }
-            else {
+            if ( ! _headerLine ) {
                 needFields();
             }
         }
@@ -398,15 +694,36 @@ public:
             _jsonArray = true;
         }
 
-        time_t start = time(0);
+        _stopOnError = hasParam("stopOnError") || _jsonArray;
+        _ordered = !hasParam("unordered");
+        _numParseThreads = getParam("numParseThreads", 1);
+        _numInsertionWorkers = getParam("numInsertionWorkers", 1);
+        if (_numParseThreads < 1 || _numInsertionWorkers < 1) {
+            error() << "numParseThreads and numInsertionWorkers must be at least 1" << endl;
+            return -1;
+        }
+        if (_numInsertionWorkers > 1 && _ordered) {
+            error() << "more than one insertion worker can't keep documents in order, use --unordered" << endl;
+            return -1;
+        }
+        if (_jsonArray && (_numParseThreads > 1 || _numInsertionWorkers > 1)) {
+            warning() << "a json array is imported by a single thread" << endl;
+        }
+
+        if (_doBulkLoad && _numInsertionWorkers > 1) {
+            warning() << "not using bulk load because numInsertionWorkers was specified" << endl;
+            _doBulkLoad = false;
+        }
+        if (_doBulkLoad && hasParam("noBulkLoad")) {
+            _doBulkLoad = false;
+        }
+        if (_doBulkLoad && conn().exists(ns)) {
+            warning() << "not using bulk load because " << ns << " already exists" << endl;
+            _doBulkLoad = false;
+        }
+
         LOG(1) << "filesize: " << fileSize << endl;
         ProgressMeter pm( fileSize );
-        int num = 0;
-        int errors = 0;
-        int len = 0;
-        // buffer and line are only used when parsing a jsonArray
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
 
         scoped_ptr<RemoteLoader> loader;
         if (_doBulkLoad) {
@@ -415,77 +732,58 @@ public:
             NamespaceString n(ns);
             loader.reset(new RemoteLoader(conn(), n.db, n.coll, vector<BSONObj>(), BSONObj()));
         }
-        while ( _jsonArray || in->rdstate() == 0 ) {
-            try {
-                BSONObj o;
-                if (_jsonArray) {
-                    int bytesProcessed = 0;
-                    if (line == buffer.get()) { // Only read on first pass - the whole array must be on one line.
-                        bytesProcessed = getLine(in, line);
-                        line += bytesProcessed;
-                        len += bytesProcessed;
-                    }
-                    if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
-                        len += bytesProcessed;
-                        break;
-                    }
-                    len += bytesProcessed;
-                    line += bytesProcessed;
-                }
-                else {
-                    if (!parseRow(in, o, len)) {
-                        continue;
-                    }
-                }
 
-                if ( _headerLine ) {
-                    _headerLine = false;
-                }
-                else if (_doimport) {
-                    bool doUpsert = _upsert;
-                    BSONObjBuilder b;
-                    if (_upsert) {
-                        for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
-                            BSONElement e = o.getFieldDotted(it->c_str());
-                            if (e.eoo()) {
-                                doUpsert = false;
-                                break;
-                            }
-                            b.appendAs(e, *it);
-                        }
-                    }
-
-                    if (doUpsert) {
-                        conn().update(ns, Query(b.obj()), o, true);
-                    }
-                    else {
-                        conn().insert( ns.c_str() , o );
-                    }
+        vector<double> parseRates(_numParseThreads);
+        if (_jsonArray) {
+            _errors.store(importJSONArray(in, ns, pm));
+        }
+        else {
+            if ( _headerLine ) {
+                boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
+                BSONObj o;
+                int len = 0;
+                while (in->rdstate() == 0 && !parseRow(in, buffer.get(), o, len)) {
                 }
-
-                num++;
+                pm.hit(len + 1);
+                _headerLine = false;
             }
-            catch ( std::exception& e ) {
-                log() << "exception:" << e.what() << endl;
-                log() << line << endl;
-                errors++;
 
-                if (hasParam("stopOnError") || _jsonArray)
-                    break;
-            }
-
-            if ( pm.hit( len + 1 ) ) {
-                log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
+            // A chunk per parser and a batch per writer in flight, plus one
+            // waiting for each.  The queue must also take the biggest chunk
+            // readChunks makes, a record just short of BUF_SIZE plus the read
+            // that finds its end, or pushing it would wait forever.
+            const size_t maxQueuedChunkBytes = std::max((size_t) 2 * _numParseThreads * CHUNK_SIZE,
+                                                        (size_t) BUF_SIZE + CHUNK_SIZE);
+            _chunks.reset(new BlockingQueue<shared_ptr<Chunk> >(maxQueuedChunkBytes + 1, chunkSize));
+            _batches.reset(new BlockingQueue<shared_ptr<Batch> >(2 * (_numParseThreads + _numInsertionWorkers)));
+
+            boost::thread reader(boost::bind(&Import::readAndParse, this, in, &pm, &parseRates));
+            boost::thread_group writers;
+            for (int i = 1; i < _numInsertionWorkers; i++) {
+                writers.create_thread(boost::bind(&Import::runWriter, this, ns, i));
             }
+            // The first writer uses the tool's own connection, which is the
+            // only one that can see a bulk load in progress.
+            writeBatches(&conn(), ns);
+            writers.join_all();
+            reader.join();
         }
+
         if (loader) {
             loader->commit();
         }
 
-        log() << "imported " << ( num - headerRows ) << " objects" << endl;
+        if (!_doimport && !_jsonArray) {
+            for (int i = 0; i < _numParseThreads; i++) {
+                log() << "parser thread " << i << ": " << parseRates[i] << " MB/s" << endl;
+            }
+        }
+
+        log() << "imported " << _num.load() << " objects" << endl;
 
         conn().getLastError();
 
+        const int errors = _errors.load();
         if ( errors == 0 )
             return 0;
 
@@ -500,3 +798,4 @@ int main( int argc , char ** argv, char** envp ) {
     return import.main( argc , argv );
 }
 const int Import::BUF_SIZE(1024 * 1024 * 16);
+const int Import::CHUNK_SIZE(1024 * 1024 * 4);
@@ -24,6 +24,7 @@
 #include <boost/program_options.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
 #include <fcntl.h>
 #include <fstream>
 #include <set>
@@ -35,6 +36,8 @@
 #include "mongo/db/json.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/remote_loader.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/queue.h"
 
 using namespace mongo;
 
@@ -48,14 +51,31 @@ public:
     bool _restoreIndexes;
     int _w;
     bool _doBulkLoad;
-    string _curns;
-    string _curdb;
-    string _curcoll;
-    set<string> _users; // For restoring users with --drop
+    int _numThreads;
+    AtomicWord<unsigned> _failed;
+
+    // A collection to restore, found while walking the dump directory.
+    struct CollectionFile {
+        boost::filesystem::path root;
+        string ns;
+        string oldCollName; // Name of the collection that was dumped from
+    };
+    vector<CollectionFile> _files;
+
+    // The state of restoring one collection, on one connection.
+    struct CollectionRestore {
+        CollectionRestore(DBClientBase &c, const string &ns) :
+            conn(c), curns(ns), curdb(NamespaceString(ns).db), curcoll(NamespaceString(ns).coll) {}
+        DBClientBase &conn;
+        const string curns;
+        const string curdb;
+        const string curcoll;
+        set<string> users; // For restoring users with --drop
+    };
 
     Restore() : BSONTool( "restore" ),
         _drop(false), _restoreOptions(false), _restoreIndexes(false),
-        _w(0), _doBulkLoad(false) {
+        _w(0), _doBulkLoad(false), _numThreads(1) {
 
         add_options()
         ("drop" , "drop each collection before import. RECOMMENDED, since only non-existent collections are eligible for the bulk load optimization.")
@@ -65,6 +85,7 @@ public:
         ("noOptionsRestore" , "don't restore collection options")
         ("noIndexRestore" , "don't restore indexes")
         ("w" , po::value<int>()->default_value(1) , "minimum number of replicas per write. WARNING, setting w > 0 prevents the bulk load optimization." )
+        ("numThreads", po::value<int>()->default_value(1), "number of collections to restore concurrently, each on its own connection" )
         ;
         add_hidden_options()
         ("dir", po::value<string>()->default_value("dump"), "directory to restore from")
@@ -124,11 +145,75 @@ public:
          * given either a root directory that contains only a single
          * .bson file, or a single .bson file itself (a collection).
          */
+        _numThreads = getParam( "numThreads" , 1 );
+        if (_numThreads < 1) {
+            error() << "numThreads must be at least 1" << endl;
+            return -1;
+        }
+        if (_numThreads > 1 && hasParam("dbpath")) {
+            warning() << "restoring with one thread because of --dbpath" << endl;
+            _numThreads = 1;
+        }
+
         drillDown(root, _db != "", _coll != "", true);
+        if (_numThreads == 1) {
+            for (vector<CollectionFile>::const_iterator it = _files.begin(); it != _files.end(); ++it) {
+                restoreCollection(conn(), *it);
+            }
+        }
+        else {
+            restoreCollections();
+        }
         conn().getLastError(_db == "" ? "admin" : _db);
+        if (_failed.load()) {
+            error() << "restore failed, see errors above" << endl;
+            return -1;
+        }
         return EXIT_CLEAN;
     }
 
+    // Each thread restores whole collections on its own connection, so that
+    // each collection still gets its own bulk load.
+    void restoreCollections() {
+        BlockingQueue<const CollectionFile *> files;
+        for (vector<CollectionFile>::const_iterator it = _files.begin(); it != _files.end(); ++it) {
+            files.push(&*it);
+        }
+        boost::thread_group threads;
+        for (int i = 0; i < _numThreads; i++) {
+            files.push(NULL);
+            threads.create_thread(boost::bind(&Restore::restoreThread, this, &files, i));
+        }
+        threads.join_all();
+    }
+
+    void restoreThread(BlockingQueue<const CollectionFile *> *files, int id) {
+        setThreadName(string(str::stream() << "restore" << id).c_str());
+        scoped_ptr<DBClientBase> c;
+        try {
+            c.reset(newConnection());
+        }
+        catch (std::exception &e) {
+            error() << "couldn't open a connection for restoring: " << e.what() << endl;
+            _failed.store(1);
+        }
+        for (const CollectionFile *f = files->blockingPop(); f != NULL; f = files->blockingPop()) {
+            if (!c) {
+                continue;
+            }
+            try {
+                restoreCollection(*c, *f);
+            }
+            catch (std::exception &e) {
+                error() << "error restoring " << f->ns << ": " << e.what() << endl;
+                _failed.store(1);
+            }
+        }
+        if (c) {
+            c->getLastError(_db == "" ? "admin" : _db);
+        }
+    }
+
     void drillDown( boost::filesystem::path root,
                     bool use_db,
                     bool use_coll,
@@ -221,26 +306,38 @@ public:
             ns += "." + oldCollName;
         }
 
+        CollectionFile f;
+        f.root = root;
+        f.ns = ns;
+        f.oldCollName = oldCollName;
+        _files.push_back(f);
+    }
+
+    void restoreCollection(DBClientBase &c, const CollectionFile &f) {
+        const boost::filesystem::path &root = f.root;
+        const string &ns = f.ns;
+        CollectionRestore r(c, ns);
+
         log() << "\tgoing into namespace [" << ns << "]" << endl;
 
         if ( _drop ) {
             if (root.leaf() != "system.users.bson" ) {
                 log() << "\t dropping" << endl;
-                conn().dropCollection( ns );
+                c.dropCollection( ns );
             } else {
                 // Create map of the users currently in the DB
                 BSONObj fields = BSON("user" << 1);
-                scoped_ptr<DBClientCursor> cursor(conn().query(ns, Query(), 0, 0, &fields));
+                scoped_ptr<DBClientCursor> cursor(c.query(ns, Query(), 0, 0, &fields));
                 while (cursor->more()) {
                     BSONObj user = cursor->next();
-                    _users.insert(user["user"].String());
+                    r.users.insert(user["user"].String());
                 }
             }
         }
 
         BSONObj metadataObject;
         if (_restoreOptions || _restoreIndexes) {
-            boost::filesystem::path metadataFile = (root.branch_path() / (oldCollName + ".metadata.json"));
+            boost::filesystem::path metadataFile = (root.branch_path() / (f.oldCollName + ".metadata.json"));
             if (!boost::filesystem::exists(metadataFile.string())) {
                 // This is fine because dumps from before 2.1 won't have a metadata file, just print a warning.
                 // System collections shouldn't have metadata so don't warn if that file is missing.
@@ -252,14 +349,10 @@ public:
             }
         }
 
-        _curns = ns.c_str();
-        _curdb = NamespaceString(_curns).db;
-        _curcoll = NamespaceString(_curns).coll;
-
         // If drop is not used, warn if the collection exists.
         if (!_drop) {
-            scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces",
-                                                            Query(BSON("name" << ns))));
+            scoped_ptr<DBClientCursor> cursor(c.query(r.curdb + ".system.namespaces",
+                                                      Query(BSON("name" << ns))));
             if (cursor->more()) {
                 // collection already exists show warning
                 warning() << "Restoring to " << ns << " without dropping. Restored data "
@@ -273,57 +366,64 @@ public:
             const vector<BSONElement> indexElements = metadataObject["indexes"].Array();
             for (vector<BSONElement>::const_iterator it = indexElements.begin(); it != indexElements.end(); ++it) {
                 // Need to make sure the ns field gets updated to
-                // the proper _curdb + _curns value, if we're
+                // the proper curdb + curcoll value, if we're
                 // restoring to a different database.
-                const BSONObj indexObj = renameIndexNs(it->Obj());
+                const BSONObj indexObj = renameIndexNs(r, it->Obj());
                 indexes.push_back(indexObj);
             }
         }
         const BSONObj options = _restoreOptions && metadataObject.hasField("options") ?
                                 metadataObject["options"].Obj() : BSONObj();
 
+        const boost::function<void (const BSONObj&)> insert =
+                boost::bind(&Restore::insertObject, this, boost::ref(r), _1);
         if (_doBulkLoad) {
-            RemoteLoader loader(conn(), _curdb, _curcoll, indexes, options);
-            processFile( root );
+            RemoteLoader loader(c, r.curdb, r.curcoll, indexes, options);
+            processFile( root , insert );
             loader.commit();
         } else {
             // No bulk load. Create collection and indexes manually.
             if (!options.isEmpty()) {
-                createCollectionWithOptions(options);
+                createCollectionWithOptions(r, options);
             }
             // Build indexes last - it's a little faster.
-            processFile( root );
+            processFile( root , insert );
             for (vector<BSONObj>::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                createIndex(*it);
+                createIndex(r, *it);
             }
         }
 
         if (_drop && root.leaf() == "system.users.bson") {
             // Delete any users that used to exist but weren't in the dump file
-            for (set<string>::iterator it = _users.begin(); it != _users.end(); ++it) {
+            for (set<string>::iterator it = r.users.begin(); it != r.users.end(); ++it) {
                 BSONObj userMatch = BSON("user" << *it);
-                conn().remove(ns, Query(userMatch));
+                c.remove(ns, Query(userMatch));
             }
-            _users.clear();
         }
     }
 
     virtual void gotObject( const BSONObj& obj ) {
+        // Every collection is read through processFile( root , insert ) in
+        // restoreCollection(), with its own state.
+        verify( false );
+    }
+
+    void insertObject( CollectionRestore& r, const BSONObj& obj ) {
         massert( 16910, "Shouldn't be inserting into system.indexes directly",
-                        !endsWith( _curns.c_str() , ".system.indexes" ));
-        if (_drop && endsWith(_curns.c_str(), ".system.users") && _users.count(obj["user"].String())) {
+                        !endsWith( r.curns.c_str() , ".system.indexes" ));
+        if (_drop && endsWith(r.curns.c_str(), ".system.users") && r.users.count(obj["user"].String())) {
             // Since system collections can't be dropped, we have to manually
             // replace the contents of the system.users collection
             BSONObj userMatch = BSON("user" << obj["user"].String());
-            conn().update(_curns, Query(userMatch), obj);
-            _users.erase(obj["user"].String());
+            r.conn.update(r.curns, Query(userMatch), obj);
+            r.users.erase(obj["user"].String());
         } else {
-            conn().insert( _curns , obj );
+            r.conn.insert( r.curns , obj );
 
             // wait for insert to propagate to "w" nodes (doesn't warn if w used without replset)
             if ( _w > 1 ) {
                 verify( !_doBulkLoad );
-                conn().getLastErrorDetailed(_curdb, false, false, _w);
+                r.conn.getLastErrorDetailed(r.curdb, false, false, _w);
             }
         }
     }
@@ -364,18 +464,18 @@ private:
         return nfields == obj2.nFields();
     }
 
-    void createCollectionWithOptions(BSONObj cmdObj) {
-        if (!cmdObj.hasField("create") || cmdObj["create"].String() != _curcoll) {
+    void createCollectionWithOptions(CollectionRestore &r, BSONObj cmdObj) {
+        if (!cmdObj.hasField("create") || cmdObj["create"].String() != r.curcoll) {
             BSONObjBuilder bo;
             if (!cmdObj.hasField("create")) {
-                bo.append("create", _curcoll);
+                bo.append("create", r.curcoll);
             }
 
             BSONObjIterator i(cmdObj);
             while ( i.more() ) {
                 BSONElement e = i.next();
                 if (strcmp(e.fieldName(), "create") == 0) {
-                    bo.append("create", _curcoll);
+                    bo.append("create", r.curcoll);
                 }
                 else {
                     bo.append(e);
@@ -385,14 +485,14 @@ private:
         }
 
         BSONObj fields = BSON("options" << 1);
-        scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces", Query(BSON("name" << _curns)), 0, 0, &fields));
+        scoped_ptr<DBClientCursor> cursor(r.conn.query(r.curdb + ".system.namespaces", Query(BSON("name" << r.curns)), 0, 0, &fields));
 
         bool createColl = true;
         if (cursor->more()) {
             createColl = false;
             BSONObj obj = cursor->next();
             if (!obj.hasField("options") || !optionsSame(cmdObj, obj["options"].Obj())) {
-                    log() << "WARNING: collection " << _curns << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
+                    log() << "WARNING: collection " << r.curns << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
             }
         }
 
@@ -401,20 +501,20 @@ private:
         }
 
         BSONObj info;
-        if (!conn().runCommand(_curdb, cmdObj, info)) {
-            uasserted(15936, "Creating collection " + _curns + " failed. Errmsg: " + info["errmsg"].String());
+        if (!r.conn.runCommand(r.curdb, cmdObj, info)) {
+            uasserted(15936, "Creating collection " + r.curns + " failed. Errmsg: " + info["errmsg"].String());
         } else {
-            log() << "\tCreated collection " << _curns << " with options: " << cmdObj.jsonString() << endl;
+            log() << "\tCreated collection " << r.curns << " with options: " << cmdObj.jsonString() << endl;
         }
     }
 
-    BSONObj renameIndexNs(const BSONObj &orig) {
+    BSONObj renameIndexNs(const CollectionRestore &r, const BSONObj &orig) {
         BSONObjBuilder bo;
         BSONObjIterator i(orig);
         while ( i.more() ) {
             BSONElement e = i.next();
             if (strcmp(e.fieldName(), "ns") == 0) {
-                string s = _curdb + "." + _curcoll;
+                string s = r.curdb + "." + r.curcoll;
                 bo.append("ns", s);
             }
             else if (strcmp(e.fieldName(), "v") != 0) { // Remove index version number
@@ -426,12 +526,12 @@ private:
 
     /* We must handle if the dbname or collection name is different at restore time than what was dumped.
      */
-    void createIndex(BSONObj indexObj) {
+    void createIndex(CollectionRestore &r, BSONObj indexObj) {
         LOG(0) << "\tCreating index: " << indexObj << endl;
-        conn().insert( _curdb + ".system.indexes" ,  indexObj );
+        r.conn.insert( r.curdb + ".system.indexes" ,  indexObj );
 
         // We're stricter about errors for indexes than for regular data
-        BSONObj err = conn().getLastErrorDetailed(_curdb, false, false, _w);
+        BSONObj err = r.conn.getLastErrorDetailed(r.curdb, false, false, _w);
 
         if (err.hasField("err") && !err["err"].isNull()) {
             if (err["err"].str() == "norepl" && _w > 1) {
@@ -435,6 +435,24 @@ namespace mongo {
         throw UserException( 9997 , (string)"authentication failed: " + errmsg );
     }
 
+    DBClientBase *Tool::newConnection() {
+        uassert( 17035 , "can't open more connections when using --dbpath" , ! _noconnection && _host != "DIRECT" );
+
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse( _host , errmsg );
+        uassert( 17036 , str::stream() << "invalid hostname [" << _host << "] " << errmsg , cs.isValid() );
+        auto_ptr<DBClientBase> c( cs.connect( errmsg ) );
+        uassert( 17037 , str::stream() << "couldn't connect to [" << _host << "] " << errmsg , c.get() );
+
+        if ( _username.size() || _password.size() ) {
+            if ( ! c->auth( _db , _username , _password , errmsg , true ) &&
+                 ! c->auth( "admin" , _username , _password , errmsg , true ) ) {
+                throw UserException( 9997 , (string)"authentication failed: " + errmsg );
+            }
+        }
+        return c.release();
+    }
+
     BSONTool::BSONTool( const char * name, DBAccess access , bool objcheck )
         : Tool( name , access , "" , "" , false ) , _objcheck( objcheck ) {
 
@@ -456,18 +474,24 @@ namespace mongo {
 
     long long BSONTool::processFile( const boost::filesystem::path& root ) {
         _fileName = root.string();
+        return processFile( root , boost::bind( &BSONTool::gotObject , this , _1 ) );
+    }
+
+    long long BSONTool::processFile( const boost::filesystem::path& root ,
+                                     const boost::function<void (const BSONObj&)>& callback ) {
+        const string fileName = root.string();
 
         unsigned long long fileLength = file_size( root );
 
         if ( fileLength == 0 ) {
-            out() << "file " << _fileName << " empty, skipping" << endl;
+            out() << "file " << fileName << " empty, skipping" << endl;
             return 0;
         }
 
 
-        FILE* file = fopen( _fileName.c_str() , "rb" );
+        FILE* file = fopen( fileName.c_str() , "rb" );
         if ( ! file ) {
-            log() << "error opening file: " << _fileName << " " << errnoWithDescription() << endl;
+            log() << "error opening file: " << fileName << " " << errnoWithDescription() << endl;
             return 0;
         }
 
@@ -517,7 +541,7 @@ namespace mongo {
             }
 
             if ( _matcher.get() == 0 || _matcher->matches( o ) ) {
-                gotObject( o );
+                callback( o );
                 processed++;
             }
 
@@ -106,6 +106,13 @@ namespace mongo {
         mongo::DBClientBase &conn( bool slaveIfPaired = false );
         void auth( string db = "",  Auth::Level * level = NULL);
 
+        /**
+         * Opens another connection to the server conn() talks to, authenticated
+         * with the same credentials, for tools that work from several threads.
+         * The caller owns the connection.  Not available with --dbpath.
+         */
+        mongo::DBClientBase *newConnection();
+
         string _name;
 
         string _db;
@@ -156,6 +163,10 @@ namespace mongo {
 
         long long processFile( const boost::filesystem::path& file );
 
+        /** Like processFile, but hands each object to callback instead of gotObject(). */
+        long long processFile( const boost::filesystem::path& file ,
+                               const boost::function<void (const BSONObj&)>& callback );
+
     };
 
 }
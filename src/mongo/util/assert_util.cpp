@@ -100,6 +100,7 @@ namespace mongo {
 #if defined(_DEBUG) || defined(_DURABLEDEFAULTON) || defined(_DURABLEDEFAULTOFF)
         // this is so we notice in buildbot
         log() << "\n\n***aborting after wassert() failure in a debug/test build\n\n" << endl;
+        Logstream::stopAsync();
         ::abort();
 #endif
     }
@@ -116,6 +117,7 @@ namespace mongo {
 #if defined(_DEBUG) || defined(_DURABLEDEFAULTON) || defined(_DURABLEDEFAULTOFF)
         // this is so we notice in buildbot
         log() << "\n\n***aborting after verify() failure as this is a debug/test build\n\n" << endl;
+        Logstream::stopAsync();
         ::abort();
 #endif
         throw e;
@@ -126,6 +128,7 @@ namespace mongo {
         logContext();
         breakpoint();
         log() << "\n\n***aborting after fassert() failure\n\n" << endl;
+        Logstream::stopAsync();
         ::abort();
     }
 
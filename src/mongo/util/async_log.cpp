@@ -0,0 +1,278 @@
+// @file async_log.cpp
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "pch.h"
+
+#include "mongo/util/async_log.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace {
+
+        unsigned long long roundUpToPowerOf2(size_t n) {
+            unsigned long long p = 2;
+            while (p < n) {
+                p <<= 1;
+            }
+            return p;
+        }
+
+        // Lines written with one write() at most; the rest wait for the next.
+        const size_t maxBatch = 256;
+
+        // How long stop() waits for the writer to finish its batch.
+        const int stopTimeoutSecs = 5;
+
+    } // namespace
+
+    AsyncLogWriter::AsyncLogWriter(Overflow overflow, size_t capacity) :
+        _overflow(overflow),
+        _mask(roundUpToPowerOf2(capacity) - 1),
+        _cells(_mask + 1),
+        _dequeuePos(0),
+        _m("AsyncLogWriter"),
+        _stopMutex("AsyncLogWriter::stop"),
+        _droppedReported(0) {
+        for (unsigned long long i = 0; i <= _mask; i++) {
+            _cells[i].seq.store(i);
+        }
+        _thread.reset(new boost::thread(boost::bind(&AsyncLogWriter::_run, this)));
+    }
+
+    AsyncLogWriter::~AsyncLogWriter() {
+        stop();
+    }
+
+    bool AsyncLogWriter::_tryPush(LogLevel level, std::string& text) {
+        unsigned long long pos = _enqueuePos.load();
+        while (true) {
+            Cell& cell = _cells[pos & _mask];
+            const unsigned long long seq = cell.seq.load();
+            const long long diff = (long long) (seq - pos);
+            if (diff == 0) {
+                // the slot is free, try to claim it
+                const unsigned long long found = _enqueuePos.compareAndSwap(pos, pos + 1);
+                if (found == pos) {
+                    cell.level = level;
+                    cell.text.swap(text);
+                    cell.seq.store(pos + 1);
+                    return true;
+                }
+                pos = found;
+            }
+            else if (diff < 0) {
+                // the writer hasn't emptied this slot since the last lap
+                return false;
+            }
+            else {
+                // another producer got it first
+                pos = _enqueuePos.load();
+            }
+        }
+    }
+
+    bool AsyncLogWriter::push(LogLevel level, std::string& text) {
+        _inFlight.fetchAndAdd(1);
+        if (_stopping.load()) {
+            _inFlight.fetchAndSubtract(1);
+            return false;
+        }
+
+        bool pushed = _tryPush(level, text);
+        if (!pushed) {
+            if (_overflow == DROP) {
+                _dropped.fetchAndAdd(1);
+            }
+            else {
+                _blocked.fetchAndAdd(1);
+                while (!pushed) {
+                    _waitForSpace();
+                    pushed = _tryPush(level, text);
+                }
+            }
+        }
+        _inFlight.fetchAndSubtract(1);
+
+        if (pushed && _writerSleeping.load()) {
+            scoped_lock lk(_m);
+            _work.notify_one();
+        }
+        return pushed;
+    }
+
+    void AsyncLogWriter::_waitForSpace() {
+        scoped_lock lk(_m);
+        _waitingProducers.fetchAndAdd(1);
+        // timed, so a wakeup that slips past us costs a little latency and
+        // nothing else
+        _space.timed_wait(lk.boost(), boost::posix_time::milliseconds(10));
+        _waitingProducers.fetchAndSubtract(1);
+    }
+
+    bool AsyncLogWriter::_empty() const {
+        const Cell& cell = _cells[_dequeuePos & _mask];
+        return cell.seq.load() != _dequeuePos + 1;
+    }
+
+    size_t AsyncLogWriter::_popBatch(std::vector<Record>& batch) {
+        size_t n = 0;
+        while (n < batch.size() && !_empty()) {
+            Cell& cell = _cells[_dequeuePos & _mask];
+            batch[n].level = cell.level;
+            batch[n].text.swap(cell.text);
+            cell.text.clear();
+            // free for the producer that wraps around to it
+            cell.seq.store(_dequeuePos + _mask + 1);
+            _dequeuePos++;
+            n++;
+        }
+        return n;
+    }
+
+    void AsyncLogWriter::_waitForWork() {
+        scoped_lock lk(_m);
+        _writerSleeping.store(1);
+        // A producer publishes its line before it looks at _writerSleeping,
+        // and we set _writerSleeping before looking for lines, so one of us
+        // sees the other.
+        if (_empty() && !_stopping.load()) {
+            _work.timed_wait(lk.boost(), boost::posix_time::milliseconds(100));
+        }
+        _writerSleeping.store(0);
+    }
+
+    void AsyncLogWriter::_write(std::vector<Record>& batch, size_t n) {
+        std::string dropNote;
+        const long long dropped = _dropped.load();
+        if (dropped != _droppedReported) {
+            char buf[64];
+            time_t_to_String(time(0), buf);
+            std::stringstream ss;
+            ss << std::string(buf, 20) << "warning: " << dropped - _droppedReported
+               << " log lines dropped, the log buffer was full\n";
+            dropNote = ss.str();
+            _droppedReported = dropped;
+        }
+
+        scoped_lock lk(Logstream::fileMutex);
+        if (Logstream::isSyslog) {
+            // syslog wants them one at a time, with their levels
+            if (!dropNote.empty()) {
+                Logstream::writeOut(LL_WARNING, dropNote);
+            }
+            for (size_t i = 0; i < n; i++) {
+                Logstream::writeOut(batch[i].level, batch[i].text);
+            }
+        }
+        else {
+            size_t size = dropNote.size();
+            for (size_t i = 0; i < n; i++) {
+                size += batch[i].text.size();
+            }
+            std::string out;
+            out.reserve(size);
+            out += dropNote;
+            for (size_t i = 0; i < n; i++) {
+                out += batch[i].text;
+            }
+            Logstream::writeOut(LL_INFO, out);
+        }
+        for (size_t i = 0; i < n; i++) {
+            batch[i].text.clear();
+        }
+        _written.fetchAndAdd(n);
+        _batches.fetchAndAdd(1);
+    }
+
+    void AsyncLogWriter::_run() {
+        std::vector<Record> batch(maxBatch);
+        while (true) {
+            const size_t n = _popBatch(batch);
+            if (n == 0) {
+                if (_stopping.load()) {
+                    break;
+                }
+                _waitForWork();
+                continue;
+            }
+            _write(batch, n);
+            if (_waitingProducers.load()) {
+                scoped_lock lk(_m);
+                _space.notify_all();
+            }
+        }
+    }
+
+    void AsyncLogWriter::stop() {
+        // Threads on their way to abort() may get here at once, or during
+        // a clean shutdown.
+        scoped_lock stopLock(_stopMutex);
+        if (!_thread) {
+            return;
+        }
+        _stopping.store(1);
+        if (boost::this_thread::get_id() == _thread->get_id()) {
+            // The writer itself is failing.  What it hasn't written yet is
+            // lost, but lines from here on are written by whoever logs them.
+            return;
+        }
+        {
+            scoped_lock lk(_m);
+            _work.notify_one();
+        }
+        if (!_thread->timed_join(boost::posix_time::seconds(stopTimeoutSecs))) {
+            // Stuck writing, probably behind a thread that is dying with
+            // the file lock.  It still owns the ring, so leave it be.
+            return;
+        }
+        _thread.reset();
+
+        // We're the consumer now.  Pushes that saw _stopping unset may still
+        // be on their way in, and blocked ones need room to finish.
+        std::vector<Record> batch(maxBatch);
+        while (true) {
+            const bool settled = _inFlight.load() == 0;
+            const size_t n = _popBatch(batch);
+            if (n != 0) {
+                _write(batch, n);
+                scoped_lock lk(_m);
+                _space.notify_all();
+            }
+            else if (settled) {
+                break;
+            }
+            else {
+                sleepmillis(1);
+            }
+        }
+    }
+
+    AsyncLogWriter::Stats AsyncLogWriter::stats() const {
+        Stats s;
+        s.written = _written.load();
+        s.dropped = _dropped.load();
+        s.blocked = _blocked.load();
+        s.batches = _batches.load();
+        return s;
+    }
+
+} // namespace mongo
@@ -0,0 +1,138 @@
+// @file async_log.h
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition.hpp>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/log.h"
+
+namespace boost {
+    class thread;
+}
+
+namespace mongo {
+
+    /**
+     * Takes the writing of formatted log lines off the threads that log them.
+     *
+     * Producers put lines in a bounded multi-producer, single-consumer ring
+     * (Vyukov's bounded queue: a slot is claimed with one compare-and-swap
+     * and published by bumping its sequence number), and a writer thread
+     * takes them out in batches and hands each batch to Logstream to write
+     * with a single write and flush.
+     *
+     * When the ring is full, a producer either waits for the writer to make
+     * room (BLOCK) or throws the line away and counts it (DROP).  The writer
+     * reports dropped lines in the log itself, so gaps can be spotted.
+     */
+    class AsyncLogWriter : boost::noncopyable {
+    public:
+        enum Overflow {
+            BLOCK,
+            DROP
+        };
+
+        struct Record {
+            LogLevel level;
+            std::string text;
+        };
+
+        struct Stats {
+            Stats() : written(0), dropped(0), blocked(0), batches(0) {}
+            long long written;
+            long long dropped;
+            // times a producer found the ring full and had to wait
+            long long blocked;
+            long long batches;
+        };
+
+        /** @param capacity lines the ring holds, rounded up to a power of 2 */
+        AsyncLogWriter(Overflow overflow, size_t capacity);
+        ~AsyncLogWriter();
+
+        /**
+         * Queue a line for writing.  Takes the contents of text (leaving it
+         * empty) unless it returns false.
+         * @return false if the line was dropped, or the writer has been
+         *         stopped and the caller must write it itself
+         */
+        bool push(LogLevel level, std::string& text);
+
+        /**
+         * Write everything queued so far and stop the writer thread.  Safe to
+         * call from several threads, and from the writer thread itself, so
+         * that paths about to abort() can call it.
+         */
+        void stop();
+
+        bool stopped() const { return _stopping.load() != 0; }
+        Overflow overflow() const { return _overflow; }
+        size_t capacity() const { return _mask + 1; }
+        Stats stats() const;
+
+    private:
+        struct Cell {
+            AtomicWord<unsigned long long> seq;
+            LogLevel level;
+            std::string text;
+        };
+
+        bool _tryPush(LogLevel level, std::string& text);
+        size_t _popBatch(std::vector<Record>& batch);
+        bool _empty() const;
+        void _waitForSpace();
+        void _waitForWork();
+        void _write(std::vector<Record>& batch, size_t n);
+        void _run();
+
+        const Overflow _overflow;
+        const unsigned long long _mask;
+        std::vector<Cell> _cells;
+        AtomicWord<unsigned long long> _enqueuePos;
+        // only the writer thread touches this, or stop() once it has joined
+        unsigned long long _dequeuePos;
+
+        // Sleeping and waking only; the ring itself is lock free.
+        mongo::mutex _m;
+        boost::condition _work;
+        boost::condition _space;
+        AtomicWord<unsigned> _writerSleeping;
+        AtomicWord<unsigned> _waitingProducers;
+
+        // pushes that have got past the _stopping check but not yet
+        // published their line
+        AtomicWord<unsigned> _inFlight;
+        AtomicWord<unsigned> _stopping;
+        boost::scoped_ptr<boost::thread> _thread;
+        mongo::mutex _stopMutex;
+
+        AtomicWord<long long> _written;
+        AtomicWord<long long> _dropped;
+        AtomicWord<long long> _blocked;
+        AtomicWord<long long> _batches;
+        long long _droppedReported;
+    };
+
+} // namespace mongo
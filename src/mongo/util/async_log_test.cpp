@@ -0,0 +1,154 @@
+// async_log_test.cpp
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdio>
+#include <set>
+#include <string>
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/async_log.h"
+
+namespace {
+    using namespace mongo;
+
+    const int numThreads = 4;
+    const int linesPerThread = 2000;
+
+    void logLines(AsyncLogWriter* writer, int thread) {
+        for (int i = 0; i < linesPerThread; i++) {
+            std::stringstream ss;
+            ss << thread << ' ' << i << '\n';
+            std::string line = ss.str();
+            writer->push(LL_INFO, line);
+        }
+    }
+
+    /** Sends the log to a temporary file for the life of the test. */
+    class LogCapture {
+    public:
+        LogCapture() : _f(tmpfile()) {
+            Logstream::setLogFile(_f);
+        }
+        ~LogCapture() {
+            Logstream::setLogFile(stdout);
+            fclose(_f);
+        }
+        /** @return the lines written, minus any dropped-lines warnings */
+        std::multiset<std::string> lines(int* warnings) {
+            std::multiset<std::string> all;
+            *warnings = 0;
+            rewind(_f);
+            char buf[256];
+            while (fgets(buf, sizeof buf, _f) != NULL) {
+                std::string line(buf);
+                if (line.find("log lines dropped") != std::string::npos) {
+                    ++*warnings;
+                }
+                else {
+                    all.insert(line);
+                }
+            }
+            return all;
+        }
+    private:
+        FILE* _f;
+    };
+
+    void runThreads(AsyncLogWriter* writer) {
+        boost::thread_group threads;
+        for (int t = 0; t < numThreads; t++) {
+            threads.add_thread(new boost::thread(boost::bind(logLines, writer, t)));
+        }
+        threads.join_all();
+    }
+
+    TEST(AsyncLogWriter, BlockWritesEverything) {
+        LogCapture capture;
+        // small, so producers have to wait for the writer
+        AsyncLogWriter writer(AsyncLogWriter::BLOCK, 8);
+        ASSERT_EQUALS(8U, writer.capacity());
+        runThreads(&writer);
+        writer.stop();
+
+        AsyncLogWriter::Stats stats = writer.stats();
+        ASSERT_EQUALS(numThreads * linesPerThread, stats.written);
+        ASSERT_EQUALS(0, stats.dropped);
+
+        int warnings;
+        std::multiset<std::string> lines = capture.lines(&warnings);
+        ASSERT_EQUALS(0, warnings);
+        ASSERT_EQUALS(size_t(numThreads * linesPerThread), lines.size());
+        for (int t = 0; t < numThreads; t++) {
+            for (int i = 0; i < linesPerThread; i++) {
+                std::stringstream ss;
+                ss << t << ' ' << i << '\n';
+                ASSERT_EQUALS(1U, lines.count(ss.str()));
+            }
+        }
+    }
+
+    TEST(AsyncLogWriter, DropCountsWhatItDrops) {
+        LogCapture capture;
+        AsyncLogWriter writer(AsyncLogWriter::DROP, 2);
+        runThreads(&writer);
+        writer.stop();
+
+        AsyncLogWriter::Stats stats = writer.stats();
+        ASSERT_EQUALS(numThreads * linesPerThread, stats.written + stats.dropped);
+        ASSERT_EQUALS(0, stats.blocked);
+
+        int warnings;
+        std::multiset<std::string> lines = capture.lines(&warnings);
+        ASSERT_EQUALS(size_t(stats.written), lines.size());
+        ASSERT_EQUALS(stats.dropped == 0, warnings == 0);
+    }
+
+    TEST(AsyncLogWriter, StoppedWriterRefusesLines) {
+        LogCapture capture;
+        AsyncLogWriter writer(AsyncLogWriter::BLOCK, 16);
+        std::string line("before\n");
+        ASSERT_TRUE(writer.push(LL_INFO, line));
+        ASSERT_TRUE(line.empty());
+        writer.stop();
+        ASSERT_TRUE(writer.stopped());
+
+        line = "after\n";
+        ASSERT_FALSE(writer.push(LL_INFO, line));
+        ASSERT_EQUALS("after\n", line);
+        ASSERT_EQUALS(1, writer.stats().written);
+    }
+
+    // As when several threads fail at once on their way to abort().
+    TEST(AsyncLogWriter, ConcurrentStopsWriteEverythingOnce) {
+        LogCapture capture;
+        AsyncLogWriter writer(AsyncLogWriter::BLOCK, 64);
+        runThreads(&writer);
+        boost::thread_group stoppers;
+        for (int t = 0; t < numThreads; t++) {
+            stoppers.add_thread(new boost::thread(boost::bind(&AsyncLogWriter::stop, &writer)));
+        }
+        stoppers.join_all();
+        ASSERT_TRUE(writer.stopped());
+
+        int warnings;
+        ASSERT_EQUALS(size_t(numThreads * linesPerThread), capture.lines(&warnings).size());
+        ASSERT_EQUALS(numThreads * linesPerThread, writer.stats().written);
+    }
+
+} // namespace
@@ -0,0 +1,264 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/util/buf_arena.h"
+
+#include <new>
+
+#include <boost/thread/tss.hpp>
+
+namespace mongo {
+
+    namespace {
+
+        // The Scope that installed the arena owns that, not the thread.
+        void noDelete(BufArena*) {}
+        boost::thread_specific_ptr<BufArena> currentArena(noDelete);
+
+        size_t roundUp(size_t n) {
+            return (n + 15) & ~size_t(15);
+        }
+
+        // Blocks kept around by reset() for the next operation.
+        const size_t retainedBlocks = 4;
+
+    } // namespace
+
+    // Every buffer is preceded by a header saying where it came from: a
+    // block, or malloc if block is NULL.
+    struct BufArena::Header {
+        Block* block;
+        size_t size;
+
+        char* data() {
+            return reinterpret_cast<char*>(this) + roundUp(sizeof(Header));
+        }
+        size_t footprint() const {
+            return roundUp(sizeof(Header)) + roundUp(size);
+        }
+        static Header* of(void* p) {
+            return reinterpret_cast<Header*>(static_cast<char*>(p) - roundUp(sizeof(Header)));
+        }
+    };
+
+    struct BufArena::Block {
+        // One per live buffer, plus one while the block belongs to an arena.
+        AtomicWord<unsigned> refs;
+        size_t size;
+        size_t used;
+
+        char* data() {
+            return reinterpret_cast<char*>(this) + roundUp(sizeof(Block));
+        }
+        bool isTop(Header* h) {
+            return reinterpret_cast<char*>(h) + h->footprint() == data() + used;
+        }
+    };
+
+    BufArena::BufArena(size_t blockSize) :
+        _blockSize(blockSize), _current(NULL), _depth(0) {
+    }
+
+    BufArena::~BufArena() {
+        for (std::vector<Block*>::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+            _release(*it);
+        }
+    }
+
+    BufArena* BufArena::current() {
+        return currentArena.get();
+    }
+
+    BufArena::Scope::Scope(BufArena& arena) : _arena(arena), _prev(currentArena.get()) {
+        _arena._depth++;
+        currentArena.reset(&_arena);
+    }
+
+    BufArena::Scope::~Scope() {
+        if (--_arena._depth == 0) {
+            _arena.reset();
+        }
+        currentArena.reset(_prev);
+    }
+
+    void BufArena::reset() {
+        std::vector<Block*> kept;
+        for (std::vector<Block*>::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+            Block* b = *it;
+            // Only this thread allocates from the block, so if nothing is
+            // live in it now, nothing will be.
+            if (b->refs.load() == 1 && kept.size() < retainedBlocks) {
+                b->used = 0;
+                kept.push_back(b);
+            }
+            else {
+                _release(b);
+            }
+        }
+        _blocks.swap(kept);
+        _current = _blocks.empty() ? NULL : _blocks.front();
+    }
+
+    BufArena::Block* BufArena::_newBlock(size_t size) {
+        void* p = malloc(roundUp(sizeof(Block)) + size);
+        if (p == NULL) {
+            return NULL;
+        }
+        _stats.mallocs++;
+        Block* b = new (p) Block;
+        b->refs.store(1);
+        b->size = size;
+        b->used = 0;
+        return b;
+    }
+
+    void BufArena::_release(Block* b) {
+        if (b->refs.subtractAndFetch(1) == 0) {
+            b->~Block();
+            ::free(b);
+        }
+    }
+
+    void* BufArena::_allocate(size_t size) {
+        _stats.allocations++;
+        _stats.bytes += size;
+        const size_t need = roundUp(sizeof(Header)) + roundUp(size);
+        Block* b = _current;
+        if (b == NULL || b->used + need > b->size) {
+            if (need > _blockSize / 4) {
+                // Too big to share a block, so it gets one of its own that
+                // the arena doesn't hold on to.
+                b = _newBlock(need);
+                if (b == NULL) {
+                    return NULL;
+                }
+                b->refs.store(0);
+            }
+            else {
+                b = NULL;
+                for (std::vector<Block*>::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+                    if (*it != _current && (*it)->refs.load() == 1) {
+                        b = *it;
+                        b->used = 0;
+                        break;
+                    }
+                }
+                if (b == NULL) {
+                    b = _newBlock(_blockSize);
+                    if (b == NULL) {
+                        return NULL;
+                    }
+                    _blocks.push_back(b);
+                }
+                _current = b;
+            }
+        }
+        Header* h = reinterpret_cast<Header*>(b->data() + b->used);
+        b->used += need;
+        b->refs.fetchAndAdd(1);
+        h->block = b;
+        h->size = size;
+        return h->data();
+    }
+
+    bool BufArena::_extend(Header* h, size_t size) {
+        Block* b = h->block;
+        if (b != _current || !b->isTop(h)) {
+            return false;
+        }
+        const size_t offset = reinterpret_cast<char*>(h) - b->data();
+        const size_t need = roundUp(sizeof(Header)) + roundUp(size);
+        if (offset + need > b->size) {
+            return false;
+        }
+        b->used = offset + need;
+        h->size = size;
+        return true;
+    }
+
+    void BufArena::_released(Block* b) {
+        if (b->refs.subtractAndFetch(1) == 1) {
+            // nothing live in it, start it over
+            b->used = 0;
+        }
+    }
+
+    void* BufArena::allocate(size_t size) {
+        BufArena* arena = current();
+        if (arena != NULL) {
+            return arena->_allocate(size);
+        }
+        Header* h = static_cast<Header*>(malloc(roundUp(sizeof(Header)) + size));
+        if (h == NULL) {
+            return NULL;
+        }
+        h->block = NULL;
+        h->size = size;
+        return h->data();
+    }
+
+    void* BufArena::reallocate(void* p, size_t size) {
+        if (p == NULL) {
+            return allocate(size);
+        }
+        Header* h = Header::of(p);
+        if (h->block == NULL) {
+            Header* n = static_cast<Header*>(realloc(h, roundUp(sizeof(Header)) + size));
+            if (n == NULL) {
+                return NULL;
+            }
+            n->size = size;
+            return n->data();
+        }
+        BufArena* arena = current();
+        if (arena != NULL && arena->_extend(h, size)) {
+            return p;
+        }
+        void* q = allocate(size);
+        if (q == NULL) {
+            return NULL;
+        }
+        memcpy(q, p, std::min(h->size, size));
+        free(p);
+        return q;
+    }
+
+    void BufArena::free(void* p) {
+        if (p == NULL) {
+            return;
+        }
+        Header* h = Header::of(p);
+        Block* b = h->block;
+        if (b == NULL) {
+            ::free(h);
+            return;
+        }
+        BufArena* arena = current();
+        if (arena != NULL && b == arena->_current) {
+            if (b->isTop(h)) {
+                // freed in the order it was allocated, as stack-scoped
+                // builders are
+                b->used = reinterpret_cast<char*>(h) - b->data();
+            }
+            arena->_released(b);
+            return;
+        }
+        _release(b);
+    }
+
+} // namespace mongo
@@ -0,0 +1,134 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/bson/util/builder.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * A bump allocator for the transient buffers of one operation.
+     *
+     * Each Client owns one, and assembleResponse installs it on the thread
+     * for the length of an operation (see BufArena::Scope).  Buffers built
+     * with ArenaAllocator while an arena is installed are carved out of
+     * its blocks instead of coming from malloc, and freeing them is nearly
+     * free: a block is rewound as soon as nothing in it is live, which for
+     * stack-scoped builders happens all the time.
+     *
+     * A block holds a reference count of the allocations in it, plus one
+     * for the arena.  Buffers that outlive the operation, or that are
+     * freed by another thread, just keep their block alive until they are
+     * freed, so nothing here needs the builders to be well behaved.  Each
+     * such buffer pins a whole block, though, so anything kept past the
+     * current call should be copied out first (see storage::Key::makeOwned).
+     */
+    class BufArena : boost::noncopyable {
+    public:
+        struct Stats {
+            Stats() : allocations(0), bytes(0), mallocs(0) {}
+            // buffers handed out, and the bytes asked for
+            long long allocations;
+            long long bytes;
+            // blocks that had to come from malloc
+            long long mallocs;
+        };
+
+        explicit BufArena(size_t blockSize = 64 * 1024);
+        ~BufArena();
+
+        /**
+         * Give back every block with nothing live in it, except for a few
+         * kept for the next operation.  Blocks that still hold live buffers
+         * are let go, and freed along with their last buffer.
+         */
+        void reset();
+
+        const Stats& stats() const { return _stats; }
+
+        /** @return the arena installed on this thread, or NULL. */
+        static BufArena* current();
+
+        /**
+         * Installs an arena on this thread.  Scopes nest: a nested
+         * operation (through DBDirectClient) shares its Client's arena, so
+         * only the outermost scope resets it.
+         */
+        class Scope : boost::noncopyable {
+        public:
+            explicit Scope(BufArena& arena);
+            ~Scope();
+        private:
+            BufArena& _arena;
+            BufArena* _prev;
+        };
+
+        // The ArenaAllocator policy.  Buffers come from the current arena if
+        // there is one and from malloc otherwise, and either way may be
+        // reallocated and freed on any thread.
+        static void* allocate(size_t size);
+        static void* reallocate(void* p, size_t size);
+        static void free(void* p);
+
+    private:
+        struct Block;
+        struct Header;
+
+        void* _allocate(size_t size);
+        bool _extend(Header* h, size_t size);
+        void _released(Block* block);
+        Block* _newBlock(size_t size);
+        static void _release(Block* block);
+
+        const size_t _blockSize;
+        Block* _current;
+        std::vector<Block*> _blocks;
+        int _depth;
+        Stats _stats;
+    };
+
+    class ArenaAllocator {
+    public:
+        void* Malloc(size_t sz) { return BufArena::allocate(sz); }
+        void* Realloc(void *p, size_t sz) { return BufArena::reallocate(p, sz); }
+        void Free(void *p) { BufArena::free(p); }
+    };
+
+    /** A BufBuilder drawing from the current BufArena.  Like StackBufBuilder,
+        it cannot decouple() its buffer, since free() could not release it.
+    */
+    class ArenaBufBuilder : public _BufBuilder<ArenaAllocator> {
+    public:
+        ArenaBufBuilder(int initsize = 512) : _BufBuilder<ArenaAllocator>(initsize) { }
+        void decouple(); // not allowed. not implemented.
+    };
+
+    /** Small buffers on the stack, larger ones in the current BufArena. */
+    class StackArenaBufBuilder : public _BufBuilder<_StackAllocator<ArenaAllocator> > {
+    public:
+        StackArenaBufBuilder() : _BufBuilder<_StackAllocator<ArenaAllocator> >(StackAllocator::SZ) { }
+        void decouple(); // not allowed. not implemented.
+    };
+
+    typedef StringBuilderImpl<ArenaAllocator> ArenaStringBuilder;
+
+} // namespace mongo
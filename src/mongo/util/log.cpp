@@ -20,6 +20,7 @@
 #include "pch.h"
 #include "assert_util.h"
 #include "time_support.h"
+#include "mongo/util/async_log.h"
 #include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/stacktrace.h"
 
@@ -46,6 +47,8 @@ namespace mongo {
     int logLevel = 0;
     int tlogLevel = 0; // test log level. so we avoid overchattiness (somewhat) in the c++ unit tests
     mongo::mutex Logstream::mutex("Logstream");
+    mongo::mutex Logstream::fileMutex("Logstream::file");
+    AsyncLogWriter* Logstream::asyncWriter = NULL;
     int Logstream::doneSetup = Logstream::magicNumber();
 
     const char *default_getcurns() { return ""; }
@@ -357,37 +360,68 @@ namespace mongo {
             string out( b.buf() , b.len() - 1);
             verify( b.len() < spaceNeeded );
 
-            scoped_lock lk(mutex);
+            AsyncLogWriter* writer = asyncWriter;
+            {
+                scoped_lock lk(mutex);
 
-            if( t ) t->write(logLevel,out);
-            if ( globalTees ) {
-                for ( unsigned i=0; i<globalTees->size(); i++ )
-                    (*globalTees)[i]->write(logLevel,out);
+                if( t ) t->write(logLevel,out);
+                if ( globalTees ) {
+                    for ( unsigned i=0; i<globalTees->size(); i++ )
+                        (*globalTees)[i]->write(logLevel,out);
+                }
+
+                if ( writer == NULL ) {
+                    writeOut( logLevel, out );
+                }
             }
-#if defined(_WIN32)
-            int fd = fileno( logfile );
-            if ( _isatty( fd ) ) {
-                fflush( logfile );
-                writeUtf8ToWindowsConsole( out.data(), out.size() );
+
+            // Dropped lines are counted by the writer.  If it has stopped,
+            // we're on our way out and write the line ourselves.
+            if ( writer != NULL && !writer->push( logLevel, out ) && writer->stopped() ) {
+                scoped_lock lk(fileMutex);
+                writeOut( logLevel, out );
             }
+        }
+        _init();
+    }
+
+    void Logstream::writeOut( LogLevel ll, const string& out ) {
+#if defined(_WIN32)
+        int fd = fileno( logfile );
+        if ( _isatty( fd ) ) {
+            fflush( logfile );
+            writeUtf8ToWindowsConsole( out.data(), out.size() );
+        }
 #else
-            if ( isSyslog ) {
-                syslog( logLevelToSysLogLevel(logLevel) , "%s" , out.data() );
-            }
+        if ( isSyslog ) {
+            syslog( logLevelToSysLogLevel(ll) , "%s" , out.c_str() );
+        }
 #endif
-            else if ( fwrite( out.data(), out.size(), 1, logfile ) ) {
-                fflush(logfile);
-            }
-            else {
-                int x = errno;
-                cout << "Failed to write to logfile: " << errnoWithDescription(x) << ": " << out << endl;
-            }
+        else if ( fwrite( out.data(), out.size(), 1, logfile ) ) {
+            fflush(logfile);
+        }
+        else {
+            int x = errno;
+            cout << "Failed to write to logfile: " << errnoWithDescription(x) << ": " << out << endl;
+        }
 #ifdef POSIX_FADV_DONTNEED
-            // This only applies to pages that have already been flushed
-            RARELY posix_fadvise(fileno(logfile), 0, 0, POSIX_FADV_DONTNEED);
+        // This only applies to pages that have already been flushed
+        RARELY posix_fadvise(fileno(logfile), 0, 0, POSIX_FADV_DONTNEED);
 #endif
+    }
+
+    void Logstream::startAsync( bool dropWhenFull, size_t capacity ) {
+        verify( asyncWriter == NULL );
+        asyncWriter = new AsyncLogWriter( dropWhenFull ? AsyncLogWriter::DROP : AsyncLogWriter::BLOCK,
+                                          capacity );
+    }
+
+    void Logstream::stopAsync() {
+        if ( asyncWriter != NULL ) {
+            // The writer stays allocated: threads still logging may hold
+            // it, and will find it stopped.
+            asyncWriter->stop();
         }
-        _init();
     }
     
     void Logstream::removeGlobalTee( Tee * tee ) {
@@ -404,6 +438,7 @@ namespace mongo {
 
     void Logstream::setLogFile(FILE* f) {
         scoped_lock lk(mutex);
+        scoped_lock flk(fileMutex);
         logfile = f;
     }
         
@@ -239,8 +239,14 @@ namespace mongo {
     };
     extern Nullstream nullstream;
 
+    class AsyncLogWriter;
+
     class Logstream : public Nullstream {
         static mongo::mutex mutex;
+        // Guards logfile against setLogFile for the async writer, which
+        // doesn't take mutex, so producers teeing lines never wait on I/O.
+        static mongo::mutex fileMutex;
+        static AsyncLogWriter* asyncWriter;
         static int doneSetup;
         std::stringstream ss;
         int indent;
@@ -283,6 +289,22 @@ namespace mongo {
 
         void flush(Tee *t = 0);
 
+        /**
+         * From now on, write log lines from a background thread, so the
+         * threads that log only wait on I/O if dropWhenFull is false and
+         * capacity lines are already waiting.  Tees still see every line
+         * before flush() returns.
+         */
+        static void startAsync(bool dropWhenFull, size_t capacity);
+        /**
+         * Write out everything queued and go back to writing synchronously.
+         * Anything about to abort() or _exit() calls this first, or the
+         * lines explaining why would still be in the queue.
+         */
+        static void stopAsync();
+        /** @return the writer, or NULL if logging synchronously */
+        static AsyncLogWriter* getAsyncWriter() { return asyncWriter; }
+
         inline Nullstream& setLogLevel(LogLevel l) {
             logLevel = l;
             return *this;
@@ -343,6 +365,10 @@ namespace mongo {
         int getIndent() const { return indent; }
 
     private:
+        friend class AsyncLogWriter;
+        // Write and flush formatted lines; callers hold mutex or fileMutex.
+        static void writeOut(LogLevel ll, const std::string& out);
+
         Logstream() {
             indent = 0;
             _init();
@@ -0,0 +1,206 @@
+// message_compressor.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_compressor.h"
+
+#include <zlib.h>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+#pragma pack(1)
+        struct CompressedHeader {
+            int originalOpcode;
+            int uncompressedSize;
+            unsigned char compressorId;
+        };
+#pragma pack()
+
+        // the most MessagingPort::recv() takes off the wire
+        const int MAX_MESSAGE_SIZE = 48000000;
+
+        const char *names[MessageCompressor::NUM_COMPRESSORS] = { "none", "zlib" };
+
+        class DirectionStats {
+        public:
+            void hit(long long bytesIn, long long bytesOut, long long micros) {
+                _messages.fetchAndAdd(1);
+                _bytesIn.fetchAndAdd(bytesIn);
+                _bytesOut.fetchAndAdd(bytesOut);
+                _micros.fetchAndAdd(micros);
+            }
+            void append(BSONObjBuilder &b, bool compressing) const {
+                const long long in = _bytesIn.load();
+                const long long out = _bytesOut.load();
+                b.appendNumber("messages", _messages.load());
+                b.appendNumber("bytesIn", in);
+                b.appendNumber("bytesOut", out);
+                // uncompressed over compressed, whichever way we went
+                const long long compressed = compressing ? out : in;
+                const long long uncompressed = compressing ? in : out;
+                b.append("ratio", compressed > 0 ? (double) uncompressed / compressed : 0.0);
+                b.appendNumber("micros", _micros.load());
+            }
+        private:
+            AtomicInt64 _messages;
+            AtomicInt64 _bytesIn;
+            AtomicInt64 _bytesOut;
+            AtomicInt64 _micros;
+        };
+
+        struct CompressorStats {
+            DirectionStats compressor;
+            DirectionStats decompressor;
+            // messages we spent the cpu on and then sent as they were
+            AtomicInt64 incompressible;
+        };
+
+        CompressorStats stats[MessageCompressor::NUM_COMPRESSORS];
+
+    } // namespace
+
+    const char *MessageCompressor::name(Id id) {
+        verify(id >= NONE && id < NUM_COMPRESSORS);
+        return names[id];
+    }
+
+    bool MessageCompressor::forName(const StringData &name, Id *id) {
+        for (int i = NONE; i < NUM_COMPRESSORS; i++) {
+            if (name == names[i]) {
+                *id = static_cast<Id>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MessageCompressor::compress(Id id, const Message &m, Message &out) {
+        verify(id == ZLIB);
+        MsgData *md = m.singleData();
+        const int bodyLen = md->dataLen();
+        if (bodyLen < MIN_COMPRESS_SIZE) {
+            return false;
+        }
+
+        Timer timer;
+        const int prefixLen = MsgDataHeaderSize + sizeof(CompressedHeader);
+        uLongf compressedLen = compressBound(bodyLen);
+        MsgData *cmd = (MsgData *) malloc(prefixLen + compressedLen);
+        verify(cmd);
+        ScopeGuard guard = MakeGuard(free, cmd);
+
+        int r = compress2(reinterpret_cast<Bytef *>(cmd) + prefixLen, &compressedLen,
+                          reinterpret_cast<const Bytef *>(md->_data), bodyLen,
+                          Z_DEFAULT_COMPRESSION);
+        if (r != Z_OK || prefixLen + compressedLen >= (uLongf) md->len) {
+            stats[id].incompressible.fetchAndAdd(1);
+            return false;
+        }
+
+        cmd->len = prefixLen + compressedLen;
+        cmd->id = md->id;
+        cmd->responseTo = md->responseTo;
+        cmd->setOperation(dbCompressed);
+        CompressedHeader *h = reinterpret_cast<CompressedHeader *>(cmd->_data);
+        h->originalOpcode = md->operation();
+        h->uncompressedSize = bodyLen;
+        h->compressorId = id;
+
+        guard.Dismiss();
+        out.setData(cmd, true);
+        stats[id].compressor.hit(bodyLen, compressedLen, timer.micros());
+        return true;
+    }
+
+    bool MessageCompressor::decompress(const Message &compressed, Message &out, string &errmsg) {
+        MsgData *cmd = compressed.singleData();
+        verify(cmd->operation() == dbCompressed);
+        if (cmd->dataLen() < (int) sizeof(CompressedHeader)) {
+            errmsg = str::stream() << "compressed message of " << cmd->len << " bytes is too short";
+            return false;
+        }
+        const CompressedHeader *h = reinterpret_cast<const CompressedHeader *>(cmd->_data);
+        if (h->compressorId != ZLIB) {
+            errmsg = str::stream() << "unknown compressor " << (int) h->compressorId;
+            return false;
+        }
+        if (h->originalOpcode == dbCompressed) {
+            errmsg = "compressed message compresses another";
+            return false;
+        }
+        if (h->uncompressedSize < 0 || h->uncompressedSize > MAX_MESSAGE_SIZE - MsgDataHeaderSize) {
+            errmsg = str::stream() << "compressed message claims " << h->uncompressedSize << " bytes";
+            return false;
+        }
+
+        Timer timer;
+        const int len = MsgDataHeaderSize + h->uncompressedSize;
+        MsgData *md = (MsgData *) malloc(std::max(len, (int) sizeof(MsgData)));
+        verify(md);
+        ScopeGuard guard = MakeGuard(free, md);
+
+        const int compressedLen = cmd->dataLen() - sizeof(CompressedHeader);
+        uLongf bodyLen = h->uncompressedSize;
+        int r = uncompress(reinterpret_cast<Bytef *>(md->_data), &bodyLen,
+                           reinterpret_cast<const Bytef *>(cmd->_data + sizeof(CompressedHeader)),
+                           compressedLen);
+        if (r != Z_OK || bodyLen != (uLongf) h->uncompressedSize) {
+            errmsg = str::stream() << "couldn't decompress message: zlib error " << r;
+            return false;
+        }
+
+        md->len = len;
+        md->id = cmd->id;
+        md->responseTo = cmd->responseTo;
+        md->setOperation(h->originalOpcode);
+
+        guard.Dismiss();
+        out.setData(md, true);
+        stats[h->compressorId].decompressor.hit(compressedLen, bodyLen, timer.micros());
+        return true;
+    }
+
+    void MessageCompressor::appendStats(BSONObjBuilder &b) {
+        for (int i = NONE + 1; i < NUM_COMPRESSORS; i++) {
+            const CompressorStats &s = stats[i];
+            BSONObjBuilder cb(b.subobjStart(names[i]));
+            {
+                BSONObjBuilder bb(cb.subobjStart("compressor"));
+                s.compressor.append(bb, true);
+                bb.appendNumber("incompressible", s.incompressible.load());
+                bb.done();
+            }
+            {
+                BSONObjBuilder bb(cb.subobjStart("decompressor"));
+                s.decompressor.append(bb, false);
+                bb.done();
+            }
+            cb.done();
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,81 @@
+// message_compressor.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class Message;
+
+    /**
+     * Compression of messages on the wire.  A compressed message has the
+     * opcode dbCompressed, the id and responseTo of the message it stands
+     * for, and in place of that message's body:
+     *
+     *   int32  the original opcode
+     *   int32  the length of the original body
+     *   uint8  the compressor id
+     *   ...    the compressed body
+     *
+     * MessagingPort decompresses on receipt, so nothing above it sees these.
+     * Anyone may always send uncompressed; a port only compresses what it
+     * sends once its peer has agreed to a compressor, through isMaster (see
+     * DBClientConnection::_connect).
+     */
+    class MessageCompressor {
+    public:
+        enum Id {
+            NONE = 0,
+            ZLIB = 1,
+            NUM_COMPRESSORS
+        };
+
+        /** bodies shorter than this aren't worth the cpu */
+        static const int MIN_COMPRESS_SIZE = 1024;
+
+        static const char *name(Id id);
+
+        /** @return false if no compressor goes by this name */
+        static bool forName(const StringData &name, Id *id);
+
+        /**
+         * Compresses m, whose header must already be filled in for sending,
+         * into out.  m must be a single buffer (see Message::concat()).
+         * @return false, leaving out empty, if m is too small to bother with
+         *         or doesn't shrink
+         */
+        static bool compress(Id id, const Message &m, Message &out);
+
+        /**
+         * Restores the message compressed stands for into out.
+         * @return false, with errmsg set, if compressed is malformed
+         */
+        static bool decompress(const Message &compressed, Message &out, std::string &errmsg);
+
+        /** bytes in and out and cpu time spent, by compressor, for serverStatus */
+        static void appendStats(BSONObjBuilder &b);
+    };
+
+} // namespace mongo
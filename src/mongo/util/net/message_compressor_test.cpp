@@ -0,0 +1,134 @@
+// message_compressor_test.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <string>
+
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+
+    void makeMessage(Message &m, int op, const std::string &body) {
+        m.setData(op, body.data(), body.size());
+        m.header()->id = 17;
+        m.header()->responseTo = 42;
+    }
+
+    std::string repetitive(size_t len) {
+        std::string s;
+        while (s.size() < len) {
+            s += "{ ns: \"test.foo\", op: \"i\", o: { _id: 1, x: \"hello\" } } ";
+        }
+        return s.substr(0, len);
+    }
+
+    TEST(MessageCompressor, Names) {
+        MessageCompressor::Id id;
+        ASSERT(MessageCompressor::forName("zlib", &id));
+        ASSERT_EQUALS(MessageCompressor::ZLIB, id);
+        ASSERT_EQUALS(std::string("zlib"), MessageCompressor::name(id));
+        ASSERT(MessageCompressor::forName("none", &id));
+        ASSERT_EQUALS(MessageCompressor::NONE, id);
+        ASSERT(!MessageCompressor::forName("lz4", &id));
+    }
+
+    TEST(MessageCompressor, RoundTrip) {
+        const std::string body = repetitive(100000);
+        Message m;
+        makeMessage(m, dbQuery, body);
+
+        Message compressed;
+        ASSERT(MessageCompressor::compress(MessageCompressor::ZLIB, m, compressed));
+        ASSERT_EQUALS(dbCompressed, compressed.operation());
+        ASSERT_LESS_THAN(compressed.size(), m.size() / 4);
+        ASSERT_EQUALS(17, (int) compressed.header()->id);
+        ASSERT_EQUALS(42, (int) compressed.header()->responseTo);
+
+        Message out;
+        std::string errmsg;
+        ASSERT(MessageCompressor::decompress(compressed, out, errmsg));
+        ASSERT_EQUALS(dbQuery, out.operation());
+        ASSERT_EQUALS(m.size(), out.size());
+        ASSERT_EQUALS(17, (int) out.header()->id);
+        ASSERT_EQUALS(42, (int) out.header()->responseTo);
+        ASSERT_EQUALS(body, std::string(out.singleData()->_data, out.singleData()->dataLen()));
+    }
+
+    TEST(MessageCompressor, SkipsWhatDoesntPay) {
+        Message small;
+        makeMessage(small, dbQuery, repetitive(MessageCompressor::MIN_COMPRESS_SIZE - 1));
+        Message out;
+        ASSERT(!MessageCompressor::compress(MessageCompressor::ZLIB, small, out));
+        ASSERT(out.empty());
+
+        std::string noise(10000, '\0');
+        srand(5);
+        for (size_t i = 0; i < noise.size(); i++) {
+            noise[i] = (char) rand();
+        }
+        Message random;
+        makeMessage(random, dbQuery, noise);
+        ASSERT(!MessageCompressor::compress(MessageCompressor::ZLIB, random, out));
+        ASSERT(out.empty());
+    }
+
+    TEST(MessageCompressor, RejectsCorruption) {
+        Message m;
+        makeMessage(m, opReply, repetitive(10000));
+        Message compressed;
+        ASSERT(MessageCompressor::compress(MessageCompressor::ZLIB, m, compressed));
+
+        // the claimed length no longer matches the body
+        MsgData *md = compressed.singleData();
+        int *uncompressedSize = reinterpret_cast<int *>(md->_data + sizeof(int));
+        *uncompressedSize += 1;
+        Message out;
+        std::string errmsg;
+        ASSERT(!MessageCompressor::decompress(compressed, out, errmsg));
+        ASSERT(out.empty());
+        ASSERT(!errmsg.empty());
+
+        // nor does a compressor we don't know
+        *uncompressedSize -= 1;
+        md->_data[2 * sizeof(int)] = 99;
+        ASSERT(!MessageCompressor::decompress(compressed, out, errmsg));
+        ASSERT(out.empty());
+    }
+
+    TEST(MessageCompressor, Stats) {
+        Message m;
+        makeMessage(m, opReply, repetitive(10000));
+        Message compressed;
+        ASSERT(MessageCompressor::compress(MessageCompressor::ZLIB, m, compressed));
+        Message out;
+        std::string errmsg;
+        ASSERT(MessageCompressor::decompress(compressed, out, errmsg));
+
+        BSONObjBuilder b;
+        MessageCompressor::appendStats(b);
+        BSONObj o = b.obj();
+        BSONObj zlib = o["zlib"].Obj();
+        ASSERT_LESS_THAN(0, zlib["compressor"]["messages"].numberLong());
+        ASSERT_LESS_THAN(1.0, zlib["compressor"]["ratio"].numberDouble());
+        ASSERT_LESS_THAN(0, zlib["decompressor"]["messages"].numberLong());
+    }
+
+} // namespace
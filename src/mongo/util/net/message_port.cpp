@@ -30,6 +30,7 @@
 #include "../time_support.h"
 #include "../../db/cmdline.h"
 #include "../scopeguard.h"
+#include "../tracepoint.h"
 
 
 #ifndef _WIN32
@@ -42,6 +43,10 @@
 
 namespace mongo {
 
+    // Reading a message is timed from when its length arrives, so waiting
+    // for the client to send the next one doesn't count.
+    MONGO_TRACEPOINT_DECLARE(messageRecv);
+    MONGO_TRACEPOINT_DECLARE(messageSend);
 
 // if you want trace output:
 #define mmm(x)
@@ -126,18 +131,19 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0),
+          _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, int ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ) , _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
     }
 
@@ -198,9 +204,21 @@ again:
             char *p = (char *) &md->id;
             int left = len -4;
 
-            psock->recv( p, left );
+            {
+                MONGO_TRACE(messageRecv);
+                psock->recv( p, left );
+            }
 
             guard.Dismiss();
+            if ( md->operation() == dbCompressed ) {
+                Message compressed( md, true );
+                string errmsg;
+                if ( ! MessageCompressor::decompress( compressed, m, errmsg ) ) {
+                    LOG(0) << "recv(): bad compressed message from " << remote() << ": " << errmsg << endl;
+                    return false;
+                }
+                return true;
+            }
             m.setData(md, true);
             return true;
 
@@ -256,20 +274,29 @@ again:
         toSend.header()->id = nextMessageId();
         toSend.header()->responseTo = responseTo;
 
+        Message compressed;
+        if ( _compressor != MessageCompressor::NONE &&
+             toSend.size() - MsgDataHeaderSize >= MessageCompressor::MIN_COMPRESS_SIZE ) {
+            toSend.concat();
+            MessageCompressor::compress( _compressor, toSend, compressed );
+        }
+        Message &m = compressed.empty() ? toSend : compressed;
+
+        MONGO_TRACE(messageSend);
         if ( piggyBackData && piggyBackData->len() ) {
             mmm( log() << "*     have piggy back" << endl; )
-            if ( ( piggyBackData->len() + toSend.header()->len ) > 1300 ) {
+            if ( ( piggyBackData->len() + m.header()->len ) > 1300 ) {
                 // won't fit in a packet - so just send it off
                 piggyBackData->flush();
             }
             else {
-                piggyBackData->append( toSend );
+                piggyBackData->append( m );
                 piggyBackData->flush();
                 return;
             }
         }
 
-        toSend.send( *this, "say" );
+        m.send( *this, "say" );
     }
 
     void MessagingPort::piggyBack( Message& toSend , int responseTo ) {
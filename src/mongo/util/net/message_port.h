@@ -19,6 +19,7 @@
 
 #include "sock.h"
 #include "message.h"
+#include "message_compressor.h"
 
 namespace mongo {
 
@@ -40,6 +41,9 @@ namespace mongo {
         long long connectionId() const { return _connectionId; }
         void setConnectionId( long long connectionId );
 
+        /** compress what we send from now on, the peer having agreed to it */
+        virtual void setCompressor( MessageCompressor::Id id ) { }
+
     public:
         // TODO make this private with some helpers
 
@@ -90,6 +94,9 @@ namespace mongo {
 
         void piggyBack( Message& toSend , int responseTo = -1 );
 
+        virtual void setCompressor( MessageCompressor::Id id ) { _compressor = id; }
+        MessageCompressor::Id compressor() const { return _compressor; }
+
         unsigned remotePort() const { return psock->remotePort(); }
         virtual HostAndPort remote() const;
 
@@ -114,6 +121,8 @@ namespace mongo {
     private:
         
         PiggyBackData * piggyBackData;
+
+        MessageCompressor::Id _compressor;
         
         // this is the parsed version of remote
         // mutable because its initialized only on call to remote()
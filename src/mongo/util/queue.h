@@ -68,6 +68,22 @@ namespace mongo {
             _cvNoLongerEmpty.notify_one();
         }
 
+        /**
+         * like push, but returns false instead of waiting if there's no room
+         * for t
+         */
+        bool tryPush(T const& t) {
+            scoped_lock l( _lock );
+            size_t tSize = _getSize(t);
+            if (_currentSize + tSize >= _maxSize) {
+                return false;
+            }
+            _queue.push( t );
+            _currentSize += tSize;
+            _cvNoLongerEmpty.notify_one();
+            return true;
+        }
+
         bool empty() const {
             scoped_lock l( _lock );
             return _queue.empty();
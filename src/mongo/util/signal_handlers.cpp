@@ -107,6 +107,8 @@ namespace mongo {
     }
 
     void printStackAndExit( int signalNum ) {
+        // What was queued before the signal goes ahead of the backtrace.
+        Logstream::stopAsync();
         int fd = Logstream::getLogDesc();
 
         if ( fd >= 0 ) {
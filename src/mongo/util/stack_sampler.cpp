@@ -0,0 +1,178 @@
+// stack_sampler.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/util/stack_sampler.h"
+
+#include "mongo/platform/atomic_word.h"
+
+#if defined(MONGO_HAVE_EXECINFO_BACKTRACE)
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "mongo/util/stacktrace.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace {
+
+        const int maxFrames = 48;
+        // getStackFrames, the handler and the kernel's signal trampoline
+        const int samplerFrames = 3;
+        // about 20MB of samples
+        const size_t maxSamples = 50000;
+
+        struct Sample {
+            AtomicWord<unsigned> done;
+            int depth;
+            void* frames[maxFrames];
+        };
+
+        AtomicWord<unsigned> running;
+
+        // Set up by run() before the timer starts, and left alone until no
+        // handler can be looking at them.
+        Sample* samples = NULL;
+        size_t capacity = 0;
+        AtomicWord<unsigned long long> next;
+        AtomicWord<unsigned> active;
+        AtomicWord<unsigned> inHandler;
+
+        void onSample(int) {
+            const int savedErrno = errno;
+            inHandler.fetchAndAdd(1);
+            if (active.load()) {
+                const unsigned long long i = next.fetchAndAdd(1);
+                if (i < capacity) {
+                    Sample& s = samples[i];
+                    s.depth = getStackFrames(s.frames, maxFrames);
+                    s.done.store(1);
+                }
+            }
+            inHandler.fetchAndSubtract(1);
+            errno = savedErrno;
+        }
+
+        void setTimer(int hz) {
+            struct itimerval tv;
+            tv.it_interval.tv_sec = 0;
+            tv.it_interval.tv_usec = hz > 0 ? 1000000 / hz : 0;
+            tv.it_value = tv.it_interval;
+            setitimer(ITIMER_PROF, &tv, NULL);
+        }
+
+        void fold(size_t n, StackSampler::Profile& out) {
+            std::map<void*, std::string> names;
+            for (size_t i = 0; i < n; i++) {
+                const Sample& s = samples[i];
+                if (!s.done.load()) {
+                    continue;
+                }
+                std::string stack;
+                for (int f = s.depth - 1; f >= samplerFrames; f--) {
+                    std::map<void*, std::string>::iterator it = names.find(s.frames[f]);
+                    if (it == names.end()) {
+                        it = names.insert(make_pair(s.frames[f], getFrameName(s.frames[f]))).first;
+                    }
+                    if (!stack.empty()) {
+                        stack += ';';
+                    }
+                    stack += it->second;
+                }
+                if (!stack.empty()) {
+                    out.stacks[stack]++;
+                    out.samples++;
+                }
+            }
+        }
+
+    } // namespace
+
+    bool StackSampler::run(int millis, int hz, Profile& out, std::string& errmsg) {
+        if (running.compareAndSwap(0, 1) != 0) {
+            errmsg = "a stack profile is already running";
+            return false;
+        }
+
+        // backtrace() loads libgcc the first time through, which mustn't
+        // happen in a signal handler
+        void* warmup[1];
+        getStackFrames(warmup, 1);
+
+        // one sample per CPU per tick is the most we can get
+        const long cpus = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+        const size_t wanted = (size_t) ((long long) hz * millis / 1000 + 1) * cpus;
+        std::vector<Sample> buffer(std::min(wanted, maxSamples));
+        samples = &buffer[0];
+        capacity = buffer.size();
+        next.store(0);
+        active.store(1);
+
+        struct sigaction sa;
+        struct sigaction old;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = onSample;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGPROF, &sa, &old);
+        setTimer(hz);
+
+        sleepmillis(millis);
+
+        setTimer(0);
+        // Don't put back SIGPROF's default action, a straggler would kill us.
+        if (old.sa_handler == SIG_DFL) {
+            old.sa_handler = SIG_IGN;
+        }
+        sigaction(SIGPROF, &old, NULL);
+        // A full barrier, so a handler that comes in after we see no one is
+        // in one will see that it's too late.
+        active.compareAndSwap(1, 0);
+        while (inHandler.load() != 0) {
+            sleepmillis(1);
+        }
+
+        const unsigned long long taken = next.load();
+        out.lost += taken > capacity ? taken - capacity : 0;
+        fold(std::min((size_t) taken, capacity), out);
+
+        samples = NULL;
+        capacity = 0;
+        running.store(0);
+        return true;
+    }
+
+} // namespace mongo
+
+#else
+
+namespace mongo {
+
+    bool StackSampler::run(int millis, int hz, Profile& out, std::string& errmsg) {
+        errmsg = "stack sampling is not supported on this platform";
+        return false;
+    }
+
+} // namespace mongo
+
+#endif
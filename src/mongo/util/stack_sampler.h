@@ -0,0 +1,54 @@
+// stack_sampler.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace mongo {
+
+    /**
+     * An in-process sampling profiler.  A CPU-time interval timer (SIGPROF)
+     * interrupts whichever threads are running, the signal handler grabs
+     * their stacks with getStackFrames(), and at the end the stacks are
+     * named and folded, ready for flamegraph.pl.
+     */
+    class StackSampler {
+    public:
+        struct Profile {
+            Profile() : samples(0), lost(0) {}
+            // stacks caught
+            long long samples;
+            // stacks missed because the sample buffer was full
+            long long lost;
+            // "outermost;...;innermost" frame names -> times seen
+            std::map<std::string, long long> stacks;
+        };
+
+        /**
+         * Sample running threads hz times per CPU-second for millis, and
+         * fold what was seen into out.  Blocks for millis.  Only one
+         * profile runs at a time.
+         * @return false, with errmsg set, if another profile is running or
+         *         this platform can't sample
+         */
+        static bool run(int millis, int hz, Profile& out, std::string& errmsg);
+    };
+
+} // namespace mongo
@@ -22,7 +22,9 @@
 
 #ifdef MONGO_HAVE_EXECINFO_BACKTRACE
 
+#include <cxxabi.h>
 #include <execinfo.h>
+#include <sstream>
 
 namespace mongo {
     static const int maxBackTraceFrames = 20;
@@ -49,6 +51,41 @@ namespace mongo {
         os.flush();
         ::free( strings );
     }
+
+    int getStackFrames( void** frames, int maxFrames ) {
+        return ::backtrace( frames, maxFrames );
+    }
+
+    std::string getFrameName( void* addr ) {
+        char **strings = ::backtrace_symbols( &addr, 1 );
+        std::string symbol( strings ? strings[0] : "" );
+        ::free( strings );
+
+        // "module(mangled+0x1f) [0x4a2b3c]"
+        std::string::size_type open = symbol.find( '(' );
+        std::string::size_type plus = symbol.find( '+', open );
+        if ( open != std::string::npos && plus != std::string::npos && plus > open + 1 ) {
+            std::string mangled = symbol.substr( open + 1, plus - open - 1 );
+            int status = 0;
+            char *demangled = abi::__cxa_demangle( mangled.c_str(), NULL, NULL, &status );
+            if ( demangled ) {
+                std::string name( demangled );
+                ::free( demangled );
+                return name;
+            }
+            return mangled;
+        }
+        if ( open != std::string::npos && open > 0 ) {
+            // no symbol, but we know the module
+            std::string module = symbol.substr( 0, open );
+            std::string::size_type slash = module.rfind( '/' );
+            return slash == std::string::npos ? module : module.substr( slash + 1 );
+        }
+
+        std::stringstream ss;
+        ss << addr;
+        return ss.str();
+    }
 }
 
 #elif defined(_WIN32)
@@ -289,12 +326,34 @@ namespace mongo {
             log() << ss.str() << std::endl;
         }
     }
+
+    int getStackFrames( void** frames, int maxFrames ) {
+        return RtlCaptureStackBackTrace( 0, maxFrames, frames, NULL );
+    }
+
+    std::string getFrameName( void* addr ) {
+        std::stringstream ss;
+        ss << addr;
+        return ss.str();
+    }
 }
 
 #else
 
+#include <sstream>
+
 namespace mongo {
     void printStackTrace( std::ostream &os ) {}
+
+    int getStackFrames( void** frames, int maxFrames ) {
+        return 0;
+    }
+
+    std::string getFrameName( void* addr ) {
+        std::stringstream ss;
+        ss << addr;
+        return ss.str();
+    }
 }
 
 #endif
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 
 #include "mongo/platform/basic.h"
 
@@ -15,6 +16,17 @@ namespace mongo {
     // Print stack trace information to "os", default to std::cout.
     void printStackTrace(std::ostream &os=std::cout);
 
+    /**
+     * Fill frames with the return addresses on the current thread's stack,
+     * innermost first.  Safe to call from a signal handler, once it has
+     * been called at least once outside of one.
+     * @return the number of frames filled in, 0 where unsupported
+     */
+    int getStackFrames(void** frames, int maxFrames);
+
+    /** The (demangled) name of the function containing addr, or addr in hex. */
+    std::string getFrameName(void* addr);
+
 #if defined(_WIN32)
     // Print stack trace (using a specified stack context) to "os", default to std::cout.
     void printWindowsStackTrace(CONTEXT &context, std::ostream &os=std::cout);
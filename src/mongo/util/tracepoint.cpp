@@ -0,0 +1,65 @@
+// tracepoint.cpp
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/util/tracepoint.h"
+
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    AtomicWord<unsigned> Tracepoint::_enabled;
+
+    void Tracepoint::append(BSONObjBuilder& b) const {
+        LatencyDistribution d;
+        _latency.addTo(d);
+        d.appendSummary(b);
+    }
+
+    namespace {
+        TracepointMap* tracepoints = NULL;
+        bool frozen = false;
+    }
+
+    MONGO_INITIALIZER(TracepointRegistry)(InitializerContext* context) {
+        tracepoints = new TracepointMap();
+        return Status::OK();
+    }
+
+    MONGO_INITIALIZER_GENERAL(AllTracepointsRegistered, (), ())(InitializerContext* context) {
+        frozen = true;
+        return Status::OK();
+    }
+
+    Status registerTracepoint(const std::string& name, Tracepoint* tp) {
+        if (frozen) {
+            return Status(ErrorCodes::CannotMutateObject, "Tracepoint registry is already frozen");
+        }
+        if (!tracepoints->insert(make_pair(name, tp)).second) {
+            return Status(ErrorCodes::DuplicateKey,
+                          mongoutils::str::stream() << "Tracepoint already registered: " << name);
+        }
+        return Status::OK();
+    }
+
+    const TracepointMap& getTracepoints() {
+        return *tracepoints;
+    }
+
+} // namespace mongo
@@ -0,0 +1,103 @@
+// tracepoint.h
+
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/base/init.h"
+#include "mongo/base/status.h"
+#include "mongo/db/stats/latency_histogram.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    /**
+     * A named spot on a hot path (taking a lock, a ydb call, reading a
+     * message) that, while tracing is on, keeps a latency histogram of the
+     * time spent there.  While tracing is off, passing a tracepoint costs a
+     * load and a branch.
+     *
+     * Tracing is switched on and off for all tracepoints at once, with the
+     * tracepoints command.
+     */
+    class Tracepoint : boost::noncopyable {
+    public:
+        static bool enabled() { return _enabled.load() != 0; }
+        static void setEnabled(bool on) { _enabled.store(on ? 1 : 0); }
+
+        void record(unsigned long long micros) { _latency.record(micros); }
+        void reset() { _latency.reset(); }
+
+        /** count, total and percentiles of the time spent here */
+        void append(BSONObjBuilder& b) const;
+
+    private:
+        static AtomicWord<unsigned> _enabled;
+        StripedLatencyHistogram _latency;
+    };
+
+    /**
+     * Times the rest of its scope into a tracepoint, if tracing was on when
+     * it began.
+     */
+    class TracepointScope : boost::noncopyable {
+    public:
+        explicit TracepointScope(Tracepoint& tp) :
+            _tp(Tracepoint::enabled() ? &tp : NULL),
+            _start(_tp != NULL ? curTimeMicros64() : 0) {
+        }
+        ~TracepointScope() {
+            if (_tp != NULL) {
+                _tp->record(curTimeMicros64() - _start);
+            }
+        }
+    private:
+        Tracepoint* const _tp;
+        const unsigned long long _start;
+    };
+
+    typedef std::map<std::string, Tracepoint*> TracepointMap;
+
+    /**
+     * Adds a tracepoint to the registry.  Duplicate names are not allowed,
+     * and nothing may be added once all declared tracepoints are in.
+     */
+    Status registerTracepoint(const std::string& name, Tracepoint* tp);
+
+    /** every registered tracepoint, by name */
+    const TracepointMap& getTracepoints();
+
+    /**
+     * Declares a tracepoint.  Like MONGO_FP_DECLARE, must be used in global
+     * scope, never inside a function.
+     */
+    #define MONGO_TRACEPOINT_DECLARE(tp) ::mongo::Tracepoint tp; \
+        MONGO_INITIALIZER_GENERAL(Tracepoint_##tp, ("TracepointRegistry"), ("AllTracepointsRegistered")) \
+                (::mongo::InitializerContext* context) { \
+            return ::mongo::registerTracepoint(#tp, &tp); \
+        }
+
+    /** Times the rest of the enclosing scope into tracepoint tp. */
+    #define MONGO_TRACE(tp) ::mongo::TracepointScope tp##Scope(tp)
+
+} // namespace mongo